@@ -0,0 +1,152 @@
+/**
+ * Benchmark of auditing a policy over a large directory tree
+ *
+ * A tree of directories with empty files is created in the temporary
+ * directory and audited with an increasing number of threads. The first run
+ * also warms the dentry cache, so it is reported separately.
+ *
+ * Usage: audit_bench [directories] [files per directory]
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <ll/ActionType.hpp>
+#include <ll/Policy.hpp>
+#include <ll/PolicyAudit.hpp>
+
+namespace
+{
+constexpr long DEFAULT_DIRS = 2000;
+constexpr long DEFAULT_FILES = 100;
+/// Number of subdirectories of each directory
+constexpr long FANOUT = 10;
+
+using Clock = std::chrono::steady_clock;
+namespace fs = std::filesystem;
+
+/**
+ * Create dirs directories in a tree with FANOUT children per directory
+ */
+bool create_tree(const fs::path& root, long dirs, long files)
+{
+	std::error_code ec;
+	for (long i = 0; i < dirs; ++i) {
+		fs::path dir = root;
+		for (long rest = i; rest > 0; rest /= FANOUT) {
+			dir /= std::to_string(rest % FANOUT);
+		}
+		dir /= "d" + std::to_string(i);
+		fs::create_directories(dir, ec);
+		if (ec) {
+			return false;
+		}
+		for (long j = 0; j < files; ++j) {
+			const int fd = ::open(
+				(dir / std::to_string(j)).c_str(),
+				O_WRONLY | O_CREAT | O_CLOEXEC,
+				0600 // NOLINT(*-magic-numbers)
+			);
+			if (fd < 0) {
+				return false;
+			}
+			::close(fd);
+		}
+	}
+	return true;
+}
+
+void report(
+	const char* name, std::size_t threads, double seconds, double entries
+)
+{
+	std::printf(
+		"%-6s %3zu threads %8.3f s %12.0f entries/s\n",
+		name,
+		threads,
+		seconds,
+		entries / seconds
+	);
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+	const long dirs =
+		argc > 1 ? std::strtol(argv[1], nullptr, 10) : DEFAULT_DIRS;
+	const long files =
+		argc > 2 ? std::strtol(argv[2], nullptr, 10) : DEFAULT_FILES;
+	if (dirs <= 0 || files < 0) {
+		std::fprintf(
+			stderr,
+			"usage: %s [directories] [files per directory]\n",
+			argv[0]
+		);
+		return EXIT_FAILURE;
+	}
+
+	const fs::path root =
+		fs::temp_directory_path() /
+		("llpp-audit-bench-" + std::to_string(::getpid()));
+	if (not create_tree(root, dirs, files)) {
+		std::fprintf(
+			stderr, "cannot create tree in %s\n", root.c_str()
+		);
+		return EXIT_FAILURE;
+	}
+
+	landlock::Policy policy;
+	policy.handle(landlock::action::FS_READ_FILE)
+		.allow(root / "1", landlock::action::FS_READ_FILE);
+	landlock::PolicyAudit audit;
+	std::error_code ec;
+	audit.add_layer(policy, ec);
+
+	const auto measure = [&](const char* name, std::size_t threads) {
+		landlock::PolicyAudit::Options options;
+		options.threads = threads;
+		const auto start = Clock::now();
+		const landlock::PolicyAudit::Report result =
+			audit.run({root}, options, ec);
+		const std::chrono::duration<double> elapsed =
+			Clock::now() - start;
+		if (ec) {
+			return;
+		}
+		double entries = 0;
+		for (const auto& [access, counts] : result.by_access) {
+			entries +=
+				static_cast<double>(counts.dirs + counts.files);
+		}
+		report(name, threads, elapsed.count(), entries);
+	};
+
+	const std::size_t cpus =
+		std::max(1U, std::thread::hardware_concurrency());
+	if (not ec) {
+		measure("cold", cpus);
+	}
+	for (std::size_t threads = 1; not ec; threads *= 2) {
+		measure("warm", std::min(threads, cpus));
+		if (threads >= cpus) {
+			break;
+		}
+	}
+
+	int res = EXIT_SUCCESS;
+	if (ec) {
+		std::fprintf(stderr, "audit: %s\n", ec.message().c_str());
+		res = EXIT_FAILURE;
+	}
+
+	fs::remove_all(root, ec);
+	return res;
+}
@@ -0,0 +1,183 @@
+/**
+ * Benchmark of the overhead of the llpp-learn interposer
+ *
+ * Runs itself twice, once without and once with the interposer preloaded, and
+ * times opening and closing a file in several threads. With the interposer,
+ * each open writes a record to the ring of the calling thread; the trace is
+ * written to a temporary file.
+ *
+ * Usage: learn_bench PRELOAD [iterations] [threads] [path]
+ */
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+constexpr long DEFAULT_ITERATIONS = 200000;
+constexpr long DEFAULT_THREADS = 4;
+constexpr const char* CHILD_ARG = "--child";
+
+/**
+ * Open and close path iterations times in each of threads threads
+ *
+ * @return Nanoseconds per open and close, or a negative value on failure
+ */
+double measure(long iterations, long threads, const char* path)
+{
+	std::vector<std::thread> workers;
+	std::vector<int> failed(static_cast<std::size_t>(threads), 0);
+	const auto start = std::chrono::steady_clock::now();
+	for (long thr = 0; thr < threads; ++thr) {
+		workers.emplace_back([&failed, thr, iterations, path] {
+			for (long i = 0; i < iterations; ++i) {
+				const int fd =
+					::open(path, O_RDONLY | O_CLOEXEC);
+				if (fd < 0) {
+					failed.at(static_cast<std::size_t>(thr)
+					) = 1;
+					return;
+				}
+				::close(fd);
+			}
+		});
+	}
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+	const std::chrono::duration<double, std::nano> elapsed =
+		std::chrono::steady_clock::now() - start;
+	for (const int fail : failed) {
+		if (fail != 0) {
+			return -1;
+		}
+	}
+	return elapsed.count() / static_cast<double>(iterations);
+}
+
+/**
+ * Run this program as a child with the given environment
+ *
+ * @return The child's result, or a negative value on failure
+ */
+double run(char** argv, const std::vector<std::string>& env)
+{
+	std::array<int, 2> fds{};
+	if (::pipe(fds.data()) != 0) {
+		return -1;
+	}
+
+	const pid_t pid = ::fork();
+	if (pid < 0) {
+		return -1;
+	}
+	if (pid == 0) {
+		::close(fds[0]);
+		::dup2(fds[1], STDOUT_FILENO);
+		for (const std::string& var : env) {
+			::putenv(const_cast<char*>(var.c_str())); // NOLINT
+		}
+		std::vector<char*> args{argv[0], const_cast<char*>(CHILD_ARG)};
+		for (int i = 2; i < 5; ++i) {
+			args.push_back(argv[i]);
+		}
+		args.push_back(nullptr);
+		::execv("/proc/self/exe", args.data());
+		::_exit(EXIT_FAILURE);
+	}
+
+	::close(fds[1]);
+	std::array<char, 64> buf{};
+	const ssize_t len = ::read(fds[0], buf.data(), buf.size() - 1);
+	::close(fds[0]);
+	int status = 0;
+	::waitpid(pid, &status, 0);
+	if (len <= 0 || not WIFEXITED(status) ||
+	    WEXITSTATUS(status) != EXIT_SUCCESS) {
+		return -1;
+	}
+	return std::strtod(buf.data(), nullptr);
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+	if (argc == 5 && std::strcmp(argv[1], CHILD_ARG) == 0) {
+		const double res = measure(
+			std::strtol(argv[2], nullptr, 10),
+			std::strtol(argv[3], nullptr, 10),
+			argv[4]
+		);
+		// NOLINTNEXTLINE(*-vararg)
+		std::printf("%f\n", res);
+		return res < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+	}
+
+	if (argc < 2) {
+		std::fprintf(
+			stderr,
+			"usage: %s PRELOAD [iterations] [threads] [path]\n",
+			argv[0]
+		);
+		return EXIT_FAILURE;
+	}
+	const std::string iterations =
+		argc > 2 ? argv[2] : std::to_string(DEFAULT_ITERATIONS);
+	const std::string threads =
+		argc > 3 ? argv[3] : std::to_string(DEFAULT_THREADS);
+	const std::string path = argc > 4 ? argv[4] : "/etc/hostname";
+	if (std::strtol(iterations.c_str(), nullptr, 10) <= 0 ||
+	    std::strtol(threads.c_str(), nullptr, 10) <= 0) {
+		std::fprintf(stderr, "invalid iterations or threads\n");
+		return EXIT_FAILURE;
+	}
+
+	const char* tmpdir = std::getenv("TMPDIR");
+	std::string trace = std::string{tmpdir != nullptr ? tmpdir : "/tmp"} +
+			    "/learn_bench-XXXXXX";
+	const int trace_fd = ::mkstemp(trace.data());
+	if (trace_fd < 0) {
+		std::perror("mkstemp");
+		return EXIT_FAILURE;
+	}
+	::close(trace_fd);
+
+	std::vector<char*> args{
+		argv[0],
+		argv[1],
+		const_cast<char*>(iterations.c_str()), // NOLINT
+		const_cast<char*>(threads.c_str()),    // NOLINT
+		const_cast<char*>(path.c_str()),       // NOLINT
+	};
+	const double plain = run(args.data(), {});
+	const std::vector<std::string> env{
+		std::string{"LD_PRELOAD="} + argv[1],
+		"LLPP_LEARN_TRACE=" + trace,
+	};
+	const double learning = run(args.data(), env);
+	::unlink(trace.c_str());
+	if (plain < 0 || learning < 0) {
+		std::fprintf(stderr, "run failed\n");
+		return EXIT_FAILURE;
+	}
+
+	std::printf(
+		"%s opens of %s in each of %s threads\n",
+		iterations.c_str(),
+		path.c_str(),
+		threads.c_str()
+	);
+	std::printf("%-20s %10.1f ns/op\n", "plain", plain);
+	std::printf("%-20s %10.1f ns/op\n", "learning", learning);
+	std::printf("%-20s %10.1f ns/op\n", "overhead", learning - plain);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,150 @@
+/**
+ * Benchmark of the cost of denied accesses with and without audit logging
+ *
+ * Each configuration runs in a forked child which enforces a ruleset denying
+ * reading files and then repeatedly tries to open a file. The flags passed to
+ * landlock_restrict_self control whether the kernel logs these denials.
+ *
+ * The logging overhead is only visible if audit is enabled (auditctl -e 1).
+ *
+ * Usage: logging_bench [iterations] [path]
+ */
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <ll/ActionType.hpp>
+#include <ll/RestrictFlag.hpp>
+#include <ll/Ruleset.hpp>
+
+namespace
+{
+constexpr long DEFAULT_ITERATIONS = 100000;
+
+struct Config {
+	const char* name;
+	landlock::Ruleset::RestrictFlagVec flags;
+};
+
+/**
+ * Enforce a ruleset with flags and time denied opens of path
+ *
+ * @return Nanoseconds per attempt, or a negative value on failure
+ */
+double run_child(const Config& config, long iterations, const char* path)
+{
+	std::error_code ec;
+	const landlock::Ruleset ruleset{
+		{landlock::action::FS_READ_FILE}, {}, {}, ec
+	};
+	ruleset.enforce(true, config.flags, ec);
+	if (ec || not ruleset.landlock_enabled()) {
+		return -1;
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	for (long i = 0; i < iterations; ++i) {
+		const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+		if (fd >= 0) {
+			::close(fd);
+			return -1;
+		}
+	}
+	const std::chrono::duration<double, std::nano> elapsed =
+		std::chrono::steady_clock::now() - start;
+	return elapsed.count() / static_cast<double>(iterations);
+}
+
+/**
+ * Run config in a forked child, reporting the result through a pipe
+ */
+double run(const Config& config, long iterations, const char* path)
+{
+	std::array<int, 2> fds{};
+	if (::pipe(fds.data()) != 0) {
+		return -1;
+	}
+
+	const pid_t pid = ::fork();
+	if (pid < 0) {
+		return -1;
+	}
+	if (pid == 0) {
+		::close(fds[0]);
+		const double res = run_child(config, iterations, path);
+		const bool ok = ::write(fds[1], &res, sizeof(res)) ==
+				static_cast<ssize_t>(sizeof(res));
+		::_exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	::close(fds[1]);
+	double res = -1;
+	const ssize_t len = ::read(fds[0], &res, sizeof(res));
+	if (len != static_cast<ssize_t>(sizeof(res))) {
+		res = -1;
+	}
+	::close(fds[0]);
+	::waitpid(pid, nullptr, 0);
+	return res;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+	const long iterations = argc > 1 ? std::strtol(argv[1], nullptr, 10)
+					 : DEFAULT_ITERATIONS;
+	const char* path = argc > 2 ? argv[2] : "/etc/hostname";
+	if (iterations <= 0) {
+		std::fprintf(
+			stderr, "usage: %s [iterations] [path]\n", argv[0]
+		);
+		return EXIT_FAILURE;
+	}
+
+	std::error_code ec;
+	const landlock::Ruleset probe{
+		{landlock::action::FS_READ_FILE}, {}, {}, ec
+	};
+	if (ec || not probe.landlock_enabled()) {
+		std::printf("Landlock is not available, skipping\n");
+		return EXIT_SUCCESS;
+	}
+	const bool flags_supported =
+		landlock::restrict_flag::LOG_SAME_EXEC_OFF.type_code() != 0 &&
+		probe.abi_version() >= 7;
+	if (not flags_supported) {
+		std::printf(
+			"Logging flags are not supported (ABI %d, built for "
+			"API %d), all configurations log alike\n",
+			probe.abi_version(),
+			LLPP_BUILD_LANDLOCK_API
+		);
+	}
+
+	const std::vector<Config> configs{
+		{"default logging", {}},
+		{"LOG_SAME_EXEC_OFF",
+		 {landlock::restrict_flag::LOG_SAME_EXEC_OFF}},
+	};
+
+	std::printf("%ld denied opens of %s\n", iterations, path);
+	for (const Config& config : configs) {
+		const double ns = run(config, iterations, path);
+		if (ns < 0) {
+			std::fprintf(stderr, "%s: run failed\n", config.name);
+			return EXIT_FAILURE;
+		}
+		std::printf("%-20s %10.1f ns/op\n", config.name, ns);
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,204 @@
+/**
+ * Benchmark of the request latency with and without a worker pool
+ *
+ * Each request is answered by a sandboxed worker process which echoes a byte.
+ * Without a pool, the worker is forked and enforces its ruleset on the request
+ * path. With a pool, an idle worker which already enforced the ruleset is
+ * leased. Requests are spaced by a pause, which gives the pool time to refill
+ * as under moderate load.
+ *
+ * Usage: pool_bench [requests] [pause in us]
+ */
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <ll/ActionType.hpp>
+#include <ll/Policy.hpp>
+#include <ll/Ruleset.hpp>
+#include <ll/WorkerPool.hpp>
+
+namespace
+{
+constexpr long DEFAULT_REQUESTS = 500;
+constexpr long DEFAULT_PAUSE_US = 2000;
+constexpr std::size_t POOL_SIZE = 4;
+constexpr double PERCENTILE_99 = 0.99;
+
+using Clock = std::chrono::steady_clock;
+using Request = std::function<bool()>;
+
+landlock::Policy policy()
+{
+	landlock::Policy res;
+	res.handle(landlock::action::FS_READ_FILE)
+		.handle(landlock::action::FS_WRITE_FILE)
+		.allow("/usr", landlock::action::FS_READ_FILE);
+	return res;
+}
+
+int echo_main(int sock)
+{
+	char byte = 0;
+	while (::recv(sock, &byte, 1, 0) == 1) {
+		if (::send(sock, &byte, 1, MSG_NOSIGNAL) != 1) {
+			return EXIT_FAILURE;
+		}
+	}
+	return EXIT_SUCCESS;
+}
+
+bool echo(int sock)
+{
+	char byte = 'x';
+	return ::send(sock, &byte, 1, MSG_NOSIGNAL) == 1 &&
+	       ::recv(sock, &byte, 1, 0) == 1 && byte == 'x';
+}
+
+/**
+ * Fork a worker which builds and enforces the ruleset, then answers
+ */
+bool fork_request()
+{
+	std::array<int, 2> socks{};
+	if (::socketpair(
+		    AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, socks.data()
+	    ) != 0) {
+		return false;
+	}
+
+	const pid_t pid = ::fork();
+	if (pid == 0) {
+		::close(socks[0]);
+		std::error_code ec;
+		const auto ruleset =
+			policy().build(landlock::Backend::system(), ec);
+		if (not ec) {
+			ruleset->enforce(true, ec);
+		}
+		::_exit(ec ? EXIT_FAILURE : echo_main(socks[1]));
+	}
+
+	::close(socks[1]);
+	const bool res = pid > 0 && echo(socks[0]);
+	::close(socks[0]);
+	if (pid > 0) {
+		::waitpid(pid, nullptr, 0);
+	}
+	return res;
+}
+
+/**
+ * Time requests, returning the sorted latencies in microseconds
+ */
+std::vector<double>
+measure(const Request& request, long requests, std::chrono::microseconds pause)
+{
+	std::vector<double> res;
+	res.reserve(static_cast<std::size_t>(requests));
+	for (long i = 0; i < requests; ++i) {
+		std::this_thread::sleep_for(pause);
+		const auto start = Clock::now();
+		if (not request()) {
+			return {};
+		}
+		const std::chrono::duration<double, std::micro> elapsed =
+			Clock::now() - start;
+		res.push_back(elapsed.count());
+	}
+	std::sort(res.begin(), res.end());
+	return res;
+}
+
+void report(const char* name, const std::vector<double>& latencies)
+{
+	const auto at = [&latencies](double fraction) {
+		return latencies.at(static_cast<std::size_t>(
+			fraction * static_cast<double>(latencies.size() - 1)
+		));
+	};
+	std::printf(
+		"%-12s p50 %9.1f us  p99 %9.1f us  max %9.1f us\n",
+		name,
+		at(0.5), // NOLINT(*-magic-numbers)
+		at(PERCENTILE_99),
+		latencies.back()
+	);
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+	const long requests =
+		argc > 1 ? std::strtol(argv[1], nullptr, 10) : DEFAULT_REQUESTS;
+	const std::chrono::microseconds pause{
+		argc > 2 ? std::strtol(argv[2], nullptr, 10) : DEFAULT_PAUSE_US
+	};
+	if (requests <= 0 || pause.count() < 0) {
+		std::fprintf(
+			stderr, "usage: %s [requests] [pause in us]\n", argv[0]
+		);
+		return EXIT_FAILURE;
+	}
+
+	std::error_code ec;
+	auto ruleset = policy().build(landlock::Backend::system(), ec);
+	if (ec || not ruleset->landlock_enabled()) {
+		std::printf("Landlock is not available, skipping\n");
+		return EXIT_SUCCESS;
+	}
+
+	std::printf(
+		"%ld requests, %ld us apart\n",
+		requests,
+		static_cast<long>(pause.count())
+	);
+
+	const std::vector<double> forked =
+		measure(fork_request, requests, pause);
+	if (forked.empty()) {
+		std::fprintf(stderr, "fork: request failed\n");
+		return EXIT_FAILURE;
+	}
+	report("fork", forked);
+
+	landlock::WorkerPool pool{std::move(ruleset), echo_main, POOL_SIZE, ec};
+	if (ec) {
+		std::fprintf(stderr, "pool: %s\n", ec.message().c_str());
+		return EXIT_FAILURE;
+	}
+	const std::vector<double> pooled = measure(
+		[&pool] {
+			std::error_code lease_ec;
+			const landlock::WorkerPool::Lease lease =
+				pool.acquire(lease_ec);
+			return not lease_ec && echo(lease.fd());
+		},
+		requests,
+		pause
+	);
+	if (pooled.empty()) {
+		std::fprintf(stderr, "pool: request failed\n");
+		return EXIT_FAILURE;
+	}
+	report("pool", pooled);
+
+	const landlock::WorkerPool::Stats stats = pool.stats();
+	std::printf(
+		"pool spawned %llu workers, %llu failed\n",
+		static_cast<unsigned long long>(stats.spawned),
+		static_cast<unsigned long long>(stats.failed)
+	);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,97 @@
+/**
+ * Benchmark of the startup overhead of llpp-run
+ *
+ * Spawns a trivial command repeatedly, once directly and once through
+ * llpp-run with a read-only policy for the whole filesystem, and reports the
+ * mean wall-clock time per spawn of both.
+ *
+ * Usage: run_bench LLPP_RUN [iterations] [command]
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ; // NOLINT(*-avoid-non-const-global-variables)
+
+namespace
+{
+constexpr long DEFAULT_ITERATIONS = 1000;
+
+/**
+ * Spawn argv and wait for it iterations times
+ *
+ * @return Microseconds per spawn, or a negative value on failure
+ */
+double run(const std::vector<char*>& argv, long iterations)
+{
+	const auto start = std::chrono::steady_clock::now();
+	for (long i = 0; i < iterations; ++i) {
+		pid_t pid = 0;
+		const int err = ::posix_spawn(
+			&pid, argv[0], nullptr, nullptr, argv.data(), environ
+		);
+		if (err != 0) {
+			return -1;
+		}
+		int status = 0;
+		if (::waitpid(pid, &status, 0) != pid ||
+		    not WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			return -1;
+		}
+	}
+	const std::chrono::duration<double, std::micro> elapsed =
+		std::chrono::steady_clock::now() - start;
+	return elapsed.count() / static_cast<double>(iterations);
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+	if (argc < 2) {
+		std::fprintf(
+			stderr,
+			"usage: %s LLPP_RUN [iterations] [command]\n",
+			argv[0]
+		);
+		return EXIT_FAILURE;
+	}
+	const long iterations = argc > 2 ? std::strtol(argv[2], nullptr, 10)
+					 : DEFAULT_ITERATIONS;
+	char* command = argc > 3 ? argv[3] : const_cast<char*>("/bin/true");
+	if (iterations <= 0) {
+		std::fprintf(stderr, "invalid iterations: %s\n", argv[2]);
+		return EXIT_FAILURE;
+	}
+
+	// NOLINTBEGIN(*-const-cast)
+	const std::vector<char*> direct{command, nullptr};
+	const std::vector<char*> sandboxed{
+		argv[1],
+		const_cast<char*>("--ro"),
+		const_cast<char*>("/"),
+		const_cast<char*>("--"),
+		command,
+		nullptr,
+	};
+	// NOLINTEND(*-const-cast)
+
+	std::printf("%ld spawns of %s\n", iterations, command);
+	const double direct_us = run(direct, iterations);
+	const double sandboxed_us = run(sandboxed, iterations);
+	if (direct_us < 0 || sandboxed_us < 0) {
+		std::fprintf(stderr, "spawning failed\n");
+		return EXIT_FAILURE;
+	}
+	std::printf("%-20s %10.1f us/spawn\n", "direct", direct_us);
+	std::printf("%-20s %10.1f us/spawn\n", "llpp-run", sandboxed_us);
+	std::printf(
+		"%-20s %10.1f us/spawn\n", "overhead", sandboxed_us - direct_us
+	);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,162 @@
+/**
+ * Benchmark of building per-tenant rulesets from a policy template
+ *
+ * Each tenant's policy consists of shared system paths, a tenant directory
+ * and a port. Rulesets are built either from a complete Policy per tenant or
+ * by instantiating a prepared PolicyTemplate with the tenant's parameters.
+ * The rulesets are built, but not enforced.
+ *
+ * Usage: template_bench [tenants]
+ */
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <unistd.h>
+
+#include <ll/ActionType.hpp>
+#include <ll/Backend.hpp>
+#include <ll/Policy.hpp>
+#include <ll/PolicyTemplate.hpp>
+#include <ll/config.h>
+
+namespace
+{
+constexpr long DEFAULT_TENANTS = 2000;
+constexpr long TENANT_DIRS = 16;
+constexpr std::uint16_t BASE_PORT = 20000;
+
+using Clock = std::chrono::steady_clock;
+namespace fs = std::filesystem;
+namespace action = landlock::action;
+
+const fs::path SHARED_PATHS[] = {
+	"/usr", "/lib", "/etc", "/bin", "/sbin", "/opt", "/var", "/tmp",
+};
+
+landlock::Policy base_policy()
+{
+	landlock::Policy res;
+	res.handle(action::FS_READ_FILE | action::FS_WRITE_FILE |
+		   action::FS_READ_DIR);
+	const auto read = action::FS_READ_FILE | action::FS_READ_DIR;
+	for (const fs::path& path : SHARED_PATHS) {
+		if (fs::exists(path)) {
+			res.allow(path, read);
+		}
+	}
+#if LLPP_BUILD_LANDLOCK_API >= 4
+	res.handle(action::NET_BIND_TCP);
+#endif
+	return res;
+}
+
+#if LLPP_BUILD_LANDLOCK_API >= 4
+std::uint16_t tenant_port(long tenant)
+{
+	return static_cast<std::uint16_t>(BASE_PORT + tenant);
+}
+#endif
+
+void report(const char* name, long tenants, double seconds)
+{
+	std::printf(
+		"%-10s %6ld tenants %8.3f s %8.2f us/tenant\n",
+		name,
+		tenants,
+		seconds,
+		// NOLINTNEXTLINE(*-magic-numbers)
+		seconds * 1e6 / static_cast<double>(tenants)
+	);
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+	const long tenants =
+		argc > 1 ? std::strtol(argv[1], nullptr, 10) : DEFAULT_TENANTS;
+	if (tenants <= 0 || tenants > UINT16_MAX - BASE_PORT) {
+		std::fprintf(stderr, "usage: %s [tenants]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	const fs::path root =
+		fs::temp_directory_path() /
+		("llpp-template-bench-" + std::to_string(::getpid()));
+	std::vector<fs::path> dirs;
+	std::error_code ec;
+	for (long i = 0; i < TENANT_DIRS && not ec; ++i) {
+		dirs.push_back(root / std::to_string(i));
+		fs::create_directories(dirs.back(), ec);
+	}
+	if (ec) {
+		std::fprintf(stderr, "cannot create %s\n", root.c_str());
+		return EXIT_FAILURE;
+	}
+
+	landlock::Backend& backend = landlock::Backend::system();
+	const auto tenant_dir = [&dirs](long tenant) -> const fs::path& {
+		return dirs[static_cast<std::size_t>(tenant % TENANT_DIRS)];
+	};
+
+	// Full build of each tenant's policy
+	auto start = Clock::now();
+	for (long i = 0; i < tenants && not ec; ++i) {
+		landlock::Policy policy = base_policy();
+		policy.allow(
+			tenant_dir(i),
+			action::FS_READ_FILE | action::FS_WRITE_FILE
+		);
+#if LLPP_BUILD_LANDLOCK_API >= 4
+		policy.allow(tenant_port(i), action::NET_BIND_TCP);
+#endif
+		const auto ruleset = policy.build(backend, ec);
+		if (not ec && not ruleset->active()) {
+			std::fprintf(
+				stderr, "Landlock is not supported, skipping\n"
+			);
+			fs::remove_all(root, ec);
+			return EXIT_SUCCESS;
+		}
+	}
+	std::chrono::duration<double> elapsed = Clock::now() - start;
+	if (not ec) {
+		report("build", tenants, elapsed.count());
+	}
+
+	// Instantiation of a template prepared once
+	start = Clock::now();
+	landlock::PolicyTemplate tmpl{base_policy()};
+	tmpl.path_param(action::FS_READ_FILE | action::FS_WRITE_FILE);
+#if LLPP_BUILD_LANDLOCK_API >= 4
+	tmpl.port_param(action::NET_BIND_TCP);
+#endif
+	if (not ec) {
+		tmpl.prepare(backend, ec);
+	}
+	for (long i = 0; i < tenants && not ec; ++i) {
+		landlock::PolicyTemplate::Params params{{tenant_dir(i)}, {}};
+#if LLPP_BUILD_LANDLOCK_API >= 4
+		params.ports.push_back(tenant_port(i));
+#endif
+		const auto ruleset = tmpl.instantiate(params, ec);
+	}
+	elapsed = Clock::now() - start;
+	if (not ec) {
+		report("template", tenants, elapsed.count());
+	}
+
+	int res = EXIT_SUCCESS;
+	if (ec) {
+		std::fprintf(stderr, "template: %s\n", ec.message().c_str());
+		res = EXIT_FAILURE;
+	}
+
+	fs::remove_all(root, ec);
+	return res;
+}
@@ -0,0 +1,20 @@
+// Typical user of the library: builds and enforces a ruleset
+#include <utility>
+
+#include <ll/ActionType.hpp>
+#include <ll/Rule.hpp>
+#include <ll/Ruleset.hpp>
+
+void enforce_sandbox()
+{
+	landlock::Ruleset ruleset{
+		{landlock::action::FS_READ_FILE,
+		 landlock::action::FS_WRITE_FILE}
+	};
+	landlock::PathBeneathRule rule;
+	rule.add_path("/usr")
+		.add_action(landlock::action::FS_READ_FILE)
+		.add_action(landlock::action::FS_EXECUTE);
+	ruleset.add_rule(std::move(rule));
+	ruleset.enforce();
+}
@@ -0,0 +1,28 @@
+// Stress test of the typing metaprogramming with large value packs
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include <ll/typing.hpp>
+
+namespace
+{
+using landlock::typing::UnionT;
+using landlock::typing::ValWrapper;
+
+template <typename Indices, std::size_t offset>
+struct Range;
+
+template <std::size_t... idx, std::size_t offset>
+struct Range<std::index_sequence<idx...>, offset> {
+	using type = ValWrapper<int, static_cast<int>(idx + offset)...>;
+};
+
+constexpr std::size_t SIZE = 96;
+
+using Lhs = Range<std::make_index_sequence<SIZE>, 0>::type;
+using Rhs = Range<std::make_index_sequence<SIZE>, SIZE / 2>::type;
+using Expected = Range<std::make_index_sequence<SIZE / 2>, SIZE / 2>::type;
+
+static_assert(std::is_same_v<UnionT<int, Lhs, Rhs>, Expected>);
+} // namespace
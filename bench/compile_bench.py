@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+"""
+Compile-time benchmark of the public headers
+
+Compiles each given translation unit several times and reports the best wall
+clock time and the number of class template specializations instantiated by
+the compiler. The number of specializations is taken from -fdump-lang-class
+with GCC and from -ftime-trace with Clang.
+
+Usage: compile_bench.py [--runs N] SOURCE... -- COMPILER [ARGS...]
+"""
+
+import argparse
+import glob
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def compiler_kind(cmd):
+    out = subprocess.run(
+        cmd + ["--version"], capture_output=True, text=True, check=True
+    ).stdout
+    return "clang" if "clang" in out else "gcc"
+
+
+def best_time(cmd, runs):
+    best = None
+    for _ in range(runs):
+        start = time.perf_counter()
+        subprocess.run(cmd, check=True)
+        elapsed = time.perf_counter() - start
+        best = elapsed if best is None else min(best, elapsed)
+    return best
+
+
+def count_gcc(cmd, tmp):
+    subprocess.run(cmd + ["-fdump-lang-class", "-dumpdir", tmp + "/"], check=True)
+    total = project = 0
+    for dump in glob.glob(os.path.join(tmp, "*.class")):
+        with open(dump, encoding="utf-8", errors="replace") as f:
+            for line in f:
+                if line.startswith("Class ") and "<" in line:
+                    total += 1
+                    if "landlock::" in line:
+                        project += 1
+        os.remove(dump)
+    return total, project
+
+
+def count_clang(cmd, tmp):
+    out = os.path.join(tmp, "tu.o")
+    subprocess.run(cmd[:-2] + ["-o", out, "-ftime-trace"], check=True)
+    with open(os.path.join(tmp, "tu.json"), encoding="utf-8") as f:
+        events = json.load(f)["traceEvents"]
+    total = project = 0
+    for event in events:
+        if event.get("name") == "InstantiateClass":
+            total += 1
+            if "landlock::" in event.get("args", {}).get("detail", ""):
+                project += 1
+    return total, project
+
+
+def main():
+    argv = sys.argv[1:]
+    if "--" not in argv:
+        print(__doc__.strip(), file=sys.stderr)
+        return 1
+    sep = argv.index("--")
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--runs", type=int, default=5)
+    parser.add_argument("sources", nargs="+")
+    args = parser.parse_args(argv[:sep])
+    compiler = argv[sep + 1:]
+
+    kind = compiler_kind(compiler[:1])
+    print(f"{'translation unit':<24} {'best time':>10} {'classes':>8} {'landlock':>8}")
+    with tempfile.TemporaryDirectory() as tmp:
+        for source in args.sources:
+            cmd = compiler + ["-c", source, "-o", os.devnull]
+            elapsed = best_time(cmd, args.runs)
+            count = count_clang if kind == "clang" else count_gcc
+            total, project = count(cmd, tmp)
+            name = os.path.basename(source)
+            print(f"{name:<24} {elapsed * 1000:>8.0f}ms {total:>8} {project:>8}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
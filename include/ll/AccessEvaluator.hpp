@@ -0,0 +1,169 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include <ll/ActionType.hpp>
+#include <ll/Ruleset.hpp>
+#include <ll/config.h>
+#include <ll/coredefs.hpp>
+
+namespace landlock
+{
+/**
+ * Userspace evaluation of Landlock access decisions
+ *
+ * The evaluator answers whether an access would be allowed by one or more
+ * stacked rulesets without issuing any syscall. Each added ruleset forms one
+ * layer. As in the kernel, an access is allowed only if every layer allows it,
+ * and a layer allows all actions it does not handle. Within a layer, the
+ * actions granted on a path are the union of the actions of all rules on the
+ * path and its ancestors.
+ *
+ * Rule paths are resolved once when adding a layer and stored in a trie of
+ * path components. Port rules are stored in one bitmap per network action.
+ * Queries do not allocate and perform one hash lookup per path component.
+ *
+ * Paths are evaluated lexically, so symbolic links in queried paths are not
+ * resolved. Pass canonical paths (e.g. from std::filesystem::weakly_canonical)
+ * if they may contain symbolic links.
+ */
+class LLPP_EXPORT AccessEvaluator
+{
+public:
+	/// Maximum number of stacked layers supported by Landlock
+	constexpr static std::size_t MAX_LAYERS = 16;
+
+	/// Number of distinct TCP ports
+	constexpr static std::size_t PORT_COUNT = 1U << 16U;
+
+	AccessEvaluator();
+
+#ifndef LLPP_NO_EXCEPTIONS
+	/**
+	 * Create an evaluator with a single layer for ruleset
+	 *
+	 * @throws std::system_error If a rule path cannot be resolved or the
+	 * rules of the ruleset are not known (see Ruleset::rules_known())
+	 */
+	explicit AccessEvaluator(const Ruleset& ruleset);
+
+	/**
+	 * Add a ruleset as the next layer
+	 *
+	 * @throws std::system_error If a rule path cannot be resolved, the
+	 * rules of the ruleset are not known (see Ruleset::rules_known()) or
+	 * more than MAX_LAYERS layers are added
+	 */
+	AccessEvaluator& add_layer(const Ruleset& ruleset);
+#endif
+
+	/**
+	 * Add a ruleset as the next layer without throwing
+	 *
+	 * An active ruleset whose rules are not known, e.g. one received by
+	 * RulesetClient or instantiated from a PolicyTemplate, sets ec to
+	 * std::errc::not_supported, since everything it handles would be
+	 * evaluated as denied. On failure, ec is set and the evaluator is
+	 * unchanged.
+	 */
+	AccessEvaluator& add_layer(const Ruleset& ruleset, std::error_code& ec);
+
+	/**
+	 * Get the number of layers
+	 */
+	[[nodiscard]] std::size_t layer_count() const noexcept
+	{
+		return layers_.size();
+	}
+
+	/**
+	 * Get the filesystem actions denied when accessing path
+	 *
+	 * path must be absolute, otherwise all requested actions are reported
+	 * as denied. Redundant separators and "." components are ignored;
+	 * paths containing ".." components are normalized first, which
+	 * allocates.
+	 *
+	 * @param access Bitmask of requested LANDLOCK_ACCESS_FS_* actions
+	 *
+	 * @return Bitmask of the requested actions that are denied
+	 */
+	[[nodiscard]] std::uint64_t
+	denied(std::string_view path, std::uint64_t access) const;
+
+	/**
+	 * Get the network actions denied for port
+	 *
+	 * @param access Bitmask of requested LANDLOCK_ACCESS_NET_* actions
+	 *
+	 * @return Bitmask of the requested actions that are denied
+	 */
+	[[nodiscard]] std::uint64_t
+	denied(std::uint16_t port, std::uint64_t access) const noexcept;
+
+	/**
+	 * Check whether access to path would be allowed
+	 *
+	 * Relative paths are interpreted relative to the current working
+	 * directory.
+	 */
+	[[nodiscard]] bool allowed(
+		const std::filesystem::path& path,
+		const action::FsAction& access
+	) const;
+
+	/**
+	 * Check whether access to port would be allowed
+	 */
+	[[nodiscard]] bool allowed(
+		std::uint16_t port, const action::NetAction& access
+	) const noexcept
+	{
+		return denied(port, access.type_code()) == 0;
+	}
+
+private:
+	struct StringHash {
+		using is_transparent = void;
+
+		std::size_t operator()(std::string_view str) const noexcept
+		{
+			return std::hash<std::string_view>{}(str);
+		}
+	};
+
+	struct Node {
+		std::unordered_map<
+			std::string,
+			std::uint32_t,
+			StringHash,
+			std::equal_to<>>
+			children;
+		std::array<std::uint64_t, MAX_LAYERS> allowed_access{};
+	};
+
+	struct Layer {
+		std::uint64_t handled_access_fs{0};
+		std::uint64_t handled_access_net{0};
+		std::vector<std::bitset<PORT_COUNT>> ports;
+	};
+
+	/**
+	 * Find or create the trie node for an absolute, normalized path
+	 */
+	std::uint32_t node_for(std::string_view path);
+
+	std::vector<Node> nodes_;
+	std::vector<Layer> layers_;
+};
+} // namespace landlock
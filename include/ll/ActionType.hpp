@@ -1,7 +1,10 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <limits>
 #include <type_traits>
+#include <vector>
 
 extern "C" {
 #include <linux/landlock.h>
@@ -148,6 +151,70 @@ DECL_ACTION_ABI4(NetAction, NET, CONNECT_TCP);
 
 DECL_ACTION_ABI5(FsAction, FS, IOCTL_DEV);
 
+/**
+ * All filesystem actions known at compile time
+ *
+ * Actions not supported by the API at compile time are INVALID_ACTION_FS.
+ */
+constexpr static std::array<FsAction, 16> FS_ACTIONS{
+	FS_EXECUTE,
+	FS_WRITE_FILE,
+	FS_READ_FILE,
+	FS_READ_DIR,
+	FS_REMOVE_DIR,
+	FS_REMOVE_FILE,
+	FS_MAKE_CHAR,
+	FS_MAKE_DIR,
+	FS_MAKE_REG,
+	FS_MAKE_SOCK,
+	FS_MAKE_FIFO,
+	FS_MAKE_BLOCK,
+	FS_MAKE_SYM,
+	FS_REFER,
+	FS_TRUNCATE,
+	FS_IOCTL_DEV,
+};
+
+/**
+ * Filesystem actions which may be allowed on files other than directories
+ *
+ * The kernel rejects rules allowing any other action beneath a file which is
+ * not a directory.
+ */
+constexpr static FsAction FS_FILE_ACTIONS =
+	FS_EXECUTE | FS_WRITE_FILE | FS_READ_FILE | FS_TRUNCATE | FS_IOCTL_DEV;
+
+/**
+ * All network actions known at compile time
+ *
+ * Actions not supported by the API at compile time are INVALID_ACTION_NET.
+ */
+constexpr static std::array<NetAction, 2> NET_ACTIONS{
+	NET_BIND_TCP,
+	NET_CONNECT_TCP,
+};
+
+/**
+ * Split a bitmask into the known actions it is composed of
+ *
+ * Each action of known whose bits are all set in mask is returned, keeping its
+ * minimum ABI version. Bits not belonging to any valid known action are
+ * dropped.
+ */
+template <ActionRuleType supp, std::size_t N>
+std::vector<ActionType<supp>>
+split(std::uint64_t mask, const std::array<ActionType<supp>, N>& known)
+{
+	std::vector<ActionType<supp>> res;
+	for (const ActionType<supp>& act : known) {
+		if (act.type_code() != 0 &&
+		    (mask & act.type_code()) == act.type_code()) {
+			res.push_back(act);
+		}
+	}
+	return res;
+}
+
 #undef DECL_ACTION
 #undef DECL_ACTION_ABI1
 #undef DECL_ACTION_ABI2
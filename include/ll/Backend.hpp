@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+extern "C" {
+#include <linux/landlock.h>
+}
+
+#include <ll/config.h>
+#include <ll/coredefs.hpp>
+
+namespace landlock
+{
+/**
+ * Interface to the Landlock syscalls
+ *
+ * A ruleset issues all of its kernel calls through a backend. The default
+ * backend performs the actual syscalls, while alternative backends (e.g.
+ * FakeBackend) allow running rulesets against a simulated kernel.
+ *
+ * All functions follow the syscall conventions: on failure, they return -1 and
+ * set errno.
+ */
+class LLPP_EXPORT Backend
+{
+public:
+	Backend() = default;
+	Backend(const Backend&) = delete;
+	Backend& operator=(const Backend&) = delete;
+	Backend(Backend&&) = delete;
+	Backend& operator=(Backend&&) = delete;
+	virtual ~Backend() = default;
+
+	/**
+	 * Equivalent of the landlock_create_ruleset syscall
+	 */
+	virtual int create_ruleset(
+		const landlock_ruleset_attr* attr,
+		std::size_t size,
+		std::uint32_t flags
+	) noexcept = 0;
+
+	/**
+	 * Equivalent of the landlock_add_rule syscall
+	 */
+	virtual int add_rule(
+		int ruleset_fd,
+		landlock_rule_type rule_type,
+		const void* rule_attr,
+		std::uint32_t flags
+	) noexcept = 0;
+
+	/**
+	 * Equivalent of the landlock_restrict_self syscall
+	 */
+	virtual int
+	restrict_self(int ruleset_fd, std::uint32_t flags) noexcept = 0;
+
+	/**
+	 * Equivalent of prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0)
+	 */
+	virtual int set_no_new_privs() noexcept = 0;
+
+	/**
+	 * Close a ruleset file descriptor returned by create_ruleset()
+	 */
+	virtual int close(int fd) noexcept = 0;
+
+	/**
+	 * Get the process-wide backend performing the actual syscalls
+	 */
+	static Backend& system() noexcept;
+};
+
+/**
+ * Backend performing the actual Landlock syscalls of the running kernel
+ */
+class LLPP_EXPORT SyscallBackend : public Backend
+{
+public:
+	SyscallBackend() = default;
+	SyscallBackend(const SyscallBackend&) = delete;
+	SyscallBackend& operator=(const SyscallBackend&) = delete;
+	SyscallBackend(SyscallBackend&&) = delete;
+	SyscallBackend& operator=(SyscallBackend&&) = delete;
+	~SyscallBackend() override = default;
+
+	int create_ruleset(
+		const landlock_ruleset_attr* attr,
+		std::size_t size,
+		std::uint32_t flags
+	) noexcept override;
+
+	int add_rule(
+		int ruleset_fd,
+		landlock_rule_type rule_type,
+		const void* rule_attr,
+		std::uint32_t flags
+	) noexcept override;
+
+	int
+	restrict_self(int ruleset_fd, std::uint32_t flags) noexcept override;
+
+	int set_no_new_privs() noexcept override;
+
+	int close(int fd) noexcept override;
+};
+} // namespace landlock
@@ -2,8 +2,6 @@
 
 #include <algorithm>
 #include <cstdint>
-#include <iomanip>
-#include <ostream>
 #include <vector>
 
 extern "C" {
@@ -208,15 +206,3 @@ constexpr bool operator!=(
 {
 	return not(lhs == rhs);
 }
-
-template <typename supported>
-std::ostream&
-operator<<(std::ostream& out, const landlock::CodedType<supported>& atype)
-{
-	const auto fmt = out.flags();
-	out << std::hex << std::setfill('0')
-	    << std::setw(sizeof(std::uint64_t) * 2) << atype.type_code() << '/'
-	    << std::dec << atype.min_abi();
-	out.flags(fmt);
-	return out;
-}
@@ -0,0 +1,25 @@
+/**
+ * @file CodedTypeIO.hpp Stream formatting of coded types
+ *
+ * This is kept separate from CodedType.hpp, so translation units which do not
+ * print coded types do not need to include the stream headers.
+ */
+#pragma once
+
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+
+#include <ll/CodedType.hpp>
+
+template <typename supported>
+std::ostream&
+operator<<(std::ostream& out, const landlock::CodedType<supported>& atype)
+{
+	const auto fmt = out.flags();
+	out << std::hex << std::setfill('0')
+	    << std::setw(sizeof(std::uint64_t) * 2) << atype.type_code() << '/'
+	    << std::dec << atype.min_abi();
+	out.flags(fmt);
+	return out;
+}
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+extern "C" {
+#include <linux/landlock.h>
+}
+
+#include <ll/Backend.hpp>
+#include <ll/config.h>
+#include <ll/coredefs.hpp>
+
+namespace landlock
+{
+/**
+ * In-memory simulation of the Landlock kernel interface
+ *
+ * This backend simulates a kernel supporting an arbitrary Landlock ABI version
+ * (0 meaning no Landlock support at all), independent of the running kernel
+ * and the headers present at compile time. Arguments are validated like the
+ * kernel does for the simulated ABI version. Created rulesets, added rules and
+ * enforced layers are recorded for inspection, and the calling process is
+ * never restricted.
+ *
+ * Latency and errors can be injected per call to test error handling and to
+ * run setup benchmarks deterministically.
+ *
+ * All functions are thread-safe.
+ */
+class LLPP_EXPORT FakeBackend : public Backend
+{
+public:
+	/**
+	 * Calls which can be instrumented
+	 */
+	enum class Call : std::uint8_t {
+		CREATE_RULESET,
+		ADD_RULE,
+		RESTRICT_SELF,
+		SET_NO_NEW_PRIVS,
+	};
+
+	/// Number of enumerators in Call
+	constexpr static std::size_t CALL_COUNT = 4;
+
+	/// Maximum number of stacked layers supported by Landlock
+	constexpr static std::size_t MAX_LAYERS = 16;
+
+	struct PathBeneath {
+		std::uint64_t allowed_access;
+		int parent_fd;
+	};
+
+	struct NetPort {
+		std::uint64_t allowed_access;
+		std::uint64_t port;
+	};
+
+	/**
+	 * Recorded state of a ruleset created through this backend
+	 */
+	struct FakeRuleset {
+		std::uint64_t handled_access_fs{0};
+		std::uint64_t handled_access_net{0};
+		std::uint64_t scoped{0};
+		std::vector<PathBeneath> path_beneath_rules;
+		std::vector<NetPort> net_port_rules;
+	};
+
+	/**
+	 * Snapshot of a ruleset at the time it was enforced
+	 */
+	struct Layer {
+		FakeRuleset ruleset;
+		std::uint32_t flags;
+	};
+
+	/**
+	 * Create a fake kernel supporting the given ABI version
+	 */
+	explicit FakeBackend(int abi_version) noexcept;
+	FakeBackend(const FakeBackend&) = delete;
+	FakeBackend& operator=(const FakeBackend&) = delete;
+	FakeBackend(FakeBackend&&) = delete;
+	FakeBackend& operator=(FakeBackend&&) = delete;
+	~FakeBackend() override = default;
+
+	int create_ruleset(
+		const landlock_ruleset_attr* attr,
+		std::size_t size,
+		std::uint32_t flags
+	) noexcept override;
+
+	int add_rule(
+		int ruleset_fd,
+		landlock_rule_type rule_type,
+		const void* rule_attr,
+		std::uint32_t flags
+	) noexcept override;
+
+	int
+	restrict_self(int ruleset_fd, std::uint32_t flags) noexcept override;
+
+	int set_no_new_privs() noexcept override;
+
+	int close(int fd) noexcept override;
+
+	[[nodiscard]] int abi_version() const noexcept
+	{
+		return abi_version_;
+	}
+
+	/**
+	 * Delay every following invocation of call by latency
+	 */
+	void set_latency(Call call, std::chrono::nanoseconds latency);
+
+	/**
+	 * Let the next count invocations of call fail with errno err
+	 */
+	void inject_error(Call call, int err, std::size_t count = 1);
+
+	/**
+	 * Get the number of invocations of call so far
+	 */
+	[[nodiscard]] std::size_t call_count(Call call) const;
+
+	/**
+	 * Get the recorded state of an open ruleset file descriptor
+	 */
+	[[nodiscard]] std::optional<FakeRuleset> ruleset(int ruleset_fd) const;
+
+	/**
+	 * Get all enforced layers, oldest first
+	 */
+	[[nodiscard]] std::vector<Layer> layers() const;
+
+	[[nodiscard]] bool no_new_privs() const;
+
+private:
+	struct Instrumentation {
+		std::size_t calls{0};
+		std::chrono::nanoseconds latency{0};
+		int error{0};
+		std::size_t error_count{0};
+	};
+
+	/**
+	 * Account for a call and apply the injected latency and errors
+	 *
+	 * @return false, if an error was injected and errno is set
+	 */
+	bool instrument(Call call);
+
+	int abi_version_;
+	int next_fd_;
+	bool no_new_privs_{false};
+	std::array<Instrumentation, CALL_COUNT> instrumentation_{};
+	std::map<int, FakeRuleset> rulesets_;
+	std::vector<Layer> layers_;
+
+	mutable std::mutex mutex_;
+};
+} // namespace landlock
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+
+#include <ll/Policy.hpp>
+#include <ll/config.h>
+#include <ll/coredefs.hpp>
+
+namespace landlock
+{
+/**
+ * Unsandboxed broker opening files on behalf of sandboxed clients
+ *
+ * Some sandboxed processes occasionally need files outside of their Landlock
+ * policy. Instead of widening the policy, such a process can ask a broker
+ * running outside of the sandbox, which checks each request against an
+ * allowlist, opens the file and passes the file descriptor back via
+ * SCM_RIGHTS.
+ *
+ * The allowlist is a Policy. A request is granted if the policy allows all
+ * access implied by the open flags on the file, where access not handled by
+ * the policy is never granted:
+ *
+ * - reading a regular file requires FS_READ_FILE, reading a directory
+ *   FS_READ_DIR
+ * - writing requires FS_WRITE_FILE
+ *
+ * Only the access mode and O_APPEND, O_CLOEXEC, O_DIRECTORY, O_DSYNC,
+ * O_LARGEFILE, O_NOCTTY, O_NOFOLLOW, O_NONBLOCK and O_SYNC may be requested.
+ * Requests with any other flag are denied, in particular O_CREAT, O_TMPFILE,
+ * O_TRUNC and O_PATH, since they would create or modify files beyond the
+ * checked access. Only regular files and directories are passed. The check
+ * uses the path of the opened file, so symbolic links cannot be used to escape
+ * the allowlist.
+ *
+ * The broker serves connected SOCK_SEQPACKET sockets, e.g. one end of a
+ * socketpair(2) created before starting a client.
+ */
+class LLPP_EXPORT FdBroker
+{
+public:
+	/// Maximum length of a requested path
+	constexpr static std::size_t MAX_PATH = 4096;
+
+	/**
+	 * Broker statistics
+	 */
+	struct Stats {
+		std::uint64_t granted;
+		std::uint64_t denied;
+	};
+
+	explicit FdBroker(Policy allowlist);
+
+	/**
+	 * Handle a single request on sock
+	 *
+	 * Blocks until a request arrives.
+	 *
+	 * @return false, if the peer closed the connection or receiving
+	 * failed, with ec set in the latter case; true, otherwise
+	 */
+	bool handle(int sock, std::error_code& ec);
+
+	/**
+	 * Handle requests on sock until the peer closes the connection
+	 *
+	 * This is safe to call concurrently for different sockets. On failure,
+	 * ec is set.
+	 */
+	void serve(int sock, std::error_code& ec);
+
+	/**
+	 * Get the broker statistics
+	 */
+	[[nodiscard]] Stats stats() const noexcept;
+
+private:
+	/**
+	 * Open path on behalf of a client and check the result
+	 *
+	 * @return The file descriptor, or -1 with errno set
+	 */
+	int open_checked(const std::string& path, int flags) const;
+
+	Policy allowlist_;
+	std::atomic<std::uint64_t> granted_{0};
+	std::atomic<std::uint64_t> denied_{0};
+};
+
+/**
+ * Client requesting files from an FdBroker
+ *
+ * Granted file descriptors and denials are cached per path and flags, so
+ * repeated requests do not reach the broker. The returned file descriptors
+ * are owned by the client and stay valid until it is destroyed; since they
+ * are shared between all requests for the same path and flags, callers
+ * should use positional I/O (e.g. pread(2)) or dup(2) them.
+ *
+ * Requests can be pipelined: prefetch() sends a request without waiting for
+ * the response, which is collected by a later open() of the same file.
+ *
+ * The client is thread-safe.
+ */
+class LLPP_EXPORT FdClient
+{
+public:
+	/**
+	 * Cache statistics
+	 */
+	struct Stats {
+		/// Requests answered from the cache
+		std::uint64_t hits;
+		/// Requests sent to the broker
+		std::uint64_t requests;
+	};
+
+	/**
+	 * Create a client talking to the broker over sock
+	 *
+	 * The client takes ownership of the socket.
+	 */
+	explicit FdClient(int sock) noexcept;
+	FdClient(const FdClient&) = delete;
+	FdClient& operator=(const FdClient&) = delete;
+	FdClient(FdClient&&) = delete;
+	FdClient& operator=(FdClient&&) = delete;
+
+	/**
+	 * Close the socket and all cached file descriptors
+	 */
+	~FdClient();
+
+	/**
+	 * Open a file through the broker
+	 *
+	 * @return The cached file descriptor, or -1 with errno set. Denials by
+	 * the broker are reported as EACCES.
+	 */
+	int open(const char* path, int flags);
+
+	/**
+	 * Request a file without waiting for the response
+	 *
+	 * @return 0, or -1 with errno set if the request could not be sent
+	 */
+	int prefetch(const char* path, int flags);
+
+	/**
+	 * Get the cache statistics
+	 */
+	[[nodiscard]] Stats stats() const;
+
+private:
+	using Key = std::pair<int, std::string>;
+
+	struct KeyHash {
+		std::size_t operator()(const Key& key) const noexcept
+		{
+			return std::hash<std::string>{}(key.second) ^
+			       std::hash<int>{}(key.first);
+		}
+	};
+
+	/// Cached result: file descriptor or negative errno
+	using Result = int;
+
+	/**
+	 * Send a request for key unless it is cached or pending
+	 */
+	bool send_request(const Key& key);
+
+	/**
+	 * Receive one response and store it in the cache
+	 */
+	bool receive_response();
+
+	int sock_;
+	std::uint64_t next_id_{0};
+	mutable std::mutex mutex_;
+	std::unordered_map<Key, Result, KeyHash> cache_;
+	std::map<std::uint64_t, Key> pending_;
+	std::unordered_map<Key, std::uint64_t, KeyHash> pending_ids_;
+	Stats stats_{0, 0};
+};
+} // namespace landlock
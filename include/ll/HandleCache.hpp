@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <system_error>
+
+#include <sys/types.h>
+
+#include <ll/config.h>
+#include <ll/coredefs.hpp>
+
+namespace landlock
+{
+/**
+ * O_PATH file descriptor of a filesystem object
+ *
+ * The descriptor is closed on destruction.
+ */
+class LLPP_EXPORT PathHandle
+{
+public:
+	PathHandle(int fd, dev_t dev, ino_t ino, bool directory) noexcept :
+		fd_(fd), dev_(dev), ino_(ino), directory_(directory)
+	{
+	}
+	PathHandle(const PathHandle&) = delete;
+	PathHandle& operator=(const PathHandle&) = delete;
+	PathHandle(PathHandle&&) = delete;
+	PathHandle& operator=(PathHandle&&) = delete;
+	~PathHandle();
+
+	[[nodiscard]] int fd() const noexcept
+	{
+		return fd_;
+	}
+
+	[[nodiscard]] dev_t dev() const noexcept
+	{
+		return dev_;
+	}
+
+	[[nodiscard]] ino_t ino() const noexcept
+	{
+		return ino_;
+	}
+
+	/**
+	 * Return whether the object was a directory when it was opened
+	 */
+	[[nodiscard]] bool directory() const noexcept
+	{
+		return directory_;
+	}
+
+private:
+	int fd_;
+	dev_t dev_;
+	ino_t ino_;
+	bool directory_;
+};
+
+/**
+ * Cache sharing O_PATH handles between everyone opening the same path
+ *
+ * Handles are reference counted and the cache only keeps weak references, so
+ * a handle is closed as soon as the last rule using it is gone. While it is in
+ * use, opening the same absolute path again returns the same handle, after
+ * checking with stat(2) that the path still refers to the same object (device
+ * and inode). If it does not, e.g. because the path was replaced, a new handle
+ * is opened, and users of the old handle keep the old object.
+ *
+ * Relative paths depend on the working directory, so they are opened without
+ * the cache.
+ *
+ * PathBeneathRule opens its paths through global(), so repeated rules for the
+ * same directories, e.g. of phases or per-tenant rulesets, share one file
+ * descriptor per object. The cache can be shared between threads.
+ */
+class LLPP_EXPORT HandleCache
+{
+public:
+	using Handle = std::shared_ptr<const PathHandle>;
+
+	/**
+	 * Cache statistics
+	 */
+	struct Stats {
+		/// Opens answered with a cached handle
+		std::uint64_t hits;
+		/// Opens passed on to the kernel
+		std::uint64_t misses;
+		/// Cached handles found to refer to a replaced object
+		std::uint64_t stale;
+	};
+
+	HandleCache();
+	HandleCache(const HandleCache&) = delete;
+	HandleCache& operator=(const HandleCache&) = delete;
+	HandleCache(HandleCache&&) = delete;
+	HandleCache& operator=(HandleCache&&) = delete;
+	~HandleCache();
+
+	/**
+	 * Get the process-wide cache used by PathBeneathRule
+	 */
+	static HandleCache& global();
+
+#ifndef LLPP_NO_EXCEPTIONS
+	/**
+	 * Get a handle for path, following symbolic links
+	 *
+	 * @throws std::system_error If the path cannot be opened
+	 */
+	[[nodiscard]] Handle open(const std::filesystem::path& path);
+#endif
+
+	/**
+	 * Get a handle for path without throwing
+	 *
+	 * On failure, ec is set to the error returned by open(2) and nullptr
+	 * is returned. On success, ec is cleared.
+	 */
+	[[nodiscard]] Handle
+	open(const std::filesystem::path& path, std::error_code& ec);
+
+	/**
+	 * Get the cache statistics
+	 */
+	[[nodiscard]] Stats stats() const noexcept;
+
+	/**
+	 * Get the number of cached handles which are still in use
+	 */
+	[[nodiscard]] std::size_t size() const;
+
+private:
+	struct State;
+
+	// Shared with the deleters of the handles, which remove their entry
+	// and may outlive the cache
+	std::shared_ptr<State> state_;
+};
+} // namespace landlock
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include <sys/types.h>
+
+#include <ll/config.h>
+#include <ll/coredefs.hpp>
+
+namespace landlock
+{
+/**
+ * File open wrapper caching access denials
+ *
+ * Once a ruleset is enforced, the Landlock domain of the process never gains
+ * permissions, so a path once denied with EACCES stays denied. This wrapper
+ * calls open(2)/openat(2) and remembers each EACCES result per (directory,
+ * path, flags) in a bounded LRU cache. Repeated attempts to open a denied path
+ * fail with EACCES immediately, without a path walk in the kernel.
+ *
+ * Relative paths are cached per device and inode of the directory they are
+ * resolved from (dirfd or the working directory), not per descriptor number,
+ * since the number of a closed descriptor may be reused for another
+ * directory. This costs an fstat(2) of the directory per call.
+ *
+ * The cache is never invalidated. It should therefore only be used after the
+ * ruleset has been enforced, and callers must not rely on permission changes
+ * (e.g. chmod(2)) or on renames becoming visible through the cache.
+ *
+ * The cache is split into independently locked shards, so it can be shared
+ * between threads.
+ */
+class LLPP_EXPORT OpenCache
+{
+public:
+	constexpr static std::size_t DEFAULT_CAPACITY = 4096;
+	constexpr static std::size_t DEFAULT_SHARDS = 16;
+
+	/**
+	 * Cache statistics
+	 */
+	struct Stats {
+		/// Denials answered from the cache
+		std::uint64_t hits;
+		/// Calls passed on to the kernel
+		std::uint64_t misses;
+		/// Denials evicted due to the capacity limit
+		std::uint64_t evictions;
+	};
+
+	/**
+	 * Create a cache holding up to capacity denials
+	 *
+	 * The capacity is distributed evenly over the given number of
+	 * independently locked shards.
+	 */
+	explicit OpenCache(
+		std::size_t capacity = DEFAULT_CAPACITY,
+		std::size_t shards = DEFAULT_SHARDS
+	);
+	OpenCache(const OpenCache&) = delete;
+	OpenCache& operator=(const OpenCache&) = delete;
+	OpenCache(OpenCache&&) = delete;
+	OpenCache& operator=(OpenCache&&) = delete;
+	~OpenCache();
+
+	/**
+	 * Open a file like open(2)
+	 *
+	 * @return The new file descriptor, or -1 with errno set on failure
+	 */
+	int open(const char* path, int flags, mode_t mode = 0);
+
+	/**
+	 * Open a file like openat(2)
+	 *
+	 * @return The new file descriptor, or -1 with errno set on failure
+	 */
+	int openat(int dirfd, const char* path, int flags, mode_t mode = 0);
+
+	/**
+	 * Get the cache statistics
+	 */
+	[[nodiscard]] Stats stats() const noexcept;
+
+	/**
+	 * Get the number of cached denials
+	 */
+	[[nodiscard]] std::size_t size() const;
+
+private:
+	/// Device and inode of the directory relative paths are resolved from,
+	/// or zero for absolute paths
+	struct Dir {
+		dev_t dev;
+		ino_t ino;
+
+		bool operator==(const Dir& other) const noexcept = default;
+	};
+
+	struct Key {
+		Dir dir;
+		int flags;
+		std::string path;
+	};
+
+	struct KeyView {
+		Dir dir;
+		int flags;
+		std::string_view path;
+	};
+
+	struct KeyHash {
+		using is_transparent = void;
+
+		std::size_t operator()(const KeyView& key) const noexcept;
+		std::size_t operator()(const Key& key) const noexcept
+		{
+			return (*this)(KeyView{key.dir, key.flags, key.path});
+		}
+	};
+
+	struct KeyEqual {
+		using is_transparent = void;
+
+		template <typename L, typename R>
+		bool operator()(const L& lhs, const R& rhs) const noexcept
+		{
+			return lhs.dir == rhs.dir && lhs.flags == rhs.flags &&
+			       std::string_view{lhs.path} ==
+				       std::string_view{rhs.path};
+		}
+	};
+
+	struct Shard {
+		mutable std::mutex mutex;
+		std::list<Key> lru;
+		std::unordered_map<
+			Key,
+			std::list<Key>::iterator,
+			KeyHash,
+			KeyEqual>
+			entries;
+	};
+
+	/**
+	 * Check for a cached denial, marking it as recently used
+	 */
+	bool lookup(Shard& shard, const KeyView& key);
+
+	/**
+	 * Cache a denial, evicting the least recently used one if needed
+	 */
+	void insert(Shard& shard, const KeyView& key);
+
+	std::size_t shard_count_;
+	std::size_t shard_capacity_;
+	std::unique_ptr<Shard[]> shards_; // NOLINT(*-avoid-c-arrays)
+
+	std::atomic<std::uint64_t> hits_{0};
+	std::atomic<std::uint64_t> misses_{0};
+	std::atomic<std::uint64_t> evictions_{0};
+};
+} // namespace landlock
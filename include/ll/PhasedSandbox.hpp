@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <system_error>
+#include <vector>
+
+#include <ll/Backend.hpp>
+#include <ll/Policy.hpp>
+#include <ll/Ruleset.hpp>
+#include <ll/config.h>
+#include <ll/coredefs.hpp>
+
+namespace landlock
+{
+/**
+ * Sandbox tightening in phases with rulesets prepared ahead of time
+ *
+ * Processes often need broad access while starting up (e.g. loading plugins
+ * and configuration) and much less afterwards. Building a ruleset opens all
+ * rule paths and issues one syscall per rule, which would add latency at the
+ * moment of switching phases. The sandbox therefore builds the ruleset of each
+ * phase in advance, on a background thread for phases added as a Policy or
+ * builder, so advance() only issues landlock_restrict_self(2).
+ *
+ * Phases are enforced in the order they were added, each as a new layer on
+ * top of the previous ones. The first advance() also sets no_new_privs, which
+ * like the Landlock domain applies to the calling thread, so all phases should
+ * be advanced from the same thread.
+ *
+ * The sandbox itself is not thread-safe.
+ */
+class LLPP_EXPORT PhasedSandbox
+{
+public:
+	/**
+	 * Function building the ruleset of a phase
+	 *
+	 * On failure, it sets ec and may return nullptr. Exceptions it throws
+	 * are reported as errors of the phase instead: the code of a
+	 * std::system_error, std::errc::not_enough_memory for std::bad_alloc
+	 * and std::errc::state_not_recoverable for anything else.
+	 */
+	using Builder = std::function<std::unique_ptr<Ruleset>(
+		Backend& backend, std::error_code& ec
+	)>;
+
+	explicit PhasedSandbox(Backend& backend = Backend::system()) noexcept;
+	PhasedSandbox(const PhasedSandbox&) = delete;
+	PhasedSandbox& operator=(const PhasedSandbox&) = delete;
+	PhasedSandbox(PhasedSandbox&&) = delete;
+	PhasedSandbox& operator=(PhasedSandbox&&) = delete;
+
+	/**
+	 * Waits for the preparation of all phases to finish
+	 */
+	~PhasedSandbox();
+
+	/**
+	 * Add a phase with an already built ruleset
+	 */
+	PhasedSandbox& add_phase(std::unique_ptr<Ruleset> ruleset);
+
+	/**
+	 * Add a phase enforcing policy
+	 *
+	 * The ruleset is built on a background thread right away.
+	 */
+	PhasedSandbox& add_phase(Policy policy);
+
+	/**
+	 * Add a phase with a ruleset created by builder
+	 *
+	 * builder is called on a background thread right away.
+	 */
+	PhasedSandbox& add_phase(Builder builder);
+
+	/**
+	 * Get the number of phases added
+	 */
+	[[nodiscard]] std::size_t phase_count() const noexcept
+	{
+		return phases_.size();
+	}
+
+	/**
+	 * Get the number of phases enforced so far
+	 */
+	[[nodiscard]] std::size_t current_phase() const noexcept
+	{
+		return current_;
+	}
+
+	/**
+	 * Check whether the ruleset of phase has been prepared, without
+	 * blocking
+	 */
+	[[nodiscard]] bool ready(std::size_t phase) const;
+
+	/**
+	 * Wait until the rulesets of all phases have been prepared
+	 *
+	 * On failure, ec is set to the error of the first phase which could
+	 * not be prepared.
+	 */
+	void wait(std::error_code& ec) const;
+
+#ifndef LLPP_NO_EXCEPTIONS
+	/**
+	 * Enforce the next phase
+	 *
+	 * Waits for the preparation of the phase if it is not finished yet.
+	 *
+	 * @throws std::system_error With std::errc::result_out_of_range if all
+	 * phases have been enforced, with the error of preparing the ruleset,
+	 * or if enforcing fails. The current phase is unchanged then.
+	 */
+	void advance();
+#endif
+
+	/**
+	 * Enforce the next phase without throwing
+	 *
+	 * On failure, ec is set and the current phase is unchanged.
+	 */
+	void advance(std::error_code& ec);
+
+private:
+	struct Prepared {
+		std::unique_ptr<Ruleset> ruleset;
+		std::error_code ec;
+	};
+
+	Backend* backend_;
+	std::vector<std::shared_future<Prepared>> phases_;
+	std::size_t current_{0};
+};
+} // namespace landlock
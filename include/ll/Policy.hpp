@@ -0,0 +1,222 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include <ll/ActionType.hpp>
+#include <ll/Backend.hpp>
+#include <ll/Ruleset.hpp>
+#include <ll/Scope.hpp>
+#include <ll/config.h>
+#include <ll/coredefs.hpp>
+
+namespace landlock
+{
+/**
+ * Report of the changes made when merging two policies
+ *
+ * For each rule path and port of either input whose effective access differs
+ * between an input and the merged policy, a change entry is recorded. All
+ * access masks in the report are limited to the access handled by the merged
+ * policy.
+ */
+struct MergeReport {
+	template <typename ObjectT>
+	struct Change {
+		ObjectT object;
+		/// Effective access granted by the left-hand side policy
+		std::uint64_t lhs;
+		/// Effective access granted by the right-hand side policy
+		std::uint64_t rhs;
+		/// Effective access granted by the merged policy
+		std::uint64_t merged;
+	};
+
+	std::vector<Change<std::string>> paths;
+	std::vector<Change<std::uint16_t>> ports;
+
+	/// Number of path and port rules of both inputs
+	std::size_t input_rules{0};
+	/// Number of path and port rules of the merged policy
+	std::size_t merged_rules{0};
+};
+
+/**
+ * Userspace representation of a Landlock policy
+ *
+ * A policy describes the same restrictions as a ruleset (handled access, path
+ * and port rules, scopes), but by value: paths are stored as strings and no
+ * kernel objects are created until the policy is built into a ruleset. This
+ * allows combining policies before enforcing them.
+ *
+ * Paths are made absolute and lexically normalized. As in Landlock, the access
+ * granted on a path is the union of the access of the rules on the path and
+ * all of its ancestors, and access which is not handled is always granted.
+ *
+ * Two policies can be combined exactly:
+ *
+ * - intersect() yields a single policy allowing only what both policies allow.
+ *   Enforcing it as one layer is equivalent to enforcing both policies on top
+ *   of each other, which saves a layer.
+ * - unite() yields a single policy allowing what either policy allows.
+ */
+class LLPP_EXPORT Policy
+{
+public:
+	using PathRules = std::map<std::string, std::uint64_t, std::less<>>;
+	using PortRules = std::map<std::uint16_t, std::uint64_t>;
+
+	/**
+	 * Handle the filesystem action access
+	 */
+	Policy& handle(const action::FsAction& access);
+
+	/**
+	 * Handle the network action access
+	 */
+	Policy& handle(const action::NetAction& access);
+
+	/**
+	 * Restrict the scope scp
+	 */
+	Policy& restrict(const Scope& scp);
+
+	/**
+	 * Allow access beneath path
+	 *
+	 * Relative paths are interpreted relative to the current working
+	 * directory.
+	 */
+	Policy& allow(
+		const std::filesystem::path& path,
+		const action::FsAction& access
+	);
+
+	/**
+	 * Allow access to port
+	 */
+	Policy& allow(std::uint16_t port, const action::NetAction& access);
+
+	[[nodiscard]] std::uint64_t handled_access_fs() const noexcept
+	{
+		return handled_access_fs_;
+	}
+
+	[[nodiscard]] std::uint64_t handled_access_net() const noexcept
+	{
+		return handled_access_net_;
+	}
+
+	[[nodiscard]] std::uint64_t scoped() const noexcept
+	{
+		return scoped_;
+	}
+
+	[[nodiscard]] const PathRules& path_rules() const noexcept
+	{
+		return path_rules_;
+	}
+
+	[[nodiscard]] const PortRules& port_rules() const noexcept
+	{
+		return port_rules_;
+	}
+
+	/**
+	 * Get the handled filesystem access granted beneath path
+	 *
+	 * path must be absolute and lexically normalized.
+	 */
+	[[nodiscard]] std::uint64_t effective_access(std::string_view path
+	) const;
+
+	/**
+	 * Get the handled network access granted for port
+	 */
+	[[nodiscard]] std::uint64_t effective_access(std::uint16_t port
+	) const;
+
+	/**
+	 * Create a policy allowing only what both lhs and rhs allow
+	 */
+	static Policy intersect(const Policy& lhs, const Policy& rhs);
+	static Policy
+	intersect(const Policy& lhs, const Policy& rhs, MergeReport& report);
+
+	/**
+	 * Create a policy allowing what either lhs or rhs allows
+	 */
+	static Policy unite(const Policy& lhs, const Policy& rhs);
+	static Policy
+	unite(const Policy& lhs, const Policy& rhs, MergeReport& report);
+
+#ifndef LLPP_NO_EXCEPTIONS
+	/**
+	 * Create a ruleset enforcing this policy
+	 *
+	 * Access not supported by the running kernel is dropped as usual.
+	 *
+	 * @throws std::invalid_argument If the policy handles nothing
+	 *
+	 * @throws std::system_error If a path cannot be opened or a syscall
+	 * fails
+	 */
+	[[nodiscard]] std::unique_ptr<Ruleset>
+	build(Backend& backend = Backend::system()) const;
+#endif
+
+	/**
+	 * Create a ruleset enforcing this policy without throwing
+	 *
+	 * On failure, ec is set and nullptr is returned.
+	 */
+	[[nodiscard]] std::unique_ptr<Ruleset>
+	build(Backend& backend, std::error_code& ec) const;
+
+	/**
+	 * Shorthand for intersect()
+	 */
+	friend Policy operator&(const Policy& lhs, const Policy& rhs)
+	{
+		return intersect(lhs, rhs);
+	}
+
+	/**
+	 * Shorthand for unite()
+	 */
+	friend Policy operator|(const Policy& lhs, const Policy& rhs)
+	{
+		return unite(lhs, rhs);
+	}
+
+	friend bool operator==(const Policy&, const Policy&) = default;
+
+private:
+	/**
+	 * Combine two policies, applying combine to the access allowed by both
+	 * sides (including unhandled access) for each object
+	 */
+	template <typename CombineF>
+	static Policy merge(
+		const Policy& lhs,
+		const Policy& rhs,
+		std::uint64_t handled_fs,
+		std::uint64_t handled_net,
+		CombineF combine,
+		MergeReport& report
+	);
+
+	std::uint64_t handled_access_fs_{0};
+	std::uint64_t handled_access_net_{0};
+	std::uint64_t scoped_{0};
+	PathRules path_rules_;
+	PortRules port_rules_;
+};
+} // namespace landlock
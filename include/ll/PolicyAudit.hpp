@@ -0,0 +1,217 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/types.h>
+
+#include <ll/Policy.hpp>
+#include <ll/Ruleset.hpp>
+#include <ll/config.h>
+#include <ll/coredefs.hpp>
+
+namespace landlock
+{
+/**
+ * Audit of the filesystem access a policy exposes
+ *
+ * The audit walks directory trees and classifies every file and directory by
+ * the filesystem access it would be allowed under one or more stacked layers.
+ * Like the kernel, and unlike AccessEvaluator, it matches rules by inode while
+ * walking down from the root directory, so rules on symbolic links, bind
+ * mounts and hard links apply as they would after enforcing. Symbolic links
+ * are classified themselves, but not followed.
+ *
+ * The walk is parallel: each thread reads directories with getdents64(2) and
+ * keeps the subdirectories it finds in its own queue, from which idle threads
+ * steal the oldest entries, i.e. the largest remaining subtrees.
+ *
+ * Reported access masks only contain access handled by at least one layer.
+ * Files only report the access which applies to files (execute, write_file,
+ * read_file, truncate and ioctl_dev), directories report all access.
+ */
+class LLPP_EXPORT PolicyAudit
+{
+public:
+	/// Maximum number of stacked layers supported by Landlock
+	constexpr static std::size_t MAX_LAYERS = 16;
+
+	/**
+	 * Callback for every audited file and directory
+	 *
+	 * It is called concurrently from the walking threads.
+	 */
+	using Visitor = std::function<
+		void(std::string_view path, bool dir, std::uint64_t access)>;
+
+	struct Options {
+		/// Number of walking threads, or 0 for the number of CPUs
+		std::size_t threads{0};
+		/// Do not descend into directories on other filesystems
+		bool one_file_system{false};
+		/// Called for every entry if set
+		Visitor visitor;
+	};
+
+	/**
+	 * Number of entries with the same access
+	 */
+	struct Counts {
+		std::uint64_t dirs;
+		std::uint64_t files;
+	};
+
+	/**
+	 * Entry whose access differs from the access it inherits from its
+	 * parent directory, i.e. the root of a region of equal access
+	 */
+	struct Region {
+		std::string path;
+		bool dir;
+		std::uint64_t access;
+	};
+
+	struct Report {
+		/// Number of entries by access mask
+		std::map<std::uint64_t, Counts> by_access;
+		/// Regions sorted by path, starting with the roots
+		std::vector<Region> regions;
+		/// Directories which could not be read
+		std::uint64_t errors;
+	};
+
+#ifndef LLPP_NO_EXCEPTIONS
+	/**
+	 * Add a ruleset as the next layer
+	 *
+	 * @throws std::system_error If a rule's file cannot be examined, the
+	 * rules of the ruleset are not known (see Ruleset::rules_known()) or
+	 * more than MAX_LAYERS layers are added
+	 */
+	PolicyAudit& add_layer(const Ruleset& ruleset);
+
+	/**
+	 * Add a policy as the next layer
+	 *
+	 * This does not need Landlock support, so policies can be audited on
+	 * any system.
+	 *
+	 * @throws std::system_error If a rule path does not exist or more than
+	 * MAX_LAYERS layers are added
+	 */
+	PolicyAudit& add_layer(const Policy& policy);
+#endif
+
+	/**
+	 * Add a ruleset as the next layer without throwing
+	 *
+	 * A ruleset which is not active() forms a layer handling nothing. An
+	 * active ruleset whose rules are not known, e.g. one received by
+	 * RulesetClient or instantiated from a PolicyTemplate, sets ec to
+	 * std::errc::not_supported, since it would be reported as denying
+	 * everything it handles. On failure, ec is set and the audit is
+	 * unchanged.
+	 */
+	PolicyAudit& add_layer(const Ruleset& ruleset, std::error_code& ec);
+
+	/**
+	 * Add a policy as the next layer without throwing
+	 *
+	 * On failure, ec is set and the audit is unchanged.
+	 */
+	PolicyAudit& add_layer(const Policy& policy, std::error_code& ec);
+
+	/**
+	 * Get the number of layers
+	 */
+	[[nodiscard]] std::size_t layer_count() const noexcept
+	{
+		return handled_.size();
+	}
+
+#ifndef LLPP_NO_EXCEPTIONS
+	/**
+	 * Walk the directory trees beneath roots
+	 *
+	 * @throws std::system_error If a root cannot be resolved
+	 */
+	[[nodiscard]] Report run(
+		const std::vector<std::filesystem::path>& roots,
+		const Options& options
+	) const;
+
+	/**
+	 * Walk the directory trees beneath roots with the default options
+	 *
+	 * @throws std::system_error If a root cannot be resolved
+	 */
+	[[nodiscard]] Report run(const std::vector<std::filesystem::path>& roots
+	) const;
+#endif
+
+	/**
+	 * Walk the directory trees beneath roots without throwing
+	 *
+	 * Directories beneath the roots which cannot be read are counted in
+	 * Report::errors. On failure to resolve a root, ec is set and an
+	 * empty report is returned.
+	 */
+	[[nodiscard]] Report run(
+		const std::vector<std::filesystem::path>& roots,
+		const Options& options,
+		std::error_code& ec
+	) const;
+
+private:
+	using Grants = std::array<std::uint64_t, MAX_LAYERS>;
+
+	struct InodeGrants {
+		dev_t dev;
+		Grants access;
+	};
+
+	/// Rule of a layer, identified by the inode of its path
+	struct InodeRule {
+		dev_t dev;
+		ino_t ino;
+		std::uint64_t access;
+	};
+
+	class Walk;
+
+	void add_layer(
+		std::uint64_t handled,
+		const std::vector<InodeRule>& rules
+	);
+
+	/**
+	 * Get the rule of the inode, or nullptr
+	 */
+	[[nodiscard]] const Grants* rule(dev_t dev, ino_t ino) const noexcept;
+
+	/**
+	 * Add the rule of the inode, if any, to granted
+	 */
+	void
+	apply_rule(dev_t dev, ino_t ino, Grants& granted) const noexcept;
+
+	/**
+	 * Get the allowed access from the access granted in each layer
+	 */
+	[[nodiscard]] std::uint64_t allowed(const Grants& granted
+	) const noexcept;
+
+	std::vector<std::uint64_t> handled_;
+	std::uint64_t audited_{0};
+	std::unordered_map<ino_t, std::vector<InodeGrants>> rules_;
+};
+} // namespace landlock
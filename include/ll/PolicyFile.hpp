@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <ll/ActionType.hpp>
+#include <ll/Policy.hpp>
+#include <ll/Scope.hpp>
+#include <ll/config.h>
+#include <ll/coredefs.hpp>
+
+namespace landlock
+{
+/**
+ * Error reported when reading a policy file
+ */
+struct PolicyFileError {
+	/// Line number of the error, starting at 1
+	std::size_t line{0};
+	std::string message;
+};
+
+/**
+ * Text format for policies
+ *
+ * A policy file contains one directive per line. Empty lines and lines
+ * starting with '#' are ignored. The directives are:
+ *
+ *     handle fs <actions>
+ *     handle net <actions>
+ *     scope <scopes>
+ *     path <actions> <path>
+ *     port <actions> <port>
+ *
+ * Actions and scopes are comma-separated lists of names, which are the names
+ * of the constants in landlock::action and landlock::scope without prefix in
+ * lower case (e.g. read_file, bind_tcp, abstract_unix_socket). For
+ * filesystem actions, "ro" stands for execute, read_file and read_dir, and
+ * "all" for all filesystem actions. For network actions, "all" stands for all
+ * network actions. Names of actions not supported at compile time are
+ * accepted and ignored. The path extends to the end of the line and may
+ * contain spaces.
+ */
+class LLPP_EXPORT PolicyFile
+{
+public:
+	PolicyFile() = delete;
+
+	/**
+	 * Read a policy file, adding its directives to policy
+	 *
+	 * @return false, if the file is malformed, with error set; true,
+	 * otherwise
+	 */
+	static bool read(
+		std::istream& in, Policy& policy, PolicyFileError& error
+	);
+
+	/**
+	 * Apply a single directive to policy
+	 *
+	 * @return false, if the directive is malformed, with message set;
+	 * true, otherwise
+	 */
+	static bool
+	apply(std::string_view directive, Policy& policy, std::string& message);
+
+	/**
+	 * Write policy in the policy file format
+	 *
+	 * Access unknown at compile time is omitted.
+	 */
+	static void write(std::ostream& out, const Policy& policy);
+
+	/**
+	 * Parse a comma-separated list of filesystem actions
+	 */
+	static std::optional<action::FsAction> fs_actions(std::string_view names
+	);
+
+	/**
+	 * Get the comma-separated names of the filesystem actions in mask
+	 *
+	 * Access unknown at compile time is omitted.
+	 */
+	static std::string fs_names(std::uint64_t mask);
+
+	/**
+	 * Parse a comma-separated list of network actions
+	 */
+	static std::optional<action::NetAction>
+	net_actions(std::string_view names);
+
+	/**
+	 * Parse a comma-separated list of scopes
+	 */
+	static std::optional<Scope> scopes(std::string_view names);
+};
+} // namespace landlock
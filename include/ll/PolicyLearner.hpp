@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <string_view>
+
+#include <ll/ActionType.hpp>
+#include <ll/Policy.hpp>
+#include <ll/config.h>
+#include <ll/coredefs.hpp>
+
+namespace landlock
+{
+/**
+ * Derivation of compact policies from recorded accesses
+ *
+ * The learner collects the accesses a program actually performed, e.g. from
+ * a trace written by the llpp-learn interposer, and turns them into a policy
+ * allowing exactly these accesses with few rules:
+ *
+ * - Accesses to the same path or port are merged into one rule.
+ * - Once at least collapse_threshold paths directly beneath a directory have
+ *   rules, they are replaced by one rule on the directory granting the union
+ *   of their access. This is repeated up the tree.
+ * - Rules granting nothing beyond the access inherited from their ancestors
+ *   are dropped, and the remaining rules only grant the access not inherited.
+ *
+ * Components of the form /proc/<pid> are replaced by /proc/self, since
+ * process IDs differ between runs.
+ *
+ * Traces are text files with one record per line:
+ *
+ *     fs <access> <path>
+ *     net <access> <port>
+ *     lost <count>
+ *
+ * access is a hexadecimal bitmask of LANDLOCK_ACCESS_FS_* or
+ * LANDLOCK_ACCESS_NET_* values and path is absolute and extends to the end of
+ * the line. lost reports records the tracer had to drop.
+ */
+class LLPP_EXPORT PolicyLearner
+{
+public:
+	/// Default number of rules beneath a directory which are collapsed
+	constexpr static std::size_t DEFAULT_COLLAPSE_THRESHOLD = 8;
+
+	/**
+	 * Learning statistics
+	 */
+	struct Stats {
+		/// Accesses recorded
+		std::uint64_t records;
+		/// Accesses the tracer reported as lost
+		std::uint64_t lost;
+		/// Trace lines which could not be parsed
+		std::uint64_t malformed;
+	};
+
+	/**
+	 * Record an access to path
+	 *
+	 * Relative paths are interpreted relative to the current working
+	 * directory.
+	 */
+	PolicyLearner&
+	record(std::string_view path, const action::FsAction& access);
+
+	/**
+	 * Record an access to port
+	 */
+	PolicyLearner& record(
+		std::uint16_t port, const action::NetAction& access
+	);
+
+	/**
+	 * Record all accesses of a trace
+	 *
+	 * Malformed lines are skipped and counted in the statistics. Access
+	 * unknown at compile time is ignored.
+	 */
+	PolicyLearner& read_trace(std::istream& in);
+
+	/**
+	 * Move the access recorded for paths which do not exist to their
+	 * closest existing ancestor
+	 *
+	 * Rules can only be added for existing paths, but programs access
+	 * temporary files which are gone by the time the policy is created.
+	 * The access to such a path is granted beneath its ancestor instead,
+	 * which also covers the file when it is created again.
+	 *
+	 * @return The number of paths moved
+	 */
+	std::size_t relocate_missing();
+
+	/**
+	 * Create a policy allowing the recorded accesses
+	 *
+	 * The policy handles all filesystem and network actions known at
+	 * compile time except FS_IOCTL_DEV, which the interposer does not
+	 * record, so anything else not recorded is denied.
+	 *
+	 * @param collapse_threshold Minimum number of rules directly beneath a
+	 * directory to replace them by a rule on the directory, or 0 to never
+	 * collapse rules
+	 */
+	[[nodiscard]] Policy policy(
+		std::size_t collapse_threshold = DEFAULT_COLLAPSE_THRESHOLD
+	) const;
+
+	[[nodiscard]] Stats stats() const noexcept
+	{
+		return stats_;
+	}
+
+private:
+	void record_fs(std::string_view path, std::uint64_t access);
+
+	std::map<std::string, std::uint64_t, std::less<>> paths_;
+	std::map<std::uint16_t, std::uint64_t> ports_;
+	Stats stats_{0, 0, 0};
+};
+} // namespace landlock
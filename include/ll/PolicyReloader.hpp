@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <system_error>
+
+#include <ll/Backend.hpp>
+#include <ll/Policy.hpp>
+#include <ll/config.h>
+#include <ll/coredefs.hpp>
+
+namespace landlock
+{
+/**
+ * Helper for tightening the enforced policy on configuration reloads
+ *
+ * Landlock restrictions can only be tightened, so applying a narrower policy
+ * does not require a new process: enforcing an additional layer on top of the
+ * current ones suffices. The reloader tracks the policy effectively enforced
+ * through it, which is the intersection of all layers it enforced. On reload,
+ * it checks that the new policy does not allow anything the current one
+ * denies, and enforces a minimal layer handling only the access which
+ * actually changes.
+ *
+ * A process should use a single reloader, since the kernel limits the number
+ * of stacked layers and each reloader only knows about its own layers.
+ */
+class LLPP_EXPORT PolicyReloader
+{
+public:
+	/**
+	 * Create a reloader for a process without enforced policy
+	 */
+	explicit PolicyReloader(Backend& backend = Backend::system()) noexcept;
+
+	/**
+	 * Create a reloader for a process which already enforces enforced
+	 *
+	 * Reloads are then checked against enforced.
+	 */
+	explicit PolicyReloader(
+		Policy enforced, Backend& backend = Backend::system()
+	) noexcept;
+
+	/**
+	 * Get the policy currently enforced, if any
+	 */
+	[[nodiscard]] const std::optional<Policy>& enforced() const noexcept
+	{
+		return enforced_;
+	}
+
+	/**
+	 * Get the number of layers enforced by this reloader
+	 */
+	[[nodiscard]] std::size_t layer_count() const noexcept
+	{
+		return layer_count_;
+	}
+
+	/**
+	 * Check whether next allows nothing beyond the enforced policy
+	 *
+	 * Always true if no policy is enforced yet.
+	 */
+	[[nodiscard]] bool narrower(const Policy& next) const;
+
+	/**
+	 * Compute the minimal layer turning the enforced policy into next
+	 *
+	 * Enforcing the returned policy on top of the enforced one is
+	 * equivalent to enforcing next. It only handles the access which
+	 * differs between both policies, so it is empty (handles nothing) if
+	 * next is equivalent to the enforced policy. If no policy is enforced
+	 * yet, next is returned.
+	 *
+	 * next must be narrower() than the enforced policy.
+	 */
+	[[nodiscard]] Policy delta(const Policy& next) const;
+
+#ifndef LLPP_NO_EXCEPTIONS
+	/**
+	 * Tighten the enforced policy to next
+	 *
+	 * If next is equivalent to the enforced policy, no layer is added.
+	 *
+	 * @throws std::system_error With std::errc::operation_not_permitted if
+	 * next would widen the enforced policy, in which case nothing is
+	 * changed, or if building or enforcing the layer fails
+	 */
+	void reload(const Policy& next);
+#endif
+
+	/**
+	 * Tighten the enforced policy to next without throwing
+	 *
+	 * On failure, ec is set and the tracked policy is unchanged.
+	 */
+	void reload(const Policy& next, std::error_code& ec);
+
+private:
+	Backend* backend_;
+	std::optional<Policy> enforced_;
+	std::size_t layer_count_{0};
+};
+} // namespace landlock
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <system_error>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <ll/ActionType.hpp>
+#include <ll/Backend.hpp>
+#include <ll/HandleCache.hpp>
+#include <ll/Policy.hpp>
+#include <ll/Ruleset.hpp>
+#include <ll/config.h>
+#include <ll/coredefs.hpp>
+
+namespace landlock
+{
+/**
+ * Policy with parameters, prepared once and instantiated cheaply
+ *
+ * Many sandboxes often share one policy except for a few paths and ports,
+ * e.g. a root directory and a port per tenant. A template holds the shared
+ * part as a Policy and declares the parameters with path_param() and
+ * port_param(). prepare() then queries the ABI version, folds all access masks
+ * to what the kernel supports and opens the fixed paths once. instantiate()
+ * only substitutes the parameters and issues the syscalls: one to create the
+ * ruleset, one per rule, and an open(2) and close(2) per path parameter given
+ * as a path.
+ *
+ * Instances are adopted rulesets (see Ruleset::adopt()): their accessors
+ * report the handled access, but rules() is empty. A template may be
+ * instantiated from multiple threads once it is prepared.
+ */
+class LLPP_EXPORT PolicyTemplate
+{
+public:
+	/// Value of a path parameter: a path, or a file descriptor opened
+	/// e.g. with O_PATH which the caller keeps ownership of
+	using PathArg = std::variant<std::filesystem::path, int>;
+
+	/**
+	 * Parameter values of one instance
+	 */
+	struct Params {
+		/// Values in the order of the path_param() calls
+		std::vector<PathArg> paths;
+		/// Values in the order of the port_param() calls
+		std::vector<std::uint16_t> ports;
+	};
+
+	/**
+	 * Create a template with the rules of base and no parameters
+	 */
+	explicit PolicyTemplate(Policy base);
+
+	/**
+	 * Declare a path parameter allowed access
+	 *
+	 * Only access handled by the base policy is allowed. Like for fixed
+	 * paths, only action::FS_FILE_ACTIONS are allowed for values which
+	 * are not directories.
+	 *
+	 * @return The index of the parameter in Params::paths
+	 */
+	std::size_t path_param(const action::FsAction& access);
+
+	/**
+	 * Declare a port parameter allowed access
+	 *
+	 * Only access handled by the base policy is allowed.
+	 *
+	 * @return The index of the parameter in Params::ports
+	 */
+	std::size_t port_param(const action::NetAction& access);
+
+#ifndef LLPP_NO_EXCEPTIONS
+	/**
+	 * Prepare instantiation for the running kernel
+	 *
+	 * The backend must outlive the template. Parameters must be declared
+	 * before.
+	 *
+	 * @throws std::system_error If the base policy handles nothing, a
+	 * fixed path cannot be opened or the ABI version query fails
+	 */
+	void prepare(Backend& backend = Backend::system());
+#endif
+
+	/**
+	 * Prepare instantiation without throwing
+	 *
+	 * If the base policy handles nothing, ec is set to
+	 * std::errc::invalid_argument. On failure, the template stays
+	 * unprepared.
+	 */
+	void prepare(Backend& backend, std::error_code& ec);
+
+	[[nodiscard]] bool prepared() const noexcept
+	{
+		return backend_ != nullptr;
+	}
+
+	[[nodiscard]] const Policy& base() const noexcept
+	{
+		return base_;
+	}
+
+#ifndef LLPP_NO_EXCEPTIONS
+	/**
+	 * Create a ruleset with the given parameter values
+	 *
+	 * @throws std::system_error If the template is not prepared, the
+	 * number of values does not match the parameters, a path cannot be
+	 * opened or a syscall fails
+	 */
+	[[nodiscard]] std::unique_ptr<Ruleset> instantiate(const Params& params
+	) const;
+#endif
+
+	/**
+	 * Create a ruleset with the given parameter values without throwing
+	 *
+	 * If the template is not prepared or the number of values does not
+	 * match the parameters, ec is set to std::errc::invalid_argument. On
+	 * failure, nullptr is returned.
+	 */
+	[[nodiscard]] std::unique_ptr<Ruleset>
+	instantiate(const Params& params, std::error_code& ec) const;
+
+private:
+	/// Fixed paths sharing the same access
+	struct PathGroup {
+		std::uint64_t access;
+		std::vector<HandleCache::Handle> handles;
+	};
+
+	Policy base_;
+	std::vector<std::uint64_t> path_params_;
+	std::vector<std::uint64_t> port_params_;
+
+	// Computed by prepare()
+	Backend* backend_{nullptr};
+	int abi_version_{0};
+	landlock_ruleset_attr attr_{};
+	bool active_{false};
+	std::vector<PathGroup> paths_;
+	std::vector<std::pair<std::uint16_t, std::uint64_t>> ports_;
+	/// Supported access of the parameters
+	std::vector<std::uint64_t> path_access_;
+	std::vector<std::uint64_t> port_access_;
+};
+} // namespace landlock
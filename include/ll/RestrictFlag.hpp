@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+
+#include <ll/CodedType.hpp>
+#include <ll/config.h>
+
+namespace landlock
+{
+/**
+ * Flag for landlock_restrict_self controlling the enforcement
+ *
+ * The tag value differs from Scope, so flags and scopes cannot be mixed up.
+ */
+using RestrictFlag =
+	CodedType<typing::ValWrapper<std::uint64_t, 1>, std::uint64_t>;
+
+/**
+ * Definitions for flags of landlock_restrict_self
+ *
+ * These control the audit logging of access denials, which can be costly on
+ * hot paths with expected denials.
+ */
+namespace restrict_flag
+{
+constexpr static RestrictFlag INVALID_FLAG{0, 0};
+
+// NOLINTBEGIN(*-macro-usage)
+#define DECL_RESTRICT_FLAG(flag, abi)                                          \
+	constexpr static RestrictFlag flag                                     \
+	{                                                                      \
+		(LANDLOCK_RESTRICT_SELF_##flag), abi                           \
+	}
+#define DECL_INVALID_RESTRICT_FLAG(flag)                                       \
+	constexpr static RestrictFlag flag = INVALID_FLAG
+
+#if LLPP_BUILD_LANDLOCK_API >= 7
+# define DECL_RESTRICT_FLAG_ABI7(flag) DECL_RESTRICT_FLAG(flag, 7)
+#else
+# define DECL_RESTRICT_FLAG_ABI7(flag) DECL_INVALID_RESTRICT_FLAG(flag)
+#endif
+
+/// Do not log denials of the enforcing process until it calls execve(2)
+DECL_RESTRICT_FLAG_ABI7(LOG_SAME_EXEC_OFF);
+/// Log denials of programs executed after enforcement
+DECL_RESTRICT_FLAG_ABI7(LOG_NEW_EXEC_ON);
+/// Do not log denials of nested domains created later on
+DECL_RESTRICT_FLAG_ABI7(LOG_SUBDOMAINS_OFF);
+
+#undef DECL_RESTRICT_FLAG
+#undef DECL_INVALID_RESTRICT_FLAG
+#undef DECL_RESTRICT_FLAG_ABI7
+// NOLINTEND(*-macro-usage)
+} // namespace restrict_flag
+} // namespace landlock
@@ -1,9 +1,13 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
+#include <system_error>
 #include <vector>
 
 #include <ll/ActionType.hpp>
+#include <ll/HandleCache.hpp>
 #include <ll/config.h>
 #include <ll/coredefs.hpp>
 #include <ll/typing.hpp>
@@ -97,7 +101,10 @@ private:
 /**
  * Rule for access to files beneath a path in the filesystem
  *
- * This rule controls access to files and directories beneath a path.
+ * This rule controls access to files and directories beneath a path. Paths
+ * are opened through HandleCache::global(), so rules for the same path share
+ * a single O_PATH file descriptor. For paths which are not directories, only
+ * the actions in action::FS_FILE_ACTIONS are allowed and the others dropped.
  */
 class LLPP_EXPORT PathBeneathRule :
 	public Rule<
@@ -108,6 +115,21 @@ class LLPP_EXPORT PathBeneathRule :
 {
 public:
 	PathBeneathRule() = default;
+
+	/**
+	 * Create a rule for a ruleset with the given ABI version and handled
+	 * filesystem access
+	 *
+	 * If the rule cannot take effect in such a ruleset, because max_abi is
+	 * below MIN_ABI or no filesystem access is handled, add_path() only
+	 * counts paths in skipped_paths() without opening them. Use
+	 * Ruleset::path_beneath_rule() to create a rule for a ruleset.
+	 */
+	PathBeneathRule(int max_abi, std::uint64_t handled_access) noexcept :
+		open_paths_(max_abi >= MIN_ABI && handled_access != 0)
+	{
+	}
+
 	PathBeneathRule(const PathBeneathRule&) = delete;
 	PathBeneathRule& operator=(const PathBeneathRule&) = delete;
 	PathBeneathRule(PathBeneathRule&&) = default;
@@ -117,10 +139,45 @@ public:
 	[[nodiscard]] std::vector<Attr> generate(int max_abi
 	) const noexcept override;
 
+#ifndef LLPP_NO_EXCEPTIONS
+	/**
+	 * Add a path to this rule
+	 *
+	 * @throws std::system_error If the path cannot be opened
+	 */
 	PathBeneathRule& add_path(const std::filesystem::path& path);
+#endif
+
+	/**
+	 * Add a path to this rule without throwing
+	 *
+	 * On failure, ec is set to the error returned by open(2) and the path
+	 * is not added. On success, ec is cleared.
+	 */
+	PathBeneathRule&
+	add_path(const std::filesystem::path& path, std::error_code& ec);
+
+	/**
+	 * Add an already opened path to this rule
+	 *
+	 * Like add_path(), the handle is only counted in skipped_paths() if the
+	 * rule cannot take effect. A null handle is ignored.
+	 */
+	PathBeneathRule& add_handle(HandleCache::Handle handle);
+
+	/**
+	 * Get the number of paths which were not opened because the rule
+	 * cannot take effect
+	 */
+	[[nodiscard]] std::size_t skipped_paths() const noexcept
+	{
+		return skipped_paths_;
+	}
 
 private:
-	std::vector<int> path_fds_;
+	std::vector<HandleCache::Handle> path_handles_;
+	bool open_paths_{true};
+	std::size_t skipped_paths_{0};
 };
 
 /**
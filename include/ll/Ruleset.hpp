@@ -3,6 +3,8 @@
 #include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <system_error>
 #include <variant>
 #include <vector>
 
@@ -11,6 +13,8 @@ extern "C" {
 }
 
 #include <ll/ActionType.hpp>
+#include <ll/Backend.hpp>
+#include <ll/RestrictFlag.hpp>
 #include <ll/Rule.hpp>
 #include <ll/RuleType.hpp>
 #include <ll/Scope.hpp>
@@ -33,8 +37,10 @@ public:
 	template <ActionRuleType supp>
 	using ActionVec = std::vector<ActionType<supp>>;
 	using ScopeVec = std::vector<Scope>;
+	using RestrictFlagVec = std::vector<RestrictFlag>;
 	using RuleVariant = std::variant<PathBeneathRule, NetPortRule>;
 
+#ifndef LLPP_NO_EXCEPTIONS
 	/**
 	 * Create a new ruleset for filtering the specified filesystem actions
 	 *
@@ -44,6 +50,8 @@ public:
 	 * @param handled_access_fs Actions to filter with this ruleset. Any
 	 * actions not listed here are not filtered.
 	 *
+	 * @throws std::invalid_argument If neither access nor scope is handled
+	 *
 	 * @throws std::system_error If the syscall fails
 	 */
 	LLPP_EXPORT explicit Ruleset(
@@ -53,12 +61,82 @@ public:
 			{},
 		const ScopeVec& scoped = {}
 	);
+
+	/**
+	 * Create a new ruleset issuing its kernel calls through backend
+	 *
+	 * The backend must outlive the ruleset.
+	 *
+	 * @throws std::invalid_argument If neither access nor scope is handled
+	 *
+	 * @throws std::system_error If the backend call fails
+	 */
+	LLPP_EXPORT explicit Ruleset(
+		Backend& backend,
+		const ActionVec<ActionRuleType::PATH_BENEATH>&
+			handled_access_fs = {},
+		const ActionVec<ActionRuleType::NET_PORT>& handled_access_net =
+			{},
+		const ScopeVec& scoped = {}
+	);
+#endif
+
+	/**
+	 * Create a new ruleset without throwing
+	 *
+	 * This behaves like the throwing constructor, but reports errors via ec
+	 * instead. If neither access nor scope is handled, ec is set to
+	 * std::errc::invalid_argument. If ec is set after construction, the
+	 * ruleset is unusable and landlock_enabled() returns false.
+	 */
+	LLPP_EXPORT Ruleset(
+		const ActionVec<ActionRuleType::PATH_BENEATH>&
+			handled_access_fs,
+		const ActionVec<ActionRuleType::NET_PORT>& handled_access_net,
+		const ScopeVec& scoped,
+		std::error_code& ec
+	);
+
+	/**
+	 * Create a new ruleset issuing its kernel calls through backend without
+	 * throwing
+	 *
+	 * The backend must outlive the ruleset.
+	 */
+	LLPP_EXPORT Ruleset(
+		Backend& backend,
+		const ActionVec<ActionRuleType::PATH_BENEATH>&
+			handled_access_fs,
+		const ActionVec<ActionRuleType::NET_PORT>& handled_access_net,
+		const ScopeVec& scoped,
+		std::error_code& ec
+	);
 	Ruleset(const Ruleset&) = delete;
 	Ruleset& operator=(const Ruleset&) = delete;
 	Ruleset(Ruleset&&) = delete;
 	Ruleset& operator=(Ruleset&&) = delete;
 	LLPP_EXPORT ~Ruleset();
 
+	/**
+	 * Take ownership of an existing ruleset file descriptor
+	 *
+	 * This wraps a ruleset created elsewhere, e.g. by another process which
+	 * passed it over a UNIX socket. The handled access and scopes are not
+	 * checked against the file descriptor and are only used for the
+	 * accessors. The rules of the ruleset are not known, so rules() is
+	 * empty and rules_known() is false.
+	 *
+	 * The backend must outlive the ruleset.
+	 */
+	LLPP_EXPORT static std::unique_ptr<Ruleset> adopt(
+		int ruleset_fd,
+		int abi_version,
+		std::uint64_t handled_access_fs,
+		std::uint64_t handled_access_net,
+		std::uint64_t scoped,
+		Backend& backend = Backend::system()
+	);
+
 	/**
 	 * Return whether Landlock support is enabled on the system
 	 *
@@ -72,6 +150,20 @@ public:
 		return abi_version_ > 0;
 	}
 
+	/**
+	 * Return whether enforcing this ruleset restricts anything
+	 *
+	 * This is false if Landlock is not supported, or if none of the
+	 * handled access and scopes is supported by the kernel or the headers
+	 * the library was compiled with. No kernel ruleset is created then,
+	 * rules are dropped without generating attributes and enforce() only
+	 * sets NO_NEW_PRIVS.
+	 */
+	[[nodiscard]] bool active() const noexcept
+	{
+		return ruleset_fd_ >= 0;
+	}
+
 	/**
 	 * Get the probed Landlock ABI version
 	 */
@@ -94,11 +186,104 @@ public:
 		return std::min(abi_version_, LLPP_BUILD_LANDLOCK_API);
 	}
 
+	/**
+	 * Get the backend this ruleset issues its kernel calls through
+	 */
+	[[nodiscard]] Backend& backend() const noexcept
+	{
+		return *backend_;
+	}
+
+	/**
+	 * Get the filesystem actions handled by this ruleset
+	 *
+	 * This only contains actions supported by the running kernel.
+	 */
+	[[nodiscard]] std::uint64_t handled_access_fs() const noexcept
+	{
+		return handled_access_fs_;
+	}
+
+	/**
+	 * Get the network actions handled by this ruleset
+	 *
+	 * This only contains actions supported by the running kernel.
+	 */
+	[[nodiscard]] std::uint64_t handled_access_net() const noexcept
+	{
+		return handled_access_net_;
+	}
+
+	/**
+	 * Get the scopes restricted by this ruleset
+	 *
+	 * This only contains scopes supported by the running kernel.
+	 */
+	[[nodiscard]] std::uint64_t scoped() const noexcept
+	{
+		return scoped_;
+	}
+
+	/**
+	 * Get all rules added to this ruleset
+	 */
+	[[nodiscard]] const std::vector<RuleVariant>& rules() const noexcept
+	{
+		return added_rules_;
+	}
+
+	/**
+	 * Return whether rules() lists all rules of the ruleset
+	 *
+	 * This is false for rulesets created with adopt(), whose rules were
+	 * added elsewhere.
+	 */
+	[[nodiscard]] bool rules_known() const noexcept
+	{
+		return rules_known_;
+	}
+
+	/**
+	 * Get the number of rules dropped by add_rule()
+	 *
+	 * Rules are dropped if the ruleset is not active() or if they do not
+	 * generate any attributes, e.g. because none of their actions is
+	 * supported.
+	 */
+	[[nodiscard]] std::size_t skipped_rules() const noexcept
+	{
+		return skipped_rules_;
+	}
+
+	/**
+	 * Create an empty path beneath rule for this ruleset
+	 *
+	 * If the ruleset is not active() or handles no filesystem access, the
+	 * rule does not open the paths added to it.
+	 */
+	[[nodiscard]] PathBeneathRule path_beneath_rule() const noexcept
+	{
+		return {active() ? abi_version_ : 0, handled_access_fs_};
+	}
+
+	/**
+	 * Get the ruleset file descriptor
+	 *
+	 * This is -1 if the ruleset is not active().
+	 */
+	[[nodiscard]] int fd() const noexcept
+	{
+		return ruleset_fd_;
+	}
+
+#ifndef LLPP_NO_EXCEPTIONS
 	/**
 	 * Add a new rule to the ruleset
 	 *
 	 * The rule's generate() method is called to obtain all rules to add to
 	 * the ruleset.
+	 *
+	 * @throws std::system_error If the syscall fails
 	 */
 	template <
 		typename Self,
@@ -107,13 +292,52 @@ public:
 		int min_abi>
 	Ruleset& add_rule(Rule<Self, AttrT, supp, min_abi>&& rule)
 	{
-		for (const auto rule : rule.generate(abi_version_)) {
-			add_rule_int(rule);
+		std::error_code ec;
+		add_rule(std::move(rule), ec);
+		throw_on_error(ec);
+		return *this;
+	}
+#endif
+
+	/**
+	 * Add a new rule to the ruleset without throwing
+	 *
+	 * On failure, ec is set to the error of the first failing syscall and
+	 * the rule is not stored in the ruleset. Attributes generated before
+	 * the failing one remain registered in the kernel.
+	 *
+	 * Rules which cannot take effect are counted in skipped_rules() instead
+	 * of being stored.
+	 */
+	template <
+		typename Self,
+		typename AttrT,
+		ActionRuleType supp,
+		int min_abi>
+	Ruleset&
+	add_rule(Rule<Self, AttrT, supp, min_abi>&& rule, std::error_code& ec)
+	{
+		ec.clear();
+		if (not active()) {
+			++skipped_rules_;
+			return *this;
+		}
+
+		const auto attrs = rule.generate(abi_version_);
+		if (attrs.empty()) {
+			++skipped_rules_;
+			return *this;
+		}
+		for (const auto attr : attrs) {
+			if (not add_rule_int(attr, ec)) {
+				return *this;
+			}
 		}
 		added_rules_.emplace_back(static_cast<Self&&>(std::move(rule)));
 		return *this;
 	}
 
+#ifndef LLPP_NO_EXCEPTIONS
 	/**
 	 * Enforce this ruleset
 	 *
@@ -122,16 +346,70 @@ public:
 	 * starts restricting actions as defined by this ruleset.
 	 *
 	 * @param set_no_new_privs Run prctl(1) to set NO_NEW_PRIVS
+	 *
+	 * @throws std::system_error If prctl(2) or the syscall fails
 	 */
 	LLPP_EXPORT void enforce(bool set_no_new_privs = true) const;
 
+	/**
+	 * Enforce this ruleset with flags for landlock_restrict_self
+	 *
+	 * Flags not supported by the running kernel are dropped.
+	 *
+	 * @throws std::system_error If prctl(2) or the syscall fails
+	 */
+	LLPP_EXPORT void
+	enforce(bool set_no_new_privs, const RestrictFlagVec& flags) const;
+#endif
+
+	/**
+	 * Enforce this ruleset without throwing
+	 *
+	 * On failure, ec is set to the error of the failing call. On success,
+	 * ec is cleared.
+	 */
+	LLPP_EXPORT void
+	enforce(bool set_no_new_privs, std::error_code& ec) const noexcept;
+
+	/**
+	 * Enforce this ruleset with flags for landlock_restrict_self without
+	 * throwing
+	 */
+	LLPP_EXPORT void enforce(
+		bool set_no_new_privs,
+		const RestrictFlagVec& flags,
+		std::error_code& ec
+	) const noexcept;
+
 private:
+	friend class RulesetBuilder;
+
+	/// Tag selecting the constructor used by adopt()
+	struct AdoptTag {};
+
+	/**
+	 * Create an empty ruleset without a file descriptor
+	 */
+	Ruleset(AdoptTag tag, Backend& backend) noexcept;
+
 	/**
 	 * Read and store the running ABI version from the Landlock API
 	 *
-	 * @return true, if Landlock is available; false, otherwise
+	 * @return true, if Landlock is available; false, otherwise. If reading
+	 * the version fails for other reasons, ec is set.
 	 */
-	bool read_abi_version();
+	bool read_abi_version(std::error_code& ec) noexcept;
+
+	/**
+	 * Validate the arguments and set up the Landlock Ruleset
+	 */
+	void init(
+		const ActionVec<ActionRuleType::PATH_BENEATH>&
+			handled_access_fs,
+		const ActionVec<ActionRuleType::NET_PORT>& handled_access_net,
+		const ScopeVec& scoped,
+		std::error_code& ec
+	) noexcept;
 
 	/**
 	 * Initialize the Landlock Ruleset
@@ -140,52 +418,46 @@ private:
 		const ActionVec<ActionRuleType::PATH_BENEATH>&
 			handled_access_fs,
 		const ActionVec<ActionRuleType::NET_PORT>& handled_access_net,
-		const ScopeVec& scoped
-	);
+		const ScopeVec& scoped,
+		std::error_code& ec
+	) noexcept;
 
 	template <typename AttrT>
-	void add_rule_int(const AttrT& rule)
+	bool add_rule_int(const AttrT& rule, std::error_code& ec) noexcept
 	{
 		const landlock_rule_type type =
 			RuleType<std::remove_reference_t<AttrT>>::TYPE_CODE;
 		if (type == INVALID_RULE_TYPE) {
-			return;
+			return true;
 		}
 
-		const int res = landlock_add_rule(ruleset_fd_, type, &rule);
-		assert_res(res);
+		const int res = backend_->add_rule(ruleset_fd_, type, &rule, 0);
+		return check_res(res, ec);
 	}
 
 	/**
-	 * Wrapper for the SYS_landlock_create_ruleset syscall
-	 */
-	static int landlock_create_ruleset(
-		const landlock_ruleset_attr* attr,
-		std::size_t size,
-		std::uint32_t flags
-	);
-
-	/**
-	 * Wrapper for the SYS_landlock_add_rule syscall
+	 * Check a syscall result, storing errno in ec on failure
+	 *
+	 * @return true, if res indicates success; false, otherwise
 	 */
-	static int landlock_add_rule(
-		int ruleset_fd,
-		landlock_rule_type rule_type,
-		const void* rule_attr,
-		std::uint32_t flags = 0
-	);
+	static bool check_res(int res, std::error_code& ec) noexcept;
 
+#ifndef LLPP_NO_EXCEPTIONS
 	/**
-	 * Wrapper for the SYS_landlock_restrict_self syscall
+	 * Throw a std::system_error if ec is set
 	 */
-	static int
-	landlock_restrict_self(int ruleset_fd, std::uint32_t flags = 0);
-
-	static void assert_res(int res);
+	static void throw_on_error(const std::error_code& ec);
+#endif
 
+	Backend* backend_{&Backend::system()};
 	int ruleset_fd_{-1};
 	int abi_version_{0};
+	std::uint64_t handled_access_fs_{0};
+	std::uint64_t handled_access_net_{0};
+	std::uint64_t scoped_{0};
 
 	std::vector<RuleVariant> added_rules_;
+	std::size_t skipped_rules_{0};
+	bool rules_known_{true};
 };
 } // namespace landlock
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <system_error>
+
+#include <ll/Backend.hpp>
+#include <ll/Ruleset.hpp>
+#include <ll/config.h>
+#include <ll/coredefs.hpp>
+
+namespace landlock
+{
+/**
+ * Broker handing out a prebuilt ruleset over a UNIX socket
+ *
+ * Many short-lived processes sharing the same policy would each build the
+ * ruleset from scratch, opening every rule path and issuing one syscall per
+ * rule. Instead, a broker builds the ruleset once and passes a ruleset file
+ * descriptor to each client connecting to its socket, together with the
+ * information needed to enforce it. A client then only receives a single
+ * message and calls landlock_restrict_self(2), independent of the size of the
+ * policy.
+ *
+ * A ruleset file descriptor stays writable, so every client gets a fresh
+ * kernel ruleset, created from the rules of the ruleset and the paths they
+ * already opened. Rules a client adds to its ruleset therefore never reach
+ * other clients. As the rules must be known for this, rulesets created with
+ * Ruleset::adopt() cannot be brokered.
+ *
+ * The socket is a SOCK_SEQPACKET socket bound to a path in the filesystem.
+ * Access to the socket is controlled by the permissions of the path.
+ */
+class LLPP_EXPORT RulesetBroker
+{
+public:
+#ifndef LLPP_NO_EXCEPTIONS
+	/**
+	 * Create a broker for ruleset listening on socket_path
+	 *
+	 * The ruleset must outlive the broker.
+	 *
+	 * @throws std::system_error If the socket cannot be created, or with
+	 * std::errc::not_supported if the rules of an active ruleset are not
+	 * known
+	 */
+	RulesetBroker(
+		const Ruleset& ruleset, const std::filesystem::path& socket_path
+	);
+#endif
+
+	/**
+	 * Create a broker for ruleset listening on socket_path without throwing
+	 *
+	 * On failure, ec is set and the broker is unusable. If the ruleset is
+	 * active() but its rules are not known, ec is set to
+	 * std::errc::not_supported.
+	 */
+	RulesetBroker(
+		const Ruleset& ruleset,
+		const std::filesystem::path& socket_path,
+		std::error_code& ec
+	);
+	RulesetBroker(const RulesetBroker&) = delete;
+	RulesetBroker& operator=(const RulesetBroker&) = delete;
+	RulesetBroker(RulesetBroker&&) = delete;
+	RulesetBroker& operator=(RulesetBroker&&) = delete;
+
+	/**
+	 * Close the socket and remove its path
+	 */
+	~RulesetBroker();
+
+	/**
+	 * Get the listening socket, e.g. for polling in an event loop
+	 */
+	[[nodiscard]] int fd() const noexcept
+	{
+		return listen_fd_;
+	}
+
+	/**
+	 * Get the number of clients the ruleset was sent to
+	 */
+	[[nodiscard]] std::size_t served() const noexcept
+	{
+		return served_.load();
+	}
+
+	/**
+	 * Accept one client and send it the ruleset
+	 *
+	 * Blocks until a client connects. On failure, ec is set.
+	 */
+	void serve_one(std::error_code& ec);
+
+	/**
+	 * Send the ruleset over an already connected socket
+	 *
+	 * This allows handing the ruleset to processes over an inherited
+	 * socket (e.g. one end of a socketpair(2)), which receive it with
+	 * RulesetClient::receive(). On failure, ec is set.
+	 */
+	void send(int sock, std::error_code& ec) const noexcept;
+
+#ifndef LLPP_NO_EXCEPTIONS
+	/**
+	 * Serve clients until stop() is called
+	 *
+	 * @throws std::system_error If accepting clients fails
+	 */
+	void run();
+#endif
+
+	/**
+	 * Serve clients until stop() is called without throwing
+	 *
+	 * Failures to send the ruleset to a single client are ignored. If
+	 * accepting clients fails, ec is set and the function returns.
+	 */
+	void run(std::error_code& ec);
+
+	/**
+	 * Make run() return
+	 *
+	 * This is safe to call from another thread or a signal handler. The
+	 * broker does not accept clients afterwards.
+	 */
+	void stop() noexcept;
+
+private:
+	/**
+	 * Create the listening socket
+	 */
+	void listen(std::error_code& ec) noexcept;
+
+	/**
+	 * Create a new kernel ruleset with the access and rules of the ruleset
+	 *
+	 * @return The ruleset file descriptor, or -1 with ec set on failure
+	 */
+	int copy_ruleset(std::error_code& ec) const noexcept;
+
+	const Ruleset& ruleset_;
+	std::filesystem::path socket_path_;
+	int listen_fd_{-1};
+	std::atomic<bool> stopping_{false};
+	mutable std::atomic<std::size_t> served_{0};
+};
+
+/**
+ * Client for receiving rulesets from a RulesetBroker
+ */
+class LLPP_EXPORT RulesetClient
+{
+public:
+	RulesetClient() = delete;
+
+#ifndef LLPP_NO_EXCEPTIONS
+	/**
+	 * Connect to the broker at socket_path and receive its ruleset
+	 *
+	 * The backend is used for enforcing the received ruleset and must
+	 * outlive it.
+	 *
+	 * @throws std::system_error If connecting or receiving fails
+	 */
+	[[nodiscard]] static std::unique_ptr<Ruleset> fetch(
+		const std::filesystem::path& socket_path,
+		Backend& backend = Backend::system()
+	);
+#endif
+
+	/**
+	 * Connect to the broker at socket_path and receive its ruleset without
+	 * throwing
+	 *
+	 * On failure, ec is set and nullptr is returned.
+	 */
+	[[nodiscard]] static std::unique_ptr<Ruleset> fetch(
+		const std::filesystem::path& socket_path,
+		Backend& backend,
+		std::error_code& ec
+	);
+
+	/**
+	 * Receive a ruleset from a socket already connected to a broker
+	 *
+	 * This allows receiving the ruleset over an inherited socket without
+	 * connecting. On failure, ec is set and nullptr is returned.
+	 */
+	[[nodiscard]] static std::unique_ptr<Ruleset>
+	receive(int sock, Backend& backend, std::error_code& ec);
+};
+} // namespace landlock
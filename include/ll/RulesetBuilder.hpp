@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <ll/ActionType.hpp>
+#include <ll/Rule.hpp>
+#include <ll/Ruleset.hpp>
+#include <ll/config.h>
+#include <ll/coredefs.hpp>
+
+namespace landlock
+{
+/**
+ * Thread-safe collector of rules for a ruleset
+ *
+ * Ruleset::add_rule() is not thread-safe. When many threads contribute rules
+ * (e.g. plugins initializing in parallel), they can add them to a builder
+ * instead. Each thread appends to one of several independently locked shards,
+ * and the rule attributes are generated on the calling thread, so adding rules
+ * scales with the number of threads. Paths are opened by the threads when
+ * calling PathBeneathRule::add_path() before adding the rule.
+ *
+ * commit() finally registers all collected rules in the ruleset in a single
+ * step from one thread.
+ */
+class LLPP_EXPORT RulesetBuilder
+{
+public:
+	/**
+	 * Create a builder for ruleset
+	 *
+	 * The ruleset must outlive the builder and must not be modified
+	 * until the builder is committed.
+	 *
+	 * @param shards Number of independently locked shards. Defaults to the
+	 * number of hardware threads.
+	 */
+	explicit RulesetBuilder(Ruleset& ruleset, std::size_t shards = 0);
+	RulesetBuilder(const RulesetBuilder&) = delete;
+	RulesetBuilder& operator=(const RulesetBuilder&) = delete;
+	RulesetBuilder(RulesetBuilder&&) = delete;
+	RulesetBuilder& operator=(RulesetBuilder&&) = delete;
+	~RulesetBuilder();
+
+	/**
+	 * Add a rule
+	 *
+	 * This is safe to call concurrently from multiple threads. Rules which
+	 * cannot take effect are dropped and added to
+	 * Ruleset::skipped_rules() on commit().
+	 */
+	template <
+		typename Self,
+		typename AttrT,
+		ActionRuleType supp,
+		int min_abi>
+	RulesetBuilder& add_rule(Rule<Self, AttrT, supp, min_abi>&& rule)
+	{
+		if (not active_) {
+			skipped_.fetch_add(1);
+			return *this;
+		}
+
+		Entry entry{static_cast<Self&&>(std::move(rule)), {}, {}};
+		auto attrs = std::get<Self>(entry.rule).generate(abi_version_);
+		if (attrs.empty()) {
+			skipped_.fetch_add(1);
+			return *this;
+		}
+		if constexpr (std::is_same_v<Self, PathBeneathRule>) {
+			entry.path_beneath_attrs = std::move(attrs);
+		} else {
+			entry.net_port_attrs = std::move(attrs);
+		}
+
+		Shard& shard = shards_[shard_index()];
+		const std::lock_guard lock{shard.mutex};
+		shard.entries.push_back(std::move(entry));
+		return *this;
+	}
+
+	/**
+	 * Get the number of rules not yet committed
+	 */
+	[[nodiscard]] std::size_t size() const;
+
+#ifndef LLPP_NO_EXCEPTIONS
+	/**
+	 * Register all collected rules in the ruleset
+	 *
+	 * @throws std::system_error If a syscall fails. The rules not yet
+	 * registered remain in the builder.
+	 */
+	void commit();
+#endif
+
+	/**
+	 * Register all collected rules in the ruleset without throwing
+	 *
+	 * On failure, ec is set and the rules not yet registered remain in
+	 * the builder.
+	 */
+	void commit(std::error_code& ec);
+
+private:
+	struct Entry {
+		Ruleset::RuleVariant rule;
+		PathBeneathRule::AttrVec path_beneath_attrs;
+		NetPortRule::AttrVec net_port_attrs;
+	};
+
+	/// Avoid false sharing between shards locked by different threads
+	constexpr static std::size_t SHARD_ALIGNMENT = 64;
+
+	struct alignas(SHARD_ALIGNMENT) Shard {
+		std::mutex mutex;
+		std::vector<Entry> entries;
+	};
+
+	[[nodiscard]] std::size_t shard_index() const noexcept
+	{
+		const std::thread::id id = std::this_thread::get_id();
+		return std::hash<std::thread::id>{}(id) % shard_count_;
+	}
+
+	Ruleset& ruleset_;
+	int abi_version_;
+	bool active_;
+	std::atomic<std::size_t> skipped_{0};
+	std::size_t shard_count_;
+	std::unique_ptr<Shard[]> shards_; // NOLINT(*-avoid-c-arrays)
+};
+} // namespace landlock
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
+#include <vector>
+
 #include <ll/CodedType.hpp>
 
 namespace landlock
@@ -33,6 +37,31 @@ constexpr static Scope INVALID_SCOPE{0, 0};
 DECL_SCOPE_ABI6(ABSTRACT_UNIX_SOCKET);
 DECL_SCOPE_ABI6(SIGNAL);
 
+/**
+ * All scopes known at compile time
+ *
+ * Scopes not supported by the API at compile time are INVALID_SCOPE.
+ */
+constexpr static std::array<Scope, 2> SCOPES{
+	ABSTRACT_UNIX_SOCKET,
+	SIGNAL,
+};
+
+/**
+ * Split a bitmask into the known scopes it is composed of
+ */
+inline std::vector<Scope> split(std::uint64_t mask)
+{
+	std::vector<Scope> res;
+	for (const Scope& scp : SCOPES) {
+		if (scp.type_code() != 0 &&
+		    (mask & scp.type_code()) == scp.type_code()) {
+			res.push_back(scp);
+		}
+	}
+	return res;
+}
+
 #undef DECL_SCOPE
 // NOLINTEND(*-macro-usage)
 } // namespace scope
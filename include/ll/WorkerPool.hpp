@@ -0,0 +1,241 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
+#include <sys/types.h>
+
+#include <ll/Ruleset.hpp>
+#include <ll/config.h>
+#include <ll/coredefs.hpp>
+
+namespace landlock
+{
+/**
+ * Pool of pre-forked worker processes which are already sandboxed
+ *
+ * Forking a worker and enforcing its ruleset when a request arrives adds
+ * latency to the request. The pool instead keeps a fixed number of workers
+ * which have enforced the ruleset already and wait for tasks. A task is
+ * started by leasing an idle worker and sending the task over the worker's
+ * socket. Workers are used for a single lease: when the lease ends, the
+ * worker's socket is closed and it is expected to exit. A background thread
+ * replaces each worker once it exited, so forking and enforcing happen after
+ * a request rather than during the next one. The pool size therefore also
+ * bounds the number of concurrent leases.
+ *
+ * The background thread manages the workers in an epoll loop with a pidfd per
+ * worker (Linux 5.3 or newer), which reports exits without SIGCHLD handlers
+ * and without the risk of PID reuse. A worker is only handed out after it
+ * reported that the ruleset was enforced successfully.
+ *
+ * Workers are forked from the background thread, so the worker function runs
+ * in a child of a multi-threaded process, with the usual restrictions after
+ * fork(2). Before enforcing the ruleset, the worker closes all inherited
+ * close-on-exec file descriptors, including the pool's own, and fails to start
+ * if it cannot list them. Other file descriptors are inherited.
+ *
+ * All member functions are thread-safe.
+ */
+class LLPP_EXPORT WorkerPool
+{
+public:
+	/**
+	 * Function run by each worker after enforcing the ruleset
+	 *
+	 * It receives the worker's end of a SOCK_SEQPACKET socket, on which
+	 * end of file indicates the end of the lease, and returns the exit
+	 * status of the worker.
+	 */
+	using WorkerMain = std::function<int(int sock)>;
+
+	/**
+	 * Pool statistics
+	 */
+	struct Stats {
+		/// Workers forked
+		std::uint64_t spawned;
+		/// Workers which exited and were reaped
+		std::uint64_t exited;
+		/// Workers which exited before reporting that they are ready
+		std::uint64_t failed;
+		/// Workers leased
+		std::uint64_t leased;
+	};
+
+	/**
+	 * Leased worker
+	 *
+	 * The lease owns the pool's end of the worker's socket and closes it
+	 * when destroyed.
+	 */
+	class LLPP_EXPORT Lease
+	{
+	public:
+		Lease() noexcept = default;
+		Lease(const Lease&) = delete;
+		Lease& operator=(const Lease&) = delete;
+		Lease(Lease&& other) noexcept;
+		Lease& operator=(Lease&& other) noexcept;
+		~Lease();
+
+		/**
+		 * Get the socket connected to the worker
+		 */
+		[[nodiscard]] int fd() const noexcept
+		{
+			return fd_;
+		}
+
+		/**
+		 * Get the process ID of the worker
+		 */
+		[[nodiscard]] pid_t pid() const noexcept
+		{
+			return pid_;
+		}
+
+		explicit operator bool() const noexcept
+		{
+			return fd_ >= 0;
+		}
+
+	private:
+		friend class WorkerPool;
+
+		Lease(int fd, pid_t pid) noexcept : fd_(fd), pid_(pid) {}
+
+		int fd_{-1};
+		pid_t pid_{-1};
+	};
+
+	/// Number of consecutive workers failing to start after which the pool
+	/// stops replacing workers
+	constexpr static std::size_t MAX_FAILURES = 8;
+
+#ifndef LLPP_NO_EXCEPTIONS
+	/**
+	 * Create a pool of size workers which enforce ruleset and run main
+	 *
+	 * @throws std::system_error If the background thread cannot be set up,
+	 * e.g. because pidfds are not supported
+	 */
+	WorkerPool(
+		std::unique_ptr<Ruleset> ruleset,
+		WorkerMain main,
+		std::size_t size
+	);
+#endif
+
+	/**
+	 * Create a pool without throwing
+	 *
+	 * On failure, ec is set and the pool is unusable.
+	 */
+	WorkerPool(
+		std::unique_ptr<Ruleset> ruleset,
+		WorkerMain main,
+		std::size_t size,
+		std::error_code& ec
+	);
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+	WorkerPool(WorkerPool&&) = delete;
+	WorkerPool& operator=(WorkerPool&&) = delete;
+
+	/**
+	 * Stop the background thread and kill all workers, including leased
+	 * ones
+	 */
+	~WorkerPool();
+
+#ifndef LLPP_NO_EXCEPTIONS
+	/**
+	 * Lease an idle worker, waiting until one is ready
+	 *
+	 * If all workers are leased, this waits until a lease ends and the
+	 * worker was replaced.
+	 *
+	 * @throws std::system_error If workers repeatedly fail to start, with
+	 * the error of the last failure
+	 */
+	[[nodiscard]] Lease acquire();
+#endif
+
+	/**
+	 * Lease an idle worker without throwing
+	 *
+	 * On failure, ec is set and an empty lease is returned.
+	 */
+	[[nodiscard]] Lease acquire(std::error_code& ec);
+
+	/**
+	 * Lease an idle worker if one is ready, without waiting
+	 *
+	 * @return The lease, or an empty lease if no worker is idle
+	 */
+	[[nodiscard]] Lease try_acquire();
+
+	/**
+	 * Get the number of idle workers ready to be leased
+	 */
+	[[nodiscard]] std::size_t idle() const;
+
+	/**
+	 * Get the pool statistics
+	 */
+	[[nodiscard]] Stats stats() const;
+
+private:
+	enum class State {
+		STARTING,
+		IDLE,
+		LEASED,
+	};
+
+	struct Worker {
+		int pidfd;
+		/// Pool's end of the socket, -1 once leased
+		int sock;
+		State state;
+	};
+
+	void setup(std::error_code& ec);
+	void run();
+	void refill();
+	void spawn();
+	void on_ready(pid_t pid);
+	void on_exit(pid_t pid);
+	void wake() const noexcept;
+
+	/**
+	 * Take an idle worker, the mutex must be held
+	 */
+	Lease take();
+
+	std::unique_ptr<Ruleset> ruleset_;
+	WorkerMain main_;
+	std::size_t size_;
+
+	int epoll_fd_{-1};
+	int event_fd_{-1};
+	std::thread thread_;
+
+	mutable std::mutex mutex_;
+	std::condition_variable cond_;
+	std::map<pid_t, Worker> workers_;
+	std::deque<pid_t> idle_;
+	bool stopping_{false};
+	std::size_t failures_{0};
+	std::error_code error_;
+	Stats stats_{0, 0, 0, 0};
+};
+} // namespace landlock
@@ -3,7 +3,10 @@
  */
 #pragma once
 
+#include <array>
+#include <cstddef>
 #include <type_traits>
+#include <utility>
 
 #if __cplusplus < 202002L
 # define LLPP_CONSTEVAL constexpr
@@ -46,62 +49,94 @@ template <typename T, T v, typename U>
 using CombineT = typename Combine<T, v, U>::type;
 
 /**
- * Check whether item is contained in the set {set_1} + set_n
+ * Check whether item is contained in the set {set...}
  */
-template <typename T, T item, T set_1, T... set_n>
-LLPP_CONSTEVAL bool is_element();
-template <typename T, T item>
-LLPP_CONSTEVAL bool is_element();
-
-template <typename T, T item, T set_1, T... set_n>
+template <typename T, T item, T... set>
 LLPP_CONSTEVAL bool is_element()
 {
-	return item == set_1 or is_element<T, item, set_n...>();
+	return ((item == set) || ...);
 }
 
-template <typename T, T item>
-LLPP_CONSTEVAL bool is_element()
+namespace detail
+{
+/**
+ * Check whether item is contained in the value wrapper Set
+ */
+template <typename T, T item, typename Set>
+struct Contains;
+
+template <typename T, T item, T... set>
+struct Contains<T, item, ValWrapper<T, set...>> {
+	constexpr static bool value = is_element<T, item, set...>();
+};
+
+template <typename T, T item, typename... Sets>
+LLPP_CONSTEVAL bool contained_in_all()
 {
-	return false;
+	return (Contains<T, item, Sets>::value && ...);
 }
 
+/**
+ * Values of the value wrapper First which are contained in all of Rest
+ *
+ * The values are computed into a constexpr array in a single instantiation
+ * instead of recursing once per value.
+ */
+template <typename T, typename First, typename... Rest>
+struct Common;
+
+template <typename T, T... vals, typename... Rest>
+struct Common<T, ValWrapper<T, vals...>, Rest...> {
+	constexpr static std::size_t COUNT =
+		(std::size_t{0} + ... +
+		 std::size_t{contained_in_all<T, vals, Rest...>()});
+
+	constexpr static std::array<T, COUNT> values() noexcept
+	{
+		std::array<T, COUNT> res{};
+		[[maybe_unused]] std::size_t idx = 0;
+		((contained_in_all<T, vals, Rest...>() ? void(res[idx++] = vals)
+						       : void()),
+		 ...);
+		return res;
+	}
+};
+
+template <typename T, typename... Us>
+inline constexpr std::array COMMON_VALUES = Common<T, Us...>::values();
+
+template <typename T, typename Indices, typename... Us>
+struct CommonWrapper;
+
+template <typename T, std::size_t... idx, typename... Us>
+struct CommonWrapper<T, std::index_sequence<idx...>, Us...> {
+	using type = ValWrapper<T, COMMON_VALUES<T, Us...>[idx]...>;
+};
+
+template <typename T, typename... Us>
+using CommonT = typename CommonWrapper<
+	T,
+	std::make_index_sequence<Common<T, Us...>::COUNT>,
+	Us...>::type;
+} // namespace detail
+
 /**
  * Calculate the union between value packs U1 and U2
  *
  * U1 and U2 must be ValWrappers of type T. The resulting type() is a value
- * wrapper containing exactly the values that are both in U1 and U2.
+ * wrapper containing exactly the values that are both in U1 and U2, in the
+ * order of U1.
  *
  * The corresponding convenience wrapper is UnionT.
  */
 template <typename T, typename U1, typename U2>
-struct Union;
+struct Union {
+	using type = detail::CommonT<T, U1, U2>;
+};
 
 template <typename T, typename U1, typename U2>
 using UnionT = typename Union<T, U1, U2>::type;
 
-template <typename T, T lv1, T... lvs, T... rvs>
-struct Union<T, ValWrapper<T, lv1, lvs...>, ValWrapper<T, rvs...>> {
-	constexpr static bool ADD_LV1 = is_element<T, lv1, rvs...>();
-	using type_true = CombineT<
-		T,
-		lv1,
-		UnionT<T, ValWrapper<T, lvs...>, ValWrapper<T, rvs...>>>;
-	using type_false =
-		UnionT<T, ValWrapper<T, lvs...>, ValWrapper<T, rvs...>>;
-
-	using type = std::conditional_t<ADD_LV1, type_true, type_false>;
-};
-
-template <typename T, T lv1, T... rvs>
-struct Union<T, ValWrapper<T, lv1>, ValWrapper<T, rvs...>> {
-	constexpr static bool ADD_LV1 = is_element<T, lv1, rvs...>();
-
-	using type_true = ValWrapper<T, lv1>;
-	using type_false = ValWrapper<T>;
-
-	using type = std::conditional_t<ADD_LV1, type_true, type_false>;
-};
-
 template <typename T, T v, T... us>
 struct Combine<T, v, ValWrapper<T, us...>> {
 	using type = ValWrapper<T, v, us...>;
@@ -111,19 +146,8 @@ struct Combine<T, v, ValWrapper<T, us...>> {
  * Perform Union on a pack of value packs
  */
 template <typename T, typename... Us>
-struct MultiUnion;
-
-template <typename T, typename U, typename... Us>
-struct MultiUnion<T, U, Us...> {
-	using type =
-		UnionT<T,
-		       typename Unwrap<U>::type,
-		       typename MultiUnion<T, Us...>::type>;
-};
-
-template <typename T, typename U>
-struct MultiUnion<T, U> {
-	using type = typename Unwrap<U>::type;
+struct MultiUnion {
+	using type = detail::CommonT<T, typename Unwrap<Us>::type...>;
 };
 
 template <typename T, typename... Us>
@@ -0,0 +1,263 @@
+#include "ll/AccessEvaluator.hpp"
+#include "ll/ActionType.hpp"
+#include "ll/Rule.hpp"
+#include "ll/config.h"
+#include "ProcFd.hpp"
+
+#include <bit>
+#include <bitset>
+#include <cerrno>
+#include <string>
+#include <utility>
+#include <variant>
+
+#include <unistd.h>
+
+namespace landlock
+{
+namespace
+{
+/**
+ * Split the next component off an absolute path
+ *
+ * Empty components from redundant separators are skipped.
+ */
+std::string_view next_component(std::string_view& rest) noexcept
+{
+	while (not rest.empty() && rest.front() == '/') {
+		rest.remove_prefix(1);
+	}
+	const std::size_t end = rest.find('/');
+	const std::string_view component = rest.substr(0, end);
+	rest.remove_prefix(component.size());
+	return component;
+}
+
+/**
+ * Check whether a path contains ".." components
+ */
+bool has_parent_component(std::string_view path) noexcept
+{
+	for (std::string_view component = next_component(path);
+	     not component.empty();
+	     component = next_component(path)) {
+		if (component == "..") {
+			return true;
+		}
+	}
+	return false;
+}
+
+using PathRules = std::vector<std::pair<std::string, std::uint64_t>>;
+using PortBits = std::vector<std::bitset<AccessEvaluator::PORT_COUNT>>;
+
+/**
+ * Resolve the paths of the attributes generated by a path beneath rule
+ */
+bool add_path_rules(
+	const PathBeneathRule& rule,
+	int abi_version,
+	PathRules& path_rules,
+	std::error_code& ec
+)
+{
+	for (const auto& attr : rule.generate(abi_version)) {
+		std::string path;
+		if (not detail::resolve_fd(attr.parent_fd, path, ec)) {
+			return false;
+		}
+		path_rules.emplace_back(std::move(path), attr.allowed_access);
+	}
+	return true;
+}
+
+#if LLPP_BUILD_LANDLOCK_API >= 4
+/**
+ * Set the port of a net port rule in the bits of its allowed access
+ */
+void add_port_rules(const NetPortRule& rule, int abi_version, PortBits& ports)
+{
+	for (const auto& attr : rule.generate(abi_version)) {
+		for (std::size_t bit = 0; bit < ports.size(); ++bit) {
+			if (((attr.allowed_access >> bit) & 1U) != 0) {
+				ports.at(bit).set(attr.port);
+			}
+		}
+	}
+}
+#endif
+} // namespace
+
+AccessEvaluator::AccessEvaluator() : nodes_(1)
+{
+}
+
+#ifndef LLPP_NO_EXCEPTIONS
+AccessEvaluator::AccessEvaluator(const Ruleset& ruleset) : AccessEvaluator()
+{
+	add_layer(ruleset);
+}
+
+AccessEvaluator& AccessEvaluator::add_layer(const Ruleset& ruleset)
+{
+	std::error_code ec;
+	add_layer(ruleset, ec);
+	if (ec) {
+		throw std::system_error{ec};
+	}
+	return *this;
+}
+#endif
+
+AccessEvaluator&
+AccessEvaluator::add_layer(const Ruleset& ruleset, std::error_code& ec)
+{
+	ec.clear();
+
+	if (layers_.size() >= MAX_LAYERS) {
+		ec = std::make_error_code(std::errc::argument_list_too_long);
+		return *this;
+	}
+
+	// Without the rules of an adopted ruleset, everything it handles would
+	// be evaluated as denied
+	if (ruleset.active() && not ruleset.rules_known()) {
+		ec = std::make_error_code(std::errc::not_supported);
+		return *this;
+	}
+
+	Layer layer;
+	PathRules path_rules;
+
+	// An inactive ruleset, e.g. on a system without Landlock support, does
+	// not restrict anything, so it is represented by a layer handling
+	// nothing
+	if (ruleset.active()) {
+		// The kernel always handles REFER implicitly
+		layer.handled_access_fs = ruleset.handled_access_fs() |
+					  action::FS_REFER.type_code();
+		layer.handled_access_net = ruleset.handled_access_net();
+		layer.ports.resize(static_cast<std::size_t>(
+			std::bit_width(layer.handled_access_net)
+		));
+
+		const int abi = ruleset.abi_version();
+		for (const Ruleset::RuleVariant& rule : ruleset.rules()) {
+			const auto* pb = std::get_if<PathBeneathRule>(&rule);
+			if (pb != nullptr &&
+			    not add_path_rules(*pb, abi, path_rules, ec)) {
+				return *this;
+			}
+#if LLPP_BUILD_LANDLOCK_API >= 4
+			if (const auto* np = std::get_if<NetPortRule>(&rule)) {
+				add_port_rules(*np, abi, layer.ports);
+			}
+#endif
+		}
+	}
+
+	const std::size_t layer_idx = layers_.size();
+	for (const auto& [path, allowed_access] : path_rules) {
+		nodes_.at(node_for(path)).allowed_access.at(layer_idx) |=
+			allowed_access;
+	}
+	layers_.push_back(std::move(layer));
+
+	return *this;
+}
+
+std::uint64_t
+AccessEvaluator::denied(std::string_view path, std::uint64_t access) const
+{
+	if (path.empty() || path.front() != '/') {
+		return access;
+	}
+
+	if (has_parent_component(path)) {
+		const std::filesystem::path normalized =
+			std::filesystem::path{path}.lexically_normal();
+		return denied(normalized.native(), access);
+	}
+
+	std::array<std::uint64_t, MAX_LAYERS> granted =
+		nodes_.front().allowed_access;
+	const Node* node = &nodes_.front();
+
+	std::string_view rest = path;
+	for (std::string_view component = next_component(rest);
+	     not component.empty();
+	     component = next_component(rest)) {
+		if (component == ".") {
+			continue;
+		}
+
+		const auto child = node->children.find(component);
+		if (child == node->children.end()) {
+			break;
+		}
+		node = &nodes_[child->second];
+		for (std::size_t i = 0; i < layers_.size(); ++i) {
+			granted[i] |= node->allowed_access[i];
+		}
+	}
+
+	std::uint64_t res = 0;
+	for (std::size_t i = 0; i < layers_.size(); ++i) {
+		res |= access & layers_[i].handled_access_fs & ~granted[i];
+	}
+	return res;
+}
+
+std::uint64_t
+AccessEvaluator::denied(std::uint16_t port, std::uint64_t access) const noexcept
+{
+	std::uint64_t res = 0;
+	for (const Layer& layer : layers_) {
+		const std::uint64_t requested =
+			access & layer.handled_access_net;
+		for (std::size_t bit = 0; bit < layer.ports.size(); ++bit) {
+			const std::uint64_t mask = std::uint64_t{1} << bit;
+			if ((requested & mask) != 0 &&
+			    not layer.ports[bit].test(port)) {
+				res |= mask;
+			}
+		}
+	}
+	return res;
+}
+
+bool AccessEvaluator::allowed(
+	const std::filesystem::path& path, const action::FsAction& access
+) const
+{
+	std::filesystem::path absolute = path;
+	if (absolute.is_relative()) {
+		absolute = std::filesystem::current_path() / path;
+	}
+	const std::string normal = absolute.lexically_normal().native();
+	return denied(normal, access.type_code()) == 0;
+}
+
+std::uint32_t AccessEvaluator::node_for(std::string_view path)
+{
+	std::uint32_t idx = 0;
+	std::string_view rest = path;
+	while (true) {
+		const std::string_view component = next_component(rest);
+		if (component.empty()) {
+			return idx;
+		}
+
+		auto child = nodes_[idx].children.find(component);
+		if (child != nodes_[idx].children.end()) {
+			idx = child->second;
+			continue;
+		}
+
+		const auto new_idx = static_cast<std::uint32_t>(nodes_.size());
+		nodes_[idx].children.emplace(std::string{component}, new_idx);
+		nodes_.emplace_back();
+		idx = new_idx;
+	}
+}
+} // namespace landlock
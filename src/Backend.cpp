@@ -0,0 +1,58 @@
+#include "ll/Backend.hpp"
+
+#include <unistd.h>
+
+extern "C" {
+#include <linux/landlock.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+}
+
+namespace landlock
+{
+Backend& Backend::system() noexcept
+{
+	static SyscallBackend backend;
+	return backend;
+}
+
+// NOLINTBEGIN(*-vararg)
+int SyscallBackend::create_ruleset(
+	const landlock_ruleset_attr* attr, std::size_t size, std::uint32_t flags
+) noexcept
+{
+	return static_cast<int>(
+		::syscall(SYS_landlock_create_ruleset, attr, size, flags)
+	);
+}
+
+int SyscallBackend::add_rule(
+	int ruleset_fd,
+	landlock_rule_type rule_type,
+	const void* rule_attr,
+	std::uint32_t flags
+) noexcept
+{
+	return static_cast<int>(::syscall(
+		SYS_landlock_add_rule, ruleset_fd, rule_type, rule_attr, flags
+	));
+}
+
+int SyscallBackend::restrict_self(int ruleset_fd, std::uint32_t flags) noexcept
+{
+	return static_cast<int>(
+		::syscall(SYS_landlock_restrict_self, ruleset_fd, flags)
+	);
+}
+
+int SyscallBackend::set_no_new_privs() noexcept
+{
+	return ::prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0);
+}
+// NOLINTEND(*-vararg)
+
+int SyscallBackend::close(int fd) noexcept
+{
+	return ::close(fd);
+}
+} // namespace landlock
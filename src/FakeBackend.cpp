@@ -0,0 +1,350 @@
+#include "ll/FakeBackend.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+namespace landlock
+{
+namespace
+{
+// The masks are spelled out instead of using the macros from linux/landlock.h,
+// since the fake kernel must be able to simulate ABI versions newer than the
+// headers present at compile time.
+
+/// Filesystem access bits supported per ABI version (index = ABI version)
+constexpr std::array<std::uint64_t, 8> FS_ACCESS_MASK{
+	0x0000, 0x1FFF, 0x3FFF, 0x7FFF, 0x7FFF, 0xFFFF, 0xFFFF, 0xFFFF,
+};
+
+/// Filesystem access allowed beneath files which are not directories
+constexpr std::uint64_t FS_FILE_ACCESS_MASK = 0xC007;
+
+constexpr int NET_MIN_ABI = 4;
+constexpr std::uint64_t NET_ACCESS_MASK = 0x3;
+
+constexpr int SCOPE_MIN_ABI = 6;
+constexpr std::uint64_t SCOPE_MASK = 0x3;
+
+constexpr int RESTRICT_FLAGS_MIN_ABI = 7;
+constexpr std::uint32_t RESTRICT_FLAGS_MASK = 0x7;
+constexpr std::uint32_t RESTRICT_LOG_SUBDOMAINS_OFF = 0x4;
+
+constexpr std::uint32_t CREATE_RULESET_VERSION = 1U << 0U;
+constexpr std::uint32_t CREATE_RULESET_ERRATA = 1U << 1U;
+constexpr int CREATE_RULESET_ERRATA_MIN_ABI = 7;
+
+constexpr int RULE_PATH_BENEATH = 1;
+constexpr int RULE_NET_PORT = 2;
+
+constexpr std::uint64_t MAX_PORT = 0xFFFF;
+
+/// First file descriptor number handed out, far away from real descriptors
+constexpr int FIRST_FAKE_FD = 1 << 20;
+
+std::uint64_t fs_access_mask(int abi) noexcept
+{
+	if (abi <= 0) {
+		return 0;
+	}
+	if (static_cast<std::size_t>(abi) >= FS_ACCESS_MASK.size()) {
+		return FS_ACCESS_MASK.back();
+	}
+	return FS_ACCESS_MASK.at(static_cast<std::size_t>(abi));
+}
+
+int fail(int err) noexcept
+{
+	errno = err;
+	return -1;
+}
+} // namespace
+
+FakeBackend::FakeBackend(int abi_version) noexcept :
+	abi_version_(abi_version), next_fd_(FIRST_FAKE_FD)
+{
+}
+
+int FakeBackend::create_ruleset(
+	const landlock_ruleset_attr* attr, std::size_t size, std::uint32_t flags
+) noexcept
+{
+	if (not instrument(Call::CREATE_RULESET)) {
+		return -1;
+	}
+
+	if (abi_version_ <= 0) {
+		return fail(ENOSYS);
+	}
+
+	if (flags == CREATE_RULESET_VERSION ||
+	    (flags == CREATE_RULESET_ERRATA &&
+	     abi_version_ >= CREATE_RULESET_ERRATA_MIN_ABI)) {
+		if (attr != nullptr || size != 0) {
+			return fail(EINVAL);
+		}
+		return flags == CREATE_RULESET_VERSION ? abi_version_ : 0;
+	}
+	if (flags != 0) {
+		return fail(EINVAL);
+	}
+
+	if (attr == nullptr) {
+		return fail(EFAULT);
+	}
+
+	// Read the attribute by offset to support layouts of newer ABIs than
+	// the compile-time headers know about
+	FakeRuleset ruleset;
+	const auto* raw = reinterpret_cast<const unsigned char*>(attr);
+	const std::size_t field = sizeof(std::uint64_t);
+	if (size < field) {
+		return fail(EINVAL);
+	}
+	std::memcpy(&ruleset.handled_access_fs, raw, field);
+	if (size >= 2 * field) {
+		std::memcpy(&ruleset.handled_access_net, raw + field, field);
+	}
+	if (size >= 3 * field) {
+		std::memcpy(&ruleset.scoped, raw + 2 * field, field);
+	}
+
+	const std::uint64_t net_mask =
+		abi_version_ >= NET_MIN_ABI ? NET_ACCESS_MASK : 0;
+	const std::uint64_t scope_mask =
+		abi_version_ >= SCOPE_MIN_ABI ? SCOPE_MASK : 0;
+	if ((ruleset.handled_access_fs & ~fs_access_mask(abi_version_)) != 0 ||
+	    (ruleset.handled_access_net & ~net_mask) != 0 ||
+	    (ruleset.scoped & ~scope_mask) != 0) {
+		return fail(EINVAL);
+	}
+
+	if (ruleset.handled_access_fs == 0 && ruleset.handled_access_net == 0 &&
+	    ruleset.scoped == 0) {
+		return fail(ENOMSG);
+	}
+
+	const std::lock_guard lock{mutex_};
+	const int fd = next_fd_++;
+	rulesets_.emplace(fd, std::move(ruleset));
+	return fd;
+}
+
+int FakeBackend::add_rule(
+	int ruleset_fd,
+	landlock_rule_type rule_type,
+	const void* rule_attr,
+	std::uint32_t flags
+) noexcept
+{
+	if (not instrument(Call::ADD_RULE)) {
+		return -1;
+	}
+
+	if (abi_version_ <= 0) {
+		return fail(ENOSYS);
+	}
+	if (flags != 0) {
+		return fail(EINVAL);
+	}
+	if (rule_attr == nullptr) {
+		return fail(EFAULT);
+	}
+
+	const std::lock_guard lock{mutex_};
+	auto ruleset = rulesets_.find(ruleset_fd);
+	if (ruleset == rulesets_.end()) {
+		return fail(EBADF);
+	}
+
+	const auto* raw = static_cast<const unsigned char*>(rule_attr);
+	std::uint64_t allowed_access = 0;
+	std::memcpy(&allowed_access, raw, sizeof(allowed_access));
+
+	switch (static_cast<int>(rule_type)) {
+	case RULE_PATH_BENEATH: {
+		std::int32_t parent_fd = -1;
+		std::memcpy(
+			&parent_fd,
+			raw + sizeof(allowed_access),
+			sizeof(parent_fd)
+		);
+		if (allowed_access == 0) {
+			return fail(ENOMSG);
+		}
+		if ((allowed_access & ~ruleset->second.handled_access_fs) !=
+		    0) {
+			return fail(EINVAL);
+		}
+		struct stat st {};
+		if (::fstat(parent_fd, &st) != 0) {
+			return fail(EBADF);
+		}
+		if (not S_ISDIR(st.st_mode) &&
+		    (allowed_access & ~FS_FILE_ACCESS_MASK) != 0) {
+			return fail(EINVAL);
+		}
+		ruleset->second.path_beneath_rules.push_back(
+			{allowed_access, parent_fd}
+		);
+		return 0;
+	}
+	case RULE_NET_PORT: {
+		if (abi_version_ < NET_MIN_ABI) {
+			return fail(EINVAL);
+		}
+		std::uint64_t port = 0;
+		std::memcpy(&port, raw + sizeof(allowed_access), sizeof(port));
+		if (allowed_access == 0) {
+			return fail(ENOMSG);
+		}
+		if ((allowed_access & ~ruleset->second.handled_access_net) !=
+		    0) {
+			return fail(EINVAL);
+		}
+		if (port > MAX_PORT) {
+			return fail(EINVAL);
+		}
+		ruleset->second.net_port_rules.push_back({allowed_access, port}
+		);
+		return 0;
+	}
+	default:
+		return fail(EINVAL);
+	}
+}
+
+int FakeBackend::restrict_self(int ruleset_fd, std::uint32_t flags) noexcept
+{
+	if (not instrument(Call::RESTRICT_SELF)) {
+		return -1;
+	}
+
+	if (abi_version_ <= 0) {
+		return fail(ENOSYS);
+	}
+
+	const std::uint32_t flags_mask =
+		abi_version_ >= RESTRICT_FLAGS_MIN_ABI ? RESTRICT_FLAGS_MASK
+						       : 0;
+	if ((flags & ~flags_mask) != 0) {
+		return fail(EINVAL);
+	}
+
+	const std::lock_guard lock{mutex_};
+	if (not no_new_privs_) {
+		return fail(EPERM);
+	}
+
+	// Only changing the logging configuration without adding a layer
+	if (ruleset_fd == -1 && flags == RESTRICT_LOG_SUBDOMAINS_OFF) {
+		return 0;
+	}
+
+	auto ruleset = rulesets_.find(ruleset_fd);
+	if (ruleset == rulesets_.end()) {
+		return fail(EBADF);
+	}
+	if (layers_.size() >= MAX_LAYERS) {
+		return fail(E2BIG);
+	}
+
+	layers_.push_back({ruleset->second, flags});
+	return 0;
+}
+
+int FakeBackend::set_no_new_privs() noexcept
+{
+	if (not instrument(Call::SET_NO_NEW_PRIVS)) {
+		return -1;
+	}
+
+	const std::lock_guard lock{mutex_};
+	no_new_privs_ = true;
+	return 0;
+}
+
+int FakeBackend::close(int fd) noexcept
+{
+	const std::lock_guard lock{mutex_};
+	if (rulesets_.erase(fd) == 0) {
+		return fail(EBADF);
+	}
+	return 0;
+}
+
+void FakeBackend::set_latency(Call call, std::chrono::nanoseconds latency)
+{
+	const std::lock_guard lock{mutex_};
+	instrumentation_.at(static_cast<std::size_t>(call)).latency = latency;
+}
+
+void FakeBackend::inject_error(Call call, int err, std::size_t count)
+{
+	const std::lock_guard lock{mutex_};
+	Instrumentation& instr =
+		instrumentation_.at(static_cast<std::size_t>(call));
+	instr.error = err;
+	instr.error_count = count;
+}
+
+std::size_t FakeBackend::call_count(Call call) const
+{
+	const std::lock_guard lock{mutex_};
+	return instrumentation_.at(static_cast<std::size_t>(call)).calls;
+}
+
+std::optional<FakeBackend::FakeRuleset> FakeBackend::ruleset(int ruleset_fd
+) const
+{
+	const std::lock_guard lock{mutex_};
+	auto ruleset = rulesets_.find(ruleset_fd);
+	if (ruleset == rulesets_.end()) {
+		return std::nullopt;
+	}
+	return ruleset->second;
+}
+
+std::vector<FakeBackend::Layer> FakeBackend::layers() const
+{
+	const std::lock_guard lock{mutex_};
+	return layers_;
+}
+
+bool FakeBackend::no_new_privs() const
+{
+	const std::lock_guard lock{mutex_};
+	return no_new_privs_;
+}
+
+bool FakeBackend::instrument(Call call)
+{
+	std::chrono::nanoseconds latency{0};
+	int err = 0;
+
+	{
+		const std::lock_guard lock{mutex_};
+		Instrumentation& instr =
+			instrumentation_.at(static_cast<std::size_t>(call));
+		++instr.calls;
+		latency = instr.latency;
+		if (instr.error_count > 0) {
+			--instr.error_count;
+			err = instr.error;
+		}
+	}
+
+	if (latency.count() > 0) {
+		std::this_thread::sleep_for(latency);
+	}
+
+	if (err != 0) {
+		errno = err;
+		return false;
+	}
+	return true;
+}
+} // namespace landlock
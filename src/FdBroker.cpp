@@ -0,0 +1,315 @@
+#include "ll/FdBroker.hpp"
+#include "FdPassing.hpp"
+#include "ProcFd.hpp"
+#include "ll/ActionType.hpp"
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace landlock
+{
+namespace
+{
+struct RequestHeader {
+	std::uint64_t id;
+	std::int32_t flags;
+	std::uint32_t path_size;
+};
+
+struct Response {
+	std::uint64_t id;
+	/// 0 if a file descriptor is attached, errno value otherwise
+	std::int32_t error;
+	std::int32_t reserved;
+};
+
+/**
+ * Make a path lexically normal, without trailing separator
+ */
+std::string normalize(const std::string& path)
+{
+	std::string res = std::filesystem::path{path}.lexically_normal();
+	while (res.size() > 1 && res.back() == '/') {
+		res.pop_back();
+	}
+	return res;
+}
+
+/**
+ * Get the access implied by opening a file with flags
+ */
+std::uint64_t required_access(int flags, bool directory) noexcept
+{
+	std::uint64_t res = 0;
+	const int mode = flags & O_ACCMODE;
+	if (mode == O_RDONLY || mode == O_RDWR) {
+		res |= directory ? action::FS_READ_DIR.type_code()
+				 : action::FS_READ_FILE.type_code();
+	}
+	if (mode == O_WRONLY || mode == O_RDWR) {
+		res |= action::FS_WRITE_FILE.type_code();
+	}
+	return res;
+}
+
+bool allowed(std::uint64_t effective, int flags, bool directory) noexcept
+{
+	return (required_access(flags, directory) & ~effective) == 0;
+}
+
+/**
+ * Check that a client only requested flags which cannot create, truncate or
+ * otherwise modify files beyond the implied access
+ *
+ * Everything not listed is denied, in particular O_CREAT, O_TMPFILE, O_TRUNC
+ * and O_PATH, as well as flags added by future kernels.
+ */
+bool permitted_flags(int flags) noexcept
+{
+	constexpr int PERMITTED = O_ACCMODE | O_APPEND | O_CLOEXEC |
+				  O_DIRECTORY | O_DSYNC | O_LARGEFILE |
+				  O_NOCTTY | O_NOFOLLOW | O_NONBLOCK | O_SYNC;
+	return (flags & ~PERMITTED) == 0 && (flags & O_ACCMODE) != O_ACCMODE;
+}
+
+int fail(int err) noexcept
+{
+	errno = err;
+	return -1;
+}
+} // namespace
+
+FdBroker::FdBroker(Policy allowlist) : allowlist_(std::move(allowlist)) {}
+
+bool FdBroker::handle(int sock, std::error_code& ec)
+{
+	ec.clear();
+
+	std::array<char, sizeof(RequestHeader) + MAX_PATH> buf{};
+	ssize_t size = -1;
+	do {
+		size = ::recv(sock, buf.data(), buf.size(), 0);
+	} while (size < 0 && errno == EINTR);
+	if (size == 0) {
+		return false;
+	}
+	if (size < 0) {
+		ec = std::error_code{errno, std::system_category()};
+		return false;
+	}
+
+	const auto received = static_cast<std::size_t>(size);
+	RequestHeader header{};
+	if (received >= sizeof(header)) {
+		std::memcpy(&header, buf.data(), sizeof(header));
+	}
+	if (received < sizeof(header) ||
+	    header.path_size != received - sizeof(header)) {
+		ec = std::make_error_code(std::errc::bad_message);
+		return false;
+	}
+
+	const std::string path{buf.data() + sizeof(header), header.path_size};
+	const int fd = open_checked(path, header.flags);
+	Response response{header.id, fd < 0 ? errno : 0, 0};
+
+	ssize_t res = -1;
+	if (fd >= 0) {
+		res = detail::send_fd(sock, &response, sizeof(response), fd);
+		::close(fd);
+		granted_.fetch_add(1);
+	} else {
+		res = ::send(sock, &response, sizeof(response), MSG_NOSIGNAL);
+		denied_.fetch_add(1);
+	}
+	if (res < 0) {
+		ec = std::error_code{errno, std::system_category()};
+		return false;
+	}
+	return true;
+}
+
+void FdBroker::serve(int sock, std::error_code& ec)
+{
+	while (handle(sock, ec)) {
+	}
+}
+
+FdBroker::Stats FdBroker::stats() const noexcept
+{
+	return {granted_.load(), denied_.load()};
+}
+
+int FdBroker::open_checked(const std::string& path, int flags) const
+{
+	if (not permitted_flags(flags) || path.empty() || path.front() != '/') {
+		return fail(EACCES);
+	}
+
+	// Cheap check of the requested path first, so files outside of the
+	// allowlist are not even opened
+	const std::string requested = normalize(path);
+	const std::uint64_t requested_access =
+		allowlist_.effective_access(requested);
+	if (not allowed(requested_access, flags, false) &&
+	    not allowed(requested_access, flags, true)) {
+		return fail(EACCES);
+	}
+
+	// Opening does not block on FIFOs
+	// NOLINTNEXTLINE(*-vararg)
+	const int fd = ::open(path.c_str(), flags | O_CLOEXEC | O_NONBLOCK);
+	if (fd < 0) {
+		return -1;
+	}
+
+	std::string real;
+	std::error_code ec;
+	struct stat st{};
+	const bool checked =
+		detail::resolve_fd(fd, real, ec) && ::fstat(fd, &st) == 0 &&
+		(S_ISREG(st.st_mode) || S_ISDIR(st.st_mode)) &&
+		allowed(allowlist_.effective_access(real),
+			flags,
+			S_ISDIR(st.st_mode));
+	if (not checked) {
+		::close(fd);
+		return fail(EACCES);
+	}
+
+	// NOLINTNEXTLINE(*-vararg)
+	if ((flags & O_NONBLOCK) == 0 &&
+	    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) & ~O_NONBLOCK) != 0) {
+		const int err = errno;
+		::close(fd);
+		return fail(err);
+	}
+	return fd;
+}
+
+FdClient::FdClient(int sock) noexcept : sock_(sock) {}
+
+FdClient::~FdClient()
+{
+	for (const auto& [key, result] : cache_) {
+		if (result >= 0) {
+			::close(result);
+		}
+	}
+	::close(sock_);
+}
+
+int FdClient::open(const char* path, int flags)
+{
+	const std::lock_guard lock{mutex_};
+	const Key key{flags, path};
+
+	auto cached = cache_.find(key);
+	if (cached != cache_.end()) {
+		++stats_.hits;
+	} else {
+		if (pending_ids_.count(key) == 0 && not send_request(key)) {
+			return -1;
+		}
+		while ((cached = cache_.find(key)) == cache_.end()) {
+			if (not receive_response()) {
+				return -1;
+			}
+		}
+	}
+
+	const Result result = cached->second;
+	if (result >= 0) {
+		return result;
+	}
+	// Only denials are permanent, other errors (e.g. ENOENT) may change
+	if (result != -EACCES) {
+		cache_.erase(cached);
+	}
+	return fail(-result);
+}
+
+int FdClient::prefetch(const char* path, int flags)
+{
+	const std::lock_guard lock{mutex_};
+	const Key key{flags, path};
+	if (cache_.count(key) != 0 || pending_ids_.count(key) != 0) {
+		return 0;
+	}
+	return send_request(key) ? 0 : -1;
+}
+
+FdClient::Stats FdClient::stats() const
+{
+	const std::lock_guard lock{mutex_};
+	return stats_;
+}
+
+bool FdClient::send_request(const Key& key)
+{
+	if (key.second.size() > FdBroker::MAX_PATH) {
+		errno = ENAMETOOLONG;
+		return false;
+	}
+
+	const RequestHeader header{
+		next_id_,
+		key.first,
+		static_cast<std::uint32_t>(key.second.size()),
+	};
+	std::string buf(sizeof(header) + key.second.size(), '\0');
+	std::memcpy(buf.data(), &header, sizeof(header));
+	std::memcpy(
+		buf.data() + sizeof(header),
+		key.second.data(),
+		key.second.size()
+	);
+
+	ssize_t res = -1;
+	do {
+		res = ::send(sock_, buf.data(), buf.size(), MSG_NOSIGNAL);
+	} while (res < 0 && errno == EINTR);
+	if (res < 0) {
+		return false;
+	}
+
+	pending_.emplace(next_id_, key);
+	pending_ids_.emplace(key, next_id_);
+	++next_id_;
+	++stats_.requests;
+	return true;
+}
+
+bool FdClient::receive_response()
+{
+	Response response{};
+	int fd = -1;
+	const ssize_t res =
+		detail::recv_fd(sock_, &response, sizeof(response), fd);
+	if (res < 0) {
+		return false;
+	}
+
+	const auto pending = pending_.find(response.id);
+	if (static_cast<std::size_t>(res) != sizeof(response) ||
+	    pending == pending_.end() || (response.error == 0) != (fd >= 0)) {
+		if (fd >= 0) {
+			::close(fd);
+		}
+		errno = res == 0 ? ECONNRESET : EPROTO;
+		return false;
+	}
+
+	cache_[pending->second] = fd >= 0 ? fd : -response.error;
+	pending_ids_.erase(pending->second);
+	pending_.erase(pending);
+	return true;
+}
+} // namespace landlock
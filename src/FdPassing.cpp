@@ -0,0 +1,84 @@
+#include "FdPassing.hpp"
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace landlock::detail
+{
+namespace
+{
+/// Control message buffer for a single file descriptor
+union ControlBuffer {
+	std::array<char, CMSG_SPACE(sizeof(int))> buf;
+	cmsghdr align;
+};
+} // namespace
+
+ssize_t send_fd(int sock, const void* data, std::size_t size, int fd) noexcept
+{
+	iovec iov{const_cast<void*>(data), size}; // NOLINT(*-const-cast)
+	ControlBuffer control{};
+
+	msghdr msg{};
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buf.data();
+	msg.msg_controllen = control.buf.size();
+
+	cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	std::memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+	ssize_t res = -1;
+	do {
+		res = ::sendmsg(sock, &msg, MSG_NOSIGNAL);
+	} while (res < 0 && errno == EINTR);
+	return res;
+}
+
+ssize_t recv_fd(int sock, void* data, std::size_t size, int& fd) noexcept
+{
+	fd = -1;
+	iovec iov{data, size};
+	ControlBuffer control{};
+
+	msghdr msg{};
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buf.data();
+	msg.msg_controllen = control.buf.size();
+
+	ssize_t res = -1;
+	do {
+		res = ::recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+	} while (res < 0 && errno == EINTR);
+	if (res < 0) {
+		return res;
+	}
+
+	for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+	     cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+		if (cmsg->cmsg_level == SOL_SOCKET &&
+		    cmsg->cmsg_type == SCM_RIGHTS &&
+		    cmsg->cmsg_len == CMSG_LEN(sizeof(int))) {
+			std::memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+		}
+	}
+
+	if ((msg.msg_flags & MSG_CTRUNC) != 0) {
+		if (fd >= 0) {
+			::close(fd);
+			fd = -1;
+		}
+		errno = EMSGSIZE;
+		return -1;
+	}
+	return res;
+}
+} // namespace landlock::detail
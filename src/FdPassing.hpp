@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+
+#include <sys/types.h>
+
+namespace landlock::detail
+{
+/**
+ * Send a message with a file descriptor attached via SCM_RIGHTS
+ *
+ * @return The number of bytes sent, or -1 with errno set on failure
+ */
+ssize_t send_fd(int sock, const void* data, std::size_t size, int fd) noexcept;
+
+/**
+ * Receive a message with an optional file descriptor attached via SCM_RIGHTS
+ *
+ * The received file descriptor has FD_CLOEXEC set. If no file descriptor was
+ * attached, fd is set to -1.
+ *
+ * @return The number of bytes received, or -1 with errno set on failure
+ */
+ssize_t recv_fd(int sock, void* data, std::size_t size, int& fd) noexcept;
+} // namespace landlock::detail
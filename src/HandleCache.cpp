@@ -0,0 +1,196 @@
+#include "ll/HandleCache.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace landlock
+{
+struct HandleCache::State {
+	struct Entry {
+		std::weak_ptr<const PathHandle> handle;
+		/// Value of fork_generation when the handle was opened
+		std::uint64_t generation;
+	};
+
+	mutable std::mutex mutex;
+	std::unordered_map<std::string, Entry> entries;
+
+	std::atomic<std::uint64_t> hits{0};
+	std::atomic<std::uint64_t> misses{0};
+	std::atomic<std::uint64_t> stale{0};
+};
+
+namespace
+{
+/**
+ * Number of forks of this process
+ *
+ * Children may close the descriptors they inherited, e.g. WorkerPool workers
+ * close all close-on-exec descriptors, so handles opened before a fork are not
+ * handed out again after it.
+ */
+std::atomic<std::uint64_t> fork_generation{0};
+
+void count_fork() noexcept
+{
+	fork_generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * Open path and wrap it in a handle with the given deleter
+ */
+template <typename Deleter>
+HandleCache::Handle
+open_handle(const std::string& path, Deleter deleter, std::error_code& ec)
+{
+	const int fd =
+		::open(path.c_str(), O_PATH | O_CLOEXEC); // NOLINT(*-vararg)
+	struct stat st {};
+	if (fd < 0 || ::fstat(fd, &st) != 0) {
+		ec = std::error_code{errno, std::system_category()};
+		if (fd >= 0) {
+			::close(fd);
+		}
+		return nullptr;
+	}
+	ec.clear();
+	return {new PathHandle{fd, st.st_dev, st.st_ino, S_ISDIR(st.st_mode)},
+		std::move(deleter)};
+}
+
+bool same_object(const std::string& path, const PathHandle& handle) noexcept
+{
+	struct stat st {};
+	return ::stat(path.c_str(), &st) == 0 && st.st_dev == handle.dev() &&
+	       st.st_ino == handle.ino();
+}
+} // namespace
+
+PathHandle::~PathHandle()
+{
+	// Not much we can do if this fails, so ignore the result
+	::close(fd_);
+}
+
+HandleCache::HandleCache() : state_(std::make_shared<State>())
+{
+	static std::once_flag registered;
+	std::call_once(registered, [] {
+		::pthread_atfork(nullptr, nullptr, count_fork);
+	});
+}
+
+HandleCache::~HandleCache() = default;
+
+HandleCache& HandleCache::global()
+{
+	static HandleCache cache;
+	return cache;
+}
+
+#ifndef LLPP_NO_EXCEPTIONS
+HandleCache::Handle HandleCache::open(const std::filesystem::path& path)
+{
+	std::error_code ec;
+	Handle res = open(path, ec);
+	if (ec) {
+		throw std::system_error{ec};
+	}
+	return res;
+}
+#endif
+
+HandleCache::Handle
+HandleCache::open(const std::filesystem::path& path, std::error_code& ec)
+{
+	const std::string& key = path.native();
+	if (not path.is_absolute()) {
+		state_->misses.fetch_add(1, std::memory_order_relaxed);
+		return open_handle(key, std::default_delete<PathHandle>{}, ec);
+	}
+
+	// Handles are only released outside of the lock, since releasing the
+	// last reference takes it to remove the entry
+	const std::uint64_t generation =
+		fork_generation.load(std::memory_order_relaxed);
+	Handle cached;
+	{
+		const std::lock_guard lock{state_->mutex};
+		const auto it = state_->entries.find(key);
+		if (it != state_->entries.end() &&
+		    it->second.generation == generation) {
+			cached = it->second.handle.lock();
+		}
+	}
+	if (cached) {
+		if (same_object(key, *cached)) {
+			state_->hits.fetch_add(1, std::memory_order_relaxed);
+			ec.clear();
+			return cached;
+		}
+		state_->stale.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	state_->misses.fetch_add(1, std::memory_order_relaxed);
+	Handle opened = open_handle(
+		key,
+		[weak_state = std::weak_ptr<State>{state_},
+		 key](const PathHandle* handle) {
+			if (const auto state = weak_state.lock()) {
+				const std::lock_guard lock{state->mutex};
+				const auto it = state->entries.find(key);
+				// The entry may refer to a newer handle by now
+				if (it != state->entries.end() &&
+				    it->second.handle.expired()) {
+					state->entries.erase(it);
+				}
+			}
+			delete handle; // NOLINT(*-owning-memory)
+		},
+		ec
+	);
+	if (not opened) {
+		return nullptr;
+	}
+
+	// Another thread may have opened the same object in the meantime
+	Handle existing;
+	{
+		const std::lock_guard lock{state_->mutex};
+		State::Entry& entry = state_->entries[key];
+		if (entry.generation == generation) {
+			existing = entry.handle.lock();
+		}
+		if (not existing || existing->dev() != opened->dev() ||
+		    existing->ino() != opened->ino()) {
+			entry = {opened, generation};
+			existing.swap(opened);
+		}
+	}
+	return existing;
+}
+
+HandleCache::Stats HandleCache::stats() const noexcept
+{
+	return {
+		state_->hits.load(std::memory_order_relaxed),
+		state_->misses.load(std::memory_order_relaxed),
+		state_->stale.load(std::memory_order_relaxed),
+	};
+}
+
+std::size_t HandleCache::size() const
+{
+	const std::lock_guard lock{state_->mutex};
+	return state_->entries.size();
+}
+} // namespace landlock
@@ -0,0 +1,122 @@
+#include "ll/OpenCache.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <functional>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+namespace landlock
+{
+OpenCache::OpenCache(std::size_t capacity, std::size_t shards) :
+	shard_count_(std::max<std::size_t>(shards, 1)),
+	shard_capacity_(std::max<std::size_t>(
+		1, (capacity + shard_count_ - 1) / shard_count_
+	)),
+	// NOLINTNEXTLINE(*-avoid-c-arrays)
+	shards_(std::make_unique<Shard[]>(shard_count_))
+{
+}
+
+OpenCache::~OpenCache() = default;
+
+int OpenCache::open(const char* path, int flags, mode_t mode)
+{
+	return openat(AT_FDCWD, path, flags, mode);
+}
+
+int OpenCache::openat(int dirfd, const char* path, int flags, mode_t mode)
+{
+	Dir dir{0, 0};
+	if (path[0] != '/') {
+		struct stat st {};
+		if (::fstatat(dirfd, "", &st, AT_EMPTY_PATH) != 0) {
+			// Let the kernel report the error
+			misses_.fetch_add(1, std::memory_order_relaxed);
+			// NOLINTNEXTLINE(*-vararg)
+			return ::openat(dirfd, path, flags, mode);
+		}
+		dir = {st.st_dev, st.st_ino};
+	}
+	const KeyView key{dir, flags, path};
+	Shard& shard = shards_[KeyHash{}(key) % shard_count_];
+
+	if (lookup(shard, key)) {
+		hits_.fetch_add(1, std::memory_order_relaxed);
+		errno = EACCES;
+		return -1;
+	}
+
+	misses_.fetch_add(1, std::memory_order_relaxed);
+	// NOLINTNEXTLINE(*-vararg)
+	const int fd = ::openat(dirfd, path, flags, mode);
+	if (fd < 0 && errno == EACCES) {
+		insert(shard, key);
+		errno = EACCES;
+	}
+	return fd;
+}
+
+OpenCache::Stats OpenCache::stats() const noexcept
+{
+	return {
+		hits_.load(std::memory_order_relaxed),
+		misses_.load(std::memory_order_relaxed),
+		evictions_.load(std::memory_order_relaxed),
+	};
+}
+
+std::size_t OpenCache::size() const
+{
+	std::size_t res = 0;
+	for (std::size_t i = 0; i < shard_count_; ++i) {
+		const std::lock_guard lock{shards_[i].mutex};
+		res += shards_[i].entries.size();
+	}
+	return res;
+}
+
+std::size_t OpenCache::KeyHash::operator()(const KeyView& key) const noexcept
+{
+	std::size_t hash = std::hash<std::string_view>{}(key.path);
+	// Boost-style hash_combine
+	constexpr std::size_t MAGIC = 0x9e3779b97f4a7c15U;
+	hash ^= std::hash<dev_t>{}(key.dir.dev) + MAGIC + (hash << 6U) +
+		(hash >> 2U);
+	hash ^= std::hash<ino_t>{}(key.dir.ino) + MAGIC + (hash << 6U) +
+		(hash >> 2U);
+	hash ^= std::hash<int>{}(key.flags) + MAGIC + (hash << 6U) +
+		(hash >> 2U);
+	return hash;
+}
+
+bool OpenCache::lookup(Shard& shard, const KeyView& key)
+{
+	const std::lock_guard lock{shard.mutex};
+	const auto entry = shard.entries.find(key);
+	if (entry == shard.entries.end()) {
+		return false;
+	}
+	shard.lru.splice(shard.lru.begin(), shard.lru, entry->second);
+	return true;
+}
+
+void OpenCache::insert(Shard& shard, const KeyView& key)
+{
+	const std::lock_guard lock{shard.mutex};
+	if (shard.entries.find(key) != shard.entries.end()) {
+		// Another thread raced us to it
+		return;
+	}
+
+	if (shard.entries.size() >= shard_capacity_) {
+		shard.entries.erase(shard.lru.back());
+		shard.lru.pop_back();
+		evictions_.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	shard.lru.push_front(Key{key.dir, key.flags, std::string{key.path}});
+	shard.entries.emplace(shard.lru.front(), shard.lru.begin());
+}
+} // namespace landlock
@@ -0,0 +1,122 @@
+#include "ll/PhasedSandbox.hpp"
+
+#include <chrono>
+#include <new>
+#include <system_error>
+#include <utility>
+
+namespace landlock
+{
+PhasedSandbox::PhasedSandbox(Backend& backend) noexcept : backend_(&backend) {}
+
+PhasedSandbox::~PhasedSandbox()
+{
+	for (const auto& phase : phases_) {
+		phase.wait();
+	}
+}
+
+PhasedSandbox& PhasedSandbox::add_phase(std::unique_ptr<Ruleset> ruleset)
+{
+	std::promise<Prepared> prepared;
+	prepared.set_value({std::move(ruleset), {}});
+	phases_.push_back(prepared.get_future().share());
+	return *this;
+}
+
+PhasedSandbox& PhasedSandbox::add_phase(Policy policy)
+{
+	return add_phase(
+		[policy = std::move(policy)](
+			Backend& backend, std::error_code& ec
+		) { return policy.build(backend, ec); }
+	);
+}
+
+PhasedSandbox& PhasedSandbox::add_phase(Builder builder)
+{
+	auto prepare = [builder = std::move(builder), backend = backend_]() {
+		Prepared res;
+#ifndef LLPP_NO_EXCEPTIONS
+		// get() would rethrow exceptions of the builder, e.g.
+		// std::bad_alloc, from the non-throwing advance() and wait()
+		try {
+			res.ruleset = builder(*backend, res.ec);
+		} catch (const std::system_error& err) {
+			res.ec = err.code();
+		} catch (const std::bad_alloc&) {
+			res.ec = std::make_error_code(
+				std::errc::not_enough_memory
+			);
+		} catch (...) {
+			res.ec = std::make_error_code(
+				std::errc::state_not_recoverable
+			);
+		}
+#else
+		res.ruleset = builder(*backend, res.ec);
+#endif
+		return res;
+	};
+	phases_.push_back(
+		std::async(std::launch::async, std::move(prepare)).share()
+	);
+	return *this;
+}
+
+bool PhasedSandbox::ready(std::size_t phase) const
+{
+	return phases_.at(phase).wait_for(std::chrono::seconds{0}) ==
+	       std::future_status::ready;
+}
+
+void PhasedSandbox::wait(std::error_code& ec) const
+{
+	ec.clear();
+	for (const auto& phase : phases_) {
+		const Prepared& prepared = phase.get();
+		if (prepared.ec && not ec) {
+			ec = prepared.ec;
+		}
+	}
+}
+
+#ifndef LLPP_NO_EXCEPTIONS
+void PhasedSandbox::advance()
+{
+	std::error_code ec;
+	advance(ec);
+	if (ec) {
+		throw std::system_error{ec};
+	}
+}
+#endif
+
+void PhasedSandbox::advance(std::error_code& ec)
+{
+	ec.clear();
+
+	if (current_ >= phases_.size()) {
+		ec = std::make_error_code(std::errc::result_out_of_range);
+		return;
+	}
+
+	const Prepared& prepared = phases_[current_].get();
+	if (prepared.ec) {
+		ec = prepared.ec;
+		return;
+	}
+	if (prepared.ruleset == nullptr) {
+		ec = std::make_error_code(std::errc::invalid_argument);
+		return;
+	}
+
+	// no_new_privs is only set once, so later transitions are a single
+	// landlock_restrict_self(2)
+	prepared.ruleset->enforce(current_ == 0, ec);
+	if (ec) {
+		return;
+	}
+	++current_;
+}
+} // namespace landlock
@@ -0,0 +1,324 @@
+#include "ll/Policy.hpp"
+#include "ll/ActionType.hpp"
+#include "ll/Rule.hpp"
+#include "ll/Scope.hpp"
+
+#include <set>
+#include <stdexcept>
+#include <utility>
+
+namespace landlock
+{
+namespace
+{
+/**
+ * Make a path absolute and lexically normal, without trailing separator
+ */
+std::string normalize(const std::filesystem::path& path)
+{
+	std::filesystem::path absolute = path;
+	if (absolute.is_relative()) {
+		absolute = std::filesystem::current_path() / path;
+	}
+	std::string res = absolute.lexically_normal().native();
+	while (res.size() > 1 && res.back() == '/') {
+		res.pop_back();
+	}
+	return res;
+}
+
+/**
+ * Group objects by the access allowed for them
+ */
+template <typename RulesT>
+std::map<std::uint64_t, std::vector<typename RulesT::key_type>>
+group_by_access(const RulesT& rules)
+{
+	std::map<std::uint64_t, std::vector<typename RulesT::key_type>> res;
+	for (const auto& [object, access] : rules) {
+		res[access].push_back(object);
+	}
+	return res;
+}
+} // namespace
+
+Policy& Policy::handle(const action::FsAction& access)
+{
+	handled_access_fs_ |= access.type_code();
+	return *this;
+}
+
+Policy& Policy::handle(const action::NetAction& access)
+{
+	handled_access_net_ |= access.type_code();
+	return *this;
+}
+
+Policy& Policy::restrict(const Scope& scp)
+{
+	scoped_ |= scp.type_code();
+	return *this;
+}
+
+Policy&
+Policy::allow(const std::filesystem::path& path, const action::FsAction& access)
+{
+	if (access.type_code() != 0) {
+		path_rules_[normalize(path)] |= access.type_code();
+	}
+	return *this;
+}
+
+Policy& Policy::allow(std::uint16_t port, const action::NetAction& access)
+{
+	if (access.type_code() != 0) {
+		port_rules_[port] |= access.type_code();
+	}
+	return *this;
+}
+
+std::uint64_t Policy::effective_access(std::string_view path) const
+{
+	std::uint64_t res = 0;
+	auto add_rule = [&](std::string_view prefix) {
+		const auto rule = path_rules_.find(prefix);
+		if (rule != path_rules_.end()) {
+			res |= rule->second;
+		}
+	};
+
+	add_rule("/");
+	for (std::size_t pos = path.find('/', 1); pos != std::string_view::npos;
+	     pos = path.find('/', pos + 1)) {
+		add_rule(path.substr(0, pos));
+	}
+	if (path.size() > 1) {
+		add_rule(path);
+	}
+
+	return res & handled_access_fs_;
+}
+
+std::uint64_t Policy::effective_access(std::uint16_t port) const
+{
+	const auto rule = port_rules_.find(port);
+	if (rule == port_rules_.end()) {
+		return 0;
+	}
+	return rule->second & handled_access_net_;
+}
+
+Policy Policy::intersect(const Policy& lhs, const Policy& rhs)
+{
+	MergeReport report;
+	return intersect(lhs, rhs, report);
+}
+
+Policy
+Policy::intersect(const Policy& lhs, const Policy& rhs, MergeReport& report)
+{
+	Policy res = merge(
+		lhs,
+		rhs,
+		lhs.handled_access_fs_ | rhs.handled_access_fs_,
+		lhs.handled_access_net_ | rhs.handled_access_net_,
+		[](std::uint64_t l, std::uint64_t r) { return l & r; },
+		report
+	);
+	res.scoped_ = lhs.scoped_ | rhs.scoped_;
+	return res;
+}
+
+Policy Policy::unite(const Policy& lhs, const Policy& rhs)
+{
+	MergeReport report;
+	return unite(lhs, rhs, report);
+}
+
+Policy Policy::unite(const Policy& lhs, const Policy& rhs, MergeReport& report)
+{
+	Policy res = merge(
+		lhs,
+		rhs,
+		lhs.handled_access_fs_ & rhs.handled_access_fs_,
+		lhs.handled_access_net_ & rhs.handled_access_net_,
+		[](std::uint64_t l, std::uint64_t r) { return l | r; },
+		report
+	);
+	res.scoped_ = lhs.scoped_ & rhs.scoped_;
+	return res;
+}
+
+template <typename CombineF>
+Policy Policy::merge(
+	const Policy& lhs,
+	const Policy& rhs,
+	std::uint64_t handled_fs,
+	std::uint64_t handled_net,
+	CombineF combine,
+	MergeReport& report
+)
+{
+	Policy res;
+	res.handled_access_fs_ = handled_fs;
+	res.handled_access_net_ = handled_net;
+
+	report = MergeReport{};
+	report.input_rules = lhs.path_rules_.size() + rhs.path_rules_.size() +
+			     lhs.port_rules_.size() + rhs.port_rules_.size();
+
+	// The access allowed by a policy only changes at its rule paths, so
+	// evaluating the merged access at all rule paths of both sides is
+	// exact. Ancestors sort before their descendants, so the access
+	// inherited in the merged policy is known when visiting a path.
+	std::set<std::string_view> paths;
+	for (const auto& rule : lhs.path_rules_) {
+		paths.insert(rule.first);
+	}
+	for (const auto& rule : rhs.path_rules_) {
+		paths.insert(rule.first);
+	}
+
+	for (const std::string_view path : paths) {
+		const std::uint64_t lhs_access =
+			(lhs.effective_access(path) | ~lhs.handled_access_fs_) &
+			handled_fs;
+		const std::uint64_t rhs_access =
+			(rhs.effective_access(path) | ~rhs.handled_access_fs_) &
+			handled_fs;
+		const std::uint64_t merged = combine(lhs_access, rhs_access);
+
+		const std::uint64_t added =
+			merged & ~res.effective_access(path);
+		if (added != 0) {
+			res.path_rules_.emplace(path, added);
+		}
+
+		if (lhs_access != merged || rhs_access != merged) {
+			report.paths.push_back({std::string{path},
+						lhs_access,
+						rhs_access,
+						merged});
+		}
+	}
+
+	std::set<std::uint16_t> ports;
+	for (const auto& rule : lhs.port_rules_) {
+		ports.insert(rule.first);
+	}
+	for (const auto& rule : rhs.port_rules_) {
+		ports.insert(rule.first);
+	}
+
+	const std::uint64_t lhs_net = lhs.handled_access_net_;
+	const std::uint64_t rhs_net = rhs.handled_access_net_;
+	for (const std::uint16_t port : ports) {
+		const std::uint64_t lhs_access =
+			(lhs.effective_access(port) | ~lhs_net) & handled_net;
+		const std::uint64_t rhs_access =
+			(rhs.effective_access(port) | ~rhs_net) & handled_net;
+		const std::uint64_t merged = combine(lhs_access, rhs_access);
+
+		if (merged != 0) {
+			res.port_rules_.emplace(port, merged);
+		}
+
+		if (lhs_access != merged || rhs_access != merged) {
+			report.ports.push_back(
+				{port, lhs_access, rhs_access, merged}
+			);
+		}
+	}
+
+	report.merged_rules = res.path_rules_.size() + res.port_rules_.size();
+	return res;
+}
+
+#ifndef LLPP_NO_EXCEPTIONS
+std::unique_ptr<Ruleset> Policy::build(Backend& backend) const
+{
+	if (handled_access_fs_ == 0 && handled_access_net_ == 0 &&
+	    scoped_ == 0) {
+		throw std::invalid_argument{
+			"Landlock without handled access and scope restriction "
+			"is not allowed"
+		};
+	}
+
+	std::error_code ec;
+	std::unique_ptr<Ruleset> res = build(backend, ec);
+	if (ec) {
+		throw std::system_error{ec};
+	}
+	return res;
+}
+#endif
+
+std::unique_ptr<Ruleset>
+Policy::build(Backend& backend, std::error_code& ec) const
+{
+	ec.clear();
+
+	Ruleset::ActionVec<ActionRuleType::PATH_BENEATH> handled_fs =
+		action::split(handled_access_fs_, action::FS_ACTIONS);
+	const Ruleset::ActionVec<ActionRuleType::NET_PORT> handled_net =
+		action::split(handled_access_net_, action::NET_ACTIONS);
+	const Ruleset::ScopeVec scopes = scope::split(scoped_);
+
+	// Handled access unknown at compile time is dropped on a best-effort
+	// basis like unsupported access, which is not an invalid ruleset
+	if (handled_fs.empty() && handled_net.empty() && scopes.empty() &&
+	    (handled_access_fs_ != 0 || handled_access_net_ != 0 ||
+	     scoped_ != 0)) {
+		handled_fs.push_back(action::INVALID_ACTION_FS);
+	}
+
+	auto ruleset = std::make_unique<Ruleset>(
+		backend, handled_fs, handled_net, scopes, ec
+	);
+	if (ec) {
+		return nullptr;
+	}
+
+	// Rules which cannot take effect do not open their paths
+	const int rule_abi = ruleset->active() ? ruleset->abi_version() : 0;
+	for (const auto& [access, paths] : group_by_access(path_rules_)) {
+		PathBeneathRule rule{
+			rule_abi, access & ruleset->handled_access_fs()
+		};
+		for (const std::string& path : paths) {
+			rule.add_path(path, ec);
+			if (ec) {
+				return nullptr;
+			}
+		}
+		const std::uint64_t handled = access & handled_access_fs_;
+		for (const action::FsAction& act :
+		     action::split(handled, action::FS_ACTIONS)) {
+			rule.add_action(act);
+		}
+		ruleset->add_rule(std::move(rule), ec);
+		if (ec) {
+			return nullptr;
+		}
+	}
+
+	for (const auto& [access, ports] : group_by_access(port_rules_)) {
+		NetPortRule rule;
+		for (const std::uint16_t port : ports) {
+			rule.add_port(port);
+		}
+		for (const action::NetAction& act : action::split(
+			     access & handled_access_net_, action::NET_ACTIONS
+		     )) {
+			rule.add_action(act);
+		}
+		ruleset->add_rule(std::move(rule), ec);
+		if (ec) {
+			return nullptr;
+		}
+	}
+
+	return ruleset;
+}
+} // namespace landlock
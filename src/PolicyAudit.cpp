@@ -0,0 +1,626 @@
+#include "ll/PolicyAudit.hpp"
+#include "ll/ActionType.hpp"
+#include "ll/Rule.hpp"
+#include "ll/config.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <variant>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace landlock
+{
+namespace
+{
+/// Size of the buffer for getdents64(2), enough for ~2000 typical entries
+constexpr std::size_t DIRENT_BUFFER_SIZE = std::size_t{64} * 1024;
+
+/// Access which applies to files rather than directories
+const std::uint64_t FILE_ACCESS =
+	(action::FS_EXECUTE | action::FS_WRITE_FILE | action::FS_READ_FILE |
+	 action::FS_TRUNCATE | action::FS_IOCTL_DEV)
+		.type_code();
+
+/// Header of a linux_dirent64 record, followed by the name
+struct Dirent64 {
+	ino64_t d_ino;
+	off64_t d_off;
+	unsigned short d_reclen; // NOLINT(*-runtime-int)
+	unsigned char d_type;
+};
+
+/// Offset of the name in a linux_dirent64 record
+constexpr std::size_t DIRENT_NAME_OFFSET = offsetof(Dirent64, d_type) + 1;
+
+std::error_code last_error() noexcept
+{
+	return {errno, std::system_category()};
+}
+
+unsigned char dirent_type(mode_t mode) noexcept
+{
+	return S_ISDIR(mode) ? DT_DIR : DT_REG;
+}
+
+std::string child_path(const std::string& dir, std::string_view name)
+{
+	std::string res;
+	res.reserve(dir.size() + 1 + name.size());
+	res += dir;
+	if (res.back() != '/') {
+		res += '/';
+	}
+	res += name;
+	return res;
+}
+
+unsigned thread_count(unsigned requested) noexcept
+{
+	if (requested != 0) {
+		return requested;
+	}
+	return std::max(1U, std::thread::hardware_concurrency());
+}
+} // namespace
+
+/**
+ * State of a single run
+ *
+ * Every thread owns a queue of directories still to be read. The owner pushes
+ * and pops at the back, so it goes depth first and its queue stays short.
+ * Thieves take from the front, where the directories closest to the root, and
+ * thus the largest subtrees, wait. pending_ counts queued and processed
+ * directories, so the walk is finished when it drops to zero.
+ */
+class PolicyAudit::Walk
+{
+public:
+	Walk(const PolicyAudit& audit, const Options& options) :
+		audit_(audit), options_(options),
+		queues_(thread_count(options.threads)),
+		partials_(queues_.size())
+	{
+	}
+
+	void add_root(std::string path, const Grants& granted, dev_t dev)
+	{
+		const std::size_t idx = roots_++ % queues_.size();
+		++pending_;
+		queues_[idx].items.push_back(
+			{std::move(path),
+			 granted,
+			 audit_.allowed(granted),
+			 dev,
+			 true}
+		);
+	}
+
+	Report run()
+	{
+		std::vector<std::thread> threads;
+		threads.reserve(queues_.size() - 1);
+		for (std::size_t i = 1; i < queues_.size(); ++i) {
+			threads.emplace_back([this, i] { work(i); });
+		}
+		work(0);
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+
+		Report res{};
+		for (Partial& partial : partials_) {
+			for (const auto& [access, counts] : partial.by_access) {
+				Counts& total = res.by_access[access];
+				total.dirs += counts.dirs;
+				total.files += counts.files;
+			}
+			std::move(
+				partial.regions.begin(),
+				partial.regions.end(),
+				std::back_inserter(res.regions)
+			);
+			res.errors += partial.errors;
+		}
+		std::sort(
+			res.regions.begin(),
+			res.regions.end(),
+			[](const Region& lhs, const Region& rhs) {
+				return lhs.path < rhs.path;
+			}
+		);
+		return res;
+	}
+
+private:
+	struct Item {
+		std::string path;
+		/// Access granted by the rules of the ancestors
+		Grants granted;
+		/// Allowed access of the parent directory
+		std::uint64_t parent_access;
+		/// Device of the root, for Options::one_file_system
+		dev_t dev;
+		bool root;
+	};
+
+	// Aligned to keep the queues of different threads in different
+	// cache lines
+	struct alignas(64) Queue { // NOLINT(*-magic-numbers)
+		std::mutex mutex;
+		std::deque<Item> items;
+	};
+
+	struct Partial {
+		std::map<std::uint64_t, Counts> by_access;
+		std::vector<Region> regions;
+		std::uint64_t errors{0};
+	};
+
+	void work(std::size_t idx)
+	{
+		std::unique_ptr<char[]> buf{new char[DIRENT_BUFFER_SIZE]};
+		Item item;
+		for (;;) {
+			if (pop(idx, item)) {
+				process(idx, item, buf.get());
+				pending_.fetch_sub(
+					1, std::memory_order_acq_rel
+				);
+				continue;
+			}
+			if (pending_.load(std::memory_order_acquire) == 0) {
+				return;
+			}
+			std::this_thread::yield();
+		}
+	}
+
+	bool pop(std::size_t idx, Item& item)
+	{
+		{
+			Queue& own = queues_[idx];
+			const std::lock_guard lock{own.mutex};
+			if (not own.items.empty()) {
+				item = std::move(own.items.back());
+				own.items.pop_back();
+				return true;
+			}
+		}
+		for (std::size_t i = 1; i < queues_.size(); ++i) {
+			Queue& victim = queues_[(idx + i) % queues_.size()];
+			const std::lock_guard lock{victim.mutex};
+			if (not victim.items.empty()) {
+				item = std::move(victim.items.front());
+				victim.items.pop_front();
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void push(std::size_t idx, Item item)
+	{
+		pending_.fetch_add(1, std::memory_order_relaxed);
+		Queue& own = queues_[idx];
+		const std::lock_guard lock{own.mutex};
+		own.items.push_back(std::move(item));
+	}
+
+	/**
+	 * Count an entry and record it as a region if its access differs
+	 * from the access inherited from its parent
+	 */
+	void classify(
+		Partial& out,
+		std::string_view path,
+		bool dir,
+		std::uint64_t access,
+		bool region
+	)
+	{
+		Counts& counts = out.by_access[access];
+		++(dir ? counts.dirs : counts.files);
+		if (region) {
+			out.regions.push_back({std::string{path}, dir, access});
+		}
+		if (options_.visitor) {
+			options_.visitor(path, dir, access);
+		}
+	}
+
+	void process(std::size_t idx, Item& item, char* buf)
+	{
+		Partial& out = partials_[idx];
+
+		const int fd = ::open(
+			item.path.c_str(),
+			O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC
+		);
+		struct stat st {};
+		if (fd < 0 || ::fstat(fd, &st) != 0) {
+			const bool not_dir = errno == ENOTDIR || errno == ELOOP;
+			if (fd >= 0) {
+				::close(fd);
+			}
+			// Still classify what cannot be read, if it exists
+			if (::lstat(item.path.c_str(), &st) != 0) {
+				++out.errors;
+				return;
+			}
+			if (not not_dir) {
+				++out.errors;
+			}
+			Grants granted = item.granted;
+			audit_.apply_rule(st.st_dev, st.st_ino, granted);
+			const bool dir = S_ISDIR(st.st_mode);
+			const std::uint64_t mask = dir ? ~std::uint64_t{0}
+						       : FILE_ACCESS;
+			const std::uint64_t access =
+				audit_.allowed(granted) & mask;
+			const bool region =
+				access != (item.parent_access & mask);
+			classify(
+				out, item.path, dir, access, item.root || region
+			);
+			return;
+		}
+
+		audit_.apply_rule(st.st_dev, st.st_ino, item.granted);
+		const std::uint64_t access = audit_.allowed(item.granted);
+		classify(
+			out,
+			item.path,
+			true,
+			access,
+			item.root || access != item.parent_access
+		);
+
+		if (options_.one_file_system && st.st_dev != item.dev) {
+			::close(fd);
+			return;
+		}
+
+		read_entries(idx, fd, item, access, buf);
+		::close(fd);
+	}
+
+	void read_entries(
+		std::size_t idx,
+		int fd,
+		const Item& item,
+		std::uint64_t access,
+		char* buf
+	)
+	{
+		for (;;) {
+			const long len = ::syscall( // NOLINT(*-vararg)
+				SYS_getdents64,
+				fd,
+				buf,
+				DIRENT_BUFFER_SIZE
+			);
+			if (len <= 0) {
+				if (len < 0) {
+					++partials_[idx].errors;
+				}
+				return;
+			}
+
+			for (long pos = 0; pos < len;) {
+				const char* rec = buf + pos;
+				Dirent64 ent{};
+				std::memcpy(&ent, rec, sizeof(ent));
+				pos += ent.d_reclen;
+
+				const std::string_view name{
+					rec + DIRENT_NAME_OFFSET
+				};
+				if (name != "." && name != "..") {
+					read_entry(
+						idx, fd, item, access, ent, name
+					);
+				}
+			}
+		}
+	}
+
+	/**
+	 * Queue a subdirectory or count a file of the directory fd
+	 */
+	void read_entry(
+		std::size_t idx,
+		int fd,
+		const Item& item,
+		std::uint64_t access,
+		const Dirent64& ent,
+		std::string_view name
+	)
+	{
+		// Only stat entries whose type is unknown or whose inode number
+		// has a rule
+		struct stat st {};
+		bool have_stat = false;
+		unsigned char type = ent.d_type;
+		if (type == DT_UNKNOWN ||
+		    (type != DT_DIR && audit_.rules_.count(ent.d_ino) != 0)) {
+			const int flags = AT_SYMLINK_NOFOLLOW;
+			if (::fstatat(fd, name.data(), &st, flags) != 0) {
+				return;
+			}
+			have_stat = true;
+			type = dirent_type(st.st_mode);
+		}
+
+		if (type == DT_DIR) {
+			push(idx,
+			     {child_path(item.path, name),
+			      item.granted,
+			      access,
+			      item.dev,
+			      false});
+			return;
+		}
+
+		const std::uint64_t inherited = access & FILE_ACCESS;
+		std::uint64_t file_access = inherited;
+		if (have_stat) {
+			Grants granted = item.granted;
+			audit_.apply_rule(st.st_dev, st.st_ino, granted);
+			file_access = audit_.allowed(granted) & FILE_ACCESS;
+		}
+		Partial& out = partials_[idx];
+		const bool region = file_access != inherited;
+		if (region || options_.visitor) {
+			classify(
+				out,
+				child_path(item.path, name),
+				false,
+				file_access,
+				region
+			);
+		} else {
+			++out.by_access[file_access].files;
+		}
+	}
+
+	const PolicyAudit& audit_;
+	const Options& options_;
+	std::vector<Queue> queues_;
+	std::vector<Partial> partials_;
+	std::atomic<std::size_t> pending_{0};
+	std::size_t roots_{0};
+};
+
+#ifndef LLPP_NO_EXCEPTIONS
+PolicyAudit& PolicyAudit::add_layer(const Ruleset& ruleset)
+{
+	std::error_code ec;
+	add_layer(ruleset, ec);
+	if (ec) {
+		throw std::system_error{ec};
+	}
+	return *this;
+}
+
+PolicyAudit& PolicyAudit::add_layer(const Policy& policy)
+{
+	std::error_code ec;
+	add_layer(policy, ec);
+	if (ec) {
+		throw std::system_error{ec};
+	}
+	return *this;
+}
+#endif
+
+PolicyAudit& PolicyAudit::add_layer(const Ruleset& ruleset, std::error_code& ec)
+{
+	ec.clear();
+
+	if (handled_.size() >= MAX_LAYERS) {
+		ec = std::make_error_code(std::errc::argument_list_too_long);
+		return *this;
+	}
+
+	// Without the rules of an adopted ruleset, everything it handles would
+	// be reported as denied
+	if (ruleset.active() && not ruleset.rules_known()) {
+		ec = std::make_error_code(std::errc::not_supported);
+		return *this;
+	}
+
+	std::uint64_t handled = 0;
+	std::vector<InodeRule> rules;
+
+	// An inactive ruleset does not restrict anything, so it is represented
+	// by a layer handling nothing
+	if (ruleset.active()) {
+		// The kernel always handles REFER implicitly
+		handled = ruleset.handled_access_fs() |
+			  action::FS_REFER.type_code();
+
+		for (const Ruleset::RuleVariant& rule : ruleset.rules()) {
+			const auto* pb_rule =
+				std::get_if<PathBeneathRule>(&rule);
+			if (pb_rule == nullptr) {
+				continue;
+			}
+			for (const auto& attr :
+			     pb_rule->generate(ruleset.abi_version())) {
+				struct stat st {};
+				if (::fstat(attr.parent_fd, &st) != 0) {
+					ec = last_error();
+					return *this;
+				}
+				rules.push_back({st.st_dev,
+						 st.st_ino,
+						 attr.allowed_access});
+			}
+		}
+	}
+
+	add_layer(handled, rules);
+	return *this;
+}
+
+PolicyAudit& PolicyAudit::add_layer(const Policy& policy, std::error_code& ec)
+{
+	ec.clear();
+
+	if (handled_.size() >= MAX_LAYERS) {
+		ec = std::make_error_code(std::errc::argument_list_too_long);
+		return *this;
+	}
+
+	// Like Ruleset, which opens the rule paths following symbolic links
+	std::vector<InodeRule> rules;
+	for (const auto& [path, access] : policy.path_rules()) {
+		struct stat st {};
+		if (::stat(path.c_str(), &st) != 0) {
+			ec = last_error();
+			return *this;
+		}
+		rules.push_back(
+			{st.st_dev,
+			 st.st_ino,
+			 access & policy.handled_access_fs()}
+		);
+	}
+
+	add_layer(
+		policy.handled_access_fs() | action::FS_REFER.type_code(), rules
+	);
+	return *this;
+}
+
+void PolicyAudit::add_layer(
+	std::uint64_t handled, const std::vector<InodeRule>& rules
+)
+{
+	const std::size_t layer_idx = handled_.size();
+	for (const InodeRule& rule : rules) {
+		std::vector<InodeGrants>& inodes = rules_[rule.ino];
+		auto it = std::find_if(
+			inodes.begin(),
+			inodes.end(),
+			[&rule](const InodeGrants& inode) {
+				return inode.dev == rule.dev;
+			}
+		);
+		if (it == inodes.end()) {
+			it = inodes.insert(inodes.end(), {rule.dev, {}});
+		}
+		it->access.at(layer_idx) |= rule.access;
+	}
+	handled_.push_back(handled);
+	audited_ |= handled;
+}
+
+const PolicyAudit::Grants*
+PolicyAudit::rule(dev_t dev, ino_t ino) const noexcept
+{
+	const auto it = rules_.find(ino);
+	if (it == rules_.end()) {
+		return nullptr;
+	}
+	for (const InodeGrants& inode : it->second) {
+		if (inode.dev == dev) {
+			return &inode.access;
+		}
+	}
+	return nullptr;
+}
+
+void PolicyAudit::apply_rule(dev_t dev, ino_t ino, Grants& granted)
+	const noexcept
+{
+	if (const Grants* inode = rule(dev, ino)) {
+		for (std::size_t i = 0; i < handled_.size(); ++i) {
+			granted[i] |= (*inode)[i];
+		}
+	}
+}
+
+std::uint64_t PolicyAudit::allowed(const Grants& granted) const noexcept
+{
+	std::uint64_t res = audited_;
+	for (std::size_t i = 0; i < handled_.size(); ++i) {
+		res &= granted[i] | ~handled_[i];
+	}
+	return res;
+}
+
+#ifndef LLPP_NO_EXCEPTIONS
+PolicyAudit::Report PolicyAudit::run(
+	const std::vector<std::filesystem::path>& roots, const Options& options
+) const
+{
+	std::error_code ec;
+	Report res = run(roots, options, ec);
+	if (ec) {
+		throw std::system_error{ec};
+	}
+	return res;
+}
+
+PolicyAudit::Report
+PolicyAudit::run(const std::vector<std::filesystem::path>& roots) const
+{
+	return run(roots, Options{});
+}
+#endif
+
+PolicyAudit::Report PolicyAudit::run(
+	const std::vector<std::filesystem::path>& roots,
+	const Options& options,
+	std::error_code& ec
+) const
+{
+	ec.clear();
+
+	Walk walk{*this, options};
+	for (const std::filesystem::path& root : roots) {
+		const std::filesystem::path canonical =
+			std::filesystem::canonical(root, ec);
+		if (ec) {
+			return {};
+		}
+
+		// Rules on the ancestors of the root apply beneath it
+		Grants granted{};
+		std::filesystem::path ancestor = canonical.root_path();
+		for (const std::filesystem::path& component :
+		     canonical.relative_path()) {
+			struct stat st {};
+			if (::stat(ancestor.c_str(), &st) == 0) {
+				apply_rule(st.st_dev, st.st_ino, granted);
+			}
+			ancestor /= component;
+		}
+
+		struct stat st {};
+		if (::stat(canonical.c_str(), &st) != 0) {
+			ec = last_error();
+			return {};
+		}
+		walk.add_root(canonical.native(), granted, st.st_dev);
+	}
+	return walk.run();
+}
+} // namespace landlock
@@ -0,0 +1,307 @@
+#include "ll/PolicyFile.hpp"
+
+#include <array>
+#include <charconv>
+#include <istream>
+#include <limits>
+#include <ostream>
+
+namespace landlock
+{
+namespace
+{
+/// Names of action::FS_ACTIONS
+constexpr std::array<std::string_view, action::FS_ACTIONS.size()> FS_NAMES{
+	"execute",    "write_file", "read_file",  "read_dir",
+	"remove_dir", "remove_file", "make_char", "make_dir",
+	"make_reg",   "make_sock",  "make_fifo",  "make_block",
+	"make_sym",   "refer",      "truncate",   "ioctl_dev",
+};
+
+/// Names of action::NET_ACTIONS
+constexpr std::array<std::string_view, action::NET_ACTIONS.size()> NET_NAMES{
+	"bind_tcp",
+	"connect_tcp",
+};
+
+/// Names of scope::SCOPES
+constexpr std::array<std::string_view, scope::SCOPES.size()> SCOPE_NAMES{
+	"abstract_unix_socket",
+	"signal",
+};
+
+constexpr std::string_view WHITESPACE{" \t\r"};
+
+std::string_view trim(std::string_view str) noexcept
+{
+	const std::size_t begin = str.find_first_not_of(WHITESPACE);
+	if (begin == std::string_view::npos) {
+		return {};
+	}
+	const std::size_t end = str.find_last_not_of(WHITESPACE);
+	return str.substr(begin, end - begin + 1);
+}
+
+/**
+ * Split off the next whitespace-separated word
+ */
+std::string_view next_word(std::string_view& rest) noexcept
+{
+	rest = trim(rest);
+	const std::size_t end = rest.find_first_of(WHITESPACE);
+	const std::string_view word = rest.substr(0, end);
+	rest = end == std::string_view::npos ? std::string_view{}
+					     : trim(rest.substr(end));
+	return word;
+}
+
+/**
+ * Parse a comma-separated list of names of known into a combined value
+ *
+ * group resolves additional names standing for several values.
+ */
+template <typename T, std::size_t N, typename GroupF>
+std::optional<T> parse_list(
+	std::string_view names,
+	const std::array<T, N>& known,
+	const std::array<std::string_view, N>& known_names,
+	GroupF group
+)
+{
+	T res{0, 0};
+	for (bool more = true; more;) {
+		const std::size_t end = names.find(',');
+		const std::string_view name = names.substr(0, end);
+		more = end != std::string_view::npos;
+		names = more ? names.substr(end + 1) : std::string_view{};
+
+		if (const std::optional<T> grouped = group(name)) {
+			res |= *grouped;
+			continue;
+		}
+
+		std::size_t idx = 0;
+		while (idx < N && known_names.at(idx) != name) {
+			++idx;
+		}
+		if (idx == N) {
+			return std::nullopt;
+		}
+		res |= known.at(idx);
+	}
+	return res;
+}
+
+template <typename T, std::size_t N>
+T combine_all(const std::array<T, N>& known)
+{
+	T res{0, 0};
+	for (const T& val : known) {
+		res |= val;
+	}
+	return res;
+}
+
+/**
+ * Get the comma-separated names of the known values contained in mask
+ */
+template <typename T, std::size_t N>
+std::string names_of(
+	std::uint64_t mask,
+	const std::array<T, N>& known,
+	const std::array<std::string_view, N>& known_names
+)
+{
+	std::string res;
+	for (std::size_t i = 0; i < N; ++i) {
+		const std::uint64_t code = known.at(i).type_code();
+		if (code != 0 && (mask & code) == code) {
+			if (not res.empty()) {
+				res += ',';
+			}
+			res += known_names.at(i);
+		}
+	}
+	return res;
+}
+} // namespace
+
+bool PolicyFile::read(std::istream& in, Policy& policy, PolicyFileError& error)
+{
+	std::string line;
+	std::size_t line_no = 0;
+	while (std::getline(in, line)) {
+		++line_no;
+		std::string message;
+		if (not apply(line, policy, message)) {
+			error = {line_no, std::move(message)};
+			return false;
+		}
+	}
+	if (in.bad()) {
+		error = {line_no, "read error"};
+		return false;
+	}
+	return true;
+}
+
+bool PolicyFile::apply(
+	std::string_view directive, Policy& policy, std::string& message
+)
+{
+	std::string_view rest = trim(directive);
+	if (rest.empty() || rest.front() == '#') {
+		return true;
+	}
+
+	const std::string_view keyword = next_word(rest);
+	if (keyword == "handle") {
+		const std::string_view kind = next_word(rest);
+		const std::string_view names = next_word(rest);
+		if (kind == "fs") {
+			if (const auto acts = fs_actions(names);
+			    acts && rest.empty()) {
+				policy.handle(*acts);
+				return true;
+			}
+		} else if (kind == "net") {
+			if (const auto acts = net_actions(names);
+			    acts && rest.empty()) {
+				policy.handle(*acts);
+				return true;
+			}
+		}
+		message = "expected: handle fs|net <actions>";
+		return false;
+	}
+
+	if (keyword == "scope") {
+		const std::string_view names = next_word(rest);
+		if (const auto scp = scopes(names); scp && rest.empty()) {
+			policy.restrict(*scp);
+			return true;
+		}
+		message = "expected: scope <scopes>";
+		return false;
+	}
+
+	if (keyword == "path") {
+		const auto acts = fs_actions(next_word(rest));
+		if (acts && not rest.empty()) {
+			policy.allow(std::string{rest}, *acts);
+			return true;
+		}
+		message = "expected: path <actions> <path>";
+		return false;
+	}
+
+	if (keyword == "port") {
+		const auto acts = net_actions(next_word(rest));
+		const std::string_view port_str = next_word(rest);
+		std::uint16_t port = 0;
+		const auto [end, err] = std::from_chars(
+			port_str.data(), port_str.data() + port_str.size(), port
+		);
+		if (acts && err == std::errc{} && not port_str.empty() &&
+		    end == port_str.data() + port_str.size() && rest.empty()) {
+			policy.allow(port, *acts);
+			return true;
+		}
+		message = "expected: port <actions> <port>";
+		return false;
+	}
+
+	message = "unknown directive '" + std::string{keyword} + "'";
+	return false;
+}
+
+void PolicyFile::write(std::ostream& out, const Policy& policy)
+{
+	const std::string handled_fs = names_of(
+		policy.handled_access_fs(), action::FS_ACTIONS, FS_NAMES
+	);
+	if (not handled_fs.empty()) {
+		out << "handle fs " << handled_fs << '\n';
+	}
+	const std::string handled_net = names_of(
+		policy.handled_access_net(), action::NET_ACTIONS, NET_NAMES
+	);
+	if (not handled_net.empty()) {
+		out << "handle net " << handled_net << '\n';
+	}
+	const std::string scoped =
+		names_of(policy.scoped(), scope::SCOPES, SCOPE_NAMES);
+	if (not scoped.empty()) {
+		out << "scope " << scoped << '\n';
+	}
+
+	for (const auto& [path, access] : policy.path_rules()) {
+		const std::string names =
+			names_of(access, action::FS_ACTIONS, FS_NAMES);
+		if (not names.empty()) {
+			out << "path " << names << ' ' << path << '\n';
+		}
+	}
+	for (const auto& [port, access] : policy.port_rules()) {
+		const std::string names =
+			names_of(access, action::NET_ACTIONS, NET_NAMES);
+		if (not names.empty()) {
+			out << "port " << names << ' ' << port << '\n';
+		}
+	}
+}
+
+std::optional<action::FsAction> PolicyFile::fs_actions(std::string_view names
+)
+{
+	return parse_list(
+		names,
+		action::FS_ACTIONS,
+		FS_NAMES,
+		[](std::string_view name) -> std::optional<action::FsAction> {
+			if (name == "all") {
+				return combine_all(action::FS_ACTIONS);
+			}
+			if (name == "ro") {
+				return action::FS_EXECUTE |
+				       action::FS_READ_FILE |
+				       action::FS_READ_DIR;
+			}
+			return std::nullopt;
+		}
+	);
+}
+
+std::string PolicyFile::fs_names(std::uint64_t mask)
+{
+	return names_of(mask, action::FS_ACTIONS, FS_NAMES);
+}
+
+std::optional<action::NetAction>
+PolicyFile::net_actions(std::string_view names)
+{
+	return parse_list(
+		names,
+		action::NET_ACTIONS,
+		NET_NAMES,
+		[](std::string_view name) -> std::optional<action::NetAction> {
+			if (name == "all") {
+				return combine_all(action::NET_ACTIONS);
+			}
+			return std::nullopt;
+		}
+	);
+}
+
+std::optional<Scope> PolicyFile::scopes(std::string_view names)
+{
+	return parse_list(
+		names,
+		scope::SCOPES,
+		SCOPE_NAMES,
+		[](std::string_view /*name*/) -> std::optional<Scope> {
+			return std::nullopt;
+		}
+	);
+}
+} // namespace landlock
@@ -0,0 +1,262 @@
+#include "ll/PolicyLearner.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <istream>
+#include <system_error>
+#include <vector>
+
+namespace landlock
+{
+namespace
+{
+constexpr std::string_view PROC = "/proc/";
+
+template <typename T, std::size_t N>
+std::uint64_t known_mask(const std::array<T, N>& known)
+{
+	std::uint64_t res = 0;
+	for (const T& act : known) {
+		res |= act.type_code();
+	}
+	return res;
+}
+
+/**
+ * Combine the known actions whose bits are set in mask
+ */
+template <typename T, std::size_t N>
+T to_action(std::uint64_t mask, const std::array<T, N>& known)
+{
+	T res{0, 0};
+	for (const T& act : action::split(mask, known)) {
+		res |= act;
+	}
+	return res;
+}
+
+/**
+ * Make a path absolute and lexically normal, replacing /proc/<pid> by
+ * /proc/self
+ */
+std::string normalize(std::string_view path)
+{
+	std::filesystem::path res{path};
+	if (not res.is_absolute()) {
+		res = std::filesystem::current_path() / res;
+	}
+	std::string str = res.lexically_normal().native();
+	while (str.size() > 1 && str.back() == '/') {
+		str.pop_back();
+	}
+
+	if (str.compare(0, PROC.size(), PROC) == 0) {
+		const std::size_t end =
+			std::min(str.find('/', PROC.size()), str.size());
+		const auto pid = std::string_view{str}.substr(
+			PROC.size(), end - PROC.size()
+		);
+		if (not pid.empty() &&
+		    std::all_of(pid.begin(), pid.end(), [](char chr) {
+			    return chr >= '0' && chr <= '9';
+		    })) {
+			str.replace(PROC.size(), pid.size(), "self");
+		}
+	}
+	return str;
+}
+
+std::size_t depth(std::string_view path)
+{
+	return path == "/" ? 0
+			   : static_cast<std::size_t>(
+				     std::count(path.begin(), path.end(), '/')
+			     );
+}
+
+std::string parent(std::string_view path)
+{
+	const std::size_t pos = path.rfind('/');
+	return pos == 0 ? std::string{"/"} : std::string{path.substr(0, pos)};
+}
+
+/**
+ * Replace groups of at least threshold rules directly beneath a directory by
+ * a rule on the directory, deepest first
+ */
+void collapse(
+	std::map<std::string, std::uint64_t, std::less<>>& rules,
+	std::size_t threshold
+)
+{
+	std::size_t max_depth = 0;
+	for (const auto& [path, access] : rules) {
+		max_depth = std::max(max_depth, depth(path));
+	}
+
+	for (std::size_t cur = max_depth; cur > 0; --cur) {
+		std::map<std::string, std::vector<std::string>> groups;
+		for (const auto& [path, access] : rules) {
+			if (depth(path) == cur) {
+				groups[parent(path)].push_back(path);
+			}
+		}
+		for (const auto& [dir, children] : groups) {
+			if (children.size() < threshold) {
+				continue;
+			}
+			std::uint64_t access = 0;
+			for (const std::string& child : children) {
+				const auto rule = rules.find(child);
+				access |= rule->second;
+				rules.erase(rule);
+			}
+			rules[dir] |= access;
+		}
+	}
+}
+
+/**
+ * Parse a number in base from the next word of line
+ */
+template <typename T>
+bool parse_number(std::string_view& line, T& value, int base)
+{
+	const char* end = line.data() + line.size();
+	const auto [ptr, err] =
+		std::from_chars(line.data(), end, value, base);
+	if (err != std::errc{} || ptr == line.data() ||
+	    (ptr != end && *ptr != ' ')) {
+		return false;
+	}
+	line.remove_prefix(static_cast<std::size_t>(ptr - line.data()));
+	if (not line.empty()) {
+		line.remove_prefix(1);
+	}
+	return true;
+}
+} // namespace
+
+PolicyLearner&
+PolicyLearner::record(std::string_view path, const action::FsAction& access)
+{
+	record_fs(path, access.type_code());
+	return *this;
+}
+
+PolicyLearner&
+PolicyLearner::record(std::uint16_t port, const action::NetAction& access)
+{
+	++stats_.records;
+	const std::uint64_t known =
+		access.type_code() & known_mask(action::NET_ACTIONS);
+	if (known != 0) {
+		ports_[port] |= known;
+	}
+	return *this;
+}
+
+void PolicyLearner::record_fs(std::string_view path, std::uint64_t access)
+{
+	++stats_.records;
+	const std::uint64_t known = access & known_mask(action::FS_ACTIONS);
+	if (known != 0 && not path.empty()) {
+		paths_[normalize(path)] |= known;
+	}
+}
+
+PolicyLearner& PolicyLearner::read_trace(std::istream& in)
+{
+	std::string buf;
+	while (std::getline(in, buf)) {
+		std::string_view line{buf};
+		if (line.empty()) {
+			continue;
+		}
+
+		const std::size_t sep = line.find(' ');
+		const std::string_view kind = line.substr(0, sep);
+		line.remove_prefix(
+			sep == std::string_view::npos ? line.size() : sep + 1
+		);
+
+		std::uint64_t value = 0;
+		std::uint16_t port = 0;
+		if (kind == "fs" && parse_number(line, value, 16) &&
+		    not line.empty() && line.front() == '/') {
+			record_fs(line, value);
+		} else if (kind == "net" && parse_number(line, value, 16) &&
+			   parse_number(line, port, 10) && line.empty()) {
+			record(port, to_action(value, action::NET_ACTIONS));
+		} else if (kind == "lost" && parse_number(line, value, 10) &&
+			   line.empty()) {
+			stats_.lost += value;
+		} else {
+			++stats_.malformed;
+		}
+	}
+	return *this;
+}
+
+std::size_t PolicyLearner::relocate_missing()
+{
+	std::size_t moved = 0;
+	for (auto rule = paths_.begin(); rule != paths_.end();) {
+		std::error_code ec;
+		if (std::filesystem::symlink_status(rule->first, ec).type() !=
+		    std::filesystem::file_type::not_found) {
+			++rule;
+			continue;
+		}
+
+		std::string ancestor = parent(rule->first);
+		while (ancestor != "/" &&
+		       std::filesystem::symlink_status(ancestor, ec).type() ==
+			       std::filesystem::file_type::not_found) {
+			ancestor = parent(ancestor);
+		}
+		const std::uint64_t access = rule->second;
+		rule = paths_.erase(rule);
+		// The ancestor sorts before the erased path, so the iteration
+		// does not visit it again
+		paths_[ancestor] |= access;
+		++moved;
+	}
+	return moved;
+}
+
+Policy PolicyLearner::policy(std::size_t collapse_threshold) const
+{
+	Policy res;
+	for (const action::FsAction& act : action::FS_ACTIONS) {
+		// Device ioctls are not recorded by the interposer, so handling
+		// them would deny what the program did
+		if (act.type_code() != action::FS_IOCTL_DEV.type_code()) {
+			res.handle(act);
+		}
+	}
+	for (const action::NetAction& act : action::NET_ACTIONS) {
+		res.handle(act);
+	}
+
+	auto rules = paths_;
+	if (collapse_threshold > 0) {
+		collapse(rules, collapse_threshold);
+	}
+
+	// Ancestors sort before their descendants, so the inherited access is
+	// complete when a path is reached
+	for (const auto& [path, access] : rules) {
+		const std::uint64_t extra =
+			access & ~res.effective_access(path);
+		if (extra != 0) {
+			res.allow(path, to_action(extra, action::FS_ACTIONS));
+		}
+	}
+	for (const auto& [port, access] : ports_) {
+		res.allow(port, to_action(access, action::NET_ACTIONS));
+	}
+	return res;
+}
+} // namespace landlock
@@ -0,0 +1,216 @@
+#include "ll/PolicyReloader.hpp"
+#include "ll/ActionType.hpp"
+#include "ll/Scope.hpp"
+
+#include <set>
+#include <string_view>
+#include <utility>
+
+namespace landlock
+{
+namespace
+{
+/**
+ * Access allowed by a policy for an object, including unhandled access
+ */
+std::uint64_t
+allowed(std::uint64_t effective, std::uint64_t handled, std::uint64_t universe)
+{
+	return (effective | ~handled) & universe;
+}
+
+/**
+ * Collect the objects at which the access of either policy may change
+ *
+ * "/" stands for all paths without rules on themselves or their ancestors.
+ */
+std::set<std::string_view> rule_paths(const Policy& lhs, const Policy& rhs)
+{
+	std::set<std::string_view> res{"/"};
+	for (const auto& rule : lhs.path_rules()) {
+		res.insert(rule.first);
+	}
+	for (const auto& rule : rhs.path_rules()) {
+		res.insert(rule.first);
+	}
+	return res;
+}
+
+std::set<std::uint16_t> rule_ports(const Policy& lhs, const Policy& rhs)
+{
+	std::set<std::uint16_t> res;
+	for (const auto& rule : lhs.port_rules()) {
+		res.insert(rule.first);
+	}
+	for (const auto& rule : rhs.port_rules()) {
+		res.insert(rule.first);
+	}
+	return res;
+}
+
+/**
+ * Access bits allowed by only one of two policies for some object
+ */
+struct Change {
+	std::uint64_t removed_fs{0};
+	std::uint64_t removed_net{0};
+	std::uint64_t added_fs{0};
+	std::uint64_t added_net{0};
+};
+
+/**
+ * Compare the access of cur and next at all objects where it may change
+ *
+ * Access bits removed are allowed by cur but not by next for some object, and
+ * access bits added are allowed by next but not by cur.
+ */
+Change compare(const Policy& cur, const Policy& next)
+{
+	Change res;
+
+	const std::uint64_t fs_universe =
+		cur.handled_access_fs() | next.handled_access_fs();
+	for (const std::string_view path : rule_paths(cur, next)) {
+		const std::uint64_t cur_access = allowed(
+			cur.effective_access(path),
+			cur.handled_access_fs(),
+			fs_universe
+		);
+		const std::uint64_t next_access = allowed(
+			next.effective_access(path),
+			next.handled_access_fs(),
+			fs_universe
+		);
+		res.removed_fs |= cur_access & ~next_access;
+		res.added_fs |= next_access & ~cur_access;
+	}
+
+	const std::uint64_t net_universe =
+		cur.handled_access_net() | next.handled_access_net();
+	// Ports without any rule
+	const std::uint64_t cur_base =
+		allowed(0, cur.handled_access_net(), net_universe);
+	const std::uint64_t next_base =
+		allowed(0, next.handled_access_net(), net_universe);
+	res.removed_net = cur_base & ~next_base;
+	res.added_net = next_base & ~cur_base;
+	for (const std::uint16_t port : rule_ports(cur, next)) {
+		const std::uint64_t cur_access = allowed(
+			cur.effective_access(port),
+			cur.handled_access_net(),
+			net_universe
+		);
+		const std::uint64_t next_access = allowed(
+			next.effective_access(port),
+			next.handled_access_net(),
+			net_universe
+		);
+		res.removed_net |= cur_access & ~next_access;
+		res.added_net |= next_access & ~cur_access;
+	}
+
+	return res;
+}
+} // namespace
+
+PolicyReloader::PolicyReloader(Backend& backend) noexcept : backend_(&backend)
+{
+}
+
+PolicyReloader::PolicyReloader(Policy enforced, Backend& backend) noexcept :
+	backend_(&backend), enforced_(std::move(enforced))
+{
+}
+
+bool PolicyReloader::narrower(const Policy& next) const
+{
+	if (not enforced_) {
+		return true;
+	}
+
+	const Change change = compare(*enforced_, next);
+	return change.added_fs == 0 && change.added_net == 0 &&
+	       (enforced_->scoped() & ~next.scoped()) == 0;
+}
+
+Policy PolicyReloader::delta(const Policy& next) const
+{
+	if (not enforced_) {
+		return next;
+	}
+
+	const Change change = compare(*enforced_, next);
+
+	// Only the removed access is handled. For these bits, next grants
+	// nothing the enforced policy does not, so intersecting the enforced
+	// policy with the layer yields next.
+	Policy res;
+	for (const action::FsAction& act :
+	     action::split(change.removed_fs, action::FS_ACTIONS)) {
+		res.handle(act);
+	}
+	for (const action::NetAction& act :
+	     action::split(change.removed_net, action::NET_ACTIONS)) {
+		res.handle(act);
+	}
+	for (const Scope& scp :
+	     scope::split(next.scoped() & ~enforced_->scoped())) {
+		res.restrict(scp);
+	}
+
+	for (const auto& [path, access] : next.path_rules()) {
+		for (const action::FsAction& act : action::split(
+			     access & change.removed_fs, action::FS_ACTIONS
+		     )) {
+			res.allow(path, act);
+		}
+	}
+	for (const auto& [port, access] : next.port_rules()) {
+		for (const action::NetAction& act : action::split(
+			     access & change.removed_net, action::NET_ACTIONS
+		     )) {
+			res.allow(port, act);
+		}
+	}
+
+	return res;
+}
+
+#ifndef LLPP_NO_EXCEPTIONS
+void PolicyReloader::reload(const Policy& next)
+{
+	std::error_code ec;
+	reload(next, ec);
+	if (ec) {
+		throw std::system_error{ec};
+	}
+}
+#endif
+
+void PolicyReloader::reload(const Policy& next, std::error_code& ec)
+{
+	ec.clear();
+
+	if (not narrower(next)) {
+		ec = std::make_error_code(std::errc::operation_not_permitted);
+		return;
+	}
+
+	const Policy layer = delta(next);
+	if (layer.handled_access_fs() != 0 || layer.handled_access_net() != 0 ||
+	    layer.scoped() != 0) {
+		const std::unique_ptr<Ruleset> ruleset =
+			layer.build(*backend_, ec);
+		if (ec) {
+			return;
+		}
+		ruleset->enforce(true, ec);
+		if (ec) {
+			return;
+		}
+		++layer_count_;
+	}
+
+	enforced_ = next;
+}
+} // namespace landlock
@@ -0,0 +1,372 @@
+#include "ll/PolicyTemplate.hpp"
+#include "ll/Scope.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <string>
+#include <variant>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace landlock
+{
+namespace
+{
+std::error_code last_error() noexcept
+{
+	return {errno, std::system_category()};
+}
+
+/**
+ * Add a path beneath rule, returning false with ec set on failure
+ */
+bool add_path_rule(
+	Backend& backend,
+	int ruleset_fd,
+	int parent_fd,
+	std::uint64_t access,
+	std::error_code& ec
+) noexcept
+{
+	landlock_path_beneath_attr attr{};
+	attr.allowed_access = access;
+	attr.parent_fd = parent_fd;
+	if (backend.add_rule(ruleset_fd, LANDLOCK_RULE_PATH_BENEATH, &attr, 0) <
+	    0) {
+		ec = last_error();
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Get the fd of a path parameter, opening it unless it is borrowed,
+ * returning -1 with ec set on failure
+ */
+int open_path_arg(
+	const PolicyTemplate::PathArg& arg, std::error_code& ec
+) noexcept
+{
+	if (const int* borrowed = std::get_if<int>(&arg)) {
+		if (*borrowed < 0) {
+			ec = std::make_error_code(
+				std::errc::bad_file_descriptor
+			);
+		}
+		return *borrowed;
+	}
+	const auto* path = std::get_if<std::filesystem::path>(&arg);
+	// NOLINTNEXTLINE(*-vararg)
+	const int fd = ::open(path->c_str(), O_PATH | O_CLOEXEC);
+	if (fd < 0) {
+		ec = last_error();
+	}
+	return fd;
+}
+
+/**
+ * Drop the directory access from access if path_fd is not a directory,
+ * returning false with ec set on failure
+ */
+bool mask_file_access(
+	int path_fd, std::uint64_t& access, std::error_code& ec
+) noexcept
+{
+	struct stat st {};
+	if (::fstat(path_fd, &st) != 0) {
+		ec = last_error();
+		return false;
+	}
+	if (not S_ISDIR(st.st_mode)) {
+		access &= action::FS_FILE_ACTIONS.type_code();
+	}
+	return true;
+}
+
+#if LLPP_BUILD_LANDLOCK_API >= 4
+/**
+ * Add a net port rule, returning false with ec set on failure
+ */
+bool add_port_rule(
+	Backend& backend,
+	int ruleset_fd,
+	std::uint16_t port,
+	std::uint64_t access,
+	std::error_code& ec
+) noexcept
+{
+	landlock_net_port_attr attr{};
+	attr.allowed_access = access;
+	attr.port = port;
+	if (backend.add_rule(ruleset_fd, LANDLOCK_RULE_NET_PORT, &attr, 0) <
+	    0) {
+		ec = last_error();
+		return false;
+	}
+	return true;
+}
+#endif
+} // namespace
+
+PolicyTemplate::PolicyTemplate(Policy base) : base_(std::move(base))
+{
+}
+
+std::size_t PolicyTemplate::path_param(const action::FsAction& access)
+{
+	path_params_.push_back(access.type_code() & base_.handled_access_fs());
+	return path_params_.size() - 1;
+}
+
+std::size_t PolicyTemplate::port_param(const action::NetAction& access)
+{
+	port_params_.push_back(access.type_code() & base_.handled_access_net());
+	return port_params_.size() - 1;
+}
+
+#ifndef LLPP_NO_EXCEPTIONS
+void PolicyTemplate::prepare(Backend& backend)
+{
+	std::error_code ec;
+	prepare(backend, ec);
+	if (ec) {
+		throw std::system_error{ec};
+	}
+}
+#endif
+
+void PolicyTemplate::prepare(Backend& backend, std::error_code& ec)
+{
+	ec.clear();
+
+	if (base_.handled_access_fs() == 0 && base_.handled_access_net() == 0 &&
+	    base_.scoped() == 0) {
+		ec = std::make_error_code(std::errc::invalid_argument);
+		return;
+	}
+
+	int abi_version = backend.create_ruleset(
+		nullptr, 0, LANDLOCK_CREATE_RULESET_VERSION
+	);
+	if (abi_version < 0) {
+		if (errno != ENOSYS) {
+			ec = last_error();
+			return;
+		}
+		abi_version = 0;
+	}
+
+	// Fold the handled access to what the kernel and the headers support,
+	// as the Ruleset constructor does
+	landlock_ruleset_attr attr{};
+	std::memset(&attr, 0, sizeof(attr));
+	const auto fs_actions =
+		action::split(base_.handled_access_fs(), action::FS_ACTIONS);
+	attr.handled_access_fs = join(abi_version, fs_actions).type_code();
+	std::uint64_t handled = attr.handled_access_fs;
+#if LLPP_BUILD_LANDLOCK_API >= 4
+	const auto net_actions =
+		action::split(base_.handled_access_net(), action::NET_ACTIONS);
+	attr.handled_access_net = join(abi_version, net_actions).type_code();
+	handled |= attr.handled_access_net;
+#endif
+#if LLPP_BUILD_LANDLOCK_API >= 6
+	const auto scopes = scope::split(base_.scoped());
+	attr.scoped = join(abi_version, scopes).type_code();
+	handled |= attr.scoped;
+#endif
+
+	std::vector<PathGroup> paths;
+	std::vector<std::pair<std::uint16_t, std::uint64_t>> ports;
+	std::vector<std::uint64_t> path_access;
+	std::vector<std::uint64_t> port_access;
+
+	// Like Policy::build(), rules which cannot take effect are dropped
+	// without opening their paths
+	if (handled != 0) {
+		std::map<std::uint64_t, std::vector<std::string>> groups;
+		for (const auto& [path, access] : base_.path_rules()) {
+			const std::uint64_t effective =
+				access & attr.handled_access_fs;
+			if (effective != 0) {
+				groups[effective].push_back(path);
+			}
+		}
+		for (const auto& [access, group_paths] : groups) {
+			// Directory access cannot be allowed on other files
+			PathGroup dirs{access, {}};
+			PathGroup files{
+				access & action::FS_FILE_ACTIONS.type_code(), {}
+			};
+			for (const std::string& path : group_paths) {
+				HandleCache::Handle handle =
+					HandleCache::global().open(path, ec);
+				if (ec) {
+					return;
+				}
+				PathGroup& group =
+					handle->directory() ? dirs : files;
+				group.handles.push_back(std::move(handle));
+			}
+			for (PathGroup* group : {&dirs, &files}) {
+				if (group->access != 0 &&
+				    not group->handles.empty()) {
+					paths.push_back(std::move(*group));
+				}
+			}
+		}
+
+#if LLPP_BUILD_LANDLOCK_API >= 4
+		for (const auto& [port, access] : base_.port_rules()) {
+			const std::uint64_t effective =
+				access & attr.handled_access_net;
+			if (effective != 0) {
+				ports.emplace_back(port, effective);
+			}
+		}
+#endif
+	}
+
+	for (const std::uint64_t access : path_params_) {
+		path_access.push_back(
+			handled != 0 ? access & attr.handled_access_fs : 0
+		);
+	}
+	for ([[maybe_unused]] const std::uint64_t access : port_params_) {
+#if LLPP_BUILD_LANDLOCK_API >= 4
+		port_access.push_back(
+			handled != 0 ? access & attr.handled_access_net : 0
+		);
+#else
+		port_access.push_back(0);
+#endif
+	}
+
+	backend_ = &backend;
+	abi_version_ = abi_version;
+	attr_ = attr;
+	active_ = handled != 0;
+	paths_ = std::move(paths);
+	ports_ = std::move(ports);
+	path_access_ = std::move(path_access);
+	port_access_ = std::move(port_access);
+}
+
+#ifndef LLPP_NO_EXCEPTIONS
+std::unique_ptr<Ruleset> PolicyTemplate::instantiate(const Params& params
+) const
+{
+	std::error_code ec;
+	std::unique_ptr<Ruleset> res = instantiate(params, ec);
+	if (ec) {
+		throw std::system_error{ec};
+	}
+	return res;
+}
+#endif
+
+std::unique_ptr<Ruleset>
+PolicyTemplate::instantiate(const Params& params, std::error_code& ec) const
+{
+	ec.clear();
+
+	if (not prepared() || params.paths.size() != path_access_.size() ||
+	    params.ports.size() != port_access_.size()) {
+		ec = std::make_error_code(std::errc::invalid_argument);
+		return nullptr;
+	}
+
+	if (not active_) {
+		return Ruleset::adopt(-1, abi_version_, 0, 0, 0, *backend_);
+	}
+
+	const int ruleset_fd =
+		backend_->create_ruleset(&attr_, sizeof(attr_), 0);
+	if (ruleset_fd < 0) {
+		ec = last_error();
+		return nullptr;
+	}
+	std::uint64_t handled_net = 0;
+	std::uint64_t scoped = 0;
+#if LLPP_BUILD_LANDLOCK_API >= 4
+	handled_net = attr_.handled_access_net;
+#endif
+#if LLPP_BUILD_LANDLOCK_API >= 6
+	scoped = attr_.scoped;
+#endif
+	// Owns the ruleset fd from here on, so it is closed on failure
+	std::unique_ptr<Ruleset> res = Ruleset::adopt(
+		ruleset_fd,
+		abi_version_,
+		attr_.handled_access_fs,
+		handled_net,
+		scoped,
+		*backend_
+	);
+
+	for (const PathGroup& group : paths_) {
+		for (const HandleCache::Handle& handle : group.handles) {
+			if (not add_path_rule(
+				    *backend_,
+				    ruleset_fd,
+				    handle->fd(),
+				    group.access,
+				    ec
+			    )) {
+				return nullptr;
+			}
+		}
+	}
+
+	for (std::size_t i = 0; i < path_access_.size(); ++i) {
+		if (path_access_[i] == 0) {
+			continue;
+		}
+		const PathArg& arg = params.paths[i];
+		const int path_fd = open_path_arg(arg, ec);
+		if (path_fd < 0) {
+			return nullptr;
+		}
+		std::uint64_t access = path_access_[i];
+		bool added = mask_file_access(path_fd, access, ec);
+		if (added && access != 0) {
+			added = add_path_rule(
+				*backend_, ruleset_fd, path_fd, access, ec
+			);
+		}
+		if (not std::holds_alternative<int>(arg)) {
+			::close(path_fd);
+		}
+		if (not added) {
+			return nullptr;
+		}
+	}
+
+#if LLPP_BUILD_LANDLOCK_API >= 4
+	for (const auto& [port, access] : ports_) {
+		if (not add_port_rule(
+			    *backend_, ruleset_fd, port, access, ec
+		    )) {
+			return nullptr;
+		}
+	}
+	for (std::size_t i = 0; i < port_access_.size(); ++i) {
+		if (port_access_[i] != 0 &&
+		    not add_port_rule(
+			    *backend_,
+			    ruleset_fd,
+			    params.ports[i],
+			    port_access_[i],
+			    ec
+		    )) {
+			return nullptr;
+		}
+	}
+#endif
+
+	return res;
+}
+} // namespace landlock
@@ -0,0 +1,31 @@
+#include "ProcFd.hpp"
+
+#include <cerrno>
+#include <climits>
+#include <string_view>
+#include <utility>
+
+#include <unistd.h>
+
+namespace landlock::detail
+{
+namespace
+{
+constexpr std::string_view PROC_FD_PREFIX{"/proc/self/fd/"};
+} // namespace
+
+bool resolve_fd(int fd, std::string& path, std::error_code& ec)
+{
+	const std::string link =
+		std::string{PROC_FD_PREFIX} + std::to_string(fd);
+	std::string buf(PATH_MAX, '\0');
+	const ssize_t len = ::readlink(link.c_str(), buf.data(), buf.size());
+	if (len < 0) {
+		ec = std::error_code{errno, std::system_category()};
+		return false;
+	}
+	buf.resize(static_cast<std::size_t>(len));
+	path = std::move(buf);
+	return true;
+}
+} // namespace landlock::detail
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <string>
+#include <system_error>
+
+namespace landlock::detail
+{
+/**
+ * Resolve the path a file descriptor refers to via /proc/self/fd
+ *
+ * @return true, if the path was resolved; false, otherwise, with ec set
+ */
+bool resolve_fd(int fd, std::string& path, std::error_code& ec);
+} // namespace landlock::detail
@@ -1,20 +1,12 @@
-#include <cerrno>
-#include <fcntl.h>
 #include <system_error>
-#include <unistd.h>
+#include <utility>
 
 #include "ll/ActionType.hpp"
 #include "ll/Rule.hpp"
 
 namespace landlock
 {
-PathBeneathRule::~PathBeneathRule()
-{
-	for (int path_fd : path_fds_) {
-		// Not much we can do if this fails, so ignore the result
-		::close(path_fd);
-	}
-}
+PathBeneathRule::~PathBeneathRule() = default;
 
 PathBeneathRule::AttrVec PathBeneathRule::generate(int max_abi) const noexcept
 {
@@ -28,28 +20,65 @@ PathBeneathRule::AttrVec PathBeneathRule::generate(int max_abi) const noexcept
 		return {};
 	}
 
+	// Directory access cannot be allowed on other files
+	const std::uint64_t file_access =
+		type.type_code() & action::FS_FILE_ACTIONS.type_code();
+
 	AttrVec res;
-	res.reserve(path_fds_.size());
-	for (const int path_fd : path_fds_) {
+	res.reserve(path_handles_.size());
+	for (const HandleCache::Handle& handle : path_handles_) {
 		Attr attr;
-		attr.allowed_access = type.type_code();
-		attr.parent_fd = path_fd;
+		attr.allowed_access =
+			handle->directory() ? type.type_code() : file_access;
+		if (attr.allowed_access == 0) {
+			continue;
+		}
+		attr.parent_fd = handle->fd();
 		res.push_back(attr);
 	}
 
 	return res;
 }
 
+#ifndef LLPP_NO_EXCEPTIONS
 PathBeneathRule& PathBeneathRule::add_path(const std::filesystem::path& path)
 {
-	const int path_fd =
-		::open(path.c_str(), O_PATH | O_CLOEXEC); // NOLINT(*-vararg)
-	if (path_fd < 0) {
-		throw std::system_error{
-			std::error_code{errno, std::system_category()}
-		};
+	std::error_code ec;
+	add_path(path, ec);
+	if (ec) {
+		throw std::system_error{ec};
+	}
+	return *this;
+}
+#endif
+
+PathBeneathRule& PathBeneathRule::add_path(
+	const std::filesystem::path& path, std::error_code& ec
+)
+{
+	if (not open_paths_) {
+		ec.clear();
+		++skipped_paths_;
+		return *this;
+	}
+
+	HandleCache::Handle handle = HandleCache::global().open(path, ec);
+	if (handle) {
+		path_handles_.push_back(std::move(handle));
+	}
+	return *this;
+}
+
+PathBeneathRule& PathBeneathRule::add_handle(HandleCache::Handle handle)
+{
+	if (not handle) {
+		return *this;
 	}
-	path_fds_.push_back(path_fd);
+	if (not open_paths_) {
+		++skipped_paths_;
+		return *this;
+	}
+	path_handles_.push_back(std::move(handle));
 	return *this;
 }
 
@@ -63,7 +92,7 @@ NetPortRule::AttrVec NetPortRule::generate([[maybe_unused]] int max_abi
 ) const noexcept
 {
 #if LLPP_BUILD_LANDLOCK_API >= 4
-	const ActionType type = fold_actions(max_abi);
+	const ReducedActionType type = fold_actions(max_abi);
 
 	if (type.type_code() == 0) {
 		return {};
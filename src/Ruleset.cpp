@@ -6,22 +6,37 @@
 #include <cstring>
 #include <stdexcept>
 #include <system_error>
-#include <unistd.h>
 
 extern "C" {
 #include <linux/landlock.h>
-#include <sys/prctl.h>
-#include <sys/syscall.h>
 }
 
 namespace landlock
 {
+#ifndef LLPP_NO_EXCEPTIONS
 Ruleset::Ruleset(
 	// NOLINTNEXTLINE(*-easily-swappable-parameters)
 	const ActionVec<ActionRuleType::PATH_BENEATH>& handled_access_fs,
 	const ActionVec<ActionRuleType::NET_PORT>& handled_access_net,
 	const ScopeVec& scoped
-)
+) :
+	Ruleset(
+		Backend::system(),
+		handled_access_fs,
+		handled_access_net,
+		scoped
+	)
+{
+}
+
+Ruleset::Ruleset(
+	Backend& backend,
+	// NOLINTNEXTLINE(*-easily-swappable-parameters)
+	const ActionVec<ActionRuleType::PATH_BENEATH>& handled_access_fs,
+	const ActionVec<ActionRuleType::NET_PORT>& handled_access_net,
+	const ScopeVec& scoped
+) :
+	backend_(&backend)
 {
 	if (handled_access_fs.empty() && handled_access_net.empty() &&
 	    scoped.empty()) {
@@ -31,55 +46,168 @@ Ruleset::Ruleset(
 		};
 	}
 
-	if (not read_abi_version()) {
-		return;
-	}
+	std::error_code ec;
+	init(handled_access_fs, handled_access_net, scoped, ec);
+	throw_on_error(ec);
+}
+#endif
 
-	init_ruleset(handled_access_fs, handled_access_net, scoped);
+Ruleset::Ruleset(
+	// NOLINTNEXTLINE(*-easily-swappable-parameters)
+	const ActionVec<ActionRuleType::PATH_BENEATH>& handled_access_fs,
+	const ActionVec<ActionRuleType::NET_PORT>& handled_access_net,
+	const ScopeVec& scoped,
+	std::error_code& ec
+) :
+	Ruleset(Backend::system(),
+		handled_access_fs,
+		handled_access_net,
+		scoped,
+		ec)
+{
+}
+
+Ruleset::Ruleset(
+	Backend& backend,
+	// NOLINTNEXTLINE(*-easily-swappable-parameters)
+	const ActionVec<ActionRuleType::PATH_BENEATH>& handled_access_fs,
+	const ActionVec<ActionRuleType::NET_PORT>& handled_access_net,
+	const ScopeVec& scoped,
+	std::error_code& ec
+) :
+	backend_(&backend)
+{
+	init(handled_access_fs, handled_access_net, scoped, ec);
+}
+
+Ruleset::Ruleset(AdoptTag /*tag*/, Backend& backend) noexcept :
+	backend_(&backend)
+{
+}
+
+std::unique_ptr<Ruleset> Ruleset::adopt(
+	int ruleset_fd,
+	int abi_version,
+	// NOLINTNEXTLINE(*-easily-swappable-parameters)
+	std::uint64_t handled_access_fs,
+	std::uint64_t handled_access_net,
+	std::uint64_t scoped,
+	Backend& backend
+)
+{
+	// The constructor is private, so std::make_unique cannot be used
+	std::unique_ptr<Ruleset> res{new Ruleset{AdoptTag{}, backend}};
+	res->ruleset_fd_ = ruleset_fd;
+	res->abi_version_ = abi_version;
+	res->handled_access_fs_ = handled_access_fs;
+	res->handled_access_net_ = handled_access_net;
+	res->scoped_ = scoped;
+	res->rules_known_ = false;
+	return res;
 }
 
 Ruleset::~Ruleset()
 {
 	if (ruleset_fd_ > 0) {
-		::close(ruleset_fd_);
+		backend_->close(ruleset_fd_);
 	}
 }
 
+#ifndef LLPP_NO_EXCEPTIONS
 void Ruleset::enforce(bool set_no_new_privs) const
 {
+	std::error_code ec;
+	enforce(set_no_new_privs, ec);
+	throw_on_error(ec);
+}
+
+void Ruleset::enforce(bool set_no_new_privs, const RestrictFlagVec& flags) const
+{
+	std::error_code ec;
+	enforce(set_no_new_privs, flags, ec);
+	throw_on_error(ec);
+}
+#endif
+
+void Ruleset::enforce(bool set_no_new_privs, std::error_code& ec) const noexcept
+{
+	enforce(set_no_new_privs, {}, ec);
+}
+
+void Ruleset::enforce(
+	bool set_no_new_privs, const RestrictFlagVec& flags, std::error_code& ec
+) const noexcept
+{
+	ec.clear();
+
 	if (set_no_new_privs) {
-		// NOLINTNEXTLINE(*-vararg)
-		const int res = ::prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0);
-		assert_res(res);
+		const int res = backend_->set_no_new_privs();
+		if (not check_res(res, ec)) {
+			return;
+		}
 	}
 
-	if (landlock_enabled()) {
-		const int res = landlock_restrict_self(ruleset_fd_);
-		assert_res(res);
+	if (active()) {
+		const auto restrict_flags = static_cast<std::uint32_t>(
+			join(abi_version_, flags).type_code()
+		);
+		const int res =
+			backend_->restrict_self(ruleset_fd_, restrict_flags);
+		check_res(res, ec);
 	}
 }
 
-bool Ruleset::read_abi_version()
+bool Ruleset::read_abi_version(std::error_code& ec) noexcept
 {
-	const int res = landlock_create_ruleset(
+	const int res = backend_->create_ruleset(
 		nullptr, 0, LANDLOCK_CREATE_RULESET_VERSION
 	);
 	if (res == -1 and errno == ENOSYS) {
 		return false;
 	}
-	assert_res(res);
+	if (not check_res(res, ec)) {
+		return false;
+	}
 
 	abi_version_ = res;
 	return true;
 }
 
+void Ruleset::init(
+	// NOLINTNEXTLINE(*-easily-swappable-parameters)
+	const ActionVec<ActionRuleType::PATH_BENEATH>& handled_access_fs,
+	const ActionVec<ActionRuleType::NET_PORT>& handled_access_net,
+	const ScopeVec& scoped,
+	std::error_code& ec
+) noexcept
+{
+	ec.clear();
+
+	if (handled_access_fs.empty() && handled_access_net.empty() &&
+	    scoped.empty()) {
+		ec = std::make_error_code(std::errc::invalid_argument);
+		return;
+	}
+
+	if (not read_abi_version(ec)) {
+		return;
+	}
+
+	init_ruleset(handled_access_fs, handled_access_net, scoped, ec);
+	if (ec) {
+		// An unusable ruleset must not be enforced
+		abi_version_ = 0;
+	}
+}
+
 void Ruleset::init_ruleset(
 	// NOLINTNEXTLINE(*-easily-swappable-parameters)
 	const ActionVec<ActionRuleType::PATH_BENEATH>& handled_access_fs,
 	[[maybe_unused]] const ActionVec<ActionRuleType::NET_PORT>&
 		handled_access_net,
-	[[maybe_unused]] const ScopeVec& scoped
-)
+	[[maybe_unused]] const ScopeVec& scoped,
+	std::error_code& ec
+) noexcept
 {
 	landlock_ruleset_attr attr{};
 	std::memset(&attr, 0, sizeof(landlock_ruleset_attr));
@@ -94,48 +222,49 @@ void Ruleset::init_ruleset(
 	attr.scoped = join(abi_version_, scoped).type_code();
 #endif
 
-	const int res = landlock_create_ruleset(&attr, sizeof(attr), 0);
-	assert_res(res);
-
-	ruleset_fd_ = res;
-}
+	std::uint64_t handled = attr.handled_access_fs;
+#if LLPP_BUILD_LANDLOCK_API >= 4
+	handled |= attr.handled_access_net;
+#endif
+#if LLPP_BUILD_LANDLOCK_API >= 6
+	handled |= attr.scoped;
+#endif
+	// The kernel rejects a ruleset handling nothing, and it would not
+	// restrict anything, so the ruleset stays inactive instead
+	if (handled == 0) {
+		return;
+	}
 
-// NOLINTBEGIN(*-vararg)
-int Ruleset::landlock_create_ruleset(
-	const landlock_ruleset_attr* attr, std::size_t size, std::uint32_t flags
-)
-{
-	return static_cast<int>(
-		::syscall(SYS_landlock_create_ruleset, attr, size, flags)
-	);
-}
+	const int res = backend_->create_ruleset(&attr, sizeof(attr), 0);
+	if (not check_res(res, ec)) {
+		return;
+	}
 
-int Ruleset::landlock_add_rule(
-	int ruleset_fd,
-	landlock_rule_type rule_type,
-	const void* rule_attr,
-	std::uint32_t flags
-)
-{
-	return static_cast<int>(::syscall(
-		SYS_landlock_add_rule, ruleset_fd, rule_type, rule_attr, flags
-	));
+	ruleset_fd_ = res;
+	handled_access_fs_ = attr.handled_access_fs;
+#if LLPP_BUILD_LANDLOCK_API >= 4
+	handled_access_net_ = attr.handled_access_net;
+#endif
+#if LLPP_BUILD_LANDLOCK_API >= 6
+	scoped_ = attr.scoped;
+#endif
 }
 
-int Ruleset::landlock_restrict_self(int ruleset_fd, std::uint32_t flags)
+bool Ruleset::check_res(int res, std::error_code& ec) noexcept
 {
-	return static_cast<int>(
-		::syscall(SYS_landlock_restrict_self, ruleset_fd, flags)
-	);
+	if (res < 0) {
+		ec = std::error_code{errno, std::system_category()};
+		return false;
+	}
+	return true;
 }
-// NOLINTEND(*-vararg)
 
-void Ruleset::assert_res(int res)
+#ifndef LLPP_NO_EXCEPTIONS
+void Ruleset::throw_on_error(const std::error_code& ec)
 {
-	if (res < 0) {
-		throw std::system_error{
-			std::error_code{errno, std::system_category()}
-		};
+	if (ec) {
+		throw std::system_error{ec};
 	}
 }
+#endif
 } // namespace landlock
@@ -0,0 +1,358 @@
+#include "ll/RulesetBroker.hpp"
+#include "FdPassing.hpp"
+
+#include "ll/RuleType.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <variant>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace landlock
+{
+namespace
+{
+/// Protocol version, increased on incompatible changes of Message
+constexpr std::uint32_t PROTOCOL_VERSION = 1;
+
+/**
+ * Message sent along with the ruleset file descriptor
+ */
+struct Message {
+	std::uint32_t version;
+	std::int32_t abi_version;
+	std::uint64_t handled_access_fs;
+	std::uint64_t handled_access_net;
+	std::uint64_t scoped;
+};
+
+std::error_code last_error() noexcept
+{
+	return {errno, std::system_category()};
+}
+
+/**
+ * Fill in the address of a UNIX socket bound to path
+ */
+bool make_address(
+	const std::filesystem::path& path,
+	sockaddr_un& addr,
+	std::error_code& ec
+) noexcept
+{
+	addr = sockaddr_un{};
+	addr.sun_family = AF_UNIX;
+	const std::string& native = path.native();
+	if (native.empty() || native.size() >= sizeof(addr.sun_path)) {
+		ec = std::make_error_code(std::errc::filename_too_long);
+		return false;
+	}
+	std::memcpy(
+		static_cast<char*>(addr.sun_path), native.c_str(), native.size()
+	);
+	return true;
+}
+
+/**
+ * Add the attributes generated by rule to the kernel ruleset ruleset_fd
+ */
+template <typename RuleT>
+bool add_rule(
+	Backend& backend, int ruleset_fd, int abi_version, const RuleT& rule
+) noexcept
+{
+	for (const auto& attr : rule.generate(abi_version)) {
+		const landlock_rule_type type =
+			RuleType<std::remove_cv_t<std::remove_reference_t<
+				decltype(attr)>>>::TYPE_CODE;
+		if (type != INVALID_RULE_TYPE &&
+		    backend.add_rule(ruleset_fd, type, &attr, 0) != 0) {
+			return false;
+		}
+	}
+	return true;
+}
+} // namespace
+
+#ifndef LLPP_NO_EXCEPTIONS
+RulesetBroker::RulesetBroker(
+	const Ruleset& ruleset, const std::filesystem::path& socket_path
+) :
+	ruleset_(ruleset), socket_path_(socket_path)
+{
+	std::error_code ec;
+	listen(ec);
+	if (ec) {
+		throw std::system_error{ec};
+	}
+}
+#endif
+
+RulesetBroker::RulesetBroker(
+	const Ruleset& ruleset,
+	const std::filesystem::path& socket_path,
+	std::error_code& ec
+) :
+	ruleset_(ruleset), socket_path_(socket_path)
+{
+	listen(ec);
+}
+
+void RulesetBroker::listen(std::error_code& ec) noexcept
+{
+	ec.clear();
+
+	if (ruleset_.active() && not ruleset_.rules_known()) {
+		ec = std::make_error_code(std::errc::not_supported);
+		return;
+	}
+
+	sockaddr_un addr{};
+	if (not make_address(socket_path_, addr, ec)) {
+		return;
+	}
+
+	listen_fd_ = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	if (listen_fd_ < 0) {
+		ec = last_error();
+		return;
+	}
+
+	// NOLINTNEXTLINE(*-reinterpret-cast)
+	if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)
+	    ) != 0 ||
+	    ::listen(listen_fd_, SOMAXCONN) != 0) {
+		ec = last_error();
+		::close(listen_fd_);
+		listen_fd_ = -1;
+	}
+}
+
+RulesetBroker::~RulesetBroker()
+{
+	if (listen_fd_ >= 0) {
+		::close(listen_fd_);
+		std::error_code ec;
+		std::filesystem::remove(socket_path_, ec);
+	}
+}
+
+void RulesetBroker::serve_one(std::error_code& ec)
+{
+	ec.clear();
+
+	int conn_fd = -1;
+	do {
+		conn_fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+	} while (conn_fd < 0 && errno == EINTR);
+	if (conn_fd < 0) {
+		ec = last_error();
+		return;
+	}
+
+	send(conn_fd, ec);
+	::close(conn_fd);
+}
+
+void RulesetBroker::send(int sock, std::error_code& ec) const noexcept
+{
+	ec.clear();
+
+	const Message msg{
+		PROTOCOL_VERSION,
+		ruleset_.abi_version(),
+		ruleset_.handled_access_fs(),
+		ruleset_.handled_access_net(),
+		ruleset_.scoped(),
+	};
+
+	// Inactive rulesets, e.g. without Landlock support, have no file
+	// descriptor to pass
+	ssize_t res = -1;
+	if (ruleset_.active()) {
+		const int ruleset_fd = copy_ruleset(ec);
+		if (ruleset_fd < 0) {
+			return;
+		}
+		res = detail::send_fd(sock, &msg, sizeof(msg), ruleset_fd);
+		if (res < 0) {
+			ec = last_error();
+		}
+		ruleset_.backend().close(ruleset_fd);
+	} else {
+		res = ::send(sock, &msg, sizeof(msg), MSG_NOSIGNAL);
+		if (res < 0) {
+			ec = last_error();
+		}
+	}
+	if (res >= 0) {
+		served_.fetch_add(1);
+	}
+}
+
+int RulesetBroker::copy_ruleset(std::error_code& ec) const noexcept
+{
+	landlock_ruleset_attr attr{};
+	attr.handled_access_fs = ruleset_.handled_access_fs();
+#if LLPP_BUILD_LANDLOCK_API >= 4
+	attr.handled_access_net = ruleset_.handled_access_net();
+#endif
+#if LLPP_BUILD_LANDLOCK_API >= 6
+	attr.scoped = ruleset_.scoped();
+#endif
+
+	Backend& backend = ruleset_.backend();
+	const int ruleset_fd = backend.create_ruleset(&attr, sizeof(attr), 0);
+	if (ruleset_fd < 0) {
+		ec = last_error();
+		return -1;
+	}
+
+	for (const Ruleset::RuleVariant& rule : ruleset_.rules()) {
+		const bool added = std::visit(
+			[&backend, ruleset_fd, this](const auto& r) {
+				return add_rule(
+					backend,
+					ruleset_fd,
+					ruleset_.abi_version(),
+					r
+				);
+			},
+			rule
+		);
+		if (not added) {
+			ec = last_error();
+			backend.close(ruleset_fd);
+			return -1;
+		}
+	}
+	return ruleset_fd;
+}
+
+#ifndef LLPP_NO_EXCEPTIONS
+void RulesetBroker::run()
+{
+	std::error_code ec;
+	run(ec);
+	if (ec) {
+		throw std::system_error{ec};
+	}
+}
+#endif
+
+void RulesetBroker::run(std::error_code& ec)
+{
+	ec.clear();
+
+	while (not stopping_.load()) {
+		int conn_fd =
+			::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+		if (conn_fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED) {
+				continue;
+			}
+			if (not stopping_.load()) {
+				ec = last_error();
+			}
+			return;
+		}
+
+		std::error_code send_ec;
+		send(conn_fd, send_ec);
+		::close(conn_fd);
+	}
+}
+
+void RulesetBroker::stop() noexcept
+{
+	stopping_.store(true);
+	// Wakes up a blocking accept(2), which then fails with EINVAL
+	::shutdown(listen_fd_, SHUT_RDWR);
+}
+
+#ifndef LLPP_NO_EXCEPTIONS
+std::unique_ptr<Ruleset> RulesetClient::fetch(
+	const std::filesystem::path& socket_path, Backend& backend
+)
+{
+	std::error_code ec;
+	std::unique_ptr<Ruleset> res = fetch(socket_path, backend, ec);
+	if (ec) {
+		throw std::system_error{ec};
+	}
+	return res;
+}
+#endif
+
+std::unique_ptr<Ruleset> RulesetClient::fetch(
+	const std::filesystem::path& socket_path,
+	Backend& backend,
+	std::error_code& ec
+)
+{
+	ec.clear();
+
+	sockaddr_un addr{};
+	if (not make_address(socket_path, addr, ec)) {
+		return nullptr;
+	}
+
+	const int sock = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	if (sock < 0) {
+		ec = last_error();
+		return nullptr;
+	}
+
+	std::unique_ptr<Ruleset> res;
+	// NOLINTNEXTLINE(*-reinterpret-cast)
+	if (::connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) !=
+	    0) {
+		ec = last_error();
+	} else {
+		res = receive(sock, backend, ec);
+	}
+	::close(sock);
+	return res;
+}
+
+std::unique_ptr<Ruleset>
+RulesetClient::receive(int sock, Backend& backend, std::error_code& ec)
+{
+	ec.clear();
+
+	Message msg{};
+	int ruleset_fd = -1;
+	const ssize_t res =
+		detail::recv_fd(sock, &msg, sizeof(msg), ruleset_fd);
+	if (res < 0) {
+		ec = last_error();
+		return nullptr;
+	}
+
+	// Inactive rulesets have no file descriptor either
+	const std::uint64_t handled =
+		msg.handled_access_fs | msg.handled_access_net | msg.scoped;
+	const bool fd_expected = msg.abi_version > 0 && handled != 0;
+	if (static_cast<std::size_t>(res) != sizeof(msg) ||
+	    msg.version != PROTOCOL_VERSION ||
+	    fd_expected != (ruleset_fd >= 0)) {
+		if (ruleset_fd >= 0) {
+			::close(ruleset_fd);
+		}
+		ec = std::make_error_code(std::errc::bad_message);
+		return nullptr;
+	}
+
+	return Ruleset::adopt(
+		ruleset_fd,
+		msg.abi_version,
+		msg.handled_access_fs,
+		msg.handled_access_net,
+		msg.scoped,
+		backend
+	);
+}
+} // namespace landlock
@@ -0,0 +1,77 @@
+#include "ll/RulesetBuilder.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace landlock
+{
+RulesetBuilder::RulesetBuilder(Ruleset& ruleset, std::size_t shards) :
+	ruleset_(ruleset),
+	abi_version_(ruleset.abi_version()),
+	active_(ruleset.active()),
+	shard_count_(
+		shards > 0 ? shards
+			   : std::max(1U, std::thread::hardware_concurrency())
+	),
+	// NOLINTNEXTLINE(*-avoid-c-arrays)
+	shards_(std::make_unique<Shard[]>(shard_count_))
+{
+}
+
+RulesetBuilder::~RulesetBuilder() = default;
+
+std::size_t RulesetBuilder::size() const
+{
+	std::size_t res = 0;
+	for (std::size_t i = 0; i < shard_count_; ++i) {
+		const std::lock_guard lock{shards_[i].mutex};
+		res += shards_[i].entries.size();
+	}
+	return res;
+}
+
+#ifndef LLPP_NO_EXCEPTIONS
+void RulesetBuilder::commit()
+{
+	std::error_code ec;
+	commit(ec);
+	if (ec) {
+		throw std::system_error{ec};
+	}
+}
+#endif
+
+void RulesetBuilder::commit(std::error_code& ec)
+{
+	ec.clear();
+	ruleset_.skipped_rules_ += skipped_.exchange(0);
+
+	for (std::size_t i = 0; i < shard_count_; ++i) {
+		Shard& shard = shards_[i];
+		const std::lock_guard lock{shard.mutex};
+
+		auto entry = shard.entries.begin();
+		for (; entry != shard.entries.end(); ++entry) {
+			for (const auto& attr : entry->path_beneath_attrs) {
+				if (not ruleset_.add_rule_int(attr, ec)) {
+					break;
+				}
+			}
+			for (const auto& attr : entry->net_port_attrs) {
+				if (ec || not ruleset_.add_rule_int(attr, ec)) {
+					break;
+				}
+			}
+			if (ec) {
+				break;
+			}
+			ruleset_.added_rules_.push_back(std::move(entry->rule));
+		}
+
+		shard.entries.erase(shard.entries.begin(), entry);
+		if (ec) {
+			return;
+		}
+	}
+}
+} // namespace landlock
@@ -0,0 +1,515 @@
+#include "ll/WorkerPool.hpp"
+
+#include <array>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace landlock
+{
+namespace
+{
+/// Event data of the eventfd waking up the background thread
+constexpr std::uint64_t WAKE_EVENT = ~std::uint64_t{0};
+/// Flag in the event data of worker sockets, the rest is the process ID
+constexpr std::uint64_t SOCKET_EVENT = std::uint64_t{1} << 32U;
+constexpr std::uint64_t PID_MASK = SOCKET_EVENT - 1;
+
+constexpr std::size_t MAX_EVENTS = 16;
+
+/// idtype_t value for waitid(2) on a pidfd, not defined by older C libraries
+constexpr int P_PIDFD_VALUE = 3;
+
+/// Size of the buffer for reading /proc/self/fd in a new worker
+constexpr std::size_t DIRENT_BUFFER_SIZE = 1024;
+
+std::error_code last_error() noexcept
+{
+	return {errno, std::system_category()};
+}
+
+int pidfd_open(pid_t pid) noexcept
+{
+	return static_cast<int>(::syscall(SYS_pidfd_open, pid, 0));
+}
+
+void kill_and_reap(int pidfd) noexcept
+{
+	::syscall(SYS_pidfd_send_signal, pidfd, SIGKILL, nullptr, 0);
+	siginfo_t info{};
+	while (::waitid(static_cast<idtype_t>(P_PIDFD_VALUE),
+			static_cast<id_t>(pidfd),
+			&info,
+			WEXITED) < 0 &&
+	       errno == EINTR) {
+	}
+}
+
+bool add_event(int epoll_fd, int fd, std::uint64_t data) noexcept
+{
+	epoll_event event{};
+	event.events = EPOLLIN;
+	event.data.u64 = data;
+	return ::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0;
+}
+
+/**
+ * Close all close-on-exec file descriptors except keep and ruleset_fd, like an
+ * execve(2) would
+ *
+ * Only async-signal-safe calls are used, since this runs right after fork(2)
+ * in a multi-threaded process.
+ *
+ * @return false with errno set if the file descriptors cannot be listed
+ */
+bool close_cloexec_fds(int keep, int ruleset_fd) noexcept
+{
+	const int dir_fd =
+		::open("/proc/self/fd", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dir_fd < 0) {
+		return false;
+	}
+
+	struct LinuxDirent {
+		std::uint64_t ino;
+		std::int64_t off;
+		unsigned short reclen;
+		unsigned char type;
+		char name[1]; // NOLINT(*-avoid-c-arrays)
+	};
+
+	alignas(LinuxDirent) std::array<char, DIRENT_BUFFER_SIZE> buf{};
+	for (;;) {
+		const long len = ::syscall(
+			SYS_getdents64,
+			dir_fd,
+			buf.data(),
+			buf.size()
+		);
+		if (len < 0) {
+			const int err = errno;
+			::close(dir_fd);
+			errno = err;
+			return false;
+		}
+		if (len == 0) {
+			break;
+		}
+		for (long pos = 0; pos < len;) {
+			const char* rec = buf.data() + pos;
+			const auto* entry =
+				reinterpret_cast<const LinuxDirent*>(rec);
+			pos += entry->reclen;
+
+			int fd = 0;
+			const char* chr = static_cast<const char*>(entry->name);
+			if (*chr < '0' || *chr > '9') {
+				continue;
+			}
+			for (; *chr >= '0' && *chr <= '9'; ++chr) {
+				// NOLINTNEXTLINE(*-magic-numbers)
+				fd = fd * 10 + (*chr - '0');
+			}
+			if (fd <= STDERR_FILENO || fd == keep ||
+			    fd == ruleset_fd || fd == dir_fd) {
+				continue;
+			}
+			// NOLINTNEXTLINE(*-vararg)
+			if ((::fcntl(fd, F_GETFD) & FD_CLOEXEC) != 0) {
+				::close(fd);
+			}
+		}
+	}
+	::close(dir_fd);
+	return true;
+}
+} // namespace
+
+WorkerPool::Lease::Lease(Lease&& other) noexcept :
+	fd_(std::exchange(other.fd_, -1)), pid_(std::exchange(other.pid_, -1))
+{
+}
+
+WorkerPool::Lease& WorkerPool::Lease::operator=(Lease&& other) noexcept
+{
+	if (this != &other) {
+		if (fd_ >= 0) {
+			::close(fd_);
+		}
+		fd_ = std::exchange(other.fd_, -1);
+		pid_ = std::exchange(other.pid_, -1);
+	}
+	return *this;
+}
+
+WorkerPool::Lease::~Lease()
+{
+	if (fd_ >= 0) {
+		::close(fd_);
+	}
+}
+
+#ifndef LLPP_NO_EXCEPTIONS
+WorkerPool::WorkerPool(
+	std::unique_ptr<Ruleset> ruleset, WorkerMain main, std::size_t size
+) :
+	ruleset_(std::move(ruleset)), main_(std::move(main)), size_(size)
+{
+	std::error_code ec;
+	setup(ec);
+	if (ec) {
+		throw std::system_error{ec};
+	}
+}
+#endif
+
+WorkerPool::WorkerPool(
+	std::unique_ptr<Ruleset> ruleset,
+	WorkerMain main,
+	std::size_t size,
+	std::error_code& ec
+) :
+	ruleset_(std::move(ruleset)), main_(std::move(main)), size_(size)
+{
+	setup(ec);
+}
+
+void WorkerPool::setup(std::error_code& ec)
+{
+	ec.clear();
+	if (not ruleset_ || not main_) {
+		ec = std::make_error_code(std::errc::invalid_argument);
+		return;
+	}
+
+	// Fail early if pidfds are not supported
+	const int self = pidfd_open(::getpid());
+	if (self < 0) {
+		ec = last_error();
+		return;
+	}
+	::close(self);
+
+	epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+	event_fd_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (epoll_fd_ < 0 || event_fd_ < 0 ||
+	    not add_event(epoll_fd_, event_fd_, WAKE_EVENT)) {
+		ec = last_error();
+		return;
+	}
+
+	thread_ = std::thread{&WorkerPool::run, this};
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		const std::lock_guard lock{mutex_};
+		stopping_ = true;
+	}
+	cond_.notify_all();
+	if (thread_.joinable()) {
+		wake();
+		thread_.join();
+	}
+
+	for (auto& [pid, worker] : workers_) {
+		kill_and_reap(worker.pidfd);
+		::close(worker.pidfd);
+		if (worker.sock >= 0) {
+			::close(worker.sock);
+		}
+	}
+	if (event_fd_ >= 0) {
+		::close(event_fd_);
+	}
+	if (epoll_fd_ >= 0) {
+		::close(epoll_fd_);
+	}
+}
+
+#ifndef LLPP_NO_EXCEPTIONS
+WorkerPool::Lease WorkerPool::acquire()
+{
+	std::error_code ec;
+	Lease lease = acquire(ec);
+	if (ec) {
+		throw std::system_error{ec};
+	}
+	return lease;
+}
+#endif
+
+WorkerPool::Lease WorkerPool::acquire(std::error_code& ec)
+{
+	ec.clear();
+	std::unique_lock lock{mutex_};
+	cond_.wait(lock, [this] {
+		return not idle_.empty() || stopping_ ||
+		       failures_ >= MAX_FAILURES || not thread_.joinable();
+	});
+	if (not idle_.empty()) {
+		return take();
+	}
+	ec = failures_ >= MAX_FAILURES
+		     ? error_
+		     : std::make_error_code(std::errc::operation_canceled);
+	return {};
+}
+
+WorkerPool::Lease WorkerPool::try_acquire()
+{
+	const std::lock_guard lock{mutex_};
+	if (idle_.empty()) {
+		return {};
+	}
+	return take();
+}
+
+std::size_t WorkerPool::idle() const
+{
+	const std::lock_guard lock{mutex_};
+	return idle_.size();
+}
+
+WorkerPool::Stats WorkerPool::stats() const
+{
+	const std::lock_guard lock{mutex_};
+	return stats_;
+}
+
+WorkerPool::Lease WorkerPool::take()
+{
+	const pid_t pid = idle_.front();
+	idle_.pop_front();
+	Worker& worker = workers_.at(pid);
+	worker.state = State::LEASED;
+	++stats_.leased;
+	return {std::exchange(worker.sock, -1), pid};
+}
+
+void WorkerPool::wake() const noexcept
+{
+	const std::uint64_t one = 1;
+	[[maybe_unused]] const ssize_t res =
+		::write(event_fd_, &one, sizeof(one));
+}
+
+void WorkerPool::run()
+{
+	refill();
+
+	std::array<epoll_event, MAX_EVENTS> events{};
+	for (;;) {
+		const int count = ::epoll_wait(
+			epoll_fd_,
+			events.data(),
+			static_cast<int>(events.size()),
+			-1
+		);
+		if (count < 0 && errno != EINTR) {
+			break;
+		}
+
+		{
+			const std::lock_guard lock{mutex_};
+			if (stopping_) {
+				return;
+			}
+			for (int i = 0; i < count; ++i) {
+				const std::uint64_t data =
+					events.at(static_cast<std::size_t>(i))
+						.data.u64;
+				const auto pid =
+					static_cast<pid_t>(data & PID_MASK);
+				if (data == WAKE_EVENT) {
+					std::uint64_t value = 0;
+					[[maybe_unused]] const ssize_t res =
+						::read(event_fd_,
+						       &value,
+						       sizeof(value));
+				} else if ((data & SOCKET_EVENT) != 0) {
+					on_ready(pid);
+				} else {
+					on_exit(pid);
+				}
+			}
+		}
+		refill();
+	}
+
+	// The event loop broke down, let waiters fail instead of blocking
+	const std::lock_guard lock{mutex_};
+	failures_ = MAX_FAILURES;
+	error_ = last_error();
+	cond_.notify_all();
+}
+
+void WorkerPool::refill()
+{
+	std::size_t missing = 0;
+	{
+		const std::lock_guard lock{mutex_};
+		if (stopping_ || failures_ >= MAX_FAILURES) {
+			return;
+		}
+		missing = size_ > workers_.size() ? size_ - workers_.size() : 0;
+	}
+
+	// Fork without holding the mutex, so leasing is not blocked
+	for (std::size_t i = 0; i < missing; ++i) {
+		spawn();
+	}
+}
+
+void WorkerPool::spawn()
+{
+	std::array<int, 2> socks{};
+	if (::socketpair(
+		    AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, socks.data()
+	    ) != 0) {
+		const std::lock_guard lock{mutex_};
+		error_ = last_error();
+		++failures_;
+		return;
+	}
+
+	const pid_t pid = ::fork();
+	if (pid == 0) {
+		// Inherited file descriptors are closed first, since the
+		// ruleset may deny listing them. Failing to close them or to
+		// enforce is reported before running anything else.
+		std::error_code ec;
+		if (close_cloexec_fds(socks[1], ruleset_->fd())) {
+			ruleset_->enforce(true, ec);
+		} else {
+			ec = last_error();
+		}
+		if (ruleset_->fd() >= 0) {
+			ruleset_->backend().close(ruleset_->fd());
+		}
+		const std::int32_t status = ec ? ec.value() : 0;
+		const bool sent = ::send(socks[1],
+					 &status,
+					 sizeof(status),
+					 MSG_NOSIGNAL) ==
+				  static_cast<ssize_t>(sizeof(status));
+		if (ec || not sent) {
+			::_exit(EXIT_FAILURE);
+		}
+		::_exit(main_(socks[1]));
+	}
+
+	::close(socks[1]);
+	const int pidfd = pid > 0 ? pidfd_open(pid) : -1;
+	const std::error_code ec = last_error();
+	if (pidfd < 0) {
+		if (pid > 0) {
+			::kill(pid, SIGKILL);
+			::waitpid(pid, nullptr, 0);
+		}
+		::close(socks[0]);
+		const std::lock_guard lock{mutex_};
+		error_ = ec;
+		++failures_;
+		return;
+	}
+
+	const std::lock_guard lock{mutex_};
+	workers_.emplace(pid, Worker{pidfd, socks[0], State::STARTING});
+	++stats_.spawned;
+	add_event(epoll_fd_, pidfd, static_cast<std::uint64_t>(pid));
+	add_event(
+		epoll_fd_,
+		socks[0],
+		static_cast<std::uint64_t>(pid) | SOCKET_EVENT
+	);
+}
+
+void WorkerPool::on_ready(pid_t pid)
+{
+	const auto worker = workers_.find(pid);
+	if (worker == workers_.end() ||
+	    worker->second.state != State::STARTING) {
+		return;
+	}
+
+	const int sock = worker->second.sock;
+	::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, sock, nullptr);
+	std::int32_t status = 0;
+	const ssize_t len = ::recv(sock, &status, sizeof(status), MSG_DONTWAIT);
+	if (len == static_cast<ssize_t>(sizeof(status)) && status == 0) {
+		worker->second.state = State::IDLE;
+		idle_.push_back(pid);
+		failures_ = 0;
+		error_.clear();
+		cond_.notify_one();
+		return;
+	}
+
+	// The worker could not enforce the ruleset and exits, which on_exit()
+	// accounts for
+	error_ = {
+		len == static_cast<ssize_t>(sizeof(status)) ? status : ECHILD,
+		std::system_category()
+	};
+}
+
+void WorkerPool::on_exit(pid_t pid)
+{
+	const auto worker = workers_.find(pid);
+	if (worker == workers_.end()) {
+		return;
+	}
+
+	siginfo_t info{};
+	::waitid(
+		static_cast<idtype_t>(P_PIDFD_VALUE),
+		static_cast<id_t>(worker->second.pidfd),
+		&info,
+		WEXITED | WNOHANG
+	);
+	// Remove the descriptors from the epoll set explicitly, since workers
+	// being forked may still hold duplicates of them
+	::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, worker->second.pidfd, nullptr);
+	::close(worker->second.pidfd);
+	if (worker->second.sock >= 0) {
+		::epoll_ctl(
+			epoll_fd_, EPOLL_CTL_DEL, worker->second.sock, nullptr
+		);
+		::close(worker->second.sock);
+	}
+
+	switch (worker->second.state) {
+	case State::STARTING:
+		++stats_.failed;
+		++failures_;
+		if (not error_) {
+			error_ = std::make_error_code(
+				std::errc::no_child_process
+			);
+		}
+		if (failures_ >= MAX_FAILURES) {
+			cond_.notify_all();
+		}
+		break;
+	case State::IDLE:
+		std::erase(idle_, pid);
+		break;
+	case State::LEASED:
+		break;
+	}
+
+	workers_.erase(worker);
+	++stats_.exited;
+}
+} // namespace landlock
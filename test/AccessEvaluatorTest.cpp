@@ -0,0 +1,196 @@
+#include "ll/AccessEvaluator.hpp"
+#include "ll/ActionType.hpp"
+#include "ll/FakeBackend.hpp"
+#include "ll/Rule.hpp"
+#include "ll/Ruleset.hpp"
+#include "ll/config.h"
+
+#include <filesystem>
+#include <system_error>
+
+#include "TempDir.hpp"
+#include "test.hpp"
+
+using landlock::AccessEvaluator;
+using landlock::FakeBackend;
+using landlock::Ruleset;
+namespace action = landlock::action;
+namespace fs = std::filesystem;
+
+// NOLINTBEGIN(*-magic-numbers)
+
+TEST_CASE("AccessEvaluator::paths")
+{
+	const TempDir tree{"eval", {"allowed/sub", "other"}};
+	FakeBackend backend{7};
+	std::error_code ec;
+
+	Ruleset ruleset{
+		backend,
+		{action::FS_READ_FILE, action::FS_WRITE_FILE},
+		{},
+		{},
+		ec
+	};
+	REQUIRE_FALSE(ec);
+	landlock::PathBeneathRule rule;
+	rule.add_path(tree.path() / "allowed", ec)
+		.add_action(action::FS_READ_FILE);
+	REQUIRE_FALSE(ec);
+	ruleset.add_rule(std::move(rule), ec);
+	REQUIRE_FALSE(ec);
+
+	AccessEvaluator evaluator;
+	evaluator.add_layer(ruleset, ec);
+	REQUIRE_FALSE(ec);
+	CHECK(evaluator.layer_count() == 1);
+
+	const fs::path allowed_file = tree.path() / "allowed" / "sub" / "file";
+	const fs::path other_file = tree.path() / "other" / "file";
+
+	SECTION("beneath rule path")
+	{
+		CHECK(evaluator.allowed(allowed_file, action::FS_READ_FILE));
+		CHECK_FALSE(
+			evaluator.allowed(allowed_file, action::FS_WRITE_FILE)
+		);
+		CHECK(evaluator.denied(
+			      allowed_file.native(),
+			      (action::FS_READ_FILE | action::FS_WRITE_FILE)
+				      .type_code()
+		      ) == action::FS_WRITE_FILE.type_code());
+	}
+
+	SECTION("outside rule path")
+	{
+		CHECK_FALSE(
+			evaluator.allowed(other_file, action::FS_READ_FILE)
+		);
+		CHECK(evaluator.allowed(other_file, action::FS_EXECUTE));
+	}
+
+	SECTION("path normalization")
+	{
+		const std::string base = tree.path().native();
+		const std::uint64_t read = action::FS_READ_FILE.type_code();
+		CHECK(evaluator.denied(base + "//allowed/./sub/", read) == 0);
+		CHECK(evaluator.denied(base + "/allowed/../other/file", read) !=
+		      0);
+		CHECK(evaluator.denied(
+			      base + "/other/x/../../allowed/file", read
+		      ) == 0);
+		CHECK(evaluator.denied(
+			      "relative/path", action::FS_EXECUTE.type_code()
+		      ) == action::FS_EXECUTE.type_code());
+	}
+
+	SECTION("stacked layers")
+	{
+		Ruleset inner{backend, {action::FS_READ_FILE}, {}, {}, ec};
+		REQUIRE_FALSE(ec);
+		landlock::PathBeneathRule inner_rule;
+		inner_rule.add_path(tree.path() / "allowed" / "sub", ec)
+			.add_action(action::FS_READ_FILE);
+		REQUIRE_FALSE(ec);
+		inner.add_rule(std::move(inner_rule), ec);
+		REQUIRE_FALSE(ec);
+
+		evaluator.add_layer(inner, ec);
+		REQUIRE_FALSE(ec);
+		CHECK(evaluator.allowed(allowed_file, action::FS_READ_FILE));
+		CHECK_FALSE(evaluator.allowed(
+			tree.path() / "allowed" / "file", action::FS_READ_FILE
+		));
+	}
+}
+
+TEST_CASE("AccessEvaluator::ports")
+{
+	FakeBackend backend{7};
+	std::error_code ec;
+
+	Ruleset ruleset{
+		backend, {action::FS_READ_FILE}, {action::NET_BIND_TCP}, {}, ec
+	};
+	REQUIRE_FALSE(ec);
+	landlock::NetPortRule rule;
+	rule.add_port(8080).add_action(action::NET_BIND_TCP);
+	ruleset.add_rule(std::move(rule), ec);
+	REQUIRE_FALSE(ec);
+
+	AccessEvaluator evaluator;
+	evaluator.add_layer(ruleset, ec);
+	REQUIRE_FALSE(ec);
+
+	CHECK(evaluator.allowed(8080, action::NET_BIND_TCP));
+	CHECK(evaluator.allowed(8081, action::NET_CONNECT_TCP));
+#if LLPP_BUILD_LANDLOCK_API >= 4
+	CHECK_FALSE(evaluator.allowed(8081, action::NET_BIND_TCP));
+#else
+	CHECK(evaluator.allowed(8081, action::NET_BIND_TCP));
+#endif
+}
+
+TEST_CASE("AccessEvaluator::no Landlock support")
+{
+	FakeBackend backend{0};
+	std::error_code ec;
+
+	const Ruleset ruleset{backend, {action::FS_READ_FILE}, {}, {}, ec};
+	REQUIRE_FALSE(ec);
+
+	AccessEvaluator evaluator;
+	evaluator.add_layer(ruleset, ec);
+	REQUIRE_FALSE(ec);
+	CHECK(evaluator.allowed(fs::path{"/etc/passwd"}, action::FS_READ_FILE));
+}
+
+TEST_CASE("AccessEvaluator::inactive ruleset")
+{
+	// FS_REFER requires ABI 2, so nothing handled is supported
+	FakeBackend backend{1};
+	std::error_code ec;
+
+	const Ruleset ruleset{backend, {action::FS_REFER}, {}, {}, ec};
+	REQUIRE_FALSE(ec);
+	REQUIRE(ruleset.landlock_enabled());
+	REQUIRE_FALSE(ruleset.active());
+
+	AccessEvaluator evaluator;
+	evaluator.add_layer(ruleset, ec);
+	REQUIRE_FALSE(ec);
+	CHECK(evaluator.allowed(fs::path{"/etc/passwd"}, action::FS_REFER));
+	CHECK(evaluator.allowed(fs::path{"/etc/passwd"}, action::FS_READ_FILE));
+}
+
+TEST_CASE("AccessEvaluator::adopted ruleset")
+{
+	FakeBackend backend{7};
+	std::error_code ec;
+
+	landlock_ruleset_attr attr{};
+	attr.handled_access_fs = action::FS_READ_FILE.type_code();
+	const int fd = backend.create_ruleset(&attr, sizeof(attr), 0);
+	REQUIRE(fd >= 0);
+	const auto adopted = Ruleset::adopt(
+		fd, 7, action::FS_READ_FILE.type_code(), 0, 0, backend
+	);
+
+	// The rules are unknown, so everything would be denied
+	AccessEvaluator evaluator;
+	evaluator.add_layer(*adopted, ec);
+	CHECK(ec == std::errc::not_supported);
+	CHECK(evaluator.layer_count() == 0);
+#ifndef LLPP_NO_EXCEPTIONS
+	CHECK_THROWS_AS(evaluator.add_layer(*adopted), std::system_error);
+#endif
+
+	// Without a file descriptor, it does not restrict anything
+	const auto inactive = Ruleset::adopt(-1, 0, 0, 0, 0, backend);
+	evaluator.add_layer(*inactive, ec);
+	CHECK_FALSE(ec);
+	CHECK(evaluator.layer_count() == 1);
+	CHECK(evaluator.allowed(fs::path{"/etc/passwd"}, action::FS_READ_FILE));
+}
+
+// NOLINTEND(*-magic-numbers)
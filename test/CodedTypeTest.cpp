@@ -1,7 +1,9 @@
 #include <cstdint>
 #include <limits>
+#include <sstream>
 
 #include "ll/CodedType.hpp"
+#include "ll/CodedTypeIO.hpp"
 
 #include "test.hpp"
 
@@ -170,3 +172,13 @@ TEST_CASE("CodedType::comparison")
 		CHECK_FALSE(ct1 == ct2);
 	}
 }
+
+TEST_CASE("CodedType::stream formatting")
+{
+	constexpr std::uint64_t TYPE_CODE = 0x2A;
+	constexpr int MIN_ABI = 3;
+
+	std::ostringstream out;
+	out << CT{TYPE_CODE, MIN_ABI} << ' ' << TYPE_CODE;
+	CHECK(out.str() == "000000000000002a/3 42");
+}
@@ -0,0 +1,187 @@
+#include "ll/FakeBackend.hpp"
+#include "ll/ActionType.hpp"
+#include "ll/Rule.hpp"
+#include "ll/Ruleset.hpp"
+#include "ll/Scope.hpp"
+#include "ll/config.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <system_error>
+
+#include "test.hpp"
+
+using landlock::FakeBackend;
+using landlock::Ruleset;
+namespace action = landlock::action;
+
+// NOLINTBEGIN(*-magic-numbers)
+
+TEST_CASE("FakeBackend::ABI matrix")
+{
+	const int kernel_abi = GENERATE(range(0, 8));
+	const int effective_abi = std::min(kernel_abi, LLPP_BUILD_LANDLOCK_API);
+	FakeBackend backend{kernel_abi};
+	std::error_code ec;
+
+	Ruleset ruleset{
+		backend,
+		{action::FS_READ_FILE, action::FS_REFER, action::FS_TRUNCATE},
+		{action::NET_BIND_TCP},
+		{landlock::scope::SIGNAL},
+		ec
+	};
+	REQUIRE_FALSE(ec);
+	CHECK(ruleset.abi_version() == kernel_abi);
+	CHECK(ruleset.landlock_enabled() == (kernel_abi > 0));
+
+	landlock::PathBeneathRule path_rule;
+	path_rule.add_path("/", ec)
+		.add_action(action::FS_READ_FILE)
+		.add_action(action::FS_TRUNCATE);
+	REQUIRE_FALSE(ec);
+	landlock::NetPortRule port_rule;
+	port_rule.add_port(8080).add_action(action::NET_BIND_TCP);
+
+	ruleset.add_rule(std::move(path_rule), ec);
+	REQUIRE_FALSE(ec);
+	ruleset.add_rule(std::move(port_rule), ec);
+	REQUIRE_FALSE(ec);
+
+	ruleset.enforce(true, ec);
+	REQUIRE_FALSE(ec);
+	CHECK(backend.no_new_privs());
+
+	const auto layers = backend.layers();
+	if (kernel_abi == 0) {
+		CHECK(layers.empty());
+		return;
+	}
+
+	REQUIRE(layers.size() == 1);
+	const FakeBackend::FakeRuleset& enforced = layers.at(0).ruleset;
+
+	std::uint64_t expected_fs = action::FS_READ_FILE.type_code();
+	if (effective_abi >= 2) {
+		expected_fs |= action::FS_REFER.type_code();
+	}
+	if (effective_abi >= 3) {
+		expected_fs |= action::FS_TRUNCATE.type_code();
+	}
+	CHECK(enforced.handled_access_fs == expected_fs);
+
+	REQUIRE(enforced.path_beneath_rules.size() == 1);
+	CHECK(enforced.path_beneath_rules.at(0).allowed_access ==
+	      (expected_fs & ~action::FS_REFER.type_code()));
+
+	if (effective_abi >= 4) {
+		CHECK(enforced.handled_access_net ==
+		      action::NET_BIND_TCP.type_code());
+		REQUIRE(enforced.net_port_rules.size() == 1);
+		CHECK(enforced.net_port_rules.at(0).port == 8080);
+	} else {
+		CHECK(enforced.handled_access_net == 0);
+		CHECK(enforced.net_port_rules.empty());
+	}
+
+	if (effective_abi >= 6) {
+		CHECK(enforced.scoped == landlock::scope::SIGNAL.type_code());
+	} else {
+		CHECK(enforced.scoped == 0);
+	}
+}
+
+TEST_CASE("FakeBackend::validation")
+{
+	FakeBackend backend{3};
+	landlock_ruleset_attr attr{};
+
+	SECTION("empty ruleset")
+	{
+		CHECK(backend.create_ruleset(&attr, sizeof(attr), 0) == -1);
+		CHECK(errno == ENOMSG);
+	}
+
+	SECTION("errata query")
+	{
+		// The errata flag was introduced with ABI 7
+		constexpr std::uint32_t ERRATA = 1U << 1U;
+		CHECK(backend.create_ruleset(nullptr, 0, ERRATA) == -1);
+		CHECK(errno == EINVAL);
+		FakeBackend current{7};
+		CHECK(current.create_ruleset(nullptr, 0, ERRATA) == 0);
+	}
+
+	SECTION("unsupported access")
+	{
+		attr.handled_access_fs = std::uint64_t{1} << 15U;
+		CHECK(backend.create_ruleset(&attr, sizeof(attr), 0) == -1);
+		CHECK(errno == EINVAL);
+	}
+
+	SECTION("restrict without no_new_privs")
+	{
+		attr.handled_access_fs = action::FS_READ_FILE.type_code();
+		const int fd = backend.create_ruleset(&attr, sizeof(attr), 0);
+		REQUIRE(fd >= 0);
+		CHECK(backend.restrict_self(fd, 0) == -1);
+		CHECK(errno == EPERM);
+		CHECK(backend.close(fd) == 0);
+		CHECK_FALSE(backend.ruleset(fd).has_value());
+	}
+
+	SECTION("layer limit")
+	{
+		attr.handled_access_fs = action::FS_READ_FILE.type_code();
+		const int fd = backend.create_ruleset(&attr, sizeof(attr), 0);
+		REQUIRE(fd >= 0);
+		REQUIRE(backend.set_no_new_privs() == 0);
+		for (std::size_t i = 0; i < FakeBackend::MAX_LAYERS; ++i) {
+			REQUIRE(backend.restrict_self(fd, 0) == 0);
+		}
+		CHECK(backend.restrict_self(fd, 0) == -1);
+		CHECK(errno == E2BIG);
+	}
+}
+
+TEST_CASE("FakeBackend::instrumentation")
+{
+	FakeBackend backend{1};
+	std::error_code ec;
+
+	SECTION("error injection")
+	{
+		backend.inject_error(FakeBackend::Call::ADD_RULE, EIO);
+		Ruleset ruleset{backend, {action::FS_READ_FILE}, {}, {}, ec};
+		REQUIRE_FALSE(ec);
+
+		landlock::PathBeneathRule rule1;
+		rule1.add_path("/", ec).add_action(action::FS_READ_FILE);
+		ruleset.add_rule(std::move(rule1), ec);
+		CHECK(ec == std::error_code{EIO, std::system_category()});
+
+		landlock::PathBeneathRule rule2;
+		rule2.add_path("/", ec).add_action(action::FS_READ_FILE);
+		ruleset.add_rule(std::move(rule2), ec);
+		CHECK_FALSE(ec);
+		CHECK(backend.call_count(FakeBackend::Call::ADD_RULE) == 2);
+		const auto recorded = backend.ruleset(ruleset.fd());
+		CHECK(recorded->path_beneath_rules.size() == 1);
+	}
+
+	SECTION("latency")
+	{
+		using namespace std::chrono_literals;
+		backend.set_latency(FakeBackend::Call::CREATE_RULESET, 1ms);
+		const auto start = std::chrono::steady_clock::now();
+		const Ruleset ruleset{
+			backend, {action::FS_READ_FILE}, {}, {}, ec
+		};
+		CHECK_FALSE(ec);
+		// Version query and ruleset creation
+		CHECK(std::chrono::steady_clock::now() - start >= 2ms);
+	}
+}
+
+// NOLINTEND(*-magic-numbers)
@@ -0,0 +1,191 @@
+#include "ll/FdBroker.hpp"
+#include "ll/ActionType.hpp"
+#include "ll/Policy.hpp"
+
+#include <array>
+#include <cerrno>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "TempDir.hpp"
+#include "test.hpp"
+
+using landlock::FdBroker;
+using landlock::FdClient;
+using landlock::Policy;
+namespace action = landlock::action;
+namespace fs = std::filesystem;
+
+namespace
+{
+/**
+ * Temporary directory with an allowed and a denied file
+ */
+class Fixture : public TempDir
+{
+public:
+	Fixture() : TempDir{"fdbroker-test", {"allowed", "denied"}}
+	{
+		std::ofstream{path("allowed/file")} << "content";
+		std::ofstream{path("denied/file")} << "secret";
+		fs::create_symlink(path("denied/file"), path("allowed/escape"));
+	}
+};
+
+/**
+ * Run body with a client of a broker serving allowlist
+ */
+void with_client(
+	const Policy& allowlist, const std::function<void(FdClient&)>& body
+)
+{
+	FdBroker broker{allowlist};
+	std::array<int, 2> socks{};
+	REQUIRE(::socketpair(
+			AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, socks.data()
+		) == 0);
+
+	std::error_code serve_ec;
+	std::thread server{[&broker, &serve_ec, sock = socks[0]] {
+		broker.serve(sock, serve_ec);
+		::close(sock);
+	}};
+	{
+		FdClient client{socks[1]};
+		body(client);
+	}
+	server.join();
+	CHECK_FALSE(serve_ec);
+}
+} // namespace
+
+TEST_CASE("FdBroker::requests")
+{
+	const Fixture fixture;
+	Policy allowlist;
+	allowlist.handle(action::FS_READ_FILE)
+		.handle(action::FS_WRITE_FILE)
+		.allow(fixture.path("allowed"), action::FS_READ_FILE);
+	FdBroker broker{allowlist};
+
+	std::array<int, 2> socks{};
+	REQUIRE(::socketpair(
+			AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, socks.data()
+		) == 0);
+
+	std::error_code serve_ec;
+	std::thread server{[&broker, &serve_ec, sock = socks[0]] {
+		broker.serve(sock, serve_ec);
+		::close(sock);
+	}};
+
+	{
+		FdClient client{socks[1]};
+		const std::string allowed = fixture.path("allowed/file");
+
+		SECTION("granted and cached")
+		{
+			const int fd = client.open(allowed.c_str(), O_RDONLY);
+			REQUIRE(fd >= 0);
+			std::array<char, 7> buf{};
+			CHECK(::pread(fd, buf.data(), buf.size(), 0) == 7);
+			CHECK(std::string{buf.data(), buf.size()} == "content");
+
+			CHECK(client.open(allowed.c_str(), O_RDONLY) == fd);
+			CHECK(client.stats().hits == 1);
+			CHECK(client.stats().requests == 1);
+		}
+
+		SECTION("denied and cached")
+		{
+			for (const char* name :
+			     {"denied/file", "allowed/escape"}) {
+				const std::string path = fixture.path(name);
+				CHECK(client.open(path.c_str(), O_RDONLY) < 0);
+				CHECK(errno == EACCES);
+				CHECK(client.open(path.c_str(), O_RDONLY) < 0);
+				CHECK(errno == EACCES);
+			}
+			CHECK(client.open(allowed.c_str(), O_WRONLY) < 0);
+			CHECK(errno == EACCES);
+			CHECK(client.open(allowed.c_str(), O_RDONLY | O_CREAT) <
+			      0);
+			CHECK(errno == EACCES);
+			CHECK(client.stats().requests == 4);
+		}
+
+		SECTION("errors are not cached")
+		{
+			const std::string missing = fixture.path("allowed/x");
+			CHECK(client.open(missing.c_str(), O_RDONLY) < 0);
+			CHECK(errno == ENOENT);
+			CHECK(client.open(missing.c_str(), O_RDONLY) < 0);
+			CHECK(client.stats().requests == 2);
+		}
+
+		SECTION("pipelining")
+		{
+			const std::string denied = fixture.path("denied/file");
+			REQUIRE(client.prefetch(allowed.c_str(), O_RDONLY) == 0
+			);
+			REQUIRE(client.prefetch(denied.c_str(), O_RDONLY) == 0);
+			CHECK(client.open(denied.c_str(), O_RDONLY) < 0);
+			CHECK(client.open(allowed.c_str(), O_RDONLY) >= 0);
+			CHECK(client.stats().requests == 2);
+			CHECK(client.stats().hits == 1);
+		}
+	}
+
+	server.join();
+	CHECK_FALSE(serve_ec);
+	CHECK(broker.stats().granted + broker.stats().denied > 0);
+}
+
+TEST_CASE("FdBroker::rejected flags")
+{
+	const Fixture fixture;
+	Policy allowlist;
+	allowlist.handle(action::FS_READ_FILE | action::FS_WRITE_FILE |
+			 action::FS_READ_DIR | action::FS_MAKE_REG)
+		.allow(fixture.path("allowed"),
+		       action::FS_READ_FILE | action::FS_WRITE_FILE |
+			       action::FS_READ_DIR);
+
+	with_client(allowlist, [&fixture](FdClient& client) {
+		const std::string dir = fixture.path("allowed");
+		const std::string file = fixture.path("allowed/file");
+		const std::string created = fixture.path("allowed/new");
+
+		// Still granted without the rejected flags
+		const int fd = client.open(file.c_str(), O_WRONLY | O_APPEND);
+		CHECK(fd >= 0);
+
+		const auto denied = [&](const std::string& path, int flags) {
+			errno = 0;
+			return client.open(path.c_str(), flags) < 0 &&
+			       errno == EACCES;
+		};
+		CHECK(denied(dir, O_TMPFILE | O_WRONLY));
+		CHECK(denied(dir, O_TMPFILE | O_RDWR));
+		CHECK(denied(created, O_CREAT | O_WRONLY));
+		CHECK(denied(file, O_TRUNC | O_WRONLY));
+		CHECK(denied(file, O_PATH));
+		CHECK(denied(dir, O_PATH | O_DIRECTORY));
+		CHECK(denied(file, O_ACCMODE));
+
+		CHECK_FALSE(fs::exists(created));
+		CHECK(fs::file_size(file) == std::string{"content"}.size());
+		const std::size_t entries = std::distance(
+			fs::directory_iterator{dir}, fs::directory_iterator{}
+		);
+		CHECK(entries == 2);
+	});
+}
@@ -0,0 +1,392 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "test.hpp"
+
+/**
+ * Harness running test scenarios in forked child processes
+ *
+ * Enforcing a ruleset cannot be undone, so tests which enforce must not do so
+ * in the test runner. Each scenario instead runs in its own child, which
+ * reports failed checks back to the parent through a pipe. Independent
+ * scenarios run in parallel, up to one per CPU by default.
+ *
+ * Catch2 macros must not be used in scenarios, since the child's assertions
+ * would not reach the runner. FORKED_CHECK() replaces CHECK(), and
+ * Child::skip() ends a scenario which cannot run on this system.
+ */
+namespace forked
+{
+constexpr int EXIT_FAILED = 1;
+constexpr int EXIT_SKIP = 77;
+constexpr std::chrono::seconds DEFAULT_TIMEOUT{30};
+
+/**
+ * Context of a scenario in the child process
+ */
+class Child
+{
+public:
+	Child(int report_fd, std::filesystem::path dir) noexcept :
+		report_fd_(report_fd), dir_(std::move(dir))
+	{
+	}
+
+	/**
+	 * Record a failure unless cond holds
+	 *
+	 * @return cond
+	 */
+	bool check(bool cond, const char* expr, int line)
+	{
+		if (not cond) {
+			fail("line " + std::to_string(line) + ": " + expr);
+		}
+		return cond;
+	}
+
+	/**
+	 * Record a failure with a message
+	 */
+	void fail(const std::string& msg)
+	{
+		failed_ = true;
+		report(msg);
+	}
+
+	/**
+	 * End the scenario as skipped
+	 */
+	[[noreturn]] void skip(const std::string& reason)
+	{
+		report(reason);
+		::_exit(failed_ ? EXIT_FAILED : EXIT_SKIP);
+	}
+
+	/**
+	 * Get the scenario's private temporary directory
+	 *
+	 * It is created before the child is forked and removed by the parent
+	 * after the child exited, so the scenario does not need to clean up
+	 * in its sandbox.
+	 */
+	[[nodiscard]] const std::filesystem::path& dir() const noexcept
+	{
+		return dir_;
+	}
+
+	[[nodiscard]] bool failed() const noexcept
+	{
+		return failed_;
+	}
+
+private:
+	void report(const std::string& msg) const
+	{
+		const std::string line = msg + '\n';
+		[[maybe_unused]] const ssize_t res =
+			::write(report_fd_, line.data(), line.size());
+	}
+
+	int report_fd_;
+	std::filesystem::path dir_;
+	bool failed_{false};
+};
+
+// NOLINTNEXTLINE(*-macro-usage)
+#define FORKED_CHECK(child, ...)                                               \
+	(child).check(static_cast<bool>(__VA_ARGS__), #__VA_ARGS__, __LINE__)
+
+struct Scenario {
+	std::string name;
+	std::function<void(Child&)> body;
+};
+
+enum class Outcome {
+	PASSED,
+	FAILED,
+	SKIPPED,
+	CRASHED,
+	TIMED_OUT,
+};
+
+inline const char* to_string(Outcome outcome) noexcept
+{
+	switch (outcome) {
+	case Outcome::PASSED:
+		return "passed";
+	case Outcome::FAILED:
+		return "failed";
+	case Outcome::SKIPPED:
+		return "skipped";
+	case Outcome::CRASHED:
+		return "crashed";
+	case Outcome::TIMED_OUT:
+		return "timed out";
+	}
+	return "unknown";
+}
+
+struct Result {
+	std::string name;
+	Outcome outcome;
+	/// Failures and skip reasons reported by the child
+	std::string report;
+};
+
+namespace detail
+{
+using Clock = std::chrono::steady_clock;
+
+struct Running {
+	std::size_t index;
+	pid_t pid;
+	int fd;
+	std::filesystem::path dir;
+	Clock::time_point deadline;
+};
+
+[[noreturn]] inline void
+run_child(const Scenario& scenario, int report_fd, std::filesystem::path dir)
+{
+	Child child{report_fd, std::move(dir)};
+	try {
+		scenario.body(child);
+	} catch (const std::exception& err) {
+		child.fail(std::string{"uncaught exception: "} + err.what());
+	} catch (...) {
+		child.fail("uncaught exception");
+	}
+	::_exit(child.failed() ? EXIT_FAILED : EXIT_SUCCESS);
+}
+
+inline Outcome outcome(int status, bool killed) noexcept
+{
+	if (killed) {
+		return Outcome::TIMED_OUT;
+	}
+	if (WIFSIGNALED(status)) {
+		return Outcome::CRASHED;
+	}
+	switch (WEXITSTATUS(status)) {
+	case EXIT_SUCCESS:
+		return Outcome::PASSED;
+	case EXIT_SKIP:
+		return Outcome::SKIPPED;
+	default:
+		return Outcome::FAILED;
+	}
+}
+
+/**
+ * Fork a child for scenario, or record why it could not be started
+ */
+inline bool start(
+	const Scenario& scenario,
+	std::size_t index,
+	std::chrono::milliseconds timeout,
+	std::vector<Running>& running,
+	Result& result
+)
+{
+	std::error_code ec;
+	const std::filesystem::path dir =
+		std::filesystem::temp_directory_path() /
+		("llpp-forked-" + std::to_string(::getpid()) + "-" +
+		 std::to_string(index));
+	std::filesystem::create_directories(dir, ec);
+
+	std::array<int, 2> fds{};
+	if (ec || ::pipe2(fds.data(), O_CLOEXEC) != 0) {
+		result.outcome = Outcome::FAILED;
+		result.report = "cannot set up scenario";
+		return false;
+	}
+
+	// Each child leads its own process group, so it can be killed along
+	// with any processes it started
+	const pid_t pid = ::fork();
+	if (pid == 0) {
+		::setpgid(0, 0);
+		::close(fds[0]);
+		run_child(scenario, fds[1], dir);
+	}
+	::close(fds[1]);
+	if (pid < 0) {
+		::close(fds[0]);
+		std::filesystem::remove_all(dir, ec);
+		result.outcome = Outcome::FAILED;
+		result.report = "cannot fork";
+		return false;
+	}
+	::setpgid(pid, pid);
+	// NOLINTNEXTLINE(*-vararg)
+	::fcntl(fds[0], F_SETFL, O_NONBLOCK);
+
+	running.push_back({index, pid, fds[0], dir, Clock::now() + timeout});
+	return true;
+}
+
+/**
+ * Append the output of a child which is available without blocking to its
+ * report
+ */
+inline void read_report(const Running& child, Result& result)
+{
+	constexpr std::size_t BUF_SIZE = 4096;
+
+	std::array<char, BUF_SIZE> buf{};
+	for (;;) {
+		const ssize_t len = ::read(child.fd, buf.data(), buf.size());
+		if (len > 0) {
+			result.report.append(
+				buf.data(), static_cast<std::size_t>(len)
+			);
+		} else if (len == 0 || errno != EINTR) {
+			return;
+		}
+	}
+}
+
+/**
+ * Return whether a child exited, without reaping it
+ */
+inline bool exited(const Running& child) noexcept
+{
+	siginfo_t info{};
+	return ::waitid(
+		       P_PID,
+		       static_cast<id_t>(child.pid),
+		       &info,
+		       WEXITED | WNOHANG | WNOWAIT
+		) == 0 &&
+	       info.si_pid == child.pid;
+}
+
+/**
+ * Wait for output of the running children and collect finished ones
+ *
+ * A child is finished when it exited or timed out, not when its report pipe
+ * is closed, since processes it started may have inherited the pipe.
+ */
+inline void
+poll_children(std::vector<Running>& running, std::vector<Result>& results)
+{
+	constexpr int MAX_WAIT_MS = 100;
+
+	std::vector<pollfd> fds;
+	fds.reserve(running.size());
+	for (const Running& child : running) {
+		fds.push_back({child.fd, POLLIN, 0});
+	}
+	::poll(fds.data(), fds.size(), MAX_WAIT_MS);
+
+	const auto now = Clock::now();
+	for (std::size_t i = running.size(); i-- > 0;) {
+		Running& child = running.at(i);
+		Result& result = results.at(child.index);
+
+		const bool done = exited(child);
+		read_report(child, result);
+		const bool killed = not done && now > child.deadline;
+		if (not done && not killed) {
+			continue;
+		}
+
+		// Kills the child on timeout, and anything left over from it
+		// while the exited child still holds its process group
+		::kill(-child.pid, SIGKILL);
+		int status = 0;
+		while (::waitpid(child.pid, &status, 0) < 0 && errno == EINTR) {
+		}
+		result.outcome = outcome(status, killed);
+		::close(child.fd);
+		std::error_code ec;
+		std::filesystem::remove_all(child.dir, ec);
+		running.erase(running.begin() + static_cast<std::ptrdiff_t>(i));
+	}
+}
+} // namespace detail
+
+/**
+ * Run each scenario in a forked child, up to jobs at a time
+ *
+ * @param jobs Maximum number of concurrent children, or 0 for the number of
+ * CPUs
+ *
+ * @param timeout Time after which a child is killed
+ *
+ * @return The results in the order of scenarios
+ */
+inline std::vector<Result> run(
+	const std::vector<Scenario>& scenarios,
+	std::size_t jobs = 0,
+	std::chrono::milliseconds timeout = DEFAULT_TIMEOUT
+)
+{
+	if (jobs == 0) {
+		jobs = std::max(1U, std::thread::hardware_concurrency());
+	}
+
+	std::vector<Result> results;
+	results.reserve(scenarios.size());
+	for (const Scenario& scenario : scenarios) {
+		results.push_back({scenario.name, Outcome::CRASHED, {}});
+	}
+
+	std::vector<detail::Running> running;
+	std::size_t next = 0;
+	while (next < scenarios.size() || not running.empty()) {
+		while (next < scenarios.size() && running.size() < jobs) {
+			detail::start(
+				scenarios.at(next),
+				next,
+				timeout,
+				running,
+				results.at(next)
+			);
+			++next;
+		}
+		if (not running.empty()) {
+			detail::poll_children(running, results);
+		}
+	}
+	return results;
+}
+
+/**
+ * Run scenarios with run() and check that each passed or was skipped
+ */
+inline void check(const std::vector<Scenario>& scenarios, std::size_t jobs = 0)
+{
+	for (const Result& result : run(scenarios, jobs)) {
+		INFO(result.name << " " << to_string(result.outcome) << ":\n"
+				 << result.report);
+		if (result.outcome == Outcome::SKIPPED) {
+			WARN(result.name << " skipped: " << result.report);
+			continue;
+		}
+		CHECK(result.outcome == Outcome::PASSED);
+	}
+}
+} // namespace forked
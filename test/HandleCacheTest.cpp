@@ -0,0 +1,237 @@
+#include "ll/HandleCache.hpp"
+#include "ll/ActionType.hpp"
+#include "ll/Rule.hpp"
+
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "TempDir.hpp"
+#include "test.hpp"
+
+using landlock::HandleCache;
+using landlock::PathBeneathRule;
+namespace action = landlock::action;
+namespace fs = std::filesystem;
+
+TEST_CASE("HandleCache::open")
+{
+	const TempDir dir{"handles", {"a", "b"}};
+	HandleCache cache;
+	std::error_code ec;
+
+	const HandleCache::Handle first = cache.open(dir.path("a"), ec);
+	REQUIRE_FALSE(ec);
+	REQUIRE(first);
+	CHECK(first->fd() >= 0);
+
+	struct stat st {};
+	REQUIRE(::stat((dir.path() / "a").c_str(), &st) == 0);
+	CHECK(first->dev() == st.st_dev);
+	CHECK(first->ino() == st.st_ino);
+
+	SECTION("same path")
+	{
+		const HandleCache::Handle second =
+			cache.open(dir.path("a"), ec);
+		REQUIRE_FALSE(ec);
+		CHECK(second == first);
+		CHECK(cache.size() == 1);
+		CHECK(cache.stats().hits == 1);
+		CHECK(cache.stats().misses == 1);
+	}
+
+	SECTION("different paths")
+	{
+		const HandleCache::Handle other = cache.open(dir.path("b"), ec);
+		REQUIRE_FALSE(ec);
+		CHECK(other != first);
+		CHECK(other->fd() != first->fd());
+		CHECK(cache.size() == 2);
+	}
+
+	SECTION("released handle")
+	{
+		const int fd = first->fd();
+		HandleCache::Handle copy = first;
+		copy.reset();
+		CHECK(cache.size() == 1);
+
+		HandleCache::Handle last = cache.open(dir.path("b"), ec);
+		REQUIRE_FALSE(ec);
+		const int last_fd = last->fd();
+		CHECK(cache.size() == 2);
+		last.reset();
+		CHECK(cache.size() == 1);
+		CHECK(::fcntl(last_fd, F_GETFD) < 0);
+		CHECK(::fcntl(fd, F_GETFD) >= 0);
+	}
+
+	SECTION("replaced path")
+	{
+		fs::rename(dir.path() / "a", dir.path() / "old");
+		fs::create_directory(dir.path() / "a");
+
+		const HandleCache::Handle fresh = cache.open(dir.path("a"), ec);
+		REQUIRE_FALSE(ec);
+		CHECK(fresh != first);
+		CHECK(fresh->ino() != first->ino());
+		CHECK(cache.stats().stale == 1);
+
+		// Later opens get the new object
+		CHECK(cache.open(dir.path("a"), ec) == fresh);
+		CHECK(cache.size() == 1);
+	}
+
+	SECTION("relative path")
+	{
+		const HandleCache::Handle cwd = cache.open(".", ec);
+		REQUIRE_FALSE(ec);
+		CHECK(cache.open(".", ec) != cwd);
+		CHECK(cache.size() == 1);
+	}
+}
+
+TEST_CASE("HandleCache::errors")
+{
+	const TempDir dir{"handles", {"a", "b"}};
+	HandleCache cache;
+	std::error_code ec;
+
+	CHECK_FALSE(cache.open(dir.path() / "missing", ec));
+	CHECK(ec == std::errc::no_such_file_or_directory);
+	CHECK(cache.size() == 0);
+#ifndef LLPP_NO_EXCEPTIONS
+	CHECK_THROWS_AS(cache.open(dir.path() / "missing"), std::system_error);
+#endif
+
+	SECTION("removed path")
+	{
+		const HandleCache::Handle handle =
+			cache.open(dir.path("a"), ec);
+		REQUIRE_FALSE(ec);
+		fs::remove(dir.path() / "a");
+		CHECK_FALSE(cache.open(dir.path("a"), ec));
+		CHECK(ec == std::errc::no_such_file_or_directory);
+		CHECK(handle->fd() >= 0);
+	}
+}
+
+TEST_CASE("HandleCache::fork")
+{
+	const TempDir dir{"handles", {"a", "b"}};
+	HandleCache cache;
+	std::error_code ec;
+
+	const HandleCache::Handle parent = cache.open(dir.path("a"), ec);
+	REQUIRE_FALSE(ec);
+
+	const pid_t pid = ::fork();
+	if (pid == 0) {
+		// The child may have closed inherited descriptors, so it does
+		// not reuse the parent's handle
+		const HandleCache::Handle child = cache.open(dir.path("a"), ec);
+		::_exit(not ec && child != parent ? 0 : 1);
+	}
+	REQUIRE(pid > 0);
+	int status = 0;
+	REQUIRE(::waitpid(pid, &status, 0) == pid);
+	CHECK(WIFEXITED(status));
+	CHECK(WEXITSTATUS(status) == 0);
+}
+
+TEST_CASE("HandleCache::outlived")
+{
+	const TempDir dir{"handles", {"a", "b"}};
+	std::error_code ec;
+	HandleCache::Handle handle;
+	{
+		HandleCache cache;
+		handle = cache.open(dir.path("a"), ec);
+		REQUIRE_FALSE(ec);
+	}
+	CHECK(::fcntl(handle->fd(), F_GETFD) >= 0);
+	handle.reset();
+}
+
+TEST_CASE("HandleCache::threads")
+{
+	const TempDir dir{"handles", {"a", "b"}};
+	HandleCache cache;
+
+	constexpr int THREADS = 4;
+	constexpr int OPENS = 200;
+	std::vector<std::vector<HandleCache::Handle>> handles(THREADS);
+	std::vector<std::thread> threads;
+	threads.reserve(THREADS);
+	for (int i = 0; i < THREADS; ++i) {
+		threads.emplace_back([&dir, &cache, &handles, i] {
+			std::error_code ec;
+			for (int j = 0; j < OPENS; ++j) {
+				const char* name = j % 2 == 0 ? "a" : "b";
+				handles.at(i).push_back(
+					cache.open(dir.path(name), ec)
+				);
+			}
+		});
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+
+	const HandleCache::Handle a = handles.at(0).at(0);
+	std::size_t mismatches = 0;
+	for (const auto& opened : handles) {
+		for (std::size_t j = 0; j < opened.size(); ++j) {
+			if (not opened.at(j) ||
+			    (opened.at(j) == a) != (j % 2 == 0)) {
+				++mismatches;
+			}
+		}
+	}
+	CHECK(mismatches == 0);
+	CHECK(cache.size() == 2);
+}
+
+TEST_CASE("HandleCache::shared by rules")
+{
+	const TempDir dir{"handles", {"a", "b"}};
+	std::error_code ec;
+
+	PathBeneathRule first;
+	first.add_path(dir.path() / "a", ec).add_action(action::FS_READ_FILE);
+	REQUIRE_FALSE(ec);
+	PathBeneathRule second;
+	second.add_path(dir.path() / "a", ec).add_action(action::FS_WRITE_FILE);
+	REQUIRE_FALSE(ec);
+
+	const auto first_attrs = first.generate(1);
+	const auto second_attrs = second.generate(1);
+	REQUIRE(first_attrs.size() == 1);
+	REQUIRE(second_attrs.size() == 1);
+	CHECK(first_attrs.front().parent_fd == second_attrs.front().parent_fd);
+
+	SECTION("handle")
+	{
+		HandleCache& cache = HandleCache::global();
+		PathBeneathRule third;
+		third.add_handle(cache.open(dir.path("a"), ec))
+			.add_handle(nullptr)
+			.add_action(action::FS_READ_FILE);
+		REQUIRE_FALSE(ec);
+		const auto attrs = third.generate(1);
+		REQUIRE(attrs.size() == 1);
+		CHECK(attrs.front().parent_fd == first_attrs.front().parent_fd);
+
+		PathBeneathRule skipped{0, 0};
+		skipped.add_handle(cache.open(dir.path("a"), ec));
+		CHECK(skipped.skipped_paths() == 1);
+	}
+}
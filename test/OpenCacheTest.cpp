@@ -0,0 +1,187 @@
+#include "ll/OpenCache.hpp"
+#include "ll/ActionType.hpp"
+#include "ll/Rule.hpp"
+#include "ll/Ruleset.hpp"
+
+#include <cerrno>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "ForkedTest.hpp"
+#include "test.hpp"
+
+using landlock::OpenCache;
+
+namespace
+{
+constexpr int EXIT_SKIP = 77;
+
+/**
+ * Check the cache in a sandboxed child process
+ *
+ * Catch2 assertions are not available in the child, so each failed check is
+ * reported as a distinct exit code.
+ */
+int sandboxed_child()
+{
+	std::error_code ec;
+	landlock::Ruleset ruleset{{landlock::action::FS_READ_FILE}, {}, {}, ec};
+	landlock::PathBeneathRule rule;
+	rule.add_path("/proc", ec).add_action(landlock::action::FS_READ_FILE);
+	ruleset.add_rule(std::move(rule), ec);
+	ruleset.enforce(true, ec);
+	if (ec) {
+		return 1;
+	}
+	if (not ruleset.landlock_enabled()) {
+		return EXIT_SKIP;
+	}
+
+	OpenCache cache{4, 2};
+	constexpr int ATTEMPTS = 3;
+	for (int i = 0; i < ATTEMPTS; ++i) {
+		if (cache.open("/etc/hostname", O_RDONLY) >= 0 ||
+		    errno != EACCES) {
+			return 2;
+		}
+	}
+	if (cache.stats().misses != 1 || cache.stats().hits != 2) {
+		return 3;
+	}
+
+	const int fd = cache.open("/proc/self/status", O_RDONLY);
+	if (fd < 0) {
+		return 4;
+	}
+	::close(fd);
+	if (cache.size() != 1) {
+		return 5;
+	}
+
+	return 0;
+}
+} // namespace
+
+TEST_CASE("OpenCache::denials")
+{
+	const pid_t pid = ::fork();
+	REQUIRE(pid >= 0);
+	if (pid == 0) {
+		::_exit(sandboxed_child());
+	}
+
+	int status = 0;
+	REQUIRE(::waitpid(pid, &status, 0) == pid);
+	REQUIRE(WIFEXITED(status));
+	if (WEXITSTATUS(status) == EXIT_SKIP) {
+		WARN("Landlock not supported, skipping");
+		return;
+	}
+	CHECK(WEXITSTATUS(status) == 0);
+}
+
+TEST_CASE("OpenCache::reused directory descriptors")
+{
+	forked::check({
+		{"denial is not reused for another directory",
+		 [](forked::Child& child) {
+			 for (const char* sub : {"allowed", "denied"}) {
+				 const auto dir = child.dir() / sub;
+				 std::filesystem::create_directories(dir);
+				 std::ofstream{dir / "file"} << "x";
+			 }
+
+			 std::error_code ec;
+			 landlock::Ruleset ruleset{
+				 {landlock::action::FS_READ_FILE}, {}, {}, ec
+			 };
+			 landlock::PathBeneathRule rule;
+			 rule.add_path(child.dir() / "allowed", ec)
+				 .add_action(landlock::action::FS_READ_FILE);
+			 ruleset.add_rule(std::move(rule), ec);
+			 ruleset.enforce(true, ec);
+			 FORKED_CHECK(child, not ec);
+			 if (not ruleset.landlock_enabled()) {
+				 child.skip("Landlock is not supported");
+			 }
+
+			 OpenCache cache;
+			 const int denied = ::open(
+				 (child.dir() / "denied").c_str(),
+				 O_PATH | O_DIRECTORY | O_CLOEXEC
+			 );
+			 FORKED_CHECK(child, denied >= 0);
+			 FORKED_CHECK(
+				 child,
+				 cache.openat(denied, "file", O_RDONLY) < 0 &&
+					 errno == EACCES
+			 );
+			 ::close(denied);
+
+			 // Gets the lowest free number, i.e. that of denied
+			 const int allowed = ::open(
+				 (child.dir() / "allowed").c_str(),
+				 O_PATH | O_DIRECTORY | O_CLOEXEC
+			 );
+			 FORKED_CHECK(child, allowed == denied);
+			 const int fd = cache.openat(allowed, "file", O_RDONLY);
+			 FORKED_CHECK(child, fd >= 0);
+			 FORKED_CHECK(child, cache.stats().hits == 0);
+			 ::close(fd);
+			 ::close(allowed);
+		 }},
+	});
+}
+
+TEST_CASE("OpenCache::successful opens are not cached")
+{
+	OpenCache cache;
+	for (int i = 0; i < 2; ++i) {
+		const int fd = cache.open("/proc/self/status", O_RDONLY);
+		REQUIRE(fd >= 0);
+		::close(fd);
+	}
+
+	const int fd = cache.open("/nonexistent/landlockpp/path", O_RDONLY);
+	CHECK(fd < 0);
+	CHECK(errno == ENOENT);
+
+	CHECK(cache.size() == 0);
+	CHECK(cache.stats().hits == 0);
+	CHECK(cache.stats().misses == 3);
+}
+
+TEST_CASE("OpenCache::concurrent use")
+{
+	OpenCache cache;
+	constexpr int THREADS = 4;
+	constexpr int ITERATIONS = 100;
+
+	std::vector<std::thread> threads;
+	threads.reserve(THREADS);
+	for (int t = 0; t < THREADS; ++t) {
+		threads.emplace_back([&cache]() {
+			for (int i = 0; i < ITERATIONS; ++i) {
+				const int fd = cache.open(
+					"/proc/self/status", O_RDONLY
+				);
+				if (fd >= 0) {
+					::close(fd);
+				}
+			}
+		});
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+
+	CHECK(cache.stats().misses ==
+	      static_cast<std::uint64_t>(THREADS) * ITERATIONS);
+}
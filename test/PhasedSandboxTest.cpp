@@ -0,0 +1,188 @@
+#include "ll/PhasedSandbox.hpp"
+#include "ll/ActionType.hpp"
+#include "ll/FakeBackend.hpp"
+#include "ll/Policy.hpp"
+#include "ll/Ruleset.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <memory>
+#include <new>
+#include <system_error>
+
+#include "test.hpp"
+
+using landlock::FakeBackend;
+using landlock::PhasedSandbox;
+using landlock::Policy;
+namespace action = landlock::action;
+
+namespace
+{
+Policy startup_policy()
+{
+	Policy policy;
+	policy.handle(action::FS_WRITE_FILE)
+		.allow("/tmp", action::FS_WRITE_FILE);
+	return policy;
+}
+
+Policy serving_policy()
+{
+	Policy policy;
+	policy.handle(action::FS_WRITE_FILE)
+		.handle(action::FS_READ_FILE)
+		.allow("/tmp", action::FS_READ_FILE);
+	return policy;
+}
+} // namespace
+
+TEST_CASE("PhasedSandbox::phases")
+{
+	FakeBackend backend{3};
+	std::error_code ec;
+
+	PhasedSandbox sandbox{backend};
+	sandbox.add_phase(startup_policy()).add_phase(serving_policy());
+	CHECK(sandbox.phase_count() == 2);
+	CHECK(sandbox.current_phase() == 0);
+
+	sandbox.wait(ec);
+	REQUIRE_FALSE(ec);
+	CHECK(sandbox.ready(0));
+	CHECK(sandbox.ready(1));
+
+	// All rulesets are built before the first transition
+	const std::size_t create_calls =
+		backend.call_count(FakeBackend::Call::CREATE_RULESET);
+	const std::size_t add_rule_calls =
+		backend.call_count(FakeBackend::Call::ADD_RULE);
+	CHECK(add_rule_calls == 2);
+
+	sandbox.advance(ec);
+	REQUIRE_FALSE(ec);
+	CHECK(sandbox.current_phase() == 1);
+	sandbox.advance(ec);
+	REQUIRE_FALSE(ec);
+	CHECK(sandbox.current_phase() == 2);
+
+	// Transitions only restrict, no_new_privs is set once
+	CHECK(backend.call_count(FakeBackend::Call::CREATE_RULESET) ==
+	      create_calls);
+	CHECK(backend.call_count(FakeBackend::Call::ADD_RULE) ==
+	      add_rule_calls);
+	CHECK(backend.call_count(FakeBackend::Call::RESTRICT_SELF) == 2);
+	CHECK(backend.call_count(FakeBackend::Call::SET_NO_NEW_PRIVS) == 1);
+
+	const auto layers = backend.layers();
+	REQUIRE(layers.size() == 2);
+	CHECK(layers.at(0).ruleset.handled_access_fs ==
+	      action::FS_WRITE_FILE.type_code());
+	CHECK(layers.at(1).ruleset.handled_access_fs ==
+	      (action::FS_WRITE_FILE | action::FS_READ_FILE).type_code());
+
+	sandbox.advance(ec);
+	CHECK(ec == std::errc::result_out_of_range);
+	CHECK(sandbox.current_phase() == 2);
+}
+
+TEST_CASE("PhasedSandbox::background preparation")
+{
+	FakeBackend backend{3};
+	backend.set_latency(
+		FakeBackend::Call::CREATE_RULESET, std::chrono::milliseconds{50}
+	);
+	std::error_code ec;
+
+	PhasedSandbox sandbox{backend};
+	const auto start = std::chrono::steady_clock::now();
+	sandbox.add_phase(startup_policy()).add_phase(serving_policy());
+	CHECK(std::chrono::steady_clock::now() - start <
+	      std::chrono::milliseconds{50});
+
+	sandbox.advance(ec);
+	REQUIRE_FALSE(ec);
+	sandbox.advance(ec);
+	REQUIRE_FALSE(ec);
+	CHECK(backend.layers().size() == 2);
+}
+
+TEST_CASE("PhasedSandbox::prebuilt ruleset")
+{
+	FakeBackend backend{3};
+	std::error_code ec;
+
+	using landlock::ActionRuleType;
+	using landlock::Ruleset;
+	auto ruleset = std::make_unique<Ruleset>(
+		backend,
+		Ruleset::ActionVec<ActionRuleType::PATH_BENEATH>{
+			action::FS_READ_FILE
+		},
+		Ruleset::ActionVec<ActionRuleType::NET_PORT>{},
+		Ruleset::ScopeVec{},
+		ec
+	);
+	REQUIRE_FALSE(ec);
+
+	PhasedSandbox sandbox{backend};
+	sandbox.add_phase(std::move(ruleset));
+	CHECK(sandbox.ready(0));
+	sandbox.advance(ec);
+	REQUIRE_FALSE(ec);
+	CHECK(backend.layers().size() == 1);
+}
+
+TEST_CASE("PhasedSandbox::preparation failure")
+{
+	FakeBackend backend{3};
+	backend.inject_error(FakeBackend::Call::CREATE_RULESET, ENOMEM);
+	std::error_code ec;
+
+	PhasedSandbox sandbox{backend};
+	sandbox.add_phase(startup_policy());
+	sandbox.wait(ec);
+	CHECK(ec == std::errc::not_enough_memory);
+
+	sandbox.advance(ec);
+	CHECK(ec == std::errc::not_enough_memory);
+	CHECK(sandbox.current_phase() == 0);
+	CHECK(backend.layers().empty());
+}
+
+#ifndef LLPP_NO_EXCEPTIONS
+TEST_CASE("PhasedSandbox::throwing builder")
+{
+	FakeBackend backend{3};
+	std::error_code ec;
+
+	PhasedSandbox sandbox{backend};
+	sandbox.add_phase([](landlock::Backend& /*backend*/,
+			     std::error_code& /*ec*/
+			  ) -> std::unique_ptr<landlock::Ruleset> {
+		throw std::bad_alloc{};
+	});
+	sandbox.add_phase([](landlock::Backend& /*backend*/,
+			     std::error_code& /*ec*/
+			  ) -> std::unique_ptr<landlock::Ruleset> {
+		throw std::system_error{
+			std::make_error_code(std::errc::permission_denied)
+		};
+	});
+
+	// The non-throwing overloads report the exceptions as errors
+	REQUIRE_NOTHROW(sandbox.wait(ec));
+	CHECK(ec == std::errc::not_enough_memory);
+	REQUIRE_NOTHROW(sandbox.advance(ec));
+	CHECK(ec == std::errc::not_enough_memory);
+	CHECK(sandbox.current_phase() == 0);
+	CHECK(backend.layers().empty());
+}
+
+TEST_CASE("PhasedSandbox::throwing API")
+{
+	FakeBackend backend{3};
+	PhasedSandbox sandbox{backend};
+	REQUIRE_THROWS_AS(sandbox.advance(), std::system_error);
+}
+#endif
@@ -0,0 +1,367 @@
+#include "ll/PolicyAudit.hpp"
+#include "ll/ActionType.hpp"
+#include "ll/FakeBackend.hpp"
+#include "ll/Policy.hpp"
+#include "ll/Rule.hpp"
+#include "ll/Ruleset.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+
+#include "TempDir.hpp"
+#include "test.hpp"
+
+using landlock::FakeBackend;
+using landlock::Policy;
+using landlock::PolicyAudit;
+using landlock::Ruleset;
+namespace action = landlock::action;
+namespace fs = std::filesystem;
+
+namespace
+{
+constexpr std::uint64_t NONE = 0;
+const std::uint64_t READ = action::FS_READ_FILE.type_code();
+const std::uint64_t WRITE = action::FS_WRITE_FILE.type_code();
+const std::uint64_t READ_DIR = action::FS_READ_DIR.type_code();
+
+/**
+ * Temporary directory with a small tree
+ *
+ * root/
+ *   allowed/
+ *     sub/a.txt
+ *     b.txt
+ *   other/
+ *     c.txt
+ *     secret.txt
+ *   link -> allowed
+ */
+class TempTree : public TempDir
+{
+public:
+	TempTree() : TempDir{"audit", {"allowed/sub", "other"}}
+	{
+		for (const char* file :
+		     {"allowed/sub/a.txt",
+		      "allowed/b.txt",
+		      "other/c.txt",
+		      "other/secret.txt"}) {
+			std::ofstream{path(file)} << "x";
+		}
+		fs::create_directory_symlink("allowed", path("link"));
+	}
+};
+
+Policy read_policy(const TempTree& tree)
+{
+	Policy policy;
+	policy.handle(action::FS_READ_FILE | action::FS_WRITE_FILE |
+		      action::FS_READ_DIR)
+		.allow(tree.path() / "allowed",
+		       action::FS_READ_FILE | action::FS_READ_DIR)
+		.allow(tree.path() / "other" / "secret.txt",
+		       action::FS_READ_FILE);
+	return policy;
+}
+
+std::uint64_t
+region_access(const PolicyAudit::Report& report, const fs::path& path)
+{
+	for (const PolicyAudit::Region& region : report.regions) {
+		if (region.path == path.native()) {
+			return region.access;
+		}
+	}
+	return ~std::uint64_t{0};
+}
+} // namespace
+
+// NOLINTBEGIN(*-magic-numbers)
+
+TEST_CASE("PolicyAudit::policy")
+{
+	const TempTree tree;
+	std::error_code ec;
+
+	PolicyAudit audit;
+	audit.add_layer(read_policy(tree), ec);
+	REQUIRE_FALSE(ec);
+	CHECK(audit.layer_count() == 1);
+
+	PolicyAudit::Options options;
+	options.threads = GENERATE(1, 4);
+	const PolicyAudit::Report report =
+		audit.run({tree.path()}, options, ec);
+	REQUIRE_FALSE(ec);
+	CHECK(report.errors == 0);
+
+	REQUIRE(report.by_access.size() == 3);
+	CHECK(report.by_access.at(NONE).dirs == 2);
+	CHECK(report.by_access.at(NONE).files == 2);
+	CHECK(report.by_access.at(READ | READ_DIR).dirs == 2);
+	CHECK(report.by_access.at(READ | READ_DIR).files == 0);
+	CHECK(report.by_access.at(READ).dirs == 0);
+	CHECK(report.by_access.at(READ).files == 3);
+
+	REQUIRE(report.regions.size() == 3);
+	CHECK(report.regions.at(0).path == tree.path().native());
+	CHECK(report.regions.at(0).dir);
+	CHECK(report.regions.at(0).access == NONE);
+	CHECK(region_access(report, tree.path() / "allowed") ==
+	      (READ | READ_DIR));
+	CHECK(region_access(report, tree.path() / "other" / "secret.txt") ==
+	      READ);
+	CHECK_FALSE(report.regions.at(2).dir);
+}
+
+TEST_CASE("PolicyAudit::rules beneath the root")
+{
+	const TempTree tree;
+	std::error_code ec;
+
+	PolicyAudit audit;
+	audit.add_layer(read_policy(tree), ec);
+	REQUIRE_FALSE(ec);
+
+	// The rule on allowed applies although the walk starts beneath it
+	const PolicyAudit::Report report =
+		audit.run({tree.path() / "allowed" / "sub"}, {}, ec);
+	REQUIRE_FALSE(ec);
+	REQUIRE(report.regions.size() == 1);
+	CHECK(report.regions.front().access == (READ | READ_DIR));
+	CHECK(report.by_access.at(READ).files == 1);
+}
+
+TEST_CASE("PolicyAudit::symbolic link rule")
+{
+	const TempTree tree;
+	std::error_code ec;
+
+	Policy policy = read_policy(tree);
+	policy.allow(tree.path() / "link", action::FS_WRITE_FILE);
+
+	PolicyAudit audit;
+	audit.add_layer(policy, ec);
+	REQUIRE_FALSE(ec);
+	const PolicyAudit::Report report = audit.run({tree.path()}, {}, ec);
+	REQUIRE_FALSE(ec);
+
+	// Like the kernel, the rule applies to the link's target, and the link
+	// itself is not followed
+	CHECK(region_access(report, tree.path() / "allowed") ==
+	      (READ | WRITE | READ_DIR));
+	CHECK(region_access(report, tree.path() / "link") ==
+	      ~std::uint64_t{0});
+	CHECK(report.by_access.at(READ | WRITE).files == 2);
+}
+
+TEST_CASE("PolicyAudit::layers")
+{
+	const TempTree tree;
+	std::error_code ec;
+
+	Policy inner;
+	inner.handle(action::FS_READ_FILE)
+		.allow(tree.path() / "allowed" / "sub", action::FS_READ_FILE);
+
+	PolicyAudit audit;
+	audit.add_layer(read_policy(tree), ec).add_layer(inner, ec);
+	REQUIRE_FALSE(ec);
+	CHECK(audit.layer_count() == 2);
+
+	const PolicyAudit::Report report = audit.run({tree.path()}, {}, ec);
+	REQUIRE_FALSE(ec);
+	CHECK(region_access(report, tree.path() / "allowed") == READ_DIR);
+	CHECK(region_access(report, tree.path() / "allowed" / "sub") ==
+	      (READ | READ_DIR));
+	CHECK(region_access(report, tree.path() / "other" / "secret.txt") ==
+	      ~std::uint64_t{0});
+	CHECK(report.by_access.at(READ).files == 1);
+	CHECK(report.by_access.at(NONE).files == 4);
+
+	SECTION("too many layers")
+	{
+		for (std::size_t i = audit.layer_count();
+		     i < PolicyAudit::MAX_LAYERS;
+		     ++i) {
+			audit.add_layer(inner, ec);
+			REQUIRE_FALSE(ec);
+		}
+		audit.add_layer(inner, ec);
+		CHECK(ec == std::errc::argument_list_too_long);
+		CHECK(audit.layer_count() == PolicyAudit::MAX_LAYERS);
+	}
+}
+
+TEST_CASE("PolicyAudit::ruleset")
+{
+	const TempTree tree;
+	std::error_code ec;
+
+	SECTION("active")
+	{
+		FakeBackend backend{7};
+		Ruleset ruleset{
+			backend,
+			{action::FS_READ_FILE, action::FS_WRITE_FILE},
+			{},
+			{},
+			ec
+		};
+		REQUIRE_FALSE(ec);
+		landlock::PathBeneathRule rule;
+		rule.add_path(tree.path() / "allowed", ec)
+			.add_action(action::FS_READ_FILE);
+		REQUIRE_FALSE(ec);
+		ruleset.add_rule(std::move(rule), ec);
+		REQUIRE_FALSE(ec);
+
+		PolicyAudit audit;
+		audit.add_layer(ruleset, ec);
+		REQUIRE_FALSE(ec);
+		const PolicyAudit::Report report =
+			audit.run({tree.path()}, {}, ec);
+		REQUIRE_FALSE(ec);
+		CHECK(region_access(report, tree.path() / "allowed") == READ);
+		CHECK(report.by_access.at(READ).files == 2);
+	}
+
+	SECTION("inactive")
+	{
+		FakeBackend backend{0};
+		const Ruleset ruleset{
+			backend, {action::FS_READ_FILE}, {}, {}, ec
+		};
+		REQUIRE_FALSE(ec);
+
+		PolicyAudit audit;
+		audit.add_layer(ruleset, ec);
+		REQUIRE_FALSE(ec);
+		CHECK(audit.layer_count() == 1);
+		const PolicyAudit::Report report =
+			audit.run({tree.path()}, {}, ec);
+		REQUIRE_FALSE(ec);
+		REQUIRE(report.by_access.size() == 1);
+		CHECK(report.by_access.at(NONE).dirs == 4);
+		CHECK(report.by_access.at(NONE).files == 5);
+		CHECK(report.regions.size() == 1);
+	}
+
+	SECTION("adopted")
+	{
+		FakeBackend backend{7};
+		landlock_ruleset_attr attr{};
+		attr.handled_access_fs = READ;
+		const int fd = backend.create_ruleset(&attr, sizeof(attr), 0);
+		REQUIRE(fd >= 0);
+		const auto adopted = Ruleset::adopt(fd, 7, READ, 0, 0, backend);
+
+		// The rules are unknown, so the audit would deny everything
+		PolicyAudit audit;
+		audit.add_layer(*adopted, ec);
+		CHECK(ec == std::errc::not_supported);
+		CHECK(audit.layer_count() == 0);
+#ifndef LLPP_NO_EXCEPTIONS
+		CHECK_THROWS_AS(audit.add_layer(*adopted), std::system_error);
+#endif
+
+		// Without a file descriptor, it does not restrict anything
+		const auto inactive = Ruleset::adopt(-1, 0, 0, 0, 0, backend);
+		audit.add_layer(*inactive, ec);
+		CHECK_FALSE(ec);
+		CHECK(audit.layer_count() == 1);
+	}
+}
+
+TEST_CASE("PolicyAudit::visitor")
+{
+	const TempTree tree;
+	std::error_code ec;
+
+	PolicyAudit audit;
+	audit.add_layer(read_policy(tree), ec);
+	REQUIRE_FALSE(ec);
+
+	std::atomic<int> dirs{0};
+	std::atomic<int> files{0};
+	PolicyAudit::Options options;
+	options.threads = 3;
+	options.visitor = [&](std::string_view, bool dir, std::uint64_t) {
+		++(dir ? dirs : files);
+	};
+	const PolicyAudit::Report report =
+		audit.run({tree.path()}, options, ec);
+	REQUIRE_FALSE(ec);
+	CHECK(dirs == 4);
+	CHECK(files == 5);
+	CHECK(report.regions.size() == 3);
+}
+
+TEST_CASE("PolicyAudit::large tree")
+{
+	const TempTree tree;
+	constexpr int DIRS = 40;
+	constexpr int FILES = 25;
+	for (int i = 0; i < DIRS; ++i) {
+		const fs::path dir = tree.path() / "other" / std::to_string(i) /
+				     "nested";
+		fs::create_directories(dir);
+		for (int j = 0; j < FILES; ++j) {
+			std::ofstream{dir / std::to_string(j)};
+		}
+	}
+
+	std::error_code ec;
+	PolicyAudit audit;
+	audit.add_layer(read_policy(tree), ec);
+	REQUIRE_FALSE(ec);
+
+	PolicyAudit::Options options;
+	options.threads = GENERATE(1, 2, 8);
+	const PolicyAudit::Report report =
+		audit.run({tree.path()}, options, ec);
+	REQUIRE_FALSE(ec);
+	CHECK(report.by_access.at(NONE).dirs == 2 + 2 * DIRS);
+	CHECK(report.by_access.at(NONE).files == 2 + DIRS * FILES);
+	CHECK(report.regions.size() == 3);
+}
+
+TEST_CASE("PolicyAudit::errors")
+{
+	const TempTree tree;
+	PolicyAudit audit;
+	std::error_code ec;
+
+	SECTION("missing rule path")
+	{
+		Policy policy;
+		policy.handle(action::FS_READ_FILE)
+			.allow(tree.path() / "missing", action::FS_READ_FILE);
+		audit.add_layer(policy, ec);
+		CHECK(ec == std::errc::no_such_file_or_directory);
+		CHECK(audit.layer_count() == 0);
+#ifndef LLPP_NO_EXCEPTIONS
+		CHECK_THROWS_AS(audit.add_layer(policy), std::system_error);
+#endif
+	}
+
+	SECTION("missing root")
+	{
+		const PolicyAudit::Report report =
+			audit.run({tree.path() / "missing"}, {}, ec);
+		CHECK(ec == std::errc::no_such_file_or_directory);
+		CHECK(report.by_access.empty());
+#ifndef LLPP_NO_EXCEPTIONS
+		CHECK_THROWS_AS(
+			audit.run({tree.path() / "missing"}), std::system_error
+		);
+#endif
+	}
+}
+
+// NOLINTEND(*-magic-numbers)
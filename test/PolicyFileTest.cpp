@@ -0,0 +1,121 @@
+#include "ll/PolicyFile.hpp"
+#include "ll/ActionType.hpp"
+#include "ll/Policy.hpp"
+#include "ll/Scope.hpp"
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+#include "test.hpp"
+
+using landlock::Policy;
+using landlock::PolicyFile;
+using landlock::PolicyFileError;
+namespace action = landlock::action;
+namespace scope = landlock::scope;
+
+TEST_CASE("PolicyFile::read")
+{
+	std::istringstream in{
+		"# comment\n"
+		"\n"
+		"handle fs read_file,write_file\n"
+		"  path ro /usr  \n"
+		"path write_file /tmp/with space\n"
+		"handle net bind_tcp\n"
+		"port bind_tcp 8080\n"
+		"scope signal\n"
+	};
+	Policy policy;
+	PolicyFileError error;
+	REQUIRE(PolicyFile::read(in, policy, error));
+
+	Policy expected;
+	expected.handle(action::FS_READ_FILE)
+		.handle(action::FS_WRITE_FILE)
+		.allow("/usr", action::FS_READ_FILE | action::FS_READ_DIR |
+				       action::FS_EXECUTE)
+		.allow("/tmp/with space", action::FS_WRITE_FILE)
+		.handle(action::NET_BIND_TCP)
+		.allow(8080, action::NET_BIND_TCP);
+#ifdef LANDLOCK_SCOPE_SIGNAL
+	expected.restrict(scope::SIGNAL);
+#endif
+	CHECK(policy == expected);
+}
+
+TEST_CASE("PolicyFile::errors")
+{
+	const auto line_of = [](const std::string& text) {
+		std::istringstream in{text};
+		Policy policy;
+		PolicyFileError error;
+		CHECK_FALSE(PolicyFile::read(in, policy, error));
+		CHECK_FALSE(error.message.empty());
+		return error.line;
+	};
+
+	CHECK(line_of("handle fs read_file\nbogus\n") == 2);
+	CHECK(line_of("# c\n\nhandle fs nonsense\n") == 3);
+	CHECK(line_of("handle xyz read_file\n") == 1);
+	CHECK(line_of("path read_file\n") == 1);
+	CHECK(line_of("port bind_tcp 65536\n") == 1);
+	CHECK(line_of("port bind_tcp 80x\n") == 1);
+	CHECK(line_of("scope signal extra\n") == 1);
+
+	Policy policy;
+	std::string message;
+	CHECK(PolicyFile::apply("# only a comment", policy, message));
+	CHECK_FALSE(PolicyFile::apply("path bogus /usr", policy, message));
+	CHECK(policy == Policy{});
+}
+
+TEST_CASE("PolicyFile::action names")
+{
+	const auto code = [](const auto& acts) {
+		REQUIRE(acts.has_value());
+		return acts->type_code();
+	};
+	std::uint64_t all_fs = 0;
+	for (const auto& act : action::FS_ACTIONS) {
+		all_fs |= act.type_code();
+	}
+	std::uint64_t all_net = 0;
+	for (const auto& act : action::NET_ACTIONS) {
+		all_net |= act.type_code();
+	}
+
+	CHECK(code(PolicyFile::fs_actions("read_file,read_dir")) ==
+	      (action::FS_READ_FILE | action::FS_READ_DIR).type_code());
+	CHECK(code(PolicyFile::fs_actions("ro")) ==
+	      (action::FS_EXECUTE | action::FS_READ_FILE | action::FS_READ_DIR)
+		      .type_code());
+	CHECK(code(PolicyFile::fs_actions("all")) == all_fs);
+	CHECK(code(PolicyFile::net_actions("all")) == all_net);
+	CHECK_FALSE(PolicyFile::fs_actions("").has_value());
+	CHECK_FALSE(PolicyFile::fs_actions("read_file,").has_value());
+	CHECK_FALSE(PolicyFile::net_actions("read_file").has_value());
+	CHECK_FALSE(PolicyFile::scopes("bogus").has_value());
+}
+
+TEST_CASE("PolicyFile::write round trip")
+{
+	Policy policy;
+	for (const auto& act : action::FS_ACTIONS) {
+		policy.handle(act);
+	}
+	policy.handle(action::NET_CONNECT_TCP)
+		.allow("/usr", action::FS_READ_FILE | action::FS_EXECUTE)
+		.allow("/var/lib/some dir", action::FS_WRITE_FILE)
+		.allow(443, action::NET_CONNECT_TCP);
+
+	std::ostringstream out;
+	PolicyFile::write(out, policy);
+
+	std::istringstream in{out.str()};
+	Policy read;
+	PolicyFileError error;
+	REQUIRE(PolicyFile::read(in, read, error));
+	CHECK(read == policy);
+}
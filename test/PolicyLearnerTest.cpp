@@ -0,0 +1,269 @@
+#include "ll/PolicyLearner.hpp"
+#include "ll/ActionType.hpp"
+#include "ll/Backend.hpp"
+#include "ll/Policy.hpp"
+#include "ll/Ruleset.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "ForkedTest.hpp"
+#include "TempDir.hpp"
+#include "test.hpp"
+
+using landlock::Policy;
+using landlock::PolicyLearner;
+namespace action = landlock::action;
+
+namespace
+{
+/**
+ * Script learned and replayed in the directory given as $1
+ *
+ * It starts by removing what a previous run created, so learning runs it
+ * twice to record that as well. Only x/kept is truncated, since rules on a
+ * file do not apply to a new file of the same name.
+ */
+constexpr const char* SCRIPT =
+	"cd \"$1\" && rm -f w/b w/c w/f x/b && echo x > w/a && mv w/a w/b && "
+	"ln -sf b w/c && ln -sf b w/c && mkfifo w/f && mv w/b x/b && "
+	"truncate -s 0 x/kept";
+
+/**
+ * Run SCRIPT in dir, with the interposer writing to trace unless preload is
+ * nullptr
+ *
+ * @return The exit status of the script, or -1 if it did not exit
+ */
+int run_script(
+	const std::filesystem::path& dir,
+	const char* preload,
+	const std::filesystem::path& trace
+)
+{
+	const pid_t pid = ::fork();
+	if (pid == 0) {
+		if (preload != nullptr) {
+			::setenv("LD_PRELOAD", preload, 1);
+			::setenv("LLPP_LEARN_TRACE", trace.c_str(), 1);
+		}
+		// NOLINTNEXTLINE(*-vararg)
+		::execl(
+			"/bin/sh",
+			"sh",
+			"-c",
+			SCRIPT,
+			"sh",
+			dir.c_str(),
+			nullptr
+		);
+		::_exit(EXIT_FAILURE);
+	}
+	int status = 0;
+	if (pid < 0 || ::waitpid(pid, &status, 0) != pid ||
+	    not WIFEXITED(status)) {
+		return -1;
+	}
+	return WEXITSTATUS(status);
+}
+
+/**
+ * Check that the policy learned from two runs of the script allows replaying
+ * it and denies anything else
+ */
+void replay_scenario(forked::Child& child, const char* preload)
+{
+	const std::filesystem::path dir = child.dir() / "work";
+	std::filesystem::create_directories(dir / "w");
+	std::filesystem::create_directories(dir / "x");
+	std::ofstream{dir / "x" / "kept"} << "x";
+	const std::filesystem::path trace = child.dir() / "trace";
+	FORKED_CHECK(child, run_script(dir, preload, trace) == 0);
+	FORKED_CHECK(child, run_script(dir, preload, trace) == 0);
+
+	PolicyLearner learner;
+	std::ifstream in{trace};
+	learner.read_trace(in);
+	FORKED_CHECK(child, learner.stats().lost == 0);
+	learner.relocate_missing();
+
+	std::error_code ec;
+	const auto ruleset =
+		learner.policy().build(landlock::Backend::system(), ec);
+	FORKED_CHECK(child, not ec);
+	if (ec || not ruleset->active()) {
+		child.skip("Landlock is not supported");
+	}
+	ruleset->enforce(true, ec);
+	FORKED_CHECK(child, not ec);
+
+	// Replaying what was learned succeeds, anything else is denied
+	FORKED_CHECK(child, run_script(dir, nullptr, {}) == 0);
+	const int fd = ::open(trace.c_str(), O_RDONLY | O_CLOEXEC);
+	FORKED_CHECK(child, fd < 0 && errno == EACCES);
+}
+} // namespace
+
+TEST_CASE("PolicyLearner::deduplication")
+{
+	PolicyLearner learner;
+	learner.record("/etc/hosts", action::FS_READ_FILE)
+		.record("/etc/hosts", action::FS_READ_FILE)
+		.record("/etc//hosts", action::FS_WRITE_FILE)
+		.record("/usr/bin/true", action::FS_EXECUTE)
+		.record(443, action::NET_CONNECT_TCP)
+		.record(443, action::NET_CONNECT_TCP);
+
+	const Policy policy = learner.policy();
+	CHECK(learner.stats().records == 6);
+	CHECK(policy.path_rules().size() == 2);
+	CHECK(policy.effective_access("/etc/hosts") ==
+	      (action::FS_READ_FILE | action::FS_WRITE_FILE).type_code());
+	CHECK(policy.effective_access("/etc/passwd") == 0);
+	CHECK(policy.effective_access("/usr/bin/true") ==
+	      action::FS_EXECUTE.type_code());
+#if LLPP_BUILD_LANDLOCK_API >= 4
+	CHECK(policy.port_rules().size() == 1);
+	CHECK(policy.effective_access(std::uint16_t{443}) ==
+	      action::NET_CONNECT_TCP.type_code());
+#endif
+}
+
+TEST_CASE("PolicyLearner::collapse")
+{
+	PolicyLearner learner;
+	learner.record("/usr/lib/a.so", action::FS_READ_FILE)
+		.record("/usr/lib/b.so", action::FS_READ_FILE)
+		.record("/usr/lib/c.so", action::FS_READ_FILE)
+		.record("/usr/lib/sub/d.so", action::FS_EXECUTE)
+		.record("/usr/lib/sub/e.so", action::FS_READ_FILE)
+		.record("/etc/a", action::FS_READ_FILE);
+
+	SECTION("disabled")
+	{
+		CHECK(learner.policy(0).path_rules().size() == 6);
+	}
+
+	SECTION("cascading")
+	{
+		const Policy policy = learner.policy(2);
+		// /usr/lib/sub collapses first and then counts towards /usr/lib
+		CHECK(policy.path_rules().size() == 2);
+		CHECK(policy.path_rules().count("/usr/lib") == 1);
+		CHECK(policy.effective_access("/usr/lib/x.so") ==
+		      (action::FS_READ_FILE | action::FS_EXECUTE).type_code());
+		CHECK(policy.effective_access("/etc/a") ==
+		      action::FS_READ_FILE.type_code());
+	}
+
+	SECTION("partial")
+	{
+		const Policy policy = learner.policy(3);
+		CHECK(policy.path_rules().count("/usr/lib") == 1);
+		CHECK(policy.path_rules().count("/usr/lib/sub/d.so") == 1);
+		CHECK(policy.path_rules().count("/usr/lib/sub/e.so") == 0);
+	}
+}
+
+TEST_CASE("PolicyLearner::redundant rules")
+{
+	PolicyLearner learner;
+	learner.record("/srv", action::FS_READ_FILE | action::FS_READ_DIR)
+		.record("/srv/data/file", action::FS_READ_FILE)
+		.record(
+			"/srv/data/out",
+			action::FS_READ_FILE | action::FS_WRITE_FILE
+		);
+
+	const Policy policy = learner.policy();
+	CHECK(policy.path_rules().size() == 2);
+	CHECK(policy.path_rules().count("/srv/data/file") == 0);
+	// Only the access not inherited from /srv remains
+	CHECK(policy.path_rules().at("/srv/data/out") ==
+	      action::FS_WRITE_FILE.type_code());
+}
+
+TEST_CASE("PolicyLearner::proc paths")
+{
+	PolicyLearner learner;
+	learner.record("/proc/1234/maps", action::FS_READ_FILE)
+		.record("/proc/12a/maps", action::FS_READ_FILE)
+		.record("/proc/42", action::FS_READ_DIR);
+
+	const Policy policy = learner.policy(0);
+	CHECK(policy.path_rules().count("/proc/self/maps") == 1);
+	CHECK(policy.path_rules().count("/proc/12a/maps") == 1);
+	CHECK(policy.path_rules().count("/proc/self") == 1);
+}
+
+TEST_CASE("PolicyLearner::read trace")
+{
+	std::istringstream in{
+		"fs 4 /etc/hosts\n"
+		"fs 1 /usr/bin/with space\n"
+		"net 2 443\n"
+		"lost 5\n"
+		"\n"
+		"fs 4 relative\n"
+		"fs zz /etc\n"
+		"net 1 70000\n"
+		"bogus\n"
+	};
+	PolicyLearner learner;
+	learner.read_trace(in);
+
+	CHECK(learner.stats().records == 3);
+	CHECK(learner.stats().lost == 5);
+	CHECK(learner.stats().malformed == 4);
+
+	const Policy policy = learner.policy();
+	CHECK(policy.effective_access("/etc/hosts") ==
+	      action::FS_READ_FILE.type_code());
+	CHECK(policy.effective_access("/usr/bin/with space") ==
+	      action::FS_EXECUTE.type_code());
+}
+
+TEST_CASE("PolicyLearner::missing paths")
+{
+	const TempDir tmp{"learner"};
+	const std::filesystem::path& dir = tmp.path();
+	std::ofstream{dir / "kept"} << "x";
+
+	PolicyLearner learner;
+	learner.record((dir / "kept").native(), action::FS_READ_FILE)
+		.record((dir / "tmp").native(), action::FS_WRITE_FILE)
+		.record((dir / "gone/deeper").native(), action::FS_READ_FILE);
+
+	CHECK(learner.relocate_missing() == 2);
+	const Policy policy = learner.policy(0);
+	// The rule on kept is redundant with the relocated ones
+	CHECK(policy.path_rules().size() == 1);
+	CHECK(policy.path_rules().at(dir.native()) ==
+	      (action::FS_READ_FILE | action::FS_WRITE_FILE).type_code());
+	CHECK(policy.path_rules().count((dir / "kept").native()) == 0);
+}
+
+// Needs the interposer, which the tools build passes in LLPP_LEARN_PRELOAD
+TEST_CASE("PolicyLearner::learn and replay", "[.learn]")
+{
+	const char* preload = std::getenv("LLPP_LEARN_PRELOAD");
+	if (preload == nullptr) {
+		WARN("LLPP_LEARN_PRELOAD is not set, skipping");
+		return;
+	}
+
+	forked::check({
+		{"rename, link, fifo and truncate",
+		 [preload](forked::Child& child) {
+			 replay_scenario(child, preload);
+		 }},
+	});
+}
@@ -0,0 +1,173 @@
+#include "ll/PolicyReloader.hpp"
+#include "ll/ActionType.hpp"
+#include "ll/FakeBackend.hpp"
+#include "ll/Policy.hpp"
+
+#include <system_error>
+
+#include "test.hpp"
+
+using landlock::FakeBackend;
+using landlock::Policy;
+using landlock::PolicyReloader;
+namespace action = landlock::action;
+
+namespace
+{
+Policy base_policy()
+{
+	Policy policy;
+	policy.handle(action::FS_READ_FILE)
+		.handle(action::FS_WRITE_FILE)
+		.allow("/usr", action::FS_READ_FILE)
+		.allow("/tmp", action::FS_READ_FILE)
+		.allow("/tmp", action::FS_WRITE_FILE);
+	return policy;
+}
+} // namespace
+
+TEST_CASE("PolicyReloader::initial enforcement")
+{
+	FakeBackend backend{3};
+	PolicyReloader reloader{backend};
+	std::error_code ec;
+
+	CHECK_FALSE(reloader.enforced().has_value());
+	reloader.reload(base_policy(), ec);
+	REQUIRE_FALSE(ec);
+	CHECK(reloader.layer_count() == 1);
+	REQUIRE(reloader.enforced().has_value());
+	CHECK(*reloader.enforced() == base_policy());
+
+	const auto layers = backend.layers();
+	REQUIRE(layers.size() == 1);
+	CHECK(layers.at(0).ruleset.handled_access_fs ==
+	      (action::FS_READ_FILE | action::FS_WRITE_FILE).type_code());
+}
+
+TEST_CASE("PolicyReloader::tightening")
+{
+	FakeBackend backend{3};
+	PolicyReloader reloader{backend};
+	std::error_code ec;
+	reloader.reload(base_policy(), ec);
+	REQUIRE_FALSE(ec);
+
+	SECTION("unchanged policy adds no layer")
+	{
+		reloader.reload(base_policy(), ec);
+		REQUIRE_FALSE(ec);
+		CHECK(reloader.layer_count() == 1);
+		CHECK(backend.layers().size() == 1);
+	}
+
+	SECTION("minimal layer")
+	{
+		// Writing to /tmp is no longer allowed, reading is unchanged
+		Policy next;
+		next.handle(action::FS_READ_FILE)
+			.handle(action::FS_WRITE_FILE)
+			.allow("/usr", action::FS_READ_FILE)
+			.allow("/tmp", action::FS_READ_FILE);
+		REQUIRE(reloader.narrower(next));
+
+		const Policy layer = reloader.delta(next);
+		CHECK(layer.handled_access_fs() ==
+		      action::FS_WRITE_FILE.type_code());
+		CHECK(layer.path_rules().empty());
+
+		reloader.reload(next, ec);
+		REQUIRE_FALSE(ec);
+		CHECK(reloader.layer_count() == 2);
+		CHECK(*reloader.enforced() == next);
+
+		const auto layers = backend.layers();
+		REQUIRE(layers.size() == 2);
+		CHECK(layers.at(1).ruleset.handled_access_fs ==
+		      action::FS_WRITE_FILE.type_code());
+		CHECK(layers.at(1).ruleset.path_beneath_rules.empty());
+	}
+
+	SECTION("newly handled access")
+	{
+		Policy next = base_policy();
+		next.handle(action::FS_EXECUTE)
+			.allow("/usr", action::FS_EXECUTE);
+		REQUIRE(reloader.narrower(next));
+
+		const Policy layer = reloader.delta(next);
+		CHECK(layer.handled_access_fs() ==
+		      action::FS_EXECUTE.type_code());
+		REQUIRE(layer.path_rules().size() == 1);
+		CHECK(layer.path_rules().begin()->first == "/usr");
+		CHECK(layer.path_rules().begin()->second ==
+		      action::FS_EXECUTE.type_code());
+	}
+
+	SECTION("intersection of enforced and delta equals next")
+	{
+		Policy next;
+		next.handle(action::FS_READ_FILE)
+			.handle(action::FS_WRITE_FILE)
+			.handle(action::FS_READ_DIR)
+			.allow("/usr/lib", action::FS_READ_FILE)
+			.allow("/tmp/x", action::FS_WRITE_FILE)
+			.allow("/tmp/x", action::FS_READ_DIR);
+		REQUIRE(reloader.narrower(next));
+
+		const Policy merged =
+			Policy::intersect(base_policy(), reloader.delta(next));
+		for (const char* path :
+		     {"/", "/usr", "/usr/lib/a", "/tmp", "/tmp/x/y", "/etc"}) {
+			const std::uint64_t mask = merged.handled_access_fs() |
+						   next.handled_access_fs();
+			CHECK(((merged.effective_access(path) |
+				~merged.handled_access_fs()) &
+			       mask) == ((next.effective_access(path) |
+					  ~next.handled_access_fs()) &
+					 mask));
+		}
+	}
+}
+
+TEST_CASE("PolicyReloader::widening fails")
+{
+	FakeBackend backend{3};
+	PolicyReloader reloader{base_policy(), backend};
+	std::error_code ec;
+
+	SECTION("new rule")
+	{
+		Policy next = base_policy();
+		next.allow("/etc", action::FS_READ_FILE);
+		CHECK_FALSE(reloader.narrower(next));
+		reloader.reload(next, ec);
+	}
+
+	SECTION("access no longer handled")
+	{
+		Policy next;
+		next.handle(action::FS_READ_FILE)
+			.allow("/usr", action::FS_READ_FILE)
+			.allow("/tmp", action::FS_READ_FILE);
+		CHECK_FALSE(reloader.narrower(next));
+		reloader.reload(next, ec);
+	}
+
+	CHECK(ec == std::errc::operation_not_permitted);
+	CHECK(*reloader.enforced() == base_policy());
+	CHECK(reloader.layer_count() == 0);
+	CHECK(backend.call_count(FakeBackend::Call::CREATE_RULESET) == 0);
+}
+
+#ifndef LLPP_NO_EXCEPTIONS
+TEST_CASE("PolicyReloader::throwing API")
+{
+	FakeBackend backend{3};
+	PolicyReloader reloader{base_policy(), backend};
+
+	Policy next = base_policy();
+	next.allow("/", action::FS_WRITE_FILE);
+	REQUIRE_THROWS_AS(reloader.reload(next), std::system_error);
+}
+#endif
@@ -0,0 +1,353 @@
+#include "ll/PolicyTemplate.hpp"
+#include "ll/ActionType.hpp"
+#include "ll/Backend.hpp"
+#include "ll/FakeBackend.hpp"
+#include "ll/Policy.hpp"
+#include "ll/config.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "ForkedTest.hpp"
+#include "TempDir.hpp"
+#include "test.hpp"
+
+using landlock::FakeBackend;
+using landlock::Policy;
+using landlock::PolicyTemplate;
+namespace action = landlock::action;
+namespace fs = std::filesystem;
+
+namespace
+{
+constexpr std::uint16_t DNS_PORT = 53;
+constexpr std::uint16_t TENANT_PORT = 8080;
+
+/**
+ * Temporary directory with a shared and two tenant directories
+ */
+class TenantDir : public TempDir
+{
+public:
+	TenantDir() : TempDir{"template", {"shared", "tenant1", "tenant2"}}
+	{
+		for (const char* sub : {"shared", "tenant1", "tenant2"}) {
+			std::ofstream{path(sub) / "file"} << "x";
+		}
+	}
+};
+
+Policy base_policy(const fs::path& shared)
+{
+	Policy policy;
+	policy.handle(action::FS_READ_FILE | action::FS_WRITE_FILE |
+		      action::FS_READ_DIR)
+		.allow(shared, action::FS_READ_FILE | action::FS_READ_DIR);
+#if LLPP_BUILD_LANDLOCK_API >= 4
+	policy.handle(action::NET_BIND_TCP | action::NET_CONNECT_TCP)
+		.allow(DNS_PORT, action::NET_CONNECT_TCP);
+#endif
+	return policy;
+}
+
+/**
+ * Get the sorted access masks of the path beneath rules of a ruleset
+ */
+std::vector<std::uint64_t>
+path_access(const FakeBackend& backend, const landlock::Ruleset& ruleset)
+{
+	std::vector<std::uint64_t> res;
+	const auto recorded = backend.ruleset(ruleset.fd());
+	for (const auto& rule : recorded->path_beneath_rules) {
+		res.push_back(rule.allowed_access);
+	}
+	std::sort(res.begin(), res.end());
+	return res;
+}
+
+/**
+ * Open the file of a tenant, returning the error number or 0
+ */
+int open_file(const fs::path& dir, const char* tenant)
+{
+	const fs::path file = dir / tenant / "file";
+	const int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+	const int err = fd < 0 ? errno : 0;
+	if (fd >= 0) {
+		::close(fd);
+	}
+	return err;
+}
+
+/**
+ * Check that an instance only allows the shared and its tenant's files
+ */
+void tenant_scenario(forked::Child& child)
+{
+	const fs::path shared = child.dir() / "shared";
+	fs::create_directories(shared);
+	for (const char* tenant : {"tenant1", "tenant2"}) {
+		const fs::path dir = child.dir() / tenant;
+		fs::create_directories(dir);
+		std::ofstream{dir / "file"} << "x";
+	}
+
+	Policy policy;
+	policy.handle(action::FS_READ_FILE).allow(shared, action::FS_READ_FILE);
+	PolicyTemplate tmpl{policy};
+	tmpl.path_param(action::FS_READ_FILE);
+	std::error_code ec;
+	tmpl.prepare(landlock::Backend::system(), ec);
+	FORKED_CHECK(child, not ec);
+	const auto ruleset =
+		tmpl.instantiate({{child.dir() / "tenant1"}, {}}, ec);
+	FORKED_CHECK(child, not ec);
+	if (ec || not ruleset->active()) {
+		child.skip("Landlock is not supported");
+	}
+	ruleset->enforce(true, ec);
+	FORKED_CHECK(child, not ec);
+
+	FORKED_CHECK(child, open_file(child.dir(), "tenant1") == 0);
+	FORKED_CHECK(child, open_file(child.dir(), "tenant2") == EACCES);
+}
+} // namespace
+
+TEST_CASE("PolicyTemplate::instantiate")
+{
+	const TenantDir dir;
+	FakeBackend backend{7};
+	std::error_code ec;
+
+	PolicyTemplate tmpl{base_policy(dir.path("shared"))};
+	CHECK(tmpl.path_param(action::FS_READ_FILE | action::FS_WRITE_FILE) ==
+	      0);
+#if LLPP_BUILD_LANDLOCK_API >= 4
+	CHECK(tmpl.port_param(action::NET_BIND_TCP) == 0);
+	const std::vector<std::uint16_t> ports{TENANT_PORT};
+#else
+	const std::vector<std::uint16_t> ports;
+#endif
+	CHECK_FALSE(tmpl.prepared());
+	tmpl.prepare(backend, ec);
+	REQUIRE_FALSE(ec);
+	CHECK(tmpl.prepared());
+	CHECK(backend.call_count(FakeBackend::Call::CREATE_RULESET) == 1);
+
+	// The same policy built the usual way
+	Policy tenant_policy = base_policy(dir.path("shared"));
+	tenant_policy.allow(
+		dir.path("tenant1"),
+		action::FS_READ_FILE | action::FS_WRITE_FILE
+	);
+#if LLPP_BUILD_LANDLOCK_API >= 4
+	tenant_policy.allow(TENANT_PORT, action::NET_BIND_TCP);
+#endif
+	const auto expected = tenant_policy.build(backend, ec);
+	REQUIRE_FALSE(ec);
+	const std::size_t creates =
+		backend.call_count(FakeBackend::Call::CREATE_RULESET);
+	// Rules added by the build above, the same as for each instance
+	const std::size_t rules =
+		backend.call_count(FakeBackend::Call::ADD_RULE);
+
+	SECTION("path")
+	{
+		const auto ruleset =
+			tmpl.instantiate({{dir.path("tenant1")}, ports}, ec);
+		REQUIRE_FALSE(ec);
+		REQUIRE(ruleset);
+		CHECK(ruleset->active());
+		CHECK(ruleset->abi_version() == 7);
+		CHECK(ruleset->handled_access_fs() ==
+		      expected->handled_access_fs());
+		CHECK(ruleset->handled_access_net() ==
+		      expected->handled_access_net());
+
+		// One call to create the ruleset and one per rule
+		CHECK(backend.call_count(FakeBackend::Call::CREATE_RULESET) ==
+		      creates + 1);
+		CHECK(backend.call_count(FakeBackend::Call::ADD_RULE) ==
+		      2 * rules);
+		CHECK(path_access(backend, *ruleset) ==
+		      path_access(backend, *expected));
+		CHECK(backend.ruleset(ruleset->fd())->net_port_rules.size() ==
+		      backend.ruleset(expected->fd())->net_port_rules.size());
+	}
+
+	SECTION("file descriptor")
+	{
+		const int fd = ::open(
+			(dir.path("tenant2")).c_str(), O_PATH | O_CLOEXEC
+		);
+		REQUIRE(fd >= 0);
+		const auto ruleset = tmpl.instantiate({{fd}, ports}, ec);
+		REQUIRE_FALSE(ec);
+		CHECK(path_access(backend, *ruleset) ==
+		      path_access(backend, *expected));
+		const auto recorded = backend.ruleset(ruleset->fd());
+		const auto& added = recorded->path_beneath_rules;
+		const auto is_fd = [fd](const auto& rule) {
+			return rule.parent_fd == fd;
+		};
+		CHECK(std::any_of(added.begin(), added.end(), is_fd));
+		// The caller keeps ownership
+		CHECK(::close(fd) == 0);
+	}
+
+	SECTION("many tenants")
+	{
+		constexpr std::size_t TENANTS = 50;
+		std::vector<std::unique_ptr<landlock::Ruleset>> rulesets;
+		for (std::size_t i = 0; i < TENANTS; ++i) {
+			const fs::path path =
+				dir.path(i % 2 == 0 ? "tenant1" : "tenant2");
+			auto ruleset = tmpl.instantiate({{path}, ports}, ec);
+			REQUIRE_FALSE(ec);
+			rulesets.push_back(std::move(ruleset));
+		}
+		CHECK(backend.call_count(FakeBackend::Call::CREATE_RULESET) ==
+		      creates + TENANTS);
+		CHECK(backend.call_count(FakeBackend::Call::ADD_RULE) ==
+		      (TENANTS + 1) * rules);
+	}
+}
+
+TEST_CASE("PolicyTemplate::files")
+{
+	const TenantDir dir;
+	FakeBackend backend{7};
+	std::error_code ec;
+
+	// Directory access is dropped for files, which the kernel rejects
+	Policy base = base_policy(dir.path("shared"));
+	base.allow(
+		dir.path("shared/file"),
+		action::FS_READ_FILE | action::FS_READ_DIR
+	);
+	PolicyTemplate tmpl{base};
+	tmpl.path_param(action::FS_WRITE_FILE | action::FS_READ_DIR);
+	tmpl.path_param(action::FS_READ_DIR);
+#if LLPP_BUILD_LANDLOCK_API >= 4
+	const std::vector<std::uint16_t> ports{TENANT_PORT};
+	tmpl.port_param(action::NET_BIND_TCP);
+#else
+	const std::vector<std::uint16_t> ports;
+#endif
+	tmpl.prepare(backend, ec);
+	REQUIRE_FALSE(ec);
+
+	const auto ruleset = tmpl.instantiate(
+		{{dir.path("tenant1/file"), dir.path("tenant2/file")},
+		 ports},
+		ec
+	);
+	REQUIRE_FALSE(ec);
+	REQUIRE(ruleset);
+	const std::uint64_t read =
+		(action::FS_READ_FILE | action::FS_READ_DIR).type_code();
+	std::vector<std::uint64_t> expected{
+		action::FS_WRITE_FILE.type_code(),
+		action::FS_READ_FILE.type_code(),
+		read,
+	};
+	std::sort(expected.begin(), expected.end());
+	CHECK(path_access(backend, *ruleset) == expected);
+}
+
+TEST_CASE("PolicyTemplate::unsupported kernel")
+{
+	const TenantDir dir;
+	FakeBackend backend{0};
+	std::error_code ec;
+
+	PolicyTemplate tmpl{base_policy(dir.path("shared"))};
+	tmpl.path_param(action::FS_READ_FILE);
+	tmpl.prepare(backend, ec);
+	REQUIRE_FALSE(ec);
+
+	// Paths are not opened, since the rules cannot take effect
+	const auto ruleset = tmpl.instantiate({{dir.path("missing")}, {}}, ec);
+	REQUIRE_FALSE(ec);
+	CHECK_FALSE(ruleset->active());
+	CHECK_FALSE(ruleset->landlock_enabled());
+	ruleset->enforce(true, ec);
+	CHECK_FALSE(ec);
+	CHECK(backend.no_new_privs());
+	CHECK(backend.call_count(FakeBackend::Call::ADD_RULE) == 0);
+}
+
+TEST_CASE("PolicyTemplate::errors")
+{
+	const TenantDir dir;
+	FakeBackend backend{7};
+	std::error_code ec;
+
+	PolicyTemplate tmpl{base_policy(dir.path("shared"))};
+	tmpl.path_param(action::FS_READ_FILE);
+
+	SECTION("not prepared")
+	{
+		CHECK_FALSE(tmpl.instantiate({{dir.path()}, {}}, ec));
+		CHECK(ec == std::errc::invalid_argument);
+	}
+
+	SECTION("nothing handled")
+	{
+		PolicyTemplate empty{Policy{}};
+		empty.prepare(backend, ec);
+		CHECK(ec == std::errc::invalid_argument);
+		CHECK_FALSE(empty.prepared());
+#ifndef LLPP_NO_EXCEPTIONS
+		CHECK_THROWS_AS(empty.prepare(backend), std::system_error);
+#endif
+	}
+
+	SECTION("missing fixed path")
+	{
+		PolicyTemplate missing{base_policy(dir.path("missing"))};
+		missing.prepare(backend, ec);
+		CHECK(ec == std::errc::no_such_file_or_directory);
+		CHECK_FALSE(missing.prepared());
+	}
+
+	SECTION("prepared")
+	{
+		tmpl.prepare(backend, ec);
+		REQUIRE_FALSE(ec);
+
+		CHECK_FALSE(tmpl.instantiate({{}, {}}, ec));
+		CHECK(ec == std::errc::invalid_argument);
+
+		CHECK_FALSE(tmpl.instantiate({{dir.path("missing")}, {}}, ec));
+		CHECK(ec == std::errc::no_such_file_or_directory);
+
+		CHECK_FALSE(tmpl.instantiate({{-1}, {}}, ec));
+		CHECK(ec == std::errc::bad_file_descriptor);
+
+		backend.inject_error(FakeBackend::Call::ADD_RULE, ENOMEM);
+		CHECK_FALSE(tmpl.instantiate({{dir.path()}, {}}, ec));
+		CHECK(ec == std::errc::not_enough_memory);
+
+		backend.inject_error(FakeBackend::Call::CREATE_RULESET, EMFILE);
+		CHECK_FALSE(tmpl.instantiate({{dir.path()}, {}}, ec));
+		CHECK(ec == std::errc::too_many_files_open);
+#ifndef LLPP_NO_EXCEPTIONS
+		CHECK_THROWS_AS(tmpl.instantiate({{}, {}}), std::system_error);
+#endif
+	}
+}
+
+TEST_CASE("PolicyTemplate::enforcement")
+{
+	forked::check({{"tenant root", tenant_scenario}});
+}
@@ -0,0 +1,289 @@
+#include "ll/Policy.hpp"
+#include "ll/ActionType.hpp"
+#include "ll/FakeBackend.hpp"
+#include "ll/Scope.hpp"
+#include "ll/config.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "TempDir.hpp"
+#include "test.hpp"
+
+using landlock::FakeBackend;
+using landlock::MergeReport;
+using landlock::Policy;
+namespace action = landlock::action;
+
+namespace
+{
+constexpr std::array<std::string_view, 8> QUERY_PATHS{
+	"/",
+	"/etc/passwd",
+	"/tmp",
+	"/tmp/x/y",
+	"/usr",
+	"/usr/lib/libc.so",
+	"/usr/libexec",
+	"/var/log",
+};
+
+/**
+ * Run the program at path with args and return its exit status, or -1
+ */
+int run(const char* path, const std::vector<std::string>& args)
+{
+	std::vector<char*> argv{const_cast<char*>(path)}; // NOLINT
+	for (const std::string& arg : args) {
+		argv.push_back(const_cast<char*>(arg.c_str())); // NOLINT
+	}
+	argv.push_back(nullptr);
+
+	const pid_t pid = ::fork();
+	if (pid == 0) {
+		// NOLINTNEXTLINE(*-vararg)
+		const int null = ::open("/dev/null", O_WRONLY | O_CLOEXEC);
+		::dup2(null, STDOUT_FILENO);
+		::dup2(null, STDERR_FILENO);
+		::execv(path, argv.data());
+		::_exit(EXIT_FAILURE);
+	}
+	int status = 0;
+	if (pid < 0 || ::waitpid(pid, &status, 0) != pid ||
+	    not WIFEXITED(status)) {
+		return -1;
+	}
+	return WEXITSTATUS(status);
+}
+
+/**
+ * Access allowed by a policy, including unhandled access
+ */
+std::uint64_t allowed(const Policy& policy, std::string_view path)
+{
+	return policy.effective_access(path) | ~policy.handled_access_fs();
+}
+} // namespace
+
+TEST_CASE("Policy::rules")
+{
+	Policy policy;
+	policy.handle(action::FS_READ_FILE)
+		.allow("/usr/./lib/", action::FS_READ_FILE)
+		.allow("/usr/lib", action::FS_EXECUTE);
+
+	REQUIRE(policy.path_rules().size() == 1);
+	CHECK(policy.path_rules().begin()->first == "/usr/lib");
+	CHECK(policy.effective_access("/usr/lib/x") ==
+	      action::FS_READ_FILE.type_code());
+	CHECK(policy.effective_access("/usr/libexec") == 0);
+	CHECK(policy.effective_access("/usr") == 0);
+}
+
+TEST_CASE("Policy::merge")
+{
+	Policy lhs;
+	lhs.handle(action::FS_READ_FILE)
+		.handle(action::FS_WRITE_FILE)
+		.allow("/usr", action::FS_READ_FILE)
+		.allow("/tmp", action::FS_READ_FILE | action::FS_WRITE_FILE);
+	Policy rhs;
+	rhs.handle(action::FS_READ_FILE)
+		.restrict(landlock::scope::SIGNAL)
+		.allow("/usr/lib", action::FS_READ_FILE)
+		.allow("/tmp", action::FS_READ_FILE)
+		.allow("/var", action::FS_READ_FILE);
+
+	SECTION("intersection")
+	{
+		MergeReport report;
+		const Policy merged = Policy::intersect(lhs, rhs, report);
+
+		CHECK(merged == (lhs & rhs));
+		CHECK(merged.handled_access_fs() ==
+		      (lhs.handled_access_fs() | rhs.handled_access_fs()));
+		CHECK(merged.scoped() == landlock::scope::SIGNAL.type_code());
+		for (const std::string_view path : QUERY_PATHS) {
+			INFO(path);
+			CHECK(allowed(merged, path) ==
+			      (allowed(lhs, path) & allowed(rhs, path)));
+		}
+
+		// /usr is only readable in lhs, /var only in rhs
+		CHECK(merged.path_rules().count("/usr") == 0);
+		CHECK(merged.path_rules().count("/var") == 0);
+		CHECK(report.input_rules == 5);
+		CHECK(report.merged_rules == 2);
+		CHECK_FALSE(report.paths.empty());
+	}
+
+	SECTION("union")
+	{
+		MergeReport report;
+		const Policy merged = Policy::unite(lhs, rhs, report);
+
+		CHECK(merged == (lhs | rhs));
+		CHECK(merged.handled_access_fs() ==
+		      action::FS_READ_FILE.type_code());
+		CHECK(merged.scoped() == 0);
+		for (const std::string_view path : QUERY_PATHS) {
+			INFO(path);
+			CHECK((allowed(merged, path) &
+			       merged.handled_access_fs()) ==
+			      ((allowed(lhs, path) | allowed(rhs, path)) &
+			       merged.handled_access_fs()));
+		}
+
+		// /usr/lib is covered by /usr
+		CHECK(merged.path_rules().count("/usr/lib") == 0);
+	}
+
+	SECTION("idempotence")
+	{
+		CHECK((lhs & lhs) == lhs);
+		CHECK((lhs | lhs) == lhs);
+	}
+}
+
+TEST_CASE("Policy::ports")
+{
+	Policy lhs;
+	lhs.handle(action::NET_BIND_TCP)
+		.allow(80, action::NET_BIND_TCP)
+		.allow(443, action::NET_BIND_TCP);
+	Policy rhs;
+	rhs.handle(action::NET_BIND_TCP).allow(443, action::NET_BIND_TCP);
+
+	const Policy merged = lhs & rhs;
+	CHECK(merged.effective_access(std::uint16_t{443}) ==
+	      action::NET_BIND_TCP.type_code());
+	CHECK(merged.effective_access(std::uint16_t{80}) == 0);
+}
+
+TEST_CASE("Policy::build")
+{
+	FakeBackend backend{7};
+	std::error_code ec;
+
+	Policy policy;
+	policy.handle(action::FS_READ_FILE)
+		.handle(action::FS_READ_DIR)
+		.allow("/proc", action::FS_READ_FILE)
+		.allow("/usr", action::FS_READ_FILE)
+		.allow("/", action::FS_READ_DIR);
+
+	const auto ruleset = policy.build(backend, ec);
+	REQUIRE_FALSE(ec);
+	REQUIRE(ruleset);
+	CHECK(ruleset->rules().size() == 2);
+
+	const auto fake_ruleset = backend.ruleset(ruleset->fd());
+	REQUIRE(fake_ruleset.has_value());
+	CHECK(fake_ruleset->handled_access_fs ==
+	      (action::FS_READ_FILE | action::FS_READ_DIR).type_code());
+	CHECK(fake_ruleset->path_beneath_rules.size() == 3);
+
+	SECTION("files")
+	{
+		// The kernel rejects directory access on other files, so it is
+		// dropped
+		const auto read = action::FS_READ_FILE | action::FS_READ_DIR;
+		policy.allow("/bin/sh", read)
+			.allow("/etc/passwd", action::FS_READ_DIR);
+		const auto files = policy.build(backend, ec);
+		REQUIRE_FALSE(ec);
+		const auto recorded = backend.ruleset(files->fd());
+		REQUIRE(recorded.has_value());
+		CHECK(recorded->path_beneath_rules.size() == 4);
+		CHECK(std::count_if(
+			      recorded->path_beneath_rules.begin(),
+			      recorded->path_beneath_rules.end(),
+			      [](const FakeBackend::PathBeneath& rule) {
+				      return rule.allowed_access ==
+					     action::FS_READ_FILE.type_code();
+			      }
+		      ) == 3);
+	}
+
+	SECTION("empty policy")
+	{
+		CHECK(Policy{}.build(backend, ec) == nullptr);
+		CHECK(ec == std::errc::invalid_argument);
+	}
+
+	SECTION("unsupported kernel")
+	{
+		// Paths are not opened, so missing ones do not fail either
+		policy.allow("/nonexistent", action::FS_READ_FILE);
+		FakeBackend unsupported{0};
+		const auto noop = policy.build(unsupported, ec);
+		REQUIRE_FALSE(ec);
+		REQUIRE(noop);
+		CHECK_FALSE(noop->active());
+		CHECK(noop->rules().empty());
+		CHECK(noop->skipped_rules() == 2);
+	}
+
+	SECTION("unsupported handled access")
+	{
+		// FS_REFER requires ABI 2
+		Policy refer_policy;
+		refer_policy.handle(action::FS_REFER)
+			.allow("/nonexistent", action::FS_REFER);
+		FakeBackend old_kernel{1};
+		const auto noop = refer_policy.build(old_kernel, ec);
+		REQUIRE_FALSE(ec);
+		REQUIRE(noop);
+		CHECK_FALSE(noop->active());
+		using Call = FakeBackend::Call;
+		CHECK(old_kernel.call_count(Call::CREATE_RULESET) == 1);
+	}
+}
+
+// Needs llpp-run, which the tools build passes in LLPP_RUN
+TEST_CASE("Policy::llpp-run with files", "[.run]")
+{
+	const char* llpp_run = std::getenv("LLPP_RUN");
+	if (llpp_run == nullptr) {
+		WARN("LLPP_RUN is not set, skipping");
+		return;
+	}
+	if (landlock::Backend::system().create_ruleset(
+		    nullptr, 0, LANDLOCK_CREATE_RULESET_VERSION
+	    ) < 0) {
+		WARN("Landlock is not supported, skipping");
+		return;
+	}
+
+	const TempDir dir{"run"};
+	std::ofstream{dir.path("allowed")} << "x";
+	std::ofstream{dir.path("denied")} << "x";
+
+	// Single files are allowed next to the directories cat needs
+	std::vector<std::string> args{"-e", "-r", dir.path("allowed")};
+	for (const char* path :
+	     {"/usr", "/bin", "/lib", "/lib64", "/etc/ld.so.cache"}) {
+		if (std::filesystem::exists(path)) {
+			args.insert(args.end(), {"-r", path});
+		}
+	}
+	args.insert(args.end(), {"--", "cat"});
+
+	std::vector<std::string> allowed = args;
+	allowed.push_back(dir.path("allowed"));
+	CHECK(run(llpp_run, allowed) == 0);
+
+	std::vector<std::string> denied = args;
+	denied.push_back(dir.path("denied"));
+	CHECK(run(llpp_run, denied) == 1);
+}
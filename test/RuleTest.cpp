@@ -20,7 +20,9 @@ TEST_CASE("Rule::PathBeneathRule")
 		.add_action(action::FS_REFER)
 		.add_action(action::FS_TRUNCATE)
 		.add_action(action::FS_IOCTL_DEV);
-	pb_rule.add_path("/bin/sh");
+	std::error_code ec;
+	pb_rule.add_path("/bin", ec);
+	REQUIRE_FALSE(ec);
 	np_rule.add_action(action::NET_BIND_TCP);
 	np_rule.add_port(42); // NOLINT(*-magic-numbers)
 
@@ -97,6 +99,28 @@ TEST_CASE("Rule::PathBeneathRule")
 #endif
 	}
 
+	SECTION("file")
+	{
+		// Directory access is dropped for files
+		PathBeneathRule file_rule;
+		file_rule.add_action(action::FS_EXECUTE)
+			.add_action(action::FS_READ_DIR)
+			.add_action(action::FS_MAKE_DIR);
+		file_rule.add_path("/bin/sh", ec);
+		REQUIRE_FALSE(ec);
+		const PathBeneathRule::AttrVec pb_rules = file_rule.generate(1);
+		REQUIRE(pb_rules.size() == 1);
+		CHECK(pb_rules.at(0).allowed_access ==
+		      action::FS_EXECUTE.type_code());
+
+		// Nothing is left if only directory access is allowed
+		PathBeneathRule dir_only;
+		dir_only.add_action(action::FS_READ_DIR);
+		dir_only.add_path("/bin/sh", ec);
+		REQUIRE_FALSE(ec);
+		CHECK(dir_only.generate(1).empty());
+	}
+
 	SECTION("invalid ABI")
 	{
 		const PathBeneathRule::AttrVec pb_rules = pb_rule.generate(0);
@@ -145,3 +169,21 @@ TEST_CASE("Rule::NetPortRule")
 	}
 #endif
 }
+
+TEST_CASE("Rule::PathBeneathRule::add_path errors")
+{
+	PathBeneathRule rule;
+	std::error_code ec;
+
+	rule.add_path("/nonexistent/landlockpp/path", ec);
+	CHECK(ec == std::errc::no_such_file_or_directory);
+
+	rule.add_path("/", ec);
+	CHECK_FALSE(ec);
+
+#ifndef LLPP_NO_EXCEPTIONS
+	CHECK_THROWS_AS(
+		rule.add_path("/nonexistent/landlockpp/path"), std::system_error
+	);
+#endif
+}
@@ -0,0 +1,232 @@
+#include "ll/RulesetBroker.hpp"
+#include "ll/ActionType.hpp"
+#include "ll/Backend.hpp"
+#include "ll/FakeBackend.hpp"
+#include "ll/Rule.hpp"
+#include "ll/Ruleset.hpp"
+
+#include <array>
+#include <cerrno>
+#include <filesystem>
+#include <system_error>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "TempDir.hpp"
+#include "test.hpp"
+
+using landlock::Backend;
+using landlock::FakeBackend;
+using landlock::Ruleset;
+using landlock::RulesetBroker;
+using landlock::RulesetClient;
+
+namespace
+{
+constexpr int EXIT_SKIP = 77;
+
+/**
+ * Fetch the ruleset in a child process and check it is enforced
+ */
+int enforcing_child(const std::filesystem::path& path)
+{
+	std::error_code ec;
+	const auto ruleset = RulesetClient::fetch(path, Backend::system(), ec);
+	if (ec) {
+		return 1;
+	}
+	if (not ruleset->landlock_enabled()) {
+		return EXIT_SKIP;
+	}
+	ruleset->enforce(true, ec);
+	if (ec) {
+		return 2;
+	}
+	if (::open("/etc/hostname", O_RDONLY | O_CLOEXEC) >= 0 ||
+	    errno != EACCES) {
+		return 3;
+	}
+	return 0;
+}
+} // namespace
+
+TEST_CASE("RulesetBroker::fetch")
+{
+	std::error_code ec;
+	const Ruleset ruleset{{landlock::action::FS_READ_FILE}, {}, {}, ec};
+	REQUIRE_FALSE(ec);
+
+	const TempDir dir{"broker"};
+	const std::filesystem::path path = dir.path("socket");
+	RulesetBroker broker{ruleset, path, ec};
+	REQUIRE_FALSE(ec);
+	CHECK(std::filesystem::exists(path));
+
+	std::error_code run_ec;
+	std::thread server{[&broker, &run_ec] { broker.run(run_ec); }};
+
+	for (int i = 0; i < 2; ++i) {
+		const auto received =
+			RulesetClient::fetch(path, Backend::system(), ec);
+		REQUIRE_FALSE(ec);
+		REQUIRE(received != nullptr);
+		CHECK(received->abi_version() == ruleset.abi_version());
+		CHECK(received->handled_access_fs() ==
+		      ruleset.handled_access_fs());
+		CHECK(received->landlock_enabled() == ruleset.landlock_enabled()
+		);
+		if (ruleset.landlock_enabled()) {
+			CHECK(received->fd() >= 0);
+			CHECK(received->fd() != ruleset.fd());
+		}
+	}
+
+	const pid_t pid = ::fork();
+	REQUIRE(pid >= 0);
+	if (pid == 0) {
+		::_exit(enforcing_child(path));
+	}
+	int status = 0;
+	REQUIRE(::waitpid(pid, &status, 0) == pid);
+
+	broker.stop();
+	server.join();
+	CHECK_FALSE(run_ec);
+	CHECK(broker.served() == 3);
+
+	REQUIRE(WIFEXITED(status));
+	if (WEXITSTATUS(status) == EXIT_SKIP) {
+		WARN("Landlock not supported, enforcement not checked");
+	} else {
+		CHECK(WEXITSTATUS(status) == 0);
+	}
+}
+
+TEST_CASE("RulesetBroker::isolated clients")
+{
+	std::error_code ec;
+	const Ruleset ruleset{{landlock::action::FS_READ_FILE}, {}, {}, ec};
+	REQUIRE_FALSE(ec);
+	if (not ruleset.landlock_enabled()) {
+		WARN("Landlock not supported, isolation not checked");
+		return;
+	}
+
+	const TempDir dir{"broker"};
+	const std::filesystem::path path = dir.path("socket");
+	RulesetBroker broker{ruleset, path, ec};
+	REQUIRE_FALSE(ec);
+	std::error_code run_ec;
+	std::thread server{[&broker, &run_ec] { broker.run(run_ec); }};
+
+	// A client widens the ruleset it received
+	const auto first = RulesetClient::fetch(path, Backend::system(), ec);
+	REQUIRE_FALSE(ec);
+	const int etc_fd = ::open("/etc", O_PATH | O_CLOEXEC);
+	REQUIRE(etc_fd >= 0);
+	landlock_path_beneath_attr attr{};
+	attr.allowed_access = LANDLOCK_ACCESS_FS_READ_FILE;
+	attr.parent_fd = etc_fd;
+	CHECK(Backend::system().add_rule(
+		      first->fd(), LANDLOCK_RULE_PATH_BENEATH, &attr, 0
+	      ) == 0);
+	::close(etc_fd);
+
+	// Another client must not be affected
+	const pid_t pid = ::fork();
+	REQUIRE(pid >= 0);
+	if (pid == 0) {
+		::_exit(enforcing_child(path));
+	}
+	int status = 0;
+	REQUIRE(::waitpid(pid, &status, 0) == pid);
+
+	broker.stop();
+	server.join();
+	CHECK_FALSE(run_ec);
+	REQUIRE(WIFEXITED(status));
+	CHECK(WEXITSTATUS(status) == 0);
+}
+
+TEST_CASE("RulesetBroker::inherited socket")
+{
+	std::error_code ec;
+	const Ruleset ruleset{{landlock::action::FS_READ_FILE}, {}, {}, ec};
+	REQUIRE_FALSE(ec);
+	const TempDir dir{"broker"};
+	const RulesetBroker broker{ruleset, dir.path("socket"), ec};
+	REQUIRE_FALSE(ec);
+
+	std::array<int, 2> socks{};
+	REQUIRE(::socketpair(
+			AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, socks.data()
+		) == 0);
+
+	SECTION("ruleset")
+	{
+		broker.send(socks[0], ec);
+		REQUIRE_FALSE(ec);
+		const auto received =
+			RulesetClient::receive(socks[1], Backend::system(), ec);
+		REQUIRE_FALSE(ec);
+		CHECK(received->handled_access_fs() ==
+		      ruleset.handled_access_fs());
+		CHECK(broker.served() == 1);
+	}
+
+	SECTION("malformed message")
+	{
+		constexpr std::array<char, 3> GARBAGE{'a', 'b', 'c'};
+		REQUIRE(::send(socks[0], GARBAGE.data(), GARBAGE.size(), 0) ==
+			static_cast<ssize_t>(GARBAGE.size()));
+		const auto received =
+			RulesetClient::receive(socks[1], Backend::system(), ec);
+		CHECK(ec == std::errc::bad_message);
+		CHECK(received == nullptr);
+	}
+
+	::close(socks[0]);
+	::close(socks[1]);
+}
+
+TEST_CASE("RulesetBroker::errors")
+{
+	std::error_code ec;
+	const Ruleset ruleset{{landlock::action::FS_READ_FILE}, {}, {}, ec};
+	REQUIRE_FALSE(ec);
+
+	const TempDir dir{"broker"};
+	const std::filesystem::path missing = dir.path("missing");
+	CHECK(RulesetClient::fetch(missing, Backend::system(), ec) == nullptr);
+	CHECK(ec == std::errc::no_such_file_or_directory);
+
+	const std::filesystem::path path = dir.path("socket");
+	const RulesetBroker broker{ruleset, path, ec};
+	REQUIRE_FALSE(ec);
+	const RulesetBroker duplicate{ruleset, path, ec};
+	CHECK(ec == std::errc::address_in_use);
+	CHECK(duplicate.fd() < 0);
+
+#ifndef LLPP_NO_EXCEPTIONS
+	REQUIRE_THROWS_AS(RulesetClient::fetch(missing), std::system_error);
+#endif
+
+	// Without the rules, no copy can be handed out
+	FakeBackend backend{7};
+	landlock_ruleset_attr attr{};
+	attr.handled_access_fs = LANDLOCK_ACCESS_FS_READ_FILE;
+	const int fd = backend.create_ruleset(&attr, sizeof(attr), 0);
+	REQUIRE(fd >= 0);
+	const auto adopted = Ruleset::adopt(
+		fd, 7, LANDLOCK_ACCESS_FS_READ_FILE, 0, 0, backend
+	);
+	const RulesetBroker unknown{
+		*adopted, dir.path("adopted"), ec
+	};
+	CHECK(ec == std::errc::not_supported);
+	CHECK(unknown.fd() < 0);
+}
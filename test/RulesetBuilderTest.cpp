@@ -0,0 +1,85 @@
+#include "ll/RulesetBuilder.hpp"
+#include "ll/ActionType.hpp"
+#include "ll/FakeBackend.hpp"
+#include "ll/Rule.hpp"
+#include "ll/Ruleset.hpp"
+
+#include <cerrno>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "test.hpp"
+
+using landlock::FakeBackend;
+using landlock::Ruleset;
+using landlock::RulesetBuilder;
+namespace action = landlock::action;
+
+// NOLINTBEGIN(*-magic-numbers)
+
+TEST_CASE("RulesetBuilder::parallel rules")
+{
+	FakeBackend backend{7};
+	std::error_code ec;
+	Ruleset ruleset{backend, {action::FS_READ_FILE}, {}, {}, ec};
+	REQUIRE_FALSE(ec);
+
+	constexpr int THREADS = 8;
+	constexpr int RULES_PER_THREAD = 50;
+
+	RulesetBuilder builder{ruleset, 4};
+	std::vector<std::thread> threads;
+	threads.reserve(THREADS);
+	for (int t = 0; t < THREADS; ++t) {
+		threads.emplace_back([&builder]() {
+			for (int i = 0; i < RULES_PER_THREAD; ++i) {
+				std::error_code thread_ec;
+				landlock::PathBeneathRule rule;
+				rule.add_path("/", thread_ec)
+					.add_action(action::FS_READ_FILE);
+				builder.add_rule(std::move(rule));
+			}
+		});
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+
+	CHECK(builder.size() == THREADS * RULES_PER_THREAD);
+	CHECK(backend.call_count(FakeBackend::Call::ADD_RULE) == 0);
+
+	builder.commit(ec);
+	REQUIRE_FALSE(ec);
+	CHECK(builder.size() == 0);
+	CHECK(ruleset.rules().size() == THREADS * RULES_PER_THREAD);
+	CHECK(backend.ruleset(ruleset.fd())->path_beneath_rules.size() ==
+	      THREADS * RULES_PER_THREAD);
+}
+
+TEST_CASE("RulesetBuilder::failing commit")
+{
+	FakeBackend backend{7};
+	std::error_code ec;
+	Ruleset ruleset{backend, {action::FS_READ_FILE}, {}, {}, ec};
+	REQUIRE_FALSE(ec);
+
+	RulesetBuilder builder{ruleset, 1};
+	for (int i = 0; i < 3; ++i) {
+		landlock::PathBeneathRule rule;
+		rule.add_path("/", ec).add_action(action::FS_READ_FILE);
+		builder.add_rule(std::move(rule));
+	}
+
+	backend.inject_error(FakeBackend::Call::ADD_RULE, ENOMEM);
+	builder.commit(ec);
+	CHECK(ec == std::errc::not_enough_memory);
+	CHECK(builder.size() == 3);
+
+	builder.commit(ec);
+	CHECK_FALSE(ec);
+	CHECK(builder.size() == 0);
+	CHECK(ruleset.rules().size() == 3);
+}
+
+// NOLINTEND(*-magic-numbers)
@@ -1,31 +1,38 @@
 #include "ll/Ruleset.hpp"
 #include "ll/ActionType.hpp"
+#include "ll/FakeBackend.hpp"
+#include "ll/RestrictFlag.hpp"
 #include "ll/Rule.hpp"
 #include "ll/Scope.hpp"
 #include "ll/config.h"
 
 #include <cerrno>
+#include <chrono>
 #include <csignal>
-#include <cstdio>
-#include <cstring>
-#include <future>
-#include <iostream>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
 #include <memory>
 #include <stdexcept>
+#include <string>
 #include <system_error>
-#include <thread>
+#include <vector>
 
+#include <arpa/inet.h>
 #include <fcntl.h>
-#include <sys/epoll.h>
-#include <sys/eventfd.h>
-#include <sys/signal.h>
-#include <sys/signalfd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 #include <unistd.h>
 
+#include "ForkedTest.hpp"
 #include "test.hpp"
 
 using landlock::Ruleset;
 
+#ifndef LLPP_NO_EXCEPTIONS
 TEST_CASE("Ruleset::default init fails")
 {
 	std::unique_ptr<Ruleset> ruleset;
@@ -33,213 +40,551 @@ TEST_CASE("Ruleset::default init fails")
 		ruleset = std::make_unique<Ruleset>(), std::invalid_argument
 	);
 }
+#endif
 
-// NOLINTBEGIN(*-vararg)
-TEST_CASE("Ruleset::rules")
+TEST_CASE("Ruleset::error_code API")
 {
-	const std::filesystem::path allowed_test_path{"/proc"};
-	const std::filesystem::path disallowed_test_path{"/usr/bin"};
-	Ruleset ruleset{
-		{landlock::action::FS_READ_FILE,
-		 landlock::action::FS_READ_DIR,
-		 landlock::action::FS_WRITE_FILE,
-		 landlock::action::FS_TRUNCATE,
-		 landlock::action::FS_EXECUTE}
-	};
+	std::error_code ec;
 
+	SECTION("empty ruleset")
 	{
-		// Provoke that the rules might get deleted before enforce()
-		landlock::PathBeneathRule rule1;
-		rule1.add_path(allowed_test_path)
-			.add_action(landlock::action::FS_READ_FILE)
-			.add_action(landlock::action::FS_READ_DIR)
-			.add_action(landlock::action::FS_WRITE_FILE)
-			.add_action(landlock::action::FS_TRUNCATE);
-		landlock::PathBeneathRule rule2;
-		rule2.add_path(disallowed_test_path)
-			.add_action(landlock::action::FS_READ_DIR);
-		ruleset.add_rule(std::move(rule1)).add_rule(std::move(rule2));
+		const Ruleset ruleset{{}, {}, {}, ec};
+		CHECK(ec == std::errc::invalid_argument);
+		CHECK_FALSE(ruleset.landlock_enabled());
 	}
-	ruleset.enforce(true);
-
-	const int allowed_fd =
-		::open((allowed_test_path / "meminfo").c_str(), O_RDONLY);
-	CHECK(allowed_fd >= 0);
-	if (allowed_fd < 0) {
-		// NOLINTNEXTLINE(*-mt-unsafe)
-		std::clog << "errno: " << errno << " (" << strerror(errno)
-			  << ")\n";
+
+	SECTION("rules")
+	{
+		Ruleset ruleset{{landlock::action::FS_READ_FILE}, {}, {}, ec};
+		REQUIRE_FALSE(ec);
+
+		landlock::PathBeneathRule rule;
+		rule.add_path("/proc", ec).add_action(
+			landlock::action::FS_READ_FILE
+		);
+		REQUIRE_FALSE(ec);
+
+		ruleset.add_rule(std::move(rule), ec);
+		CHECK_FALSE(ec);
 	}
-	if (allowed_fd > 0) {
-		::close(allowed_fd);
+}
+
+TEST_CASE("Ruleset::inactive")
+{
+	using Call = landlock::FakeBackend::Call;
+	std::error_code ec;
+
+	// Either Landlock is unsupported or the only handled access is not
+	const int kernel_abi = GENERATE(0, 1);
+	landlock::FakeBackend backend{kernel_abi};
+	Ruleset ruleset{
+		backend,
+		{},
+		{landlock::action::NET_BIND_TCP},
+		{landlock::scope::SIGNAL},
+		ec
+	};
+	REQUIRE_FALSE(ec);
+	CHECK_FALSE(ruleset.active());
+	CHECK(ruleset.fd() == -1);
+	CHECK(ruleset.landlock_enabled() == (kernel_abi > 0));
+	// Only the ABI version was queried
+	CHECK(backend.call_count(Call::CREATE_RULESET) == 1);
+
+	landlock::PathBeneathRule rule = ruleset.path_beneath_rule();
+	rule.add_path("/nonexistent", ec).add_path("/proc", ec);
+	CHECK_FALSE(ec);
+	CHECK(rule.skipped_paths() == 2);
+	rule.add_action(landlock::action::FS_READ_FILE);
+	landlock::NetPortRule port_rule;
+	port_rule.add_port(443).add_action(landlock::action::NET_BIND_TCP);
+
+	ruleset.add_rule(std::move(rule), ec);
+	CHECK_FALSE(ec);
+	ruleset.add_rule(std::move(port_rule), ec);
+	CHECK_FALSE(ec);
+	CHECK(ruleset.rules().empty());
+	CHECK(ruleset.skipped_rules() == 2);
+	CHECK(backend.call_count(Call::ADD_RULE) == 0);
+
+	ruleset.enforce(true, ec);
+	CHECK_FALSE(ec);
+	CHECK(backend.no_new_privs());
+	CHECK(backend.call_count(Call::RESTRICT_SELF) == 0);
+}
+
+TEST_CASE("Ruleset::restrict flags")
+{
+	const int kernel_abi = GENERATE(6, 7);
+	landlock::FakeBackend backend{kernel_abi};
+	std::error_code ec;
+
+	const Ruleset ruleset{
+		backend, {landlock::action::FS_READ_FILE}, {}, {}, ec
+	};
+	REQUIRE_FALSE(ec);
+	ruleset.enforce(
+		true,
+		{landlock::restrict_flag::LOG_SAME_EXEC_OFF,
+		 landlock::restrict_flag::LOG_SUBDOMAINS_OFF},
+		ec
+	);
+	REQUIRE_FALSE(ec);
+
+	const auto layers = backend.layers();
+	REQUIRE(layers.size() == 1);
+	if (kernel_abi >= 7 && LLPP_BUILD_LANDLOCK_API >= 7) {
+		CHECK(layers.at(0).flags ==
+		      (landlock::restrict_flag::LOG_SAME_EXEC_OFF |
+		       landlock::restrict_flag::LOG_SUBDOMAINS_OFF)
+			      .type_code());
+	} else {
+		CHECK(layers.at(0).flags == 0);
 	}
+}
 
-	if (ruleset.landlock_enabled()) {
-		const int disallowed_fd =
-			::open((disallowed_test_path / "env").c_str(),
-			       O_RDONLY);
-		REQUIRE(disallowed_fd < 0);
-		CHECK(errno == EACCES);
-		if (disallowed_fd > 0) {
-			::close(disallowed_fd);
-		}
+// NOLINTBEGIN(*-vararg, *-magic-numbers)
+namespace
+{
+namespace fs = std::filesystem;
+using landlock::action::FsAction;
+
+/**
+ * Enforce ruleset in a scenario, skipping it if the kernel does not support
+ * min_abi
+ */
+void enforce(forked::Child& child, const Ruleset& ruleset, int min_abi)
+{
+	if (ruleset.effective_abi_version() < min_abi) {
+		child.skip(
+			"effective ABI version " +
+			std::to_string(ruleset.effective_abi_version()) +
+			" is too low, " + std::to_string(min_abi) + " required"
+		);
+	}
+	std::error_code ec;
+	ruleset.enforce(true, ec);
+	if (not FORKED_CHECK(child, not ec)) {
+		child.skip("cannot enforce: " + ec.message());
 	}
 }
 
-TEST_CASE("Ruleset::IPC scope")
+/**
+ * Return 0 if res indicates success, the error otherwise
+ */
+int error_of(int res)
 {
-	// NOLINTBEGIN(*-mt-unsafe, *-magic-numbers)
-	using namespace std::chrono_literals;
+	return res < 0 ? errno : 0;
+}
 
-	int res;
-	sigset_t sigs;
-	sigset_t original_sigs;
-	sigemptyset(&sigs);
-	sigaddset(&sigs, SIGUSR1);
+int open_and_close(const fs::path& path, int flags)
+{
+	const int fd = ::open(path.c_str(), flags | O_CLOEXEC);
+	if (fd < 0) {
+		return errno;
+	}
+	::close(fd);
+	return 0;
+}
 
-	const pid_t pid = getpid();
+void create_file(const fs::path& path)
+{
+	::close(::open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0600));
+}
 
-	int sigfd = -1;
-	int efd = -1;
-	int epfd = -1;
+/**
+ * Filesystem action probe
+ *
+ * The probe runs against an allowed and a denied directory, which setup
+ * prepared before enforcing a ruleset allowing action beneath the allowed
+ * one.
+ */
+struct FsProbe {
+	const char* name;
+	FsAction action;
+	int min_abi;
+	std::function<void(const fs::path&)> setup;
+	std::function<int(const fs::path&)> probe;
+	/// Error of the probe in the denied directory
+	int denied_error;
+};
+
+std::vector<FsProbe> fs_probes()
+{
+	using namespace landlock::action;
+	const auto no_setup = [](const fs::path& /*dir*/) {};
+	const auto file_setup = [](const fs::path& dir) {
+		create_file(dir / "file");
+	};
+	const auto dir_setup = [](const fs::path& dir) {
+		fs::create_directory(dir / "sub");
+	};
 
-	bool expect_eperm = false;
+	return {
+		{"read_file",
+		 FS_READ_FILE,
+		 1,
+		 file_setup,
+		 [](const fs::path& dir) {
+			 return open_and_close(dir / "file", O_RDONLY);
+		 },
+		 EACCES},
+		{"write_file",
+		 FS_WRITE_FILE,
+		 1,
+		 file_setup,
+		 [](const fs::path& dir) {
+			 return open_and_close(dir / "file", O_WRONLY);
+		 },
+		 EACCES},
+		{"read_dir",
+		 FS_READ_DIR,
+		 1,
+		 no_setup,
+		 [](const fs::path& dir) {
+			 return open_and_close(dir, O_RDONLY | O_DIRECTORY);
+		 },
+		 EACCES},
+		{"remove_file",
+		 FS_REMOVE_FILE,
+		 1,
+		 file_setup,
+		 [](const fs::path& dir) {
+			 return error_of(::unlink((dir / "file").c_str()));
+		 },
+		 EACCES},
+		{"remove_dir",
+		 FS_REMOVE_DIR,
+		 1,
+		 dir_setup,
+		 [](const fs::path& dir) {
+			 return error_of(::rmdir((dir / "sub").c_str()));
+		 },
+		 EACCES},
+		{"make_reg",
+		 FS_MAKE_REG,
+		 1,
+		 no_setup,
+		 [](const fs::path& dir) {
+			 return open_and_close(dir / "new", O_WRONLY | O_CREAT);
+		 },
+		 EACCES},
+		{"make_dir",
+		 FS_MAKE_DIR,
+		 1,
+		 no_setup,
+		 [](const fs::path& dir) {
+			 return error_of(::mkdir((dir / "new").c_str(), 0700));
+		 },
+		 EACCES},
+		{"make_sym",
+		 FS_MAKE_SYM,
+		 1,
+		 no_setup,
+		 [](const fs::path& dir) {
+			 return error_of(
+				 ::symlink("target", (dir / "link").c_str())
+			 );
+		 },
+		 EACCES},
+		{"make_fifo",
+		 FS_MAKE_FIFO,
+		 1,
+		 no_setup,
+		 [](const fs::path& dir) {
+			 return error_of(
+				 ::mkfifo((dir / "fifo").c_str(), 0600)
+			 );
+		 },
+		 EACCES},
+		{"make_sock",
+		 FS_MAKE_SOCK,
+		 1,
+		 no_setup,
+		 [](const fs::path& dir) {
+			 sockaddr_un addr{};
+			 addr.sun_family = AF_UNIX;
+			 const std::string path = dir / "sock";
+			 path.copy(addr.sun_path, sizeof(addr.sun_path) - 1);
+			 const int sock = ::socket(
+				 AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0
+			 );
+			 const int res = error_of(::bind(
+				 sock,
+				 reinterpret_cast<const sockaddr*>(&addr),
+				 sizeof(addr)
+			 ));
+			 ::close(sock);
+			 return res;
+		 },
+		 EACCES},
+		{"refer",
+		 FS_REFER,
+		 2,
+		 [](const fs::path& dir) {
+			 create_file(dir / "file");
+			 fs::create_directory(dir / "sub");
+		 },
+		 [](const fs::path& dir) {
+			 return error_of(::link(
+				 (dir / "file").c_str(),
+				 (dir / "sub/file").c_str()
+			 ));
+		 },
+		 EXDEV},
+		{"truncate",
+		 FS_TRUNCATE,
+		 3,
+		 file_setup,
+		 [](const fs::path& dir) {
+			 return error_of(::truncate((dir / "file").c_str(), 0));
+		 },
+		 EACCES},
+	};
+}
 
-	std::unique_ptr<std::thread> signaller;
-	std::packaged_task<bool()> signaling_task{[&]() -> bool {
-		landlock::Ruleset ruleset{{}, {}, {landlock::scope::SIGNAL}};
-		ruleset.enforce();
-		// No scope support before ABI 6
-		expect_eperm = ruleset.effective_abi_version() >= 6;
-		if (ruleset.effective_abi_version() < 6) {
-			WARN("Effective ABI version too low. This test won't "
-			     "work as expected");
-		}
+forked::Scenario fs_scenario(const FsProbe& probe)
+{
+	return {"fs " + std::string{probe.name}, [probe](forked::Child& child) {
+			const fs::path allowed = child.dir() / "allowed";
+			const fs::path denied = child.dir() / "denied";
+			fs::create_directory(allowed);
+			fs::create_directory(denied);
+			probe.setup(allowed);
+			probe.setup(denied);
+
+			std::error_code ec;
+			Ruleset ruleset{{probe.action}, {}, {}, ec};
+			landlock::PathBeneathRule rule;
+			rule.add_path(allowed, ec).add_action(probe.action);
+			ruleset.add_rule(std::move(rule), ec);
+			FORKED_CHECK(child, not ec);
+			enforce(child, ruleset, probe.min_abi);
+
+			FORKED_CHECK(child, probe.probe(allowed) == 0);
+			FORKED_CHECK(
+				child, probe.probe(denied) == probe.denied_error
+			);
+		}};
+}
 
-		const int kill_res = kill(pid, SIGUSR1);
-		std::uint64_t buf = 1;
-		const auto err = errno;
+/**
+ * Get a TCP port on the loopback interface which is currently unused
+ */
+std::uint16_t free_port()
+{
+	const int sock = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	sockaddr_in addr{};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t len = sizeof(addr);
+	::bind(sock, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr));
+	::getsockname(sock, reinterpret_cast<sockaddr*>(&addr), &len);
+	::close(sock);
+	return ntohs(addr.sin_port);
+}
 
-		if (kill_res >= 0) {
-			const ssize_t write_res =
-				::write(efd, &buf, sizeof(buf));
-			CHECK(write_res == sizeof(buf));
-			return false;
-		}
+/**
+ * Bind a socket to port, or connect it if connect is set
+ *
+ * @return 0 on success, the error otherwise
+ */
+int tcp_probe(std::uint16_t port, bool connect)
+{
+	const int sock = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	sockaddr_in addr{};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(port);
+	const auto* sock_addr = reinterpret_cast<const sockaddr*>(&addr);
+	const int res = error_of(
+		connect ? ::connect(sock, sock_addr, sizeof(addr))
+			: ::bind(sock, sock_addr, sizeof(addr))
+	);
+	::close(sock);
+	return res;
+}
 
-		if (err != EPERM) {
-			const ssize_t write_res =
-				::write(efd, &buf, sizeof(buf));
-			CHECK(write_res == sizeof(buf));
-			throw std::system_error{err, std::system_category()};
-		}
+/**
+ * Listen on port from the child, before enforcing
+ */
+void listen_on(std::uint16_t port)
+{
+	const int sock = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	sockaddr_in addr{};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(port);
+	::bind(sock, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr));
+	::listen(sock, 1);
+}
 
-		const ssize_t write_res = ::write(efd, &buf, sizeof(buf));
-		CHECK(write_res == sizeof(buf));
-		return true;
-	}};
-
-	auto errcode = [&](const std::string& pfx,
-			   std::decay_t<decltype(errno)> err) {
-		const std::string msg =
-			err > 0 ? strerror(err) : "(no errno message)";
-		if (signaller) {
-			if (signaller->joinable()) {
-				signaller->join();
+forked::Scenario net_scenario(bool connect)
+{
+	return {connect ? "net connect_tcp" : "net bind_tcp",
+		[connect](forked::Child& child) {
+			const auto action =
+				connect ? landlock::action::NET_CONNECT_TCP
+					: landlock::action::NET_BIND_TCP;
+			const std::uint16_t allowed = free_port();
+			const std::uint16_t denied = free_port();
+			if (connect) {
+				listen_on(allowed);
+				listen_on(denied);
 			}
 
-			signaller.reset();
-		}
-		if (epfd >= 0) {
-			::close(epfd);
-		}
-		if (efd >= 0) {
-			::close(efd);
-		}
-		if (sigfd >= 0) {
-			::close(sigfd);
-		}
-		sigprocmask(SIG_SETMASK, &original_sigs, &sigs);
-		FAIL(pfx + " failed: " + msg);
+			std::error_code ec;
+			Ruleset ruleset{{}, {action}, {}, ec};
+			landlock::NetPortRule rule;
+			rule.add_port(allowed).add_action(action);
+			ruleset.add_rule(std::move(rule), ec);
+			FORKED_CHECK(child, not ec);
+			enforce(child, ruleset, 4);
+
+			FORKED_CHECK(child, tcp_probe(allowed, connect) == 0);
+			FORKED_CHECK(
+				child, tcp_probe(denied, connect) == EACCES
+			);
+		}};
+}
+
+/**
+ * Check that only the allowed paths are readable, ported from the former
+ * in-process test
+ */
+void rules_scenario(forked::Child& child)
+{
+	const fs::path allowed_test_path{"/proc"};
+	const fs::path disallowed_test_path{"/usr/bin"};
+	std::error_code ec;
+	Ruleset ruleset{
+		{landlock::action::FS_READ_FILE,
+		 landlock::action::FS_READ_DIR,
+		 landlock::action::FS_WRITE_FILE,
+		 landlock::action::FS_TRUNCATE,
+		 landlock::action::FS_EXECUTE},
+		{},
+		{},
+		ec
 	};
 
-	res = sigprocmask(SIG_BLOCK, &sigs, &original_sigs);
-	if (res != 0) {
-		FAIL(strerror(errno));
+	{
+		// Provoke that the rules might get deleted before enforce()
+		landlock::PathBeneathRule rule1;
+		rule1.add_path(allowed_test_path, ec)
+			.add_action(landlock::action::FS_READ_FILE)
+			.add_action(landlock::action::FS_READ_DIR)
+			.add_action(landlock::action::FS_WRITE_FILE)
+			.add_action(landlock::action::FS_TRUNCATE);
+		landlock::PathBeneathRule rule2;
+		rule2.add_path(disallowed_test_path, ec)
+			.add_action(landlock::action::FS_READ_DIR);
+		ruleset.add_rule(std::move(rule1), ec)
+			.add_rule(std::move(rule2), ec);
 	}
+	FORKED_CHECK(child, not ec);
+	ruleset.enforce(true, ec);
+	FORKED_CHECK(child, not ec);
 
-	sigfd = signalfd(-1, &sigs, SFD_NONBLOCK);
-	if (sigfd < 0) {
-		errcode("signalfd()", errno);
+	const fs::path allowed_file = allowed_test_path / "meminfo";
+	const fs::path denied_file = disallowed_test_path / "env";
+	FORKED_CHECK(child, open_and_close(allowed_file, O_RDONLY) == 0);
+	if (ruleset.landlock_enabled()) {
+		FORKED_CHECK(
+			child, open_and_close(denied_file, O_RDONLY) == EACCES
+		);
 	}
+}
 
-	efd = eventfd(0, EFD_NONBLOCK);
-	if (efd < 0) {
-		errcode("eventfd()", errno);
-	}
+/**
+ * Check that signals to processes outside of the domain are denied
+ */
+void signal_scenario(forked::Child& child)
+{
+	std::error_code ec;
+	const Ruleset ruleset{{}, {}, {landlock::scope::SIGNAL}, ec};
+	enforce(child, ruleset, 6);
 
-	epfd = epoll_create1(0);
-	if (epfd < 0) {
-		errcode("epoll_create1()", errno);
-	}
+	FORKED_CHECK(child, error_of(::kill(::getppid(), 0)) == EPERM);
+	FORKED_CHECK(child, ::kill(::getpid(), 0) == 0);
+}
 
-	epoll_event epe_sig{};
-	epe_sig.events = EPOLLIN;
-	epe_sig.data.fd = sigfd;
-	epoll_event epe_efd{};
-	epe_efd.events = EPOLLIN;
-	epe_efd.data.fd = efd;
+/**
+ * Check that connecting to abstract UNIX sockets created outside of the
+ * domain is denied
+ */
+void abstract_socket_scenario(forked::Child& child)
+{
+	sockaddr_un addr{};
+	addr.sun_family = AF_UNIX;
+	const std::string name = "llpp-forked-" + std::to_string(::getpid());
+	name.copy(&addr.sun_path[1], sizeof(addr.sun_path) - 2);
+	const auto addr_len = static_cast<socklen_t>(
+		offsetof(sockaddr_un, sun_path) + 1 + name.size()
+	);
+	const auto* sock_addr = reinterpret_cast<const sockaddr*>(&addr);
 
-	res = epoll_ctl(epfd, EPOLL_CTL_ADD, sigfd, &epe_sig);
-	if (res < 0) {
-		errcode("epoll_ctl epe_sig", errno);
-	}
-	res = epoll_ctl(epfd, EPOLL_CTL_ADD, efd, &epe_efd);
-	if (res < 0) {
-		errcode("epoll_ctl epe_efd", errno);
-	}
+	const int outside = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	FORKED_CHECK(child, ::bind(outside, sock_addr, addr_len) == 0);
+	FORKED_CHECK(child, ::listen(outside, 1) == 0);
 
-	signaller = std::make_unique<std::thread>([&]() { signaling_task(); });
-
-	epoll_event read_event{};
-	CHECK(signaling_task.valid());
-	std::future signal_future = signaling_task.get_future();
-	CHECK(signal_future.valid());
-	while ((res = epoll_wait(epfd, &read_event, 1, 1000)) > 0) {
-		try {
-			const bool signal_eperm = signal_future.get();
-			if (expect_eperm) {
-				CHECK(signal_eperm);
-				CHECK(read_event.data.fd == efd);
-			} else {
-				CHECK_FALSE(signal_eperm);
-				CHECK(read_event.data.fd == sigfd);
-			}
+	std::error_code ec;
+	const Ruleset ruleset{
+		{}, {}, {landlock::scope::ABSTRACT_UNIX_SOCKET}, ec
+	};
+	enforce(child, ruleset, 6);
 
-			std::uint64_t buf;
-			while (::read(read_event.data.fd, &buf, sizeof(buf)) > 0
-			) {
-				// nothing
-			}
-		} catch (std::system_error& e) {
-			errcode("exception in signaling task",
-				e.code().value());
-		}
-		break;
-	}
-	if (res == 0) {
-		errcode("epoll: timeout;", 0);
-	}
-	// NOLINTEND(*-vararg)
+	const int sock = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	FORKED_CHECK(
+		child, error_of(::connect(sock, sock_addr, addr_len)) == EPERM
+	);
+	::close(sock);
+}
+} // namespace
 
-	if (signaller->joinable()) {
-		signaller->join();
+TEST_CASE("Ruleset::enforcement")
+{
+	std::vector<forked::Scenario> scenarios{
+		{"rules", rules_scenario},
+		{"scope signal", signal_scenario},
+		{"scope abstract_unix_socket", abstract_socket_scenario},
+		net_scenario(false),
+		net_scenario(true),
+	};
+	for (const FsProbe& probe : fs_probes()) {
+		scenarios.push_back(fs_scenario(probe));
 	}
 
-	::close(epfd);
-	::close(efd);
-	::close(sigfd);
-	sigprocmask(SIG_BLOCK, &original_sigs, &sigs);
-	// NOLINTEND(*-mt-unsafe, *-magic-numbers)
+	forked::check(scenarios);
+}
+
+TEST_CASE("Ruleset::enforcement harness")
+{
+	// Processes started by a scenario inherit its report pipe, which
+	// must not keep the harness waiting
+	const auto start_sleeper = [] {
+		if (::fork() == 0) {
+			::sleep(60);
+			::_exit(0);
+		}
+	};
+	const std::vector<forked::Result> results = forked::run(
+		{
+			{"exited",
+			 [&start_sleeper](forked::Child& /*child*/) {
+				 start_sleeper();
+			 }},
+			{"timed out",
+			 [&start_sleeper](forked::Child& /*child*/) {
+				 start_sleeper();
+				 ::sleep(60);
+			 }},
+		},
+		2,
+		std::chrono::milliseconds{500}
+	);
+	REQUIRE(results.size() == 2);
+	CHECK(results.at(0).outcome == forked::Outcome::PASSED);
+	CHECK(results.at(1).outcome == forked::Outcome::TIMED_OUT);
 }
-// NOLINTEND(*-vararg)
+// NOLINTEND(*-vararg, *-magic-numbers)
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <filesystem>
+#include <initializer_list>
+#include <string>
+#include <system_error>
+
+#include <unistd.h>
+
+/**
+ * Temporary directory for a test, removed with its content on destruction
+ *
+ * The directory is named "llpp-<name>-<pid>" in the canonical temporary
+ * directory, so parallel test runners do not collide.
+ */
+class TempDir
+{
+public:
+	/**
+	 * Create the directory and the given subdirectories of it
+	 */
+	explicit TempDir(
+		const std::string& name,
+		std::initializer_list<const char*> dirs = {}
+	) :
+		dir_(std::filesystem::weakly_canonical(
+			     std::filesystem::temp_directory_path()
+		     ) /
+		     ("llpp-" + name + "-" + std::to_string(::getpid())))
+	{
+		std::filesystem::create_directories(dir_);
+		for (const char* sub : dirs) {
+			std::filesystem::create_directories(dir_ / sub);
+		}
+	}
+	TempDir(const TempDir&) = delete;
+	TempDir& operator=(const TempDir&) = delete;
+	TempDir(TempDir&&) = delete;
+	TempDir& operator=(TempDir&&) = delete;
+	~TempDir()
+	{
+		std::error_code ec;
+		std::filesystem::remove_all(dir_, ec);
+	}
+
+	[[nodiscard]] const std::filesystem::path& path() const noexcept
+	{
+		return dir_;
+	}
+
+	/**
+	 * Get the path of an entry relative to the directory
+	 */
+	[[nodiscard]] std::filesystem::path
+	path(const std::filesystem::path& relative) const
+	{
+		return dir_ / relative;
+	}
+
+private:
+	std::filesystem::path dir_;
+};
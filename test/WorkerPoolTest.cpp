@@ -0,0 +1,247 @@
+#include "ll/WorkerPool.hpp"
+#include "ll/ActionType.hpp"
+#include "ll/Backend.hpp"
+#include "ll/FakeBackend.hpp"
+#include "ll/Policy.hpp"
+
+#include <array>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "test.hpp"
+
+using landlock::Backend;
+using landlock::FakeBackend;
+using landlock::WorkerPool;
+
+namespace
+{
+constexpr std::size_t BUF_SIZE = 64;
+
+/**
+ * Answer each message with its upper-case version until end of file
+ */
+int upper_main(int sock)
+{
+	std::array<char, BUF_SIZE> buf{};
+	for (;;) {
+		const ssize_t len = ::recv(sock, buf.data(), buf.size(), 0);
+		if (len <= 0) {
+			return 0;
+		}
+		for (ssize_t i = 0; i < len; ++i) {
+			auto& chr = buf.at(static_cast<std::size_t>(i));
+			chr = static_cast<char>(
+				std::toupper(static_cast<unsigned char>(chr))
+			);
+		}
+		const auto size = static_cast<std::size_t>(len);
+		if (::send(sock, buf.data(), size, 0) != len) {
+			return 1;
+		}
+	}
+}
+
+/**
+ * Send msg to the worker and return its answer
+ */
+std::string round_trip(const WorkerPool::Lease& lease, const std::string& msg)
+{
+	if (::send(lease.fd(), msg.data(), msg.size(), 0) !=
+	    static_cast<ssize_t>(msg.size())) {
+		return {};
+	}
+	std::array<char, BUF_SIZE> buf{};
+	const ssize_t len = ::recv(lease.fd(), buf.data(), buf.size(), 0);
+	return len > 0 ? std::string{buf.data(), static_cast<std::size_t>(len)}
+		       : std::string{};
+}
+
+landlock::Policy read_file_policy()
+{
+	landlock::Policy policy;
+	policy.handle(landlock::action::FS_READ_FILE);
+	return policy;
+}
+
+template <typename Pred>
+bool wait_for(Pred pred)
+{
+	constexpr auto TIMEOUT = std::chrono::seconds{5};
+	const auto deadline = std::chrono::steady_clock::now() + TIMEOUT;
+	while (not pred()) {
+		if (std::chrono::steady_clock::now() > deadline) {
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds{1});
+	}
+	return true;
+}
+} // namespace
+
+TEST_CASE("WorkerPool::lease")
+{
+	FakeBackend backend{7};
+	std::error_code ec;
+	auto ruleset = read_file_policy().build(backend, ec);
+	REQUIRE_FALSE(ec);
+
+	constexpr std::size_t SIZE = 2;
+	WorkerPool pool{std::move(ruleset), upper_main, SIZE, ec};
+	REQUIRE_FALSE(ec);
+
+	SECTION("round trip")
+	{
+		for (int i = 0; i < 3; ++i) {
+			const WorkerPool::Lease lease = pool.acquire(ec);
+			REQUIRE_FALSE(ec);
+			REQUIRE(lease);
+			CHECK(lease.pid() > 0);
+			CHECK(round_trip(lease, "hello") == "HELLO");
+			CHECK(round_trip(lease, "again") == "AGAIN");
+		}
+		CHECK(wait_for([&pool] { return pool.idle() == SIZE; }));
+
+		const WorkerPool::Stats stats = pool.stats();
+		CHECK(stats.leased == 3);
+		CHECK(stats.spawned >= SIZE + 3);
+		CHECK(stats.failed == 0);
+		CHECK(wait_for([&pool] { return pool.stats().exited == 3; }));
+	}
+
+	SECTION("distinct workers")
+	{
+		REQUIRE(wait_for([&pool] { return pool.idle() == SIZE; }));
+		const WorkerPool::Lease first = pool.try_acquire();
+		const WorkerPool::Lease second = pool.try_acquire();
+		REQUIRE(first);
+		REQUIRE(second);
+		CHECK(first.pid() != second.pid());
+		CHECK(round_trip(second, "b") == "B");
+		CHECK(round_trip(first, "a") == "A");
+	}
+
+	SECTION("killed worker")
+	{
+		const WorkerPool::Lease lease = pool.acquire(ec);
+		REQUIRE_FALSE(ec);
+		REQUIRE(::kill(lease.pid(), SIGKILL) == 0);
+		CHECK(wait_for([&pool] { return pool.stats().exited == 1; }));
+		CHECK(round_trip(lease, "gone").empty());
+		CHECK(wait_for([&pool] { return pool.idle() == SIZE; }));
+	}
+}
+
+TEST_CASE("WorkerPool::failing workers")
+{
+	FakeBackend backend{7};
+	backend.inject_error(FakeBackend::Call::RESTRICT_SELF, EPERM);
+	std::error_code ec;
+	auto ruleset = read_file_policy().build(backend, ec);
+	REQUIRE_FALSE(ec);
+
+	// Each worker inherits the injected error, so none becomes ready
+	WorkerPool pool{std::move(ruleset), upper_main, 1, ec};
+	REQUIRE_FALSE(ec);
+
+	const WorkerPool::Lease lease = pool.acquire(ec);
+	CHECK_FALSE(lease);
+	CHECK(ec == std::errc::operation_not_permitted);
+	CHECK(pool.stats().failed == WorkerPool::MAX_FAILURES);
+	CHECK(pool.idle() == 0);
+
+#ifndef LLPP_NO_EXCEPTIONS
+	CHECK_THROWS_AS(pool.acquire(), std::system_error);
+#endif
+}
+
+TEST_CASE("WorkerPool::null ruleset")
+{
+	std::error_code ec;
+	const WorkerPool pool{nullptr, upper_main, 1, ec};
+	CHECK(ec == std::errc::invalid_argument);
+}
+
+TEST_CASE("WorkerPool::enforced")
+{
+	std::error_code ec;
+	auto ruleset = read_file_policy().build(Backend::system(), ec);
+	REQUIRE_FALSE(ec);
+	if (not ruleset->landlock_enabled()) {
+		WARN("Landlock not supported, skipping");
+		return;
+	}
+
+	WorkerPool pool{
+		std::move(ruleset),
+		[](int sock) {
+			const int fd =
+				::open("/etc/hostname", O_RDONLY | O_CLOEXEC);
+			const std::int32_t err = fd < 0 ? errno : 0;
+			const bool sent = ::send(sock, &err, sizeof(err), 0) ==
+					  static_cast<ssize_t>(sizeof(err));
+			return sent ? 0 : 1;
+		},
+		1,
+		ec
+	};
+	REQUIRE_FALSE(ec);
+
+	const WorkerPool::Lease lease = pool.acquire(ec);
+	REQUIRE_FALSE(ec);
+	std::int32_t err = 0;
+	REQUIRE(::recv(lease.fd(), &err, sizeof(err), 0) ==
+		static_cast<ssize_t>(sizeof(err)));
+	CHECK(err == EACCES);
+}
+
+TEST_CASE("WorkerPool::inherited descriptors")
+{
+	// Handling FS_READ_DIR denies listing /proc/self/fd after enforcing
+	landlock::Policy policy;
+	policy.handle(
+		landlock::action::FS_READ_DIR | landlock::action::FS_READ_FILE
+	);
+	std::error_code ec;
+	auto ruleset = policy.build(Backend::system(), ec);
+	REQUIRE_FALSE(ec);
+	if (not ruleset->landlock_enabled()) {
+		WARN("Landlock not supported, skipping");
+		return;
+	}
+
+	const int inherited = ::open("/etc/hostname", O_RDONLY | O_CLOEXEC);
+	REQUIRE(inherited >= 0);
+	WorkerPool pool{
+		std::move(ruleset),
+		[inherited](int sock) {
+			const std::int32_t err =
+				::fcntl(inherited, F_GETFD) < 0 ? errno : 0;
+			return ::send(sock, &err, sizeof(err), 0) ==
+					       static_cast<ssize_t>(sizeof(err))
+				       ? 0
+				       : 1;
+		},
+		1,
+		ec
+	};
+	REQUIRE_FALSE(ec);
+
+	const WorkerPool::Lease lease = pool.acquire(ec);
+	REQUIRE_FALSE(ec);
+	std::int32_t err = 0;
+	REQUIRE(::recv(lease.fd(), &err, sizeof(err), 0) ==
+		static_cast<ssize_t>(sizeof(err)));
+	CHECK(err == EBADF);
+	CHECK(::close(inherited) == 0);
+}
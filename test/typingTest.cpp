@@ -43,6 +43,36 @@ TEST_CASE("typing::Union")
 	CHECK(std::is_same_v<ValWrapper<int, 1, 2, 3>, Union1>);
 	CHECK(std::is_same_v<ValWrapper<int, 1>, Union2>);
 	CHECK(std::is_same_v<ValWrapper<int, 1>, Union3>);
+
+	using Disjoint =
+		typing::UnionT<int, ValWrapper<int, 1, 2>, ValWrapper<int, 3>>;
+	CHECK(std::is_same_v<ValWrapper<int>, Disjoint>);
+	using Empty = typing::UnionT<int, ValWrapper<int>, ValWrapper<int, 1>>;
+	CHECK(std::is_same_v<ValWrapper<int>, Empty>);
+}
+
+namespace
+{
+template <typename T>
+struct Wrapped;
+} // namespace
+
+template <typename T, T... vals>
+struct landlock::typing::Unwrap<Wrapped<ValWrapper<T, vals...>>> {
+	using type = ValWrapper<T, vals...>;
+};
+
+TEST_CASE("typing::MultiUnion")
+{
+	using Single = typing::MultiUnionT<int, Wrapped<ValWrapper<int, 3, 1>>>;
+	CHECK(std::is_same_v<ValWrapper<int, 3, 1>, Single>);
+
+	using Multi = typing::MultiUnionT<
+		int,
+		Wrapped<ValWrapper<int, 4, 3, 2, 1>>,
+		Wrapped<ValWrapper<int, 1, 2, 3>>,
+		Wrapped<ValWrapper<int, 3, 1, 5>>>;
+	CHECK(std::is_same_v<ValWrapper<int, 3, 1>, Multi>);
 }
 
 // NOLINTEND(*-magic-numbers)
@@ -0,0 +1,228 @@
+/**
+ * Audit which filesystem access a policy allows
+ *
+ * The policy is given like for llpp-run, with all filesystem access handled.
+ * llpp-audit walks the given directory trees and prints how many files and
+ * directories each access mask applies to, followed by the regions: the
+ * entries whose access differs from their parent directory's. Nothing is
+ * enforced, so the audit also works on systems without Landlock.
+ */
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include <getopt.h>
+
+#include <ll/Policy.hpp>
+#include <ll/PolicyAudit.hpp>
+#include <ll/PolicyFile.hpp>
+
+namespace
+{
+/// Exit status for failures of llpp-audit itself
+constexpr int EXIT_LLPP_FAILURE = 125;
+
+constexpr const char* OPTSTRING = "r:w:a:f:j:xlh";
+
+constexpr const char* USAGE =
+	"Usage: %s [OPTION]... [ROOT]...\n"
+	"Show the filesystem access allowed beneath each ROOT (default /).\n"
+	"\n"
+	"  -r, --ro PATH         allow reading and executing beneath PATH\n"
+	"  -w, --rw PATH         allow all filesystem access beneath PATH\n"
+	"  -a, --allow ACTS:PATH allow filesystem actions ACTS beneath PATH\n"
+	"  -f, --policy FILE     read policy directives from FILE\n"
+	"  -j, --jobs N          walk with N threads (default: one per CPU)\n"
+	"  -x, --one-file-system do not descend into other filesystems\n"
+	"  -l, --list            print every entry, not only the regions\n"
+	"  -h, --help            print this help\n"
+	"\n"
+	"Entries are printed as TYPE ACCESS PATH, where TYPE is d for\n"
+	"directories and f for other files, and ACCESS is a comma-separated\n"
+	"list of action names as in policy files, or - for none.\n";
+
+using Clock = std::chrono::steady_clock;
+
+[[noreturn]] void die(const std::string& message)
+{
+	std::fprintf(stderr, "llpp-audit: %s\n", message.c_str());
+	std::exit(EXIT_LLPP_FAILURE);
+}
+
+void apply_directive(landlock::Policy& policy, const std::string& directive)
+{
+	std::string message;
+	if (not landlock::PolicyFile::apply(directive, policy, message)) {
+		die("invalid argument: " + message);
+	}
+}
+
+void read_policy(landlock::Policy& policy, const char* path)
+{
+	std::ifstream in{path};
+	if (not in) {
+		die(std::string{"cannot open policy file "} + path);
+	}
+	landlock::PolicyFileError error;
+	if (not landlock::PolicyFile::read(in, policy, error)) {
+		die(std::string{path} + ":" + std::to_string(error.line) +
+		    ": " + error.message);
+	}
+}
+
+std::string access_names(std::uint64_t access)
+{
+	const std::string res = landlock::PolicyFile::fs_names(access);
+	return res.empty() ? "-" : res;
+}
+
+void print_entry(std::string_view path, bool dir, std::uint64_t access)
+{
+	std::printf(
+		"%c %s %.*s\n",
+		dir ? 'd' : 'f',
+		access_names(access).c_str(),
+		static_cast<int>(path.size()),
+		path.data()
+	);
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+	landlock::Policy policy;
+	policy.handle(*landlock::PolicyFile::fs_actions("all"));
+
+	landlock::PolicyAudit::Options audit_options;
+	bool list = false;
+
+	// NOLINTBEGIN(*-avoid-c-arrays)
+	const option options[] = {
+		{"ro", required_argument, nullptr, 'r'},
+		{"rw", required_argument, nullptr, 'w'},
+		{"allow", required_argument, nullptr, 'a'},
+		{"policy", required_argument, nullptr, 'f'},
+		{"jobs", required_argument, nullptr, 'j'},
+		{"one-file-system", no_argument, nullptr, 'x'},
+		{"list", no_argument, nullptr, 'l'},
+		{"help", no_argument, nullptr, 'h'},
+		{nullptr, 0, nullptr, 0},
+	};
+	// NOLINTEND(*-avoid-c-arrays)
+
+	int opt = 0;
+	while ((opt = ::getopt_long(argc, argv, OPTSTRING, options, nullptr)
+	       ) != -1) {
+		const std::string arg = optarg != nullptr ? optarg : "";
+		switch (opt) {
+		case 'r':
+			apply_directive(policy, "path ro " + arg);
+			break;
+		case 'w':
+			apply_directive(policy, "path all " + arg);
+			break;
+		case 'a': {
+			const std::size_t sep = arg.find(':');
+			if (sep == std::string::npos) {
+				die("expected ACTS:PATH, got " + arg);
+			}
+			apply_directive(
+				policy,
+				"path " + arg.substr(0, sep) + " " +
+					arg.substr(sep + 1)
+			);
+			break;
+		}
+		case 'f':
+			read_policy(policy, optarg);
+			break;
+		case 'j': {
+			char* end = nullptr;
+			audit_options.threads = std::strtoul(optarg, &end, 10);
+			if (end == optarg || *end != '\0') {
+				die("invalid number of jobs: " + arg);
+			}
+			break;
+		}
+		case 'x':
+			audit_options.one_file_system = true;
+			break;
+		case 'l':
+			list = true;
+			break;
+		case 'h':
+			// NOLINTNEXTLINE(*-vararg)
+			std::printf(USAGE, argv[0]);
+			return EXIT_SUCCESS;
+		default:
+			// NOLINTNEXTLINE(*-vararg)
+			std::fprintf(stderr, USAGE, argv[0]);
+			return EXIT_LLPP_FAILURE;
+		}
+	}
+
+	std::vector<std::filesystem::path> roots{argv + optind, argv + argc};
+	if (roots.empty()) {
+		roots.emplace_back("/");
+	}
+
+	std::mutex output;
+	if (list) {
+		audit_options.visitor = [&output](
+						std::string_view path,
+						bool dir,
+						std::uint64_t access
+					) {
+			const std::lock_guard lock{output};
+			print_entry(path, dir, access);
+		};
+	}
+
+	std::error_code ec;
+	landlock::PolicyAudit audit;
+	audit.add_layer(policy, ec);
+	if (ec) {
+		die("cannot resolve policy: " + ec.message());
+	}
+
+	const Clock::time_point start = Clock::now();
+	const landlock::PolicyAudit::Report report =
+		audit.run(roots, audit_options, ec);
+	if (ec) {
+		die("cannot resolve root: " + ec.message());
+	}
+	const std::chrono::duration<double> elapsed = Clock::now() - start;
+
+	if (not list) {
+		for (const auto& region : report.regions) {
+			print_entry(region.path, region.dir, region.access);
+		}
+	}
+
+	std::uint64_t total = 0;
+	std::printf("\n%12s %12s  access\n", "dirs", "files");
+	for (const auto& [access, counts] : report.by_access) {
+		std::printf(
+			"%12llu %12llu  %s\n",
+			static_cast<unsigned long long>(counts.dirs),
+			static_cast<unsigned long long>(counts.files),
+			access_names(access).c_str()
+		);
+		total += counts.dirs + counts.files;
+	}
+	std::printf(
+		"\n%llu entries in %.2f s, %llu unreadable directories\n",
+		static_cast<unsigned long long>(total),
+		elapsed.count(),
+		static_cast<unsigned long long>(report.errors)
+	);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,1438 @@
+/**
+ * LD_PRELOAD interposer recording the accesses of a program for llpp-learn
+ *
+ * The interposer wraps the libc functions opening, creating, linking, renaming,
+ * truncating and removing files and binding and connecting sockets. After a
+ * successful call, the wrapper writes a fixed-size record into a ring buffer
+ * owned by the calling thread: no locks, no allocations (except for the first
+ * record of a thread) and no formatting happen on the calling thread, and a
+ * full ring drops the record instead of blocking. A background thread drains
+ * all rings every few milliseconds, deduplicates the records and appends them
+ * to the trace file named by LLPP_LEARN_TRACE in the format read by
+ * landlock::PolicyLearner.
+ *
+ * Files mapped by the dynamic loader do not go through libc, so the loaded
+ * objects are recorded from dl_iterate_phdr() instead. stat(2) and similar
+ * calls are not restricted by Landlock and therefore not recorded. ioctl(2)
+ * calls are not recorded either, so learned policies do not handle
+ * FS_IOCTL_DEV. The exec functions drain all rings before replacing the process
+ * image. Records of a process ending with _exit(2) or a signal may be lost if
+ * they were not drained yet.
+ */
+#undef _FORTIFY_SOURCE
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+
+#include <dirent.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <link.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sys/auxv.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace
+{
+// The access bits are spelled out instead of using the macros from
+// linux/landlock.h, since the interposer records access newer than the
+// headers present at compile time as well.
+constexpr std::uint64_t FS_EXECUTE = 1U << 0U;
+constexpr std::uint64_t FS_WRITE_FILE = 1U << 1U;
+constexpr std::uint64_t FS_READ_FILE = 1U << 2U;
+constexpr std::uint64_t FS_READ_DIR = 1U << 3U;
+constexpr std::uint64_t FS_REMOVE_DIR = 1U << 4U;
+constexpr std::uint64_t FS_REMOVE_FILE = 1U << 5U;
+constexpr std::uint64_t FS_MAKE_CHAR = 1U << 6U;
+constexpr std::uint64_t FS_MAKE_DIR = 1U << 7U;
+constexpr std::uint64_t FS_MAKE_REG = 1U << 8U;
+constexpr std::uint64_t FS_MAKE_SOCK = 1U << 9U;
+constexpr std::uint64_t FS_MAKE_FIFO = 1U << 10U;
+constexpr std::uint64_t FS_MAKE_BLOCK = 1U << 11U;
+constexpr std::uint64_t FS_MAKE_SYM = 1U << 12U;
+constexpr std::uint64_t FS_REFER = 1U << 13U;
+constexpr std::uint64_t FS_TRUNCATE = 1U << 14U;
+
+/// The kernel opens executables and interpreters for reading as well
+constexpr std::uint64_t FS_EXEC_IMAGE = FS_EXECUTE | FS_READ_FILE;
+
+constexpr std::uint64_t NET_BIND_TCP = 1U << 0U;
+constexpr std::uint64_t NET_CONNECT_TCP = 1U << 1U;
+
+constexpr const char* TRACE_ENV = "LLPP_LEARN_TRACE";
+
+/// Interval between two drains of the rings
+constexpr long DRAIN_INTERVAL_NS = 10'000'000;
+
+/// Size of the output buffer of the flusher before writing it out
+constexpr std::size_t WRITE_THRESHOLD = 1U << 16U;
+
+constexpr std::size_t CACHE_LINE = 64;
+constexpr std::size_t PATH_CAPACITY = 496;
+/// Records per thread, must be a power of two
+constexpr std::size_t RING_SIZE = 256;
+/// Hashes of recent records remembered per thread
+constexpr std::size_t RECENT_SIZE = 256;
+
+constexpr std::uint64_t FNV_OFFSET = 0xcbf29ce484222325ULL;
+constexpr std::uint64_t FNV_PRIME = 0x100000001b3ULL;
+
+enum class Kind : std::uint8_t {
+	/// Access to path
+	FS,
+	/// Access to the directory containing path
+	FS_PARENT,
+	/// Read access to path, which needs READ_DIR if path is a directory
+	FS_PROBE,
+	/// Access to port
+	NET,
+};
+
+struct Record {
+	std::uint64_t access;
+	Kind kind;
+	std::uint16_t port;
+	std::array<char, PATH_CAPACITY> path;
+};
+
+/**
+ * Single-producer single-consumer ring of records
+ *
+ * The producer is the owning thread, the consumer the flusher. Rings are never
+ * freed: when a thread exits, its ring is released and taken over by the next
+ * new thread.
+ *
+ * The producer skips records whose hash matches a recently published one, so
+ * that repeated accesses neither fill the ring nor keep the flusher busy.
+ */
+struct Ring {
+	alignas(CACHE_LINE) std::atomic<std::uint64_t> head{0};
+	std::atomic<std::uint64_t> lost{0};
+	std::array<std::uint64_t, RECENT_SIZE> recent{};
+	alignas(CACHE_LINE) std::atomic<std::uint64_t> tail{0};
+	std::atomic<bool> owned{true};
+	Ring* next{nullptr};
+	std::array<Record, RING_SIZE> slots{};
+};
+
+/**
+ * Global state, allocated once and never destroyed, since the flusher may
+ * still run while static objects are destroyed at exit
+ */
+struct State {
+	int trace_fd{-1};
+	std::atomic<Ring*> rings{nullptr};
+	std::atomic<bool> flusher_running{false};
+
+	/// Guards all members below
+	std::mutex drain_mutex;
+	std::unordered_set<std::string> seen;
+	std::string out;
+	/// Records dropped by the flusher
+	std::uint64_t dropped{0};
+	std::uint64_t lost_reported{0};
+	unsigned long long dl_adds{0};
+};
+
+State* state = nullptr; // NOLINT(*-avoid-non-const-global-variables)
+
+struct ThreadRing {
+	Ring* ring{nullptr};
+	/// Set while recording, so that nested calls are not recorded
+	bool busy{false};
+	/// Record written while the ring is full
+	Record overflow;
+
+	ThreadRing() = default;
+	ThreadRing(const ThreadRing&) = delete;
+	ThreadRing& operator=(const ThreadRing&) = delete;
+	ThreadRing(ThreadRing&&) = delete;
+	ThreadRing& operator=(ThreadRing&&) = delete;
+
+	~ThreadRing()
+	{
+		if (ring != nullptr) {
+			ring->owned.store(false, std::memory_order_release);
+		}
+	}
+};
+
+// NOLINTNEXTLINE(*-avoid-non-const-global-variables)
+[[gnu::tls_model("initial-exec")]] thread_local ThreadRing thread_ring;
+
+template <typename F>
+F real(const char* name) noexcept
+{
+	return reinterpret_cast<F>(::dlsym(RTLD_NEXT, name));
+}
+
+/**
+ * Restores errno on scope exit, so that recording is invisible to callers
+ */
+class ErrnoGuard
+{
+public:
+	ErrnoGuard() noexcept : saved_(errno) {}
+	ErrnoGuard(const ErrnoGuard&) = delete;
+	ErrnoGuard& operator=(const ErrnoGuard&) = delete;
+	ErrnoGuard(ErrnoGuard&&) = delete;
+	ErrnoGuard& operator=(ErrnoGuard&&) = delete;
+
+	~ErrnoGuard()
+	{
+		errno = saved_;
+	}
+
+private:
+	int saved_;
+};
+
+// --- Flusher ---
+
+void write_out(State& st)
+{
+	std::size_t done = 0;
+	while (done < st.out.size()) {
+		const ssize_t res = ::write(
+			st.trace_fd, st.out.data() + done, st.out.size() - done
+		);
+		if (res < 0 && errno == EINTR) {
+			continue;
+		}
+		if (res <= 0) {
+			break;
+		}
+		done += static_cast<std::size_t>(res);
+	}
+	st.out.clear();
+}
+
+std::string parent_of(const char* path)
+{
+	std::string res{path};
+	while (res.size() > 1 && res.back() == '/') {
+		res.pop_back();
+	}
+	const std::size_t pos = res.rfind('/');
+	res.resize(pos == 0 || pos == std::string::npos ? 1 : pos);
+	return res;
+}
+
+/**
+ * Write a record to the output buffer unless it was written before
+ */
+void emit(State& st, const Record& rec)
+{
+	if (rec.kind == Kind::NET) {
+		std::array<char, 64> line{};
+		// NOLINTNEXTLINE(*-vararg)
+		std::snprintf(
+			line.data(),
+			line.size(),
+			"net %llx %u\n",
+			static_cast<unsigned long long>(rec.access),
+			static_cast<unsigned>(rec.port)
+		);
+		if (st.seen.emplace(line.data()).second) {
+			st.out += line.data();
+		}
+		return;
+	}
+
+	const char* path = rec.path.data();
+	if (std::strchr(path, '\n') != nullptr) {
+		++st.dropped;
+		return;
+	}
+
+	std::array<char, 32> prefix{};
+	// NOLINTNEXTLINE(*-vararg)
+	std::snprintf(
+		prefix.data(),
+		prefix.size(),
+		"%d %llx ",
+		static_cast<int>(rec.kind),
+		static_cast<unsigned long long>(rec.access)
+	);
+	if (not st.seen.emplace(std::string{prefix.data()} + path).second) {
+		return;
+	}
+
+	std::uint64_t access = rec.access;
+	std::string target;
+	switch (rec.kind) {
+	case Kind::FS_PARENT:
+		target = parent_of(path);
+		break;
+	case Kind::FS_PROBE: {
+		struct stat statbuf {};
+		if (::stat(path, &statbuf) == 0 && S_ISDIR(statbuf.st_mode)) {
+			access = (access & ~FS_READ_FILE) | FS_READ_DIR;
+		}
+		target = path;
+		break;
+	}
+	default:
+		target = path;
+		break;
+	}
+
+	std::array<char, 32> head{};
+	// NOLINTNEXTLINE(*-vararg)
+	std::snprintf(
+		head.data(),
+		head.size(),
+		"fs %llx ",
+		static_cast<unsigned long long>(access)
+	);
+	st.out += head.data();
+	st.out += target;
+	st.out += '\n';
+}
+
+void emit_path(State& st, const char* path, std::uint64_t access)
+{
+	Record rec{access, Kind::FS, 0, {}};
+	const std::size_t len = std::strlen(path);
+	if (path[0] != '/' || len >= PATH_CAPACITY) {
+		return;
+	}
+	std::memcpy(rec.path.data(), path, len + 1);
+	emit(st, rec);
+}
+
+/**
+ * Record the interpreter named by the main program
+ */
+void emit_interpreter(State& st, const dl_phdr_info& info)
+{
+	for (int i = 0; i < info.dlpi_phnum; ++i) {
+		const ElfW(Phdr)& phdr = info.dlpi_phdr[i];
+		if (phdr.p_type == PT_INTERP) {
+			// NOLINTNEXTLINE(*-no-int-to-ptr)
+			const auto* path = reinterpret_cast<const char*>(
+				info.dlpi_addr + phdr.p_vaddr
+			);
+			emit_path(st, path, FS_EXEC_IMAGE);
+		}
+	}
+}
+
+/**
+ * Record the objects loaded by the dynamic loader if any were added
+ */
+void emit_loaded_objects(State& st)
+{
+	struct Scan {
+		State* st;
+		bool first;
+	} scan{&st, true};
+
+	::dl_iterate_phdr(
+		[](dl_phdr_info* info, std::size_t /* size */, void* data) {
+			auto& cur = *static_cast<Scan*>(data);
+			if (cur.first) {
+				cur.first = false;
+				if (info->dlpi_adds == cur.st->dl_adds) {
+					return 1;
+				}
+				cur.st->dl_adds = info->dlpi_adds;
+				emit_interpreter(*cur.st, *info);
+				return 0;
+			}
+			emit_path(*cur.st, info->dlpi_name, FS_READ_FILE);
+			return 0;
+		},
+		&scan
+	);
+}
+
+void drain(State& st)
+{
+	const std::lock_guard lock{st.drain_mutex};
+	emit_loaded_objects(st);
+
+	std::uint64_t lost = 0;
+	for (Ring* ring = st.rings.load(std::memory_order_acquire);
+	     ring != nullptr;
+	     ring = ring->next) {
+		const std::uint64_t head =
+			ring->head.load(std::memory_order_acquire);
+		for (std::uint64_t idx =
+			     ring->tail.load(std::memory_order_relaxed);
+		     idx != head;
+		     ++idx) {
+			emit(st, ring->slots.at(idx % RING_SIZE));
+			// Free the slot right away for the producer
+			ring->tail.store(idx + 1, std::memory_order_release);
+			if (st.out.size() >= WRITE_THRESHOLD) {
+				write_out(st);
+			}
+		}
+		lost += ring->lost.load(std::memory_order_relaxed);
+	}
+
+	lost += st.dropped;
+	if (lost > st.lost_reported) {
+		st.out += "lost " + std::to_string(lost - st.lost_reported) +
+			  "\n";
+		st.lost_reported = lost;
+	}
+	write_out(st);
+}
+
+void run_flusher()
+{
+	thread_ring.busy = true;
+	const timespec interval{0, DRAIN_INTERVAL_NS};
+	for (;;) {
+		::nanosleep(&interval, nullptr);
+		drain(*state);
+	}
+}
+
+void ensure_flusher(State& st) noexcept
+{
+	if (st.flusher_running.load(std::memory_order_relaxed)) {
+		return;
+	}
+	bool running = false;
+	if (not st.flusher_running.compare_exchange_strong(running, true)) {
+		return;
+	}
+	try {
+		std::thread{run_flusher}.detach();
+	} catch (...) {
+		st.flusher_running.store(false);
+	}
+}
+
+// --- Recording ---
+
+Ring* acquire_ring(State& st) noexcept
+{
+	Ring* head = st.rings.load(std::memory_order_acquire);
+	for (Ring* ring = head; ring != nullptr; ring = ring->next) {
+		bool owned = false;
+		if (ring->owned.compare_exchange_strong(
+			    owned, true, std::memory_order_acquire
+		    )) {
+			return ring;
+		}
+	}
+
+	auto* ring = new (std::nothrow) Ring;
+	if (ring == nullptr) {
+		return nullptr;
+	}
+	ring->next = head;
+	while (not st.rings.compare_exchange_weak(
+		ring->next, ring, std::memory_order_release
+	)) {
+	}
+	return ring;
+}
+
+/**
+ * Get the path of the file opened as fd into buf
+ *
+ * @return The length of the path, or 0 if it is not an absolute path
+ */
+std::size_t fd_path(int fd, std::array<char, PATH_CAPACITY>& buf)
+{
+	std::array<char, 32> link{};
+	// NOLINTNEXTLINE(*-vararg)
+	std::snprintf(link.data(), link.size(), "/proc/self/fd/%d", fd);
+	const ssize_t res = ::readlink(link.data(), buf.data(), buf.size() - 1);
+	if (res <= 0 || buf[0] != '/') {
+		return 0;
+	}
+	buf.at(static_cast<std::size_t>(res)) = '\0';
+	return static_cast<std::size_t>(res);
+}
+
+/**
+ * Make path absolute relative to dirfd into buf
+ */
+bool resolve(int dirfd, const char* path, std::array<char, PATH_CAPACITY>& buf)
+{
+	std::size_t len = 0;
+	if (path[0] != '/') {
+		if (dirfd == AT_FDCWD) {
+			if (::getcwd(buf.data(), buf.size()) == nullptr) {
+				return false;
+			}
+			len = std::strlen(buf.data());
+		} else {
+			len = fd_path(dirfd, buf);
+			if (len == 0) {
+				return false;
+			}
+		}
+		if (len + 1 >= buf.size()) {
+			return false;
+		}
+		buf.at(len++) = '/';
+	}
+
+	const std::size_t path_len = std::strlen(path);
+	if (len + path_len >= buf.size()) {
+		return false;
+	}
+	std::memcpy(buf.data() + len, path, path_len + 1);
+	return true;
+}
+
+std::uint64_t hash_record(const Record& rec) noexcept
+{
+	std::uint64_t hash = FNV_OFFSET;
+	const auto mix = [&hash](std::uint64_t val) {
+		hash = (hash ^ val) * FNV_PRIME;
+	};
+	mix(rec.access);
+	mix(static_cast<std::uint64_t>(rec.kind));
+	mix(rec.port);
+	if (rec.kind != Kind::NET) {
+		for (const char* chr = rec.path.data(); *chr != '\0'; ++chr) {
+			mix(static_cast<unsigned char>(*chr));
+		}
+	}
+	return hash;
+}
+
+/**
+ * Append a record to the ring of the calling thread
+ *
+ * fill writes the record and returns false if it cannot be recorded.
+ */
+template <typename FillF>
+void record(FillF fill) noexcept
+{
+	ThreadRing& local = thread_ring;
+	if (state == nullptr || local.busy) {
+		return;
+	}
+	const ErrnoGuard errno_guard;
+	local.busy = true;
+	ensure_flusher(*state);
+
+	if (local.ring == nullptr) {
+		local.ring = acquire_ring(*state);
+	}
+	Ring* ring = local.ring;
+	if (ring != nullptr) {
+		const std::uint64_t head =
+			ring->head.load(std::memory_order_relaxed);
+		const bool full =
+			head - ring->tail.load(std::memory_order_acquire) >=
+			RING_SIZE;
+		Record& rec = full ? local.overflow
+				   : ring->slots.at(head % RING_SIZE);
+		if (not fill(rec)) {
+			ring->lost.fetch_add(1, std::memory_order_relaxed);
+		} else {
+			const std::uint64_t hash = hash_record(rec);
+			std::uint64_t& recent =
+				ring->recent.at(hash % RECENT_SIZE);
+			if (recent == hash) {
+				// Published before
+			} else if (full) {
+				ring->lost.fetch_add(
+					1, std::memory_order_relaxed
+				);
+			} else {
+				recent = hash;
+				ring->head.store(
+					head + 1, std::memory_order_release
+				);
+			}
+		}
+	}
+	local.busy = false;
+}
+
+void record_path(int dirfd, const char* path, std::uint64_t access, Kind kind)
+{
+	if (path == nullptr || access == 0) {
+		return;
+	}
+	record([&](Record& rec) {
+		rec.access = access;
+		rec.kind = kind;
+		rec.port = 0;
+		return resolve(dirfd, path, rec.path);
+	});
+}
+
+void record_open(int dirfd, const char* path, int flags)
+{
+	if ((flags & O_PATH) != 0) {
+		return;
+	}
+
+	const int mode = flags & O_ACCMODE;
+	std::uint64_t access = 0;
+	if (mode == O_RDONLY || mode == O_RDWR) {
+		access |= FS_READ_FILE;
+	}
+	if (mode == O_WRONLY || mode == O_RDWR) {
+		access |= FS_WRITE_FILE;
+		if ((flags & O_TRUNC) != 0) {
+			access |= FS_TRUNCATE;
+		}
+	}
+
+	if ((flags & O_TMPFILE) == O_TMPFILE) {
+		record_path(dirfd, path, access, Kind::FS);
+	} else if ((flags & O_DIRECTORY) != 0) {
+		record_path(dirfd, path, FS_READ_DIR, Kind::FS);
+	} else {
+		record_path(
+			dirfd,
+			path,
+			access,
+			mode == O_RDONLY ? Kind::FS_PROBE : Kind::FS
+		);
+	}
+
+	// Creation needs access to the directory, even if the file happened
+	// to exist already
+	if ((flags & O_CREAT) != 0) {
+		record_path(dirfd, path, FS_MAKE_REG, Kind::FS_PARENT);
+	}
+}
+
+/**
+ * Record access to the file opened as fd
+ *
+ * Files without a name, e.g. deleted files or memfds, are skipped.
+ */
+void record_fd(int fd, std::uint64_t access)
+{
+	struct stat statbuf {};
+	if (state == nullptr || ::fstat(fd, &statbuf) != 0 ||
+	    not S_ISREG(statbuf.st_mode) || statbuf.st_nlink == 0) {
+		return;
+	}
+	record([&](Record& rec) {
+		rec.access = access;
+		rec.kind = Kind::FS;
+		rec.port = 0;
+		return fd_path(fd, rec.path) != 0;
+	});
+}
+
+/**
+ * Get the type of the file at path relative to dirfd without following
+ * symbolic links
+ *
+ * @return The S_IFMT bits, or 0 if the file does not exist or nothing is
+ * recorded
+ */
+mode_t file_type(int dirfd, const char* path) noexcept
+{
+	if (state == nullptr || thread_ring.busy || path == nullptr) {
+		return 0;
+	}
+	const ErrnoGuard errno_guard;
+	struct stat statbuf {};
+	if (::fstatat(dirfd, path, &statbuf, AT_SYMLINK_NOFOLLOW) != 0) {
+		return 0;
+	}
+	return statbuf.st_mode & S_IFMT;
+}
+
+/**
+ * Get the access needed to create a file of type in a directory
+ */
+std::uint64_t make_access(mode_t type) noexcept
+{
+	switch (type) {
+	case S_IFDIR:
+		return FS_MAKE_DIR;
+	case S_IFLNK:
+		return FS_MAKE_SYM;
+	case S_IFIFO:
+		return FS_MAKE_FIFO;
+	case S_IFSOCK:
+		return FS_MAKE_SOCK;
+	case S_IFCHR:
+		return FS_MAKE_CHAR;
+	case S_IFBLK:
+		return FS_MAKE_BLOCK;
+	default:
+		return FS_MAKE_REG;
+	}
+}
+
+/**
+ * Get the access needed to remove a file of type from a directory
+ */
+std::uint64_t remove_access(mode_t type) noexcept
+{
+	return type == S_IFDIR ? FS_REMOVE_DIR : FS_REMOVE_FILE;
+}
+
+/**
+ * Get the length of the directory part of an absolute path, as parent_of()
+ */
+std::size_t parent_length(const char* path) noexcept
+{
+	std::size_t len = std::strlen(path);
+	while (len > 1 && path[len - 1] == '/') {
+		--len;
+	}
+	while (len > 0 && path[len - 1] != '/') {
+		--len;
+	}
+	return len > 1 ? len - 1 : 1;
+}
+
+/**
+ * Record a new link at newpath to a file of type moved, made by link(2) or
+ * rename(2)
+ *
+ * @param replaced Type of the file newpath referred to before, or 0
+ * @param removed Whether oldpath was removed, i.e. the file was renamed
+ * @param exchanged Whether oldpath and newpath were exchanged
+ */
+void record_link(
+	int olddirfd,
+	const char* oldpath,
+	int newdirfd,
+	const char* newpath,
+	mode_t moved,
+	mode_t replaced,
+	bool removed,
+	bool exchanged
+)
+{
+	if (state == nullptr || thread_ring.busy || oldpath == nullptr ||
+	    newpath == nullptr) {
+		return;
+	}
+	std::array<char, PATH_CAPACITY> old_abs{};
+	std::array<char, PATH_CAPACITY> new_abs{};
+	{
+		const ErrnoGuard errno_guard;
+		if (not resolve(olddirfd, oldpath, old_abs) ||
+		    not resolve(newdirfd, newpath, new_abs)) {
+			return;
+		}
+	}
+
+	// Moving a file to another directory needs FS_REFER on both
+	const std::size_t old_len = parent_length(old_abs.data());
+	const std::uint64_t refer =
+		old_len == parent_length(new_abs.data()) &&
+			std::memcmp(old_abs.data(), new_abs.data(), old_len) ==
+				0
+			? 0
+			: FS_REFER;
+
+	std::uint64_t old_access = refer;
+	std::uint64_t new_access = refer | make_access(moved);
+	if (removed) {
+		old_access |= remove_access(moved);
+	}
+	if (replaced != 0) {
+		new_access |= remove_access(replaced);
+		if (exchanged) {
+			old_access |= make_access(replaced);
+		}
+	}
+	record_path(AT_FDCWD, old_abs.data(), old_access, Kind::FS_PARENT);
+	record_path(AT_FDCWD, new_abs.data(), new_access, Kind::FS_PARENT);
+}
+
+/**
+ * Rename with next, recording the access on success
+ */
+template <typename F>
+int record_rename(
+	int olddirfd,
+	const char* oldpath,
+	int newdirfd,
+	const char* newpath,
+	unsigned int flags,
+	F next
+)
+{
+	// The types are only known before renaming
+	const mode_t moved = file_type(olddirfd, oldpath);
+	const mode_t replaced = file_type(newdirfd, newpath);
+	const int res = next();
+	if (res == 0) {
+		record_link(
+			olddirfd,
+			oldpath,
+			newdirfd,
+			newpath,
+			moved,
+			replaced,
+			true,
+			(flags & RENAME_EXCHANGE) != 0
+		);
+	}
+	return res;
+}
+
+/**
+ * Record access to the TCP port of addr, if sockfd is a TCP socket
+ */
+void record_port(int sockfd, const sockaddr* addr, std::uint64_t access)
+{
+	std::uint16_t port = 0;
+	if (addr->sa_family == AF_INET) {
+		const auto* in = reinterpret_cast<const sockaddr_in*>(addr);
+		port = ntohs(in->sin_port);
+	} else if (addr->sa_family == AF_INET6) {
+		const auto* in6 = reinterpret_cast<const sockaddr_in6*>(addr);
+		port = ntohs(in6->sin6_port);
+	} else {
+		return;
+	}
+
+	int protocol = 0;
+	socklen_t len = sizeof(protocol);
+	if (::getsockopt(sockfd, SOL_SOCKET, SO_PROTOCOL, &protocol, &len) !=
+		    0 ||
+	    protocol != IPPROTO_TCP) {
+		return;
+	}
+
+	record([&](Record& rec) {
+		rec.access = access;
+		rec.kind = Kind::NET;
+		rec.port = port;
+		return true;
+	});
+}
+
+int open_flags(const char* mode)
+{
+	int flags = 0;
+	switch (mode[0]) {
+	case 'r':
+		flags = O_RDONLY;
+		break;
+	case 'w':
+		flags = O_WRONLY | O_CREAT | O_TRUNC;
+		break;
+	case 'a':
+		flags = O_WRONLY | O_CREAT;
+		break;
+	default:
+		return -1;
+	}
+	if (std::strchr(mode, '+') != nullptr) {
+		flags = (flags & ~O_ACCMODE) | O_RDWR;
+	}
+	return flags;
+}
+
+mode_t open_mode(int flags, va_list args)
+{
+	if ((flags & O_CREAT) != 0 || (flags & O_TMPFILE) == O_TMPFILE) {
+		return va_arg(args, mode_t);
+	}
+	return 0;
+}
+
+// --- Initialization ---
+
+void record_image()
+{
+	std::array<char, PATH_CAPACITY> exe{};
+	const ssize_t len =
+		::readlink("/proc/self/exe", exe.data(), exe.size() - 1);
+	if (len > 0) {
+		record_path(AT_FDCWD, exe.data(), FS_EXEC_IMAGE, Kind::FS);
+	}
+	// The path executed, e.g. a script run by the interpreter above
+	// NOLINTNEXTLINE(*-no-int-to-ptr)
+	const auto* execfn =
+		reinterpret_cast<const char*>(::getauxval(AT_EXECFN));
+	if (execfn != nullptr) {
+		record_path(AT_FDCWD, execfn, FS_EXEC_IMAGE, Kind::FS);
+	}
+	if (::access("/etc/ld.so.cache", F_OK) == 0) {
+		record_path(
+			AT_FDCWD, "/etc/ld.so.cache", FS_READ_FILE, Kind::FS
+		);
+	}
+}
+
+[[gnu::constructor]] void init()
+{
+	const char* trace = std::getenv(TRACE_ENV);
+	if (trace == nullptr || trace[0] == '\0') {
+		return;
+	}
+	const int trace_fd = ::open(
+		trace,
+		O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+		S_IRUSR | S_IWUSR
+	);
+	if (trace_fd < 0) {
+		return;
+	}
+
+	auto* st = new (std::nothrow) State;
+	if (st == nullptr) {
+		::close(trace_fd);
+		return;
+	}
+	st->trace_fd = trace_fd;
+
+	// Keep the drain mutex consistent across fork(); the child starts its
+	// own flusher on its first record
+	::pthread_atfork(
+		[] { state->drain_mutex.lock(); },
+		[] { state->drain_mutex.unlock(); },
+		[] {
+			state->drain_mutex.unlock();
+			state->flusher_running.store(false);
+		}
+	);
+	state = st;
+	record_image();
+}
+
+/**
+ * Drain all rings synchronously, e.g. before the process image is replaced
+ */
+void drain_now()
+{
+	if (state != nullptr && not thread_ring.busy) {
+		const ErrnoGuard errno_guard;
+		thread_ring.busy = true;
+		drain(*state);
+		thread_ring.busy = false;
+	}
+}
+
+[[gnu::destructor]] void fini()
+{
+	drain_now();
+}
+} // namespace
+
+// --- Interposed functions ---
+
+// NOLINTBEGIN(*-vararg,*-reserved-identifier,readability-identifier-naming)
+extern "C" {
+int open(const char* path, int flags, ...)
+{
+	static const auto next = real<int (*)(const char*, int, ...)>("open");
+	va_list args;
+	va_start(args, flags);
+	const mode_t mode = open_mode(flags, args);
+	va_end(args);
+	const int res = next(path, flags, mode);
+	if (res >= 0) {
+		record_open(AT_FDCWD, path, flags);
+	}
+	return res;
+}
+
+int open64(const char* path, int flags, ...)
+{
+	static const auto next = real<int (*)(const char*, int, ...)>("open64");
+	va_list args;
+	va_start(args, flags);
+	const mode_t mode = open_mode(flags, args);
+	va_end(args);
+	const int res = next(path, flags, mode);
+	if (res >= 0) {
+		record_open(AT_FDCWD, path, flags);
+	}
+	return res;
+}
+
+int openat(int dirfd, const char* path, int flags, ...)
+{
+	static const auto next =
+		real<int (*)(int, const char*, int, ...)>("openat");
+	va_list args;
+	va_start(args, flags);
+	const mode_t mode = open_mode(flags, args);
+	va_end(args);
+	const int res = next(dirfd, path, flags, mode);
+	if (res >= 0) {
+		record_open(dirfd, path, flags);
+	}
+	return res;
+}
+
+int openat64(int dirfd, const char* path, int flags, ...)
+{
+	static const auto next =
+		real<int (*)(int, const char*, int, ...)>("openat64");
+	va_list args;
+	va_start(args, flags);
+	const mode_t mode = open_mode(flags, args);
+	va_end(args);
+	const int res = next(dirfd, path, flags, mode);
+	if (res >= 0) {
+		record_open(dirfd, path, flags);
+	}
+	return res;
+}
+
+// Called instead of open() by code built with _FORTIFY_SOURCE
+int __open_2(const char* path, int flags)
+{
+	static const auto next = real<int (*)(const char*, int)>("__open_2");
+	const int res = next(path, flags);
+	if (res >= 0) {
+		record_open(AT_FDCWD, path, flags);
+	}
+	return res;
+}
+
+int __open64_2(const char* path, int flags)
+{
+	static const auto next = real<int (*)(const char*, int)>("__open64_2");
+	const int res = next(path, flags);
+	if (res >= 0) {
+		record_open(AT_FDCWD, path, flags);
+	}
+	return res;
+}
+
+int __openat_2(int dirfd, const char* path, int flags)
+{
+	static const auto next =
+		real<int (*)(int, const char*, int)>("__openat_2");
+	const int res = next(dirfd, path, flags);
+	if (res >= 0) {
+		record_open(dirfd, path, flags);
+	}
+	return res;
+}
+
+int __openat64_2(int dirfd, const char* path, int flags)
+{
+	static const auto next =
+		real<int (*)(int, const char*, int)>("__openat64_2");
+	const int res = next(dirfd, path, flags);
+	if (res >= 0) {
+		record_open(dirfd, path, flags);
+	}
+	return res;
+}
+
+int creat(const char* path, mode_t mode)
+{
+	static const auto next = real<int (*)(const char*, mode_t)>("creat");
+	const int res = next(path, mode);
+	if (res >= 0) {
+		record_open(AT_FDCWD, path, O_CREAT | O_WRONLY | O_TRUNC);
+	}
+	return res;
+}
+
+int creat64(const char* path, mode_t mode)
+{
+	static const auto next = real<int (*)(const char*, mode_t)>("creat64");
+	const int res = next(path, mode);
+	if (res >= 0) {
+		record_open(AT_FDCWD, path, O_CREAT | O_WRONLY | O_TRUNC);
+	}
+	return res;
+}
+
+// stdio and dirent open files with internal calls not going through open()
+FILE* fopen(const char* path, const char* mode)
+{
+	static const auto next =
+		real<FILE* (*)(const char*, const char*)>("fopen");
+	FILE* res = next(path, mode);
+	if (res != nullptr && open_flags(mode) >= 0) {
+		record_open(AT_FDCWD, path, open_flags(mode));
+	}
+	return res;
+}
+
+FILE* fopen64(const char* path, const char* mode)
+{
+	static const auto next =
+		real<FILE* (*)(const char*, const char*)>("fopen64");
+	FILE* res = next(path, mode);
+	if (res != nullptr && open_flags(mode) >= 0) {
+		record_open(AT_FDCWD, path, open_flags(mode));
+	}
+	return res;
+}
+
+DIR* opendir(const char* path)
+{
+	static const auto next = real<DIR* (*)(const char*)>("opendir");
+	DIR* res = next(path);
+	if (res != nullptr) {
+		record_path(AT_FDCWD, path, FS_READ_DIR, Kind::FS);
+	}
+	return res;
+}
+
+int mkdir(const char* path, mode_t mode)
+{
+	static const auto next = real<int (*)(const char*, mode_t)>("mkdir");
+	const int res = next(path, mode);
+	if (res == 0) {
+		record_path(AT_FDCWD, path, FS_MAKE_DIR, Kind::FS_PARENT);
+	}
+	return res;
+}
+
+int mkdirat(int dirfd, const char* path, mode_t mode)
+{
+	static const auto next =
+		real<int (*)(int, const char*, mode_t)>("mkdirat");
+	const int res = next(dirfd, path, mode);
+	if (res == 0) {
+		record_path(dirfd, path, FS_MAKE_DIR, Kind::FS_PARENT);
+	}
+	return res;
+}
+
+int rmdir(const char* path)
+{
+	static const auto next = real<int (*)(const char*)>("rmdir");
+	const int res = next(path);
+	if (res == 0) {
+		record_path(AT_FDCWD, path, FS_REMOVE_DIR, Kind::FS_PARENT);
+	}
+	return res;
+}
+
+int unlink(const char* path)
+{
+	static const auto next = real<int (*)(const char*)>("unlink");
+	const int res = next(path);
+	if (res == 0) {
+		record_path(AT_FDCWD, path, FS_REMOVE_FILE, Kind::FS_PARENT);
+	}
+	return res;
+}
+
+int unlinkat(int dirfd, const char* path, int flags)
+{
+	static const auto next =
+		real<int (*)(int, const char*, int)>("unlinkat");
+	const int res = next(dirfd, path, flags);
+	if (res == 0) {
+		record_path(
+			dirfd,
+			path,
+			(flags & AT_REMOVEDIR) != 0 ? FS_REMOVE_DIR
+						    : FS_REMOVE_FILE,
+			Kind::FS_PARENT
+		);
+	}
+	return res;
+}
+
+int rename(const char* oldpath, const char* newpath)
+{
+	static const auto next =
+		real<int (*)(const char*, const char*)>("rename");
+	return record_rename(AT_FDCWD, oldpath, AT_FDCWD, newpath, 0, [&] {
+		return next(oldpath, newpath);
+	});
+}
+
+int renameat(
+	int olddirfd,
+	const char* oldpath,
+	int newdirfd,
+	const char* newpath
+)
+{
+	static const auto next =
+		real<int (*)(int, const char*, int, const char*)>("renameat");
+	return record_rename(olddirfd, oldpath, newdirfd, newpath, 0, [&] {
+		return next(olddirfd, oldpath, newdirfd, newpath);
+	});
+}
+
+int renameat2(
+	int olddirfd,
+	const char* oldpath,
+	int newdirfd,
+	const char* newpath,
+	unsigned int flags
+)
+{
+	static const auto next =
+		real<int (*)(int, const char*, int, const char*, unsigned int)>(
+			"renameat2"
+		);
+	return record_rename(olddirfd, oldpath, newdirfd, newpath, flags, [&] {
+		return next(olddirfd, oldpath, newdirfd, newpath, flags);
+	});
+}
+
+int link(const char* oldpath, const char* newpath)
+{
+	static const auto next =
+		real<int (*)(const char*, const char*)>("link");
+	const int res = next(oldpath, newpath);
+	if (res == 0) {
+		record_link(
+			AT_FDCWD,
+			oldpath,
+			AT_FDCWD,
+			newpath,
+			file_type(AT_FDCWD, newpath),
+			0,
+			false,
+			false
+		);
+	}
+	return res;
+}
+
+int linkat(
+	int olddirfd,
+	const char* oldpath,
+	int newdirfd,
+	const char* newpath,
+	int flags
+)
+{
+	static const auto next =
+		real<int (*)(int, const char*, int, const char*, int)>(
+			"linkat"
+		);
+	const int res = next(olddirfd, oldpath, newdirfd, newpath, flags);
+	if (res == 0) {
+		record_link(
+			olddirfd,
+			oldpath,
+			newdirfd,
+			newpath,
+			file_type(newdirfd, newpath),
+			0,
+			false,
+			false
+		);
+	}
+	return res;
+}
+
+int symlink(const char* target, const char* linkpath)
+{
+	static const auto next =
+		real<int (*)(const char*, const char*)>("symlink");
+	const int res = next(target, linkpath);
+	if (res == 0) {
+		record_path(AT_FDCWD, linkpath, FS_MAKE_SYM, Kind::FS_PARENT);
+	}
+	return res;
+}
+
+int symlinkat(const char* target, int newdirfd, const char* linkpath)
+{
+	static const auto next =
+		real<int (*)(const char*, int, const char*)>("symlinkat");
+	const int res = next(target, newdirfd, linkpath);
+	if (res == 0) {
+		record_path(newdirfd, linkpath, FS_MAKE_SYM, Kind::FS_PARENT);
+	}
+	return res;
+}
+
+int mknod(const char* path, mode_t mode, dev_t dev)
+{
+	static const auto next =
+		real<int (*)(const char*, mode_t, dev_t)>("mknod");
+	const int res = next(path, mode, dev);
+	if (res == 0) {
+		record_path(
+			AT_FDCWD,
+			path,
+			make_access(mode & S_IFMT),
+			Kind::FS_PARENT
+		);
+	}
+	return res;
+}
+
+int mknodat(int dirfd, const char* path, mode_t mode, dev_t dev)
+{
+	static const auto next =
+		real<int (*)(int, const char*, mode_t, dev_t)>("mknodat");
+	const int res = next(dirfd, path, mode, dev);
+	if (res == 0) {
+		record_path(
+			dirfd, path, make_access(mode & S_IFMT), Kind::FS_PARENT
+		);
+	}
+	return res;
+}
+
+int mkfifo(const char* path, mode_t mode)
+{
+	static const auto next = real<int (*)(const char*, mode_t)>("mkfifo");
+	const int res = next(path, mode);
+	if (res == 0) {
+		record_path(AT_FDCWD, path, FS_MAKE_FIFO, Kind::FS_PARENT);
+	}
+	return res;
+}
+
+int mkfifoat(int dirfd, const char* path, mode_t mode)
+{
+	static const auto next =
+		real<int (*)(int, const char*, mode_t)>("mkfifoat");
+	const int res = next(dirfd, path, mode);
+	if (res == 0) {
+		record_path(dirfd, path, FS_MAKE_FIFO, Kind::FS_PARENT);
+	}
+	return res;
+}
+
+int truncate(const char* path, off_t length)
+{
+	static const auto next = real<int (*)(const char*, off_t)>("truncate");
+	const int res = next(path, length);
+	if (res == 0) {
+		record_path(AT_FDCWD, path, FS_TRUNCATE, Kind::FS);
+	}
+	return res;
+}
+
+int truncate64(const char* path, off64_t length)
+{
+	static const auto next =
+		real<int (*)(const char*, off64_t)>("truncate64");
+	const int res = next(path, length);
+	if (res == 0) {
+		record_path(AT_FDCWD, path, FS_TRUNCATE, Kind::FS);
+	}
+	return res;
+}
+
+// Landlock checks FS_TRUNCATE when the file is opened, so the right is
+// recorded for its path
+int ftruncate(int fd, off_t length)
+{
+	static const auto next = real<int (*)(int, off_t)>("ftruncate");
+	const int res = next(fd, length);
+	if (res == 0) {
+		const ErrnoGuard errno_guard;
+		record_fd(fd, FS_TRUNCATE);
+	}
+	return res;
+}
+
+int ftruncate64(int fd, off64_t length)
+{
+	static const auto next = real<int (*)(int, off64_t)>("ftruncate64");
+	const int res = next(fd, length);
+	if (res == 0) {
+		const ErrnoGuard errno_guard;
+		record_fd(fd, FS_TRUNCATE);
+	}
+	return res;
+}
+
+int execve(const char* path, char* const argv[], char* const envp[])
+{
+	static const auto next =
+		real<int (*)(const char*, char* const*, char* const*)>("execve"
+		);
+	drain_now();
+	return next(path, argv, envp);
+}
+
+int execv(const char* path, char* const argv[])
+{
+	static const auto next =
+		real<int (*)(const char*, char* const*)>("execv");
+	drain_now();
+	return next(path, argv);
+}
+
+int execvp(const char* file, char* const argv[])
+{
+	static const auto next =
+		real<int (*)(const char*, char* const*)>("execvp");
+	drain_now();
+	return next(file, argv);
+}
+
+int execvpe(const char* file, char* const argv[], char* const envp[])
+{
+	static const auto next =
+		real<int (*)(const char*, char* const*, char* const*)>("execvpe"
+		);
+	drain_now();
+	return next(file, argv, envp);
+}
+
+int bind(int sockfd, const sockaddr* addr, socklen_t len)
+{
+	static const auto next =
+		real<int (*)(int, const sockaddr*, socklen_t)>("bind");
+	const int res = next(sockfd, addr, len);
+	if (res != 0) {
+		return res;
+	}
+	if (addr->sa_family == AF_UNIX) {
+		// sun_path is not necessarily null-terminated
+		std::array<char, sizeof(sockaddr_un::sun_path) + 1> name{};
+		const auto* un = reinterpret_cast<const sockaddr_un*>(addr);
+		const std::size_t offset = offsetof(sockaddr_un, sun_path);
+		if (len > offset) {
+			const std::size_t size =
+				std::min(len - offset, name.size() - 1);
+			std::memcpy(name.data(), un->sun_path, size);
+		}
+		// Abstract sockets do not create a file
+		if (name[0] != '\0') {
+			record_path(
+				AT_FDCWD,
+				name.data(),
+				FS_MAKE_SOCK,
+				Kind::FS_PARENT
+			);
+		}
+	} else {
+		record_port(sockfd, addr, NET_BIND_TCP);
+	}
+	return res;
+}
+
+int connect(int sockfd, const sockaddr* addr, socklen_t len)
+{
+	static const auto next =
+		real<int (*)(int, const sockaddr*, socklen_t)>("connect");
+	const int res = next(sockfd, addr, len);
+	if (res == 0 || errno == EINPROGRESS) {
+		const ErrnoGuard errno_guard;
+		record_port(sockfd, addr, NET_CONNECT_TCP);
+	}
+	return res;
+}
+}
+// NOLINTEND(*-vararg,*-reserved-identifier,readability-identifier-naming)
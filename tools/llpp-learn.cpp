@@ -0,0 +1,250 @@
+/**
+ * Learn a policy from the accesses of a command
+ *
+ * Runs the command with the llpp-learn interposer preloaded, which records
+ * the files and TCP ports the command and its child processes access, and
+ * writes a compact policy allowing these accesses in the policy file format
+ * (see ll/PolicyFile.hpp). The policy can be passed to llpp-run --policy.
+ *
+ * Only what the command did during the run is allowed, so the run should
+ * exercise all code paths of interest. Review the policy before deploying it.
+ */
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <ll/Policy.hpp>
+#include <ll/PolicyFile.hpp>
+#include <ll/PolicyLearner.hpp>
+
+#ifndef LLPP_LEARN_PRELOAD_PATH
+#define LLPP_LEARN_PRELOAD_PATH "libllpp-learn.so"
+#endif
+
+namespace
+{
+/// Exit status for failures of llpp-learn itself
+constexpr int EXIT_LLPP_FAILURE = 125;
+/// Exit status if the command cannot be executed
+constexpr int EXIT_NOT_EXECUTABLE = 126;
+/// Exit status if the command is not found
+constexpr int EXIT_NOT_FOUND = 127;
+/// Offset of the exit status for commands killed by a signal
+constexpr int EXIT_SIGNAL_BASE = 128;
+
+constexpr const char* PRELOAD_NAME = "libllpp-learn.so";
+
+constexpr std::size_t DEFAULT_COLLAPSE =
+	landlock::PolicyLearner::DEFAULT_COLLAPSE_THRESHOLD;
+
+constexpr const char* USAGE =
+	"Usage: %s [OPTION]... [--] COMMAND [ARG]...\n"
+	"  or:  %s [OPTION]... --trace TRACE...\n"
+	"Learn a policy allowing the accesses of COMMAND.\n"
+	"\n"
+	"  -o, --output FILE     write the policy to FILE instead of stdout\n"
+	"  -c, --collapse N      replace N or more rules beneath a directory\n"
+	"                        by one rule (default %zu, 0: never)\n"
+	"  -k, --keep TRACE      keep the trace of COMMAND in TRACE\n"
+	"  -i, --trace TRACE     learn from an existing trace instead of\n"
+	"                        running a command (may be repeated)\n"
+	"  -h, --help            print this help\n"
+	"\n"
+	"The interposer is looked up in LLPP_LEARN_PRELOAD, next to this\n"
+	"program and in the installation directory.\n";
+
+[[noreturn]] void die(const std::string& message)
+{
+	std::cerr << "llpp-learn: " << message << '\n';
+	std::exit(EXIT_LLPP_FAILURE);
+}
+
+std::string find_preload()
+{
+	if (const char* env = std::getenv("LLPP_LEARN_PRELOAD")) {
+		return env;
+	}
+	std::string exe(PATH_MAX, '\0');
+	const ssize_t len =
+		::readlink("/proc/self/exe", exe.data(), exe.size());
+	if (len > 0) {
+		exe.resize(static_cast<std::size_t>(len));
+		const std::string local =
+			exe.substr(0, exe.rfind('/') + 1) + PRELOAD_NAME;
+		if (::access(local.c_str(), R_OK) == 0) {
+			return local;
+		}
+	}
+	return LLPP_LEARN_PRELOAD_PATH;
+}
+
+/**
+ * Run argv with the interposer writing to trace
+ *
+ * @return The exit status to report for the command
+ */
+int run(char** argv, const std::string& trace)
+{
+	std::string preload = find_preload();
+	if (const char* env = std::getenv("LD_PRELOAD")) {
+		preload = preload + ":" + env;
+	}
+
+	const pid_t pid = ::fork();
+	if (pid < 0) {
+		die(std::string{"fork: "} + std::strerror(errno));
+	}
+	if (pid == 0) {
+		::setenv("LD_PRELOAD", preload.c_str(), 1);
+		::setenv("LLPP_LEARN_TRACE", trace.c_str(), 1);
+		::execvp(argv[0], argv);
+		const int err = errno;
+		std::cerr << "llpp-learn: " << argv[0] << ": "
+			  << std::strerror(err) << '\n';
+		::_exit(err == ENOENT ? EXIT_NOT_FOUND : EXIT_NOT_EXECUTABLE);
+	}
+
+	int status = 0;
+	while (::waitpid(pid, &status, 0) < 0) {
+		if (errno != EINTR) {
+			die(std::string{"waitpid: "} + std::strerror(errno));
+		}
+	}
+	if (WIFSIGNALED(status)) {
+		return EXIT_SIGNAL_BASE + WTERMSIG(status);
+	}
+	return WEXITSTATUS(status);
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+	std::string output;
+	std::string keep;
+	std::vector<std::string> traces;
+	std::size_t collapse = DEFAULT_COLLAPSE;
+
+	// NOLINTBEGIN(*-avoid-c-arrays)
+	const option options[] = {
+		{"output", required_argument, nullptr, 'o'},
+		{"collapse", required_argument, nullptr, 'c'},
+		{"keep", required_argument, nullptr, 'k'},
+		{"trace", required_argument, nullptr, 'i'},
+		{"help", no_argument, nullptr, 'h'},
+		{nullptr, 0, nullptr, 0},
+	};
+	// NOLINTEND(*-avoid-c-arrays)
+
+	int opt = 0;
+	while ((opt = ::getopt_long(argc, argv, "+o:c:k:i:h", options, nullptr)
+	       ) != -1) {
+		switch (opt) {
+		case 'o':
+			output = optarg;
+			break;
+		case 'c': {
+			char* end = nullptr;
+			collapse = std::strtoul(optarg, &end, 10);
+			if (end == optarg || *end != '\0') {
+				die(std::string{"invalid threshold: "} +
+				    optarg);
+			}
+			break;
+		}
+		case 'k':
+			keep = optarg;
+			break;
+		case 'i':
+			traces.emplace_back(optarg);
+			break;
+		case 'h':
+			// NOLINTNEXTLINE(*-vararg)
+			std::printf(USAGE, argv[0], argv[0], DEFAULT_COLLAPSE);
+			return EXIT_SUCCESS;
+		default:
+			return EXIT_LLPP_FAILURE;
+		}
+	}
+	const bool run_command = optind < argc;
+	if (run_command == not traces.empty()) {
+		std::cerr << "llpp-learn: expected either a command or "
+			     "--trace\n";
+		return EXIT_LLPP_FAILURE;
+	}
+
+	int status = EXIT_SUCCESS;
+	std::string temp_trace;
+	if (run_command) {
+		std::string trace = keep;
+		if (trace.empty()) {
+			const char* tmpdir = std::getenv("TMPDIR");
+			trace = tmpdir != nullptr ? tmpdir : "/tmp";
+			trace += "/llpp-learn-XXXXXX";
+			const int trace_fd = ::mkstemp(trace.data());
+			if (trace_fd < 0) {
+				die(std::string{"mkstemp: "} +
+				    std::strerror(errno));
+			}
+			::close(trace_fd);
+			temp_trace = trace;
+		} else if (not std::ofstream{trace, std::ios::trunc}) {
+			die("cannot create " + trace);
+		}
+
+		status = run(argv + optind, trace);
+		traces.push_back(trace);
+	}
+
+	landlock::PolicyLearner learner;
+	for (const std::string& trace : traces) {
+		std::ifstream in{trace};
+		if (not in) {
+			die("cannot open " + trace);
+		}
+		learner.read_trace(in);
+	}
+	if (not temp_trace.empty()) {
+		::unlink(temp_trace.c_str());
+	}
+
+	const std::size_t moved = learner.relocate_missing();
+	const landlock::Policy policy = learner.policy(collapse);
+	if (output.empty()) {
+		landlock::PolicyFile::write(std::cout, policy);
+	} else {
+		std::ofstream out{output};
+		landlock::PolicyFile::write(out, policy);
+		if (not out) {
+			die("cannot write " + output);
+		}
+	}
+
+	const landlock::PolicyLearner::Stats stats = learner.stats();
+	std::cerr << "llpp-learn: " << stats.records << " accesses, "
+		  << policy.path_rules().size() << " path rules, "
+		  << policy.port_rules().size() << " port rules\n";
+	if (moved > 0) {
+		std::cerr << "llpp-learn: " << moved
+			  << " paths no longer exist, allowed their access "
+			     "beneath their parents\n";
+	}
+	if (stats.lost > 0) {
+		std::cerr << "llpp-learn: warning: " << stats.lost
+			  << " accesses were lost, the policy may be "
+			     "incomplete\n";
+	}
+	if (stats.malformed > 0) {
+		std::cerr << "llpp-learn: warning: skipped " << stats.malformed
+			  << " malformed trace lines\n";
+	}
+	return status;
+}
@@ -0,0 +1,225 @@
+/**
+ * Run a command in a Landlock sandbox
+ *
+ * The policy is given on the command line and/or read from policy files (see
+ * ll/PolicyFile.hpp). All filesystem access known at compile time is handled,
+ * so only the paths allowed explicitly are accessible. llpp-run restricts
+ * itself and then replaces itself with the command, so no additional process
+ * is created.
+ */
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <system_error>
+
+#include <getopt.h>
+#include <unistd.h>
+
+#include <ll/ActionType.hpp>
+#include <ll/Backend.hpp>
+#include <ll/Policy.hpp>
+#include <ll/PolicyFile.hpp>
+#include <ll/Ruleset.hpp>
+
+namespace
+{
+/// Exit status for failures of llpp-run itself
+constexpr int EXIT_LLPP_FAILURE = 125;
+/// Exit status if the command cannot be executed
+constexpr int EXIT_NOT_EXECUTABLE = 126;
+/// Exit status if the command is not found
+constexpr int EXIT_NOT_FOUND = 127;
+
+constexpr const char* USAGE =
+	"Usage: %s [OPTION]... [--] COMMAND [ARG]...\n"
+	"Run COMMAND restricted by Landlock.\n"
+	"\n"
+	"  -r, --ro PATH         allow reading and executing beneath PATH\n"
+	"  -w, --rw PATH         allow all filesystem access beneath PATH\n"
+	"  -a, --allow ACTS:PATH allow filesystem actions ACTS beneath PATH\n"
+	"  -b, --bind PORT       allow binding TCP port PORT\n"
+	"  -c, --connect PORT    allow connecting to TCP port PORT\n"
+	"  -n, --no-net          restrict TCP even without allowed ports\n"
+	"  -s, --scope SCOPES    restrict the scopes SCOPES\n"
+	"  -f, --policy FILE     read policy directives from FILE\n"
+	"  -e, --strict          fail if Landlock is not supported\n"
+	"  -t, --timing          print the setup time to stderr\n"
+	"  -h, --help            print this help\n"
+	"\n"
+	"ACTS and SCOPES are comma-separated names as in policy files, e.g.\n"
+	"read_file,read_dir or signal.\n";
+
+using Clock = std::chrono::steady_clock;
+
+double micros(Clock::time_point from, Clock::time_point to)
+{
+	return std::chrono::duration<double, std::micro>(to - from).count();
+}
+
+[[noreturn]] void die(const char* fmt, const char* arg)
+{
+	std::fputs("llpp-run: ", stderr);
+	// NOLINTNEXTLINE(*-vararg)
+	std::fprintf(stderr, fmt, arg);
+	std::fputc('\n', stderr);
+	std::exit(EXIT_LLPP_FAILURE);
+}
+
+void apply_directive(landlock::Policy& policy, const std::string& directive)
+{
+	std::string message;
+	if (not landlock::PolicyFile::apply(directive, policy, message)) {
+		die("invalid argument: %s", message.c_str());
+	}
+}
+
+void read_policy(landlock::Policy& policy, const char* path)
+{
+	std::ifstream in{path};
+	if (not in) {
+		die("cannot open policy file %s", path);
+	}
+	landlock::PolicyFileError error;
+	if (not landlock::PolicyFile::read(in, policy, error)) {
+		const std::string msg = std::string{path} + ":" +
+					std::to_string(error.line) + ": " +
+					error.message;
+		die("%s", msg.c_str());
+	}
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+	const Clock::time_point start = Clock::now();
+
+	landlock::Policy policy;
+	policy.handle(*landlock::PolicyFile::fs_actions("all"));
+
+	bool strict = false;
+	bool timing = false;
+
+	// NOLINTBEGIN(*-avoid-c-arrays)
+	const option options[] = {
+		{"ro", required_argument, nullptr, 'r'},
+		{"rw", required_argument, nullptr, 'w'},
+		{"allow", required_argument, nullptr, 'a'},
+		{"bind", required_argument, nullptr, 'b'},
+		{"connect", required_argument, nullptr, 'c'},
+		{"no-net", no_argument, nullptr, 'n'},
+		{"scope", required_argument, nullptr, 's'},
+		{"policy", required_argument, nullptr, 'f'},
+		{"strict", no_argument, nullptr, 'e'},
+		{"timing", no_argument, nullptr, 't'},
+		{"help", no_argument, nullptr, 'h'},
+		{nullptr, 0, nullptr, 0},
+	};
+	// NOLINTEND(*-avoid-c-arrays)
+
+	int opt = 0;
+	while ((opt = ::getopt_long(
+			argc, argv, "+r:w:a:b:c:ns:f:eth", options, nullptr
+		)) != -1) {
+		const std::string arg = optarg != nullptr ? optarg : "";
+		switch (opt) {
+		case 'r':
+			apply_directive(policy, "path ro " + arg);
+			break;
+		case 'w':
+			apply_directive(policy, "path all " + arg);
+			break;
+		case 'a': {
+			const std::size_t sep = arg.find(':');
+			if (sep == std::string::npos) {
+				die("expected ACTS:PATH, got %s", optarg);
+			}
+			apply_directive(
+				policy,
+				"path " + arg.substr(0, sep) + " " +
+					arg.substr(sep + 1)
+			);
+			break;
+		}
+		case 'b':
+			apply_directive(policy, "handle net all");
+			apply_directive(policy, "port bind_tcp " + arg);
+			break;
+		case 'c':
+			apply_directive(policy, "handle net all");
+			apply_directive(policy, "port connect_tcp " + arg);
+			break;
+		case 'n':
+			apply_directive(policy, "handle net all");
+			break;
+		case 's':
+			apply_directive(policy, "scope " + arg);
+			break;
+		case 'f':
+			read_policy(policy, optarg);
+			break;
+		case 'e':
+			strict = true;
+			break;
+		case 't':
+			timing = true;
+			break;
+		case 'h':
+			// NOLINTNEXTLINE(*-vararg)
+			std::printf(USAGE, argv[0]);
+			return EXIT_SUCCESS;
+		default:
+			// NOLINTNEXTLINE(*-vararg)
+			std::fprintf(stderr, USAGE, argv[0]);
+			return EXIT_LLPP_FAILURE;
+		}
+	}
+	if (optind >= argc) {
+		// NOLINTNEXTLINE(*-vararg)
+		std::fprintf(stderr, USAGE, argv[0]);
+		return EXIT_LLPP_FAILURE;
+	}
+	const Clock::time_point parsed = Clock::now();
+
+	std::error_code ec;
+	const auto ruleset = policy.build(landlock::Backend::system(), ec);
+	if (ec) {
+		die("cannot build ruleset: %s", ec.message().c_str());
+	}
+	if (strict && not ruleset->active()) {
+		die("%s",
+		    ruleset->landlock_enabled()
+			    ? "no handled access is supported by the kernel"
+			    : "Landlock is not supported");
+	}
+	const Clock::time_point built = Clock::now();
+
+	ruleset->enforce(true, ec);
+	if (ec) {
+		die("cannot enforce ruleset: %s", ec.message().c_str());
+	}
+	const Clock::time_point enforced = Clock::now();
+
+	if (timing) {
+		// NOLINTNEXTLINE(*-vararg)
+		std::fprintf(
+			stderr,
+			"llpp-run: parse %.1f us, build %.1f us, enforce %.1f "
+			"us, total %.1f us\n",
+			micros(start, parsed),
+			micros(parsed, built),
+			micros(built, enforced),
+			micros(start, enforced)
+		);
+	}
+
+	::execvp(argv[optind], argv + optind);
+	const int err = errno;
+	std::fprintf(
+		stderr, "llpp-run: %s: %s\n", argv[optind], std::strerror(err)
+	);
+	return err == ENOENT ? EXIT_NOT_FOUND : EXIT_NOT_EXECUTABLE;
+}